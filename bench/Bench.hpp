@@ -0,0 +1,174 @@
+// Bench.hpp
+// Minimal benchmark harness: timing, allocation counting and JSON output
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace bench {
+
+// Allocation counters, fed by the operator new replacement in the bench
+// executable
+struct AllocCounters {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> bytes{0};
+};
+
+inline AllocCounters& allocs() {
+  static AllocCounters c;
+  return c;
+}
+
+enum class Kind { Micro, Macro };
+
+struct Case {
+  std::string name;
+  Kind kind;
+  // Runs one iteration; setup that must not be timed belongs outside
+  std::function<void()> run;
+};
+
+struct Result {
+  std::string name;
+  Kind kind;
+  uint64_t iterations = 0;  // per sample
+  double medianNs = 0;      // per iteration
+  double minNs = 0;
+  double maxNs = 0;
+  double allocsPerIter = 0;
+  double bytesPerIter = 0;
+};
+
+inline std::vector<Case>& registry() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+inline void add(std::string name, Kind kind, std::function<void()> run) {
+  registry().push_back({std::move(name), kind, std::move(run)});
+}
+
+// Keep the optimizer from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Options {
+  double sampleSeconds = 0.1;  // target time of one sample
+  int samples = 7;
+  std::string filter;
+};
+
+inline Result measure(const Case& c, const Options& opt) {
+  using clock = std::chrono::steady_clock;
+  Result r;
+  r.name = c.name;
+  r.kind = c.kind;
+
+  // Calibrate iterations per sample (macro cases run at least once)
+  uint64_t iters = 1;
+  for (;;) {
+    auto t0 = clock::now();
+    for (uint64_t i = 0; i < iters; ++i)
+      c.run();
+    double s = std::chrono::duration<double>(clock::now() - t0).count();
+    if (s >= opt.sampleSeconds * 0.5 || iters >= (uint64_t(1) << 30))
+      break;
+    iters *= s > 0 ? std::clamp<uint64_t>(
+                         uint64_t(opt.sampleSeconds / s), 2, 100)
+                   : 100;
+  }
+  r.iterations = iters;
+
+  std::vector<double> ns;
+  const uint64_t a0 = allocs().count.load(), b0 = allocs().bytes.load();
+  for (int s = 0; s < opt.samples; ++s) {
+    auto t0 = clock::now();
+    for (uint64_t i = 0; i < iters; ++i)
+      c.run();
+    ns.push_back(std::chrono::duration<double, std::nano>(clock::now() - t0)
+                     .count() /
+                 double(iters));
+  }
+  const double total = double(iters) * opt.samples;
+  r.allocsPerIter = double(allocs().count.load() - a0) / total;
+  r.bytesPerIter = double(allocs().bytes.load() - b0) / total;
+
+  std::sort(ns.begin(), ns.end());
+  r.medianNs = ns[ns.size() / 2];
+  r.minNs = ns.front();
+  r.maxNs = ns.back();
+  return r;
+}
+
+inline void writeJson(FILE* f, const std::vector<Result>& results) {
+  std::fprintf(f, "{\n  \"schema\": \"gearlab-bench-1\",\n");
+#if defined(__clang__)
+  std::fprintf(f, "  \"compiler\": \"clang %s\",\n", __clang_version__);
+#elif defined(__GNUC__)
+  std::fprintf(f, "  \"compiler\": \"gcc %s\",\n", __VERSION__);
+#endif
+#ifdef NDEBUG
+  std::fprintf(f, "  \"assertions\": false,\n");
+#else
+  std::fprintf(f, "  \"assertions\": true,\n");
+#endif
+  std::fprintf(f, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    std::fprintf(f,
+                 "    {\"name\": \"%s\", \"kind\": \"%s\", "
+                 "\"iterations\": %llu, \"median_ns\": %.3f, "
+                 "\"min_ns\": %.3f, \"max_ns\": %.3f, "
+                 "\"allocs_per_iter\": %.3f, \"bytes_per_iter\": %.1f}%s\n",
+                 r.name.c_str(), r.kind == Kind::Micro ? "micro" : "macro",
+                 (unsigned long long)r.iterations, r.medianNs, r.minNs,
+                 r.maxNs, r.allocsPerIter, r.bytesPerIter,
+                 i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+}
+
+// Scratch file under TMPDIR (or /tmp), unique to this process and removed
+// when the object is destroyed. Cases keep theirs in a static so the file
+// lives until the bench exits.
+class TempFile {
+public:
+  explicit TempFile(const std::string& name) {
+    const char* dir = std::getenv("TMPDIR");
+    fullPath = std::string(dir && *dir ? dir : "/tmp") + "/gearlab_bench_" +
+               std::to_string(getpid()) + "_" + name;
+  }
+  ~TempFile() { std::remove(fullPath.c_str()); }
+
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+
+  const char* path() const { return fullPath.c_str(); }
+
+private:
+  std::string fullPath;
+};
+
+}  // namespace bench
+
+namespace bench {
+
+// Registers a case at static initialisation, one per benchmark source file
+struct Registrar {
+  Registrar(std::string name, Kind kind, std::function<void()> run) {
+    add(std::move(name), kind, std::move(run));
+  }
+};
+
+}  // namespace bench
@@ -0,0 +1,22 @@
+// ReferenceDesigns.hpp
+// Benchmark inputs: the reference designs of assets/CAD, same parameter sets
+// as tests/test_gearparams.cpp
+#pragma once
+
+#include "../src/geometry/GearParams.hpp"
+
+namespace bench {
+
+// assets/CAD/Gear_1.FCStd, 9-11 ratio
+inline BevelGearPair gear1() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                       60, 20);
+}
+
+// assets/CAD/Gear_2.FCStd, 9-14 ratio
+inline BevelGearPair gear2() {
+  return BevelGearPair(14, 9, 4.77651, 0.1, 1.5, 90, 65, 45, 1.2, 0, 24.0405,
+                       60, 20);
+}
+
+}  // namespace bench
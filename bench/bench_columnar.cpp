@@ -0,0 +1,53 @@
+// bench_columnar.cpp
+// Columnar store: writing rows with curves, and selective queries that the
+// chunk statistics prune
+
+#include <cmath>
+#include <vector>
+
+#include "../src/io/ColumnarStore.hpp"
+#include "Bench.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const bench::TempFile columnarFile("columnar.glrc");
+
+// 100k designs with a 64 sample transmission error curve each
+void writeStore() {
+  ColumnarStoreWriter writer(
+      columnarFile.path(), {{"design"}, {"score"}, {"te", ColumnKind::Array}});
+  std::vector<double> te(64);
+  for (int64_t i = 0; i < 100000; ++i) {
+    for (size_t k = 0; k < te.size(); ++k)
+      te[k] = 12.5 * std::sin(0.1 * double(k) + 1e-5 * double(i));
+    const double row[2] = {double(i), double((i * 7919) % 10007)};
+    const ArrayValue curve{te.data(), te.size()};
+    writer.addRow(row, &curve);
+  }
+  writer.close();
+}
+
+Registrar write("io.columnar.write100k", Kind::Macro, [] { writeStore(); });
+
+// One design range: most chunks are skipped or taken whole by statistics
+Registrar selectRange("io.columnar.selectRange100k", Kind::Macro, [] {
+  static const bool written = (writeStore(), true);
+  (void)written;
+  static const ColumnarResultTable table(columnarFile.path());
+  bench::doNotOptimize(
+      table.select({{0, 20000, 30000}}, ThreadPool::shared()).rows.size());
+});
+
+// A scattered column: every chunk is decoded
+Registrar selectScan("io.columnar.selectScan100k", Kind::Macro, [] {
+  static const bool written = (writeStore(), true);
+  (void)written;
+  static const ColumnarResultTable table(columnarFile.path());
+  bench::doNotOptimize(
+      table.select({{1, 0, 5000}}, ThreadPool::shared()).rows.size());
+});
+
+}  // namespace
@@ -0,0 +1,24 @@
+// bench_contactmesh.cpp
+// FE mesh stage: unloaded TCA and the contact zone refined mesh
+
+#include "../src/analysis/ContactMesh.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+Registrar contact("femesh.tca.gear2", Kind::Micro, [] {
+  static const UnloadedTca tca(bench::gear2());
+  bench::doNotOptimize(tca.contact(0).size());
+});
+
+// Mesh at the default sizes, as exported for a load step
+Registrar build("femesh.build.gear2", Kind::Macro, [] {
+  static const ContactZoneMesher mesher{UnloadedTca(bench::gear2())};
+  bench::doNotOptimize(mesher.build().nodes());
+});
+
+}  // namespace
@@ -0,0 +1,30 @@
+// bench_draft.cpp
+// Draft stage: surface mesh and demouldability check of a moulded gear
+
+#include "../src/manufacturing/Draft.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+DraftOptions boredGear() {
+  DraftOptions opt;
+  opt.surface.boreRadius = 6;
+  return opt;
+}
+
+// Full check as run while the form is edited: mesh, parting plane, raster
+Registrar full("draft.run.gear1", Kind::Macro, [] {
+  const DraftAnalysis analysis(bench::gear1().makeGear(), boredGear());
+  bench::doNotOptimize(analysis.run().undercutArea);
+});
+
+Registrar surface("draft.surface.gear1", Kind::Micro, [] {
+  static const GearSurface s(bench::gear1().makeGear());
+  bench::doNotOptimize(s.build().size());
+});
+
+}  // namespace
@@ -0,0 +1,42 @@
+// bench_dynamics.cpp
+// Dynamics stage: run-up speed sweeps of the torsional mesh model
+
+#include "../src/analysis/GearDynamics.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+BevelGearPair spiralGear2() {
+  BevelGearPair p = bench::gear2();
+  p.spiralAngle = 30;
+  p.computeDerivedValues();
+  return p;
+}
+
+// Bare gear blanks: resonance far above the sweep, step size set by the
+// natural period
+Registrar runUpBare("dynamics.runUp400.bareBlanks", Kind::Macro, [] {
+  static const GearDynamics dyn(spiralGear2());
+  static const std::vector<double> speeds =
+      GearDynamics::speedRange(0, 10000, 400);
+  bench::doNotOptimize(dyn.run(speeds).dynamicFactor.back());
+});
+
+// Heavy rotors: resonance inside the sweep
+Registrar runUpRotors("dynamics.runUp400.heavyRotors", Kind::Macro, [] {
+  static const GearDynamics dyn = [] {
+    DynamicsInputs in;
+    in.pinionInertia = 200;
+    in.gearInertia = 2000;
+    return GearDynamics(spiralGear2(), in);
+  }();
+  static const std::vector<double> speeds =
+      GearDynamics::speedRange(0, 10000, 400);
+  bench::doNotOptimize(dyn.run(speeds).dynamicFactor.back());
+});
+
+}  // namespace
@@ -0,0 +1,42 @@
+// bench_gearbox.cpp
+// Gearbox stage: two stage trains analysed as variants that share meshes
+
+#include <vector>
+
+#include "../src/pipeline/Gearbox.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+// Reference 2 as the first stage of every variant, reference 1 with one of
+// four spiral angles as the second: 16 trains, 5 distinct meshes
+const std::vector<Gearbox>& variants() {
+  static const std::vector<Gearbox> v = [] {
+    std::vector<Gearbox> boxes;
+    for (int i = 0; i < 16; ++i) {
+      BevelGearPair second = bench::gear1();
+      second.spiralAngle = 10.0 * (i % 4);
+      Gearbox box;
+      box.shafts = {{"input", {0, 0, 0}, {1, 0, 0}},
+                    {"intermediate", {0, 0, 0}, {0, 0, 1}},
+                    {"output", {0, 0, 150}, {0, 1, 0}}};
+      box.stages = {{bench::gear2(), true, {-80, 80, 1}, {-70, 70, 1}},
+                    {second, true, {210, 60, -1}, {-75, 75, 1}}};
+      boxes.push_back(box);
+    }
+    return boxes;
+  }();
+  return v;
+}
+
+Registrar variants16("gearbox.variants16", Kind::Macro, [] {
+  static const LoadSpectrum spectrum = {{120, 1500, 2000}, {250, 800, 200}};
+  bench::doNotOptimize(
+      analyseGearboxes(variants(), spectrum).variants[15].tePeakToPeak);
+});
+
+}  // namespace
@@ -0,0 +1,58 @@
+// bench_gearfit.cpp
+// Gear fit stage: bevel gear parameters from a scan of the teeth
+
+#include "../src/analysis/GearFit.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+// Flanks, tip and root lands of every tooth at 0.2 mm spacing, with the
+// apex up the axis of a rotary table
+const PointCloud& scan() {
+  static const PointCloud cloud = [] {
+    const ToothFlank f(bench::gear2().makeGear());
+    RigidTransform machine =
+        RigidTransform::rotationAbout(Vec3(0.002, -0.001, 0.3));
+    machine.translation = Vec3(0.05, -0.03, 25);
+    PointCloud c;
+    const int face = int((f.outerR() - f.innerR()) / 0.2);
+    for (int k = 0; k < f.numTeeth(); ++k) {
+      for (int i = 0; i < face; ++i) {
+        const double R =
+            f.innerR() + (f.outerR() - f.innerR()) * (i + 0.5) / face;
+        for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+          for (int j = 0; j < 40; ++j) {
+            const Vec3 p = f.point(side, R, (j + 0.5) / 40);
+            c.push_back(machine.apply(f.onTooth(p, k)));
+          }
+        }
+        for (double gamma : {f.tipAngle(R), f.rootAngle(R)}) {
+          const double w = f.halfWidth(gamma);
+          for (int j = 0; j < 8; ++j) {
+            const double phi = gamma == f.tipAngle(R)
+                                   ? w * (j - 3.5) / 4
+                                   : w + (f.pitchAngle() - 2 * w) *
+                                             (j + 0.5) / 8;
+            const Vec3 p(R * sin(gamma) * cos(phi),
+                         R * sin(gamma) * sin(phi), R * cos(gamma));
+            c.push_back(machine.apply(f.onTooth(p, k)));
+          }
+        }
+      }
+    }
+    return c;
+  }();
+  return cloud;
+}
+
+Registrar run("gearfit.run.gear2", Kind::Macro, [] {
+  GearFitOptions opt;
+  opt.backlash = 0.1;
+  bench::doNotOptimize(GearFit(opt).fit(scan()).rms);
+});
+
+}  // namespace
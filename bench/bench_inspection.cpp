@@ -0,0 +1,55 @@
+// bench_inspection.cpp
+// Inspection stage: closest nominal flank point and a registered CMM scan
+
+#include "../src/analysis/FlankDeviation.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const FlankInspection& inspection() {
+  static const FlankInspection i(bench::gear1().makeGear());
+  return i;
+}
+
+// Scan of every flank, 0.2 mm spacing, off the gear frame like on a CMM
+const PointCloud& scan() {
+  static const PointCloud cloud = [] {
+    const ToothFlank& f = inspection().toothFlank();
+    RigidTransform machine =
+        RigidTransform::rotationAbout(Vec3(0.002, 0.001, -0.004));
+    machine.translation = Vec3(0.03, -0.02, 0.05);
+    PointCloud c;
+    const int face = int((f.outerR() - f.innerR()) / 0.2);
+    for (int k = 0; k < f.numTeeth(); ++k) {
+      for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+        for (int i = 0; i < face; ++i) {
+          const double R =
+              f.innerR() + (f.outerR() - f.innerR()) * (i + 0.5) / face;
+          for (int j = 0; j < 40; ++j) {
+            const Vec3 p = f.point(side, R, (j + 0.5) / 40);
+            c.push_back(machine.apply(f.onTooth(p, k)));
+          }
+        }
+      }
+    }
+    return c;
+  }();
+  return cloud;
+}
+
+Registrar closest("inspection.closest.gear1", Kind::Micro, [] {
+  const ToothFlank& f = inspection().toothFlank();
+  const Vec3 p = f.point(FlankSide::Right, 0.5 * (f.innerR() + f.outerR()),
+                         0.4) + Vec3(0.01, 0, 0);
+  bench::doNotOptimize(inspection().closest(p).deviation);
+});
+
+Registrar run("inspection.run.gear1", Kind::Macro, [] {
+  bench::doNotOptimize(inspection().inspect(scan()).onFlank);
+});
+
+}  // namespace
@@ -0,0 +1,71 @@
+// bench_main.cpp
+// Entry point of the gearlab_bench executable. Cases register themselves
+// from the bench_*.cpp files; results are printed as JSON.
+//
+// Usage: gearlab_bench [--filter=substring] [--out=file.json] [--quick]
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "Bench.hpp"
+
+// Count every heap allocation made by the benchmarked code
+void* operator new(std::size_t size) {
+  bench::allocs().count.fetch_add(1, std::memory_order_relaxed);
+  bench::allocs().bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+  bench::Options opt;
+  std::string outPath;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0) {
+      opt.filter = arg.substr(9);
+    } else if (arg.rfind("--out=", 0) == 0) {
+      outPath = arg.substr(6);
+    } else if (arg == "--quick") {
+      opt.sampleSeconds = 0.01;
+      opt.samples = 3;
+    } else {
+      std::cerr << "Usage: gearlab_bench [--filter=substring] "
+                   "[--out=file.json] [--quick]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<bench::Result> results;
+  for (const bench::Case& c : bench::registry()) {
+    if (!opt.filter.empty() && c.name.find(opt.filter) == std::string::npos)
+      continue;
+    bench::Result r = bench::measure(c, opt);
+    std::cerr << r.name << ": " << r.medianNs << " ns/iter, "
+              << r.allocsPerIter << " allocs/iter" << std::endl;
+    results.push_back(r);
+  }
+
+  FILE* f = outPath.empty() ? stdout : std::fopen(outPath.c_str(), "w");
+  if (!f) {
+    std::cerr << "Cannot write " << outPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  bench::writeJson(f, results);
+  if (f != stdout)
+    std::fclose(f);
+  return EXIT_SUCCESS;
+}
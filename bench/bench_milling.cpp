@@ -0,0 +1,35 @@
+// bench_milling.cpp
+// Milling stage: toolpath planning and G-code output for every tooth space
+
+#include <cstdio>
+
+#include "../src/manufacturing/Milling.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const MillingPlanner& planner() {
+  static const MillingPlanner p = [] {
+    BevelGearPair pair = bench::gear2();
+    pair.spiralAngle = 30;
+    pair.computeDerivedValues();
+    return MillingPlanner(pair.makeGear());
+  }();
+  return p;
+}
+
+Registrar plan("milling.planToothSpace.ball", Kind::Macro, [] {
+  bench::doNotOptimize(planner().planToothSpace().points.size());
+});
+
+Registrar gcode("milling.writeGcode.ball", Kind::Macro, [] {
+  const char* path = "bench_milling.nc";
+  bench::doNotOptimize(planner().writeGcode(path).bytes);
+  std::remove(path);
+});
+
+}  // namespace
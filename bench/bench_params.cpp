@@ -0,0 +1,118 @@
+// bench_params.cpp
+// Gear pair parameter stage: construction, lazy edits, inverse solve,
+// gradients, TOML, autosave
+
+#include <sstream>
+
+#include "../src/geometry/InverseSolver.hpp"
+#include "../src/geometry/PairFields.hpp"
+#include "../src/geometry/PairGradient.hpp"
+#include "../src/geometry/ParamGraph.hpp"
+#include "../src/io/Autosave.hpp"
+#include "../src/io/ParamsToml.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+Registrar constructGear1("params.construct.gear1", Kind::Micro, [] {
+  bench::doNotOptimize(bench::gear1());
+});
+
+Registrar constructGear2("params.construct.gear2", Kind::Micro, [] {
+  bench::doNotOptimize(bench::gear2());
+});
+
+Registrar makeGearPinion("params.makeGearPinion.gear1", Kind::Micro, [] {
+  static const BevelGearPair pair = bench::gear1();
+  bench::doNotOptimize(pair.makeGear());
+  bench::doNotOptimize(pair.makePinion());
+});
+
+// Alternate a field so every iteration invalidates and recomputes
+Registrar lazyBacklash("params.lazy.editBacklash", Kind::Micro, [] {
+  static LazyBevelGearPair lazy(bench::gear1());
+  static bool flip = false;
+  flip = !flip;
+  lazy.set(&BevelGearPair::backlash, flip ? 0.2 : 0.1);
+  bench::doNotOptimize(lazy.pair().pinionRootConeOffset);
+});
+
+Registrar lazyFaceCone("params.lazy.editFaceConeAngle", Kind::Micro, [] {
+  static LazyBevelGearPair lazy(bench::gear1());
+  static bool flip = false;
+  flip = !flip;
+  lazy.set(&BevelGearPair::faceConeAngle, flip ? 61.0 : 60.0);
+  bench::doNotOptimize(lazy.pair().pinionRootConeOffset);
+});
+
+Registrar inverseBatch("params.inverse.batch4096", Kind::Macro, [] {
+  static const BevelGearPair ref = bench::gear2();
+  static const ConeTargets targets = [] {
+    ConeTargets t;
+    for (int i = 0; i < 4096; ++i) {
+      double s = i / 4096.0;
+      t.push_back(ref.addendum + 0.8 * s, ref.dedendum - 0.5 * s,
+                  ref.pinionAddendum - 0.7 * s, ref.pinionDedendum + s);
+    }
+    return t;
+  }();
+  static const InverseConeSolver solver(ref);
+  bench::doNotOptimize(solver.solve(targets).faceConeAngle.back());
+});
+
+Registrar gradientDual("params.gradient.dual.gear2", Kind::Micro, [] {
+  static const BevelGearPair pair = bench::gear2();
+  bench::doNotOptimize(pairGradient(pair).d[3][4]);
+});
+
+// Baseline: one forward difference reconstruction per input
+Registrar gradientFd("params.gradient.finiteDiff.gear2", Kind::Micro, [] {
+  static const BevelGearPair pair = bench::gear2();
+  double sum = 0;
+  for (const char* input : PairGradient::inputs) {
+    double x = 0;
+    BevelGearPair p = pair;
+    PairFieldUtils::get(p, input, x);
+    PairFieldUtils::set(p, input, x + 1e-6);
+    sum += (PairFieldUtils::recompute(p).addendum - pair.addendum) / 1e-6;
+  }
+  bench::doNotOptimize(sum);
+});
+
+Registrar tomlExport("io.toml.export", Kind::Micro, [] {
+  static const BevelGearPair pair = bench::gear1();
+  static const BevelGear gear = pair.makeGear(), pinion = pair.makePinion();
+  std::ostringstream out;
+  writeParamsToml(out, "bench", "/tmp", gear, pinion);
+  bench::doNotOptimize(out.str().size());
+});
+
+Registrar tomlImport("io.toml.import", Kind::Micro, [] {
+  static const std::string text = [] {
+    const BevelGearPair pair = bench::gear1();
+    std::ostringstream out;
+    writeParamsToml(out, "bench", "/tmp", pair.makeGear(), pair.makePinion());
+    return out.str();
+  }();
+  std::istringstream in(text);
+  bench::doNotOptimize(pairFromParams(readParamsToml(in)).addendum);
+});
+
+// UI thread cost of an edit: snapshot and queue, the write is coalesced
+// away on the autosave thread
+Registrar autosaveEdit("io.autosave.schedule", Kind::Micro, [] {
+  static AutosaveService service;
+  static const BevelGearPair pair = bench::gear1();
+  static const BevelGear gear = pair.makeGear(), pinion = pair.makePinion();
+  const BevelGear g = gear, p = pinion;
+  service.schedule("gearlab_bench_autosave.toml",
+                   [g, p](std::ostream& out) {
+                     writeParamsToml(out, "bench", "/tmp", g, p);
+                   });
+});
+
+}  // namespace
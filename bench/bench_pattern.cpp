@@ -0,0 +1,27 @@
+// bench_pattern.cpp
+// Pattern stage: the marking test set of contact patterns, both flanks
+
+#include <vector>
+
+#include "../src/analysis/ContactPattern.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+// Reference 2 with a 30 deg spiral, nominal and H/V +-0.05 mm: 10 patterns
+// of 96 x 48 cells over 128 roll positions
+Registrar markingSet("pattern.markingSet.gear2", Kind::Macro, [] {
+  static const ContactPatternAnalysis analysis = [] {
+    BevelGearPair pair = bench::gear2();
+    pair.spiralAngle = 30;
+    return ContactPatternAnalysis(pair);
+  }();
+  const std::vector<ContactPattern> set = analysis.run(markingTestCases());
+  bench::doNotOptimize(set.back().centreU);
+});
+
+}  // namespace
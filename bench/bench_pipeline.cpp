@@ -0,0 +1,95 @@
+// bench_pipeline.cpp
+// Scheduler overhead, sweeps and the result store
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "../src/io/ResultQuery.hpp"
+#include "../src/pipeline/Pipeline.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+Registrar pipelineSingle("pipeline.pair.gear1", Kind::Micro, [] {
+  static const BevelGearPair pair = bench::gear1();
+  bench::doNotOptimize(runPairPipeline(pair).valid);
+});
+
+std::vector<BevelGearPair> sweepDesigns(size_t n) {
+  std::vector<BevelGearPair> designs;
+  designs.reserve(n);
+  const BevelGearPair ref = bench::gear1();
+  for (size_t i = 0; i < n; ++i) {
+    BevelGearPair p = ref;
+    p.faceConeAngle = 58 + 4.0 * i / n;
+    designs.push_back(p);
+  }
+  return designs;
+}
+
+Registrar sweep10k("pipeline.sweep.10k", Kind::Macro, [] {
+  static const std::vector<BevelGearPair> designs = sweepDesigns(10000);
+  bench::doNotOptimize(runPairSweep(designs).size());
+});
+
+const bench::TempFile storeFile("store.glr");
+
+Registrar storeWrite("io.resultStore.write100k", Kind::Macro, [] {
+  ResultStoreWriter writer(storeFile.path(), {"a", "b", "c", "d"});
+  double row[4];
+  for (int i = 0; i < 100000; ++i) {
+    row[0] = i;
+    row[1] = (i * 7919) % 10007;
+    row[2] = i * 0.5;
+    row[3] = -i;
+    writer.addRow(row);
+  }
+  writer.finish();
+});
+
+Registrar storeQuery("io.resultStore.sortFilter100k", Kind::Macro, [] {
+  static const bool written = [] {
+    ResultStoreWriter writer(storeFile.path(), {"a", "b"});
+    for (int i = 0; i < 100000; ++i) {
+      double row[2] = {double(i), double((i * 7919) % 10007)};
+      writer.addRow(row);
+    }
+    writer.finish();
+    return true;
+  }();
+  (void)written;
+  static const MappedResultTable table(storeFile.path());
+  ResultQuery q;
+  q.filterColumn = 1;
+  q.filterMax = 8000;
+  q.sortColumn = 1;
+  bench::doNotOptimize(runResultQuery(table, q, ThreadPool::shared()).size());
+});
+
+// Two competing objectives over a scattered 100k catalog
+Registrar storePareto("io.resultStore.pareto100k", Kind::Macro, [] {
+  static const bench::TempFile file("pareto.glr");
+  static const bool written = [] {
+    ResultStoreWriter writer(file.path(), {"a", "b"});
+    for (int64_t i = 0; i < 100000; ++i) {
+      double row[2] = {double((i * 7919) % 10007),
+                       double((i * 104729) % 10009)};
+      writer.addRow(row);
+    }
+    writer.finish();
+    return true;
+  }();
+  (void)written;
+  static const MappedResultTable table(file.path());
+  bench::doNotOptimize(
+      runParetoQuery(table, {{0, true}, {1, false}}, nullptr,
+                     ThreadPool::shared())
+          .size());
+});
+
+}  // namespace
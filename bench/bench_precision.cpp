@@ -0,0 +1,50 @@
+// bench_precision.cpp
+// Float previews against double results: pair equations, flank points and
+// the surface mesh of the same gear
+
+#include "../src/geometry/GearSurface.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+template <typename T>
+void pairEquations() {
+  static const BevelGearPair pair = bench::gear2();
+  static const PairInputs<T> in = pairInputs<T>(pair);
+  bench::doNotOptimize(
+      derivePair(pair.numGearTeeth, pair.numPinionTeeth, in).addendum);
+}
+
+// 64 x 32 grid on one flank, as a preview samples it
+template <typename T>
+void flankGrid() {
+  static const BasicToothFlank<T> f(bench::gear1().makeGear());
+  T sum = 0;
+  for (int i = 0; i < 64; ++i) {
+    const T R = f.innerR() + (f.outerR() - f.innerR()) * i / 63;
+    for (int j = 0; j < 32; ++j)
+      sum += f.point(FlankSide::Right, R, T(j) / 31).z;
+  }
+  bench::doNotOptimize(sum);
+}
+
+template <typename T>
+void surface() {
+  static const BasicGearSurface<T> s(bench::gear1().makeGear());
+  bench::doNotOptimize(s.build().size());
+}
+
+Registrar pairDouble("precision.pair.double", Kind::Micro,
+                     pairEquations<double>);
+Registrar pairFloat("precision.pair.float", Kind::Micro, pairEquations<float>);
+Registrar flankDouble("precision.flank.double", Kind::Micro, flankGrid<double>);
+Registrar flankFloat("precision.flank.float", Kind::Micro, flankGrid<float>);
+Registrar surfaceDouble("precision.surface.double", Kind::Micro,
+                        surface<double>);
+Registrar surfaceFloat("precision.surface.float", Kind::Micro, surface<float>);
+
+}  // namespace
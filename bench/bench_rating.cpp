@@ -0,0 +1,47 @@
+// bench_rating.cpp
+// Load rating stage: batched pitting and bending rating of design sweeps
+
+#include <vector>
+
+#include "../src/analysis/LoadRating.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const LoadSpectrum& spectrum() {
+  static const LoadSpectrum s = {
+      {50, 3000, 5000}, {120, 1500, 2000}, {250, 800, 200}, {400, 300, 5}};
+  return s;
+}
+
+// Spiral angle / module grid around reference 2
+RatingInputs grid(size_t n) {
+  RatingInputs in;
+  in.reserve(n);
+  BevelGearPair p = bench::gear2();
+  for (size_t i = 0; i < n; ++i) {
+    p.spiralAngle = 35.0 * (i % 100) / 100;
+    p.module = 4 + (i / 100 % 100) * 0.01;
+    p.computeDerivedValues();
+    in.push_back(p);
+  }
+  return in;
+}
+
+Registrar single("rating.single.gear2", Kind::Micro, [] {
+  static const LoadRating rating;
+  static const BevelGearPair pair = bench::gear2();
+  bench::doNotOptimize(rating.rate(pair, spectrum()).pittingSafety1[0]);
+});
+
+Registrar batch("rating.batch1M", Kind::Macro, [] {
+  static const LoadRating rating;
+  static const RatingInputs in = grid(1 << 20);
+  bench::doNotOptimize(rating.rate(in, spectrum()).bendingSafety1.back());
+});
+
+}  // namespace
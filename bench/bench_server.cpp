@@ -0,0 +1,75 @@
+// bench_server.cpp
+// Latency of parameter queries through the compute service: warm from the
+// cache, cold through the kernels, and a full Unix socket round trip
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../src/io/UnixSocketServer.hpp"
+#include "../src/pipeline/ComputeService.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const std::string query =
+    "{\"jsonrpc\":\"2.0\",\"method\":\"compute\",\"params\":"
+    "{\"faceConeAngle\":61},\"id\":1}";
+
+Registrar warm("server.compute.warm", Kind::Micro, [] {
+  static ComputeService service(bench::gear1());
+  bench::doNotOptimize(service.handle(query).size());
+});
+
+// A new design every call, so every query misses the cache
+Registrar cold("server.compute.cold", Kind::Micro, [] {
+  static ComputeService service(bench::gear1(), [] {
+    ComputeServiceOptions o;
+    o.cacheBytes = 0;
+    return o;
+  }());
+  bench::doNotOptimize(service.handle(query).size());
+});
+
+// Client side of a warm query over the socket, server in this process
+Registrar socketWarm("server.socket.warm", Kind::Micro, [] {
+  struct Fixture {
+    std::string path =
+        "/tmp/gearlab_bench_" + std::to_string(getpid()) + ".sock";
+    ComputeService service{bench::gear1()};
+    UnixSocketServer server{
+        path, [this](const std::string& l) { return service.handle(l); }};
+    std::thread loop{[this] { server.serve(); }};
+    int fd = -1;
+    Fixture() {
+      fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      std::strcpy(addr.sun_path, path.c_str());
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    ~Fixture() {
+      close(fd);
+      server.stop();
+      loop.join();
+    }
+  };
+  static Fixture f;
+  static const std::string line = query + "\n";
+  send(f.fd, line.data(), line.size(), 0);
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(f.fd, buf, sizeof(buf), 0)) > 0 && buf[n - 1] != '\n') {
+  }
+  bench::doNotOptimize(n);
+});
+
+}  // namespace
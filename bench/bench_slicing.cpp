@@ -0,0 +1,31 @@
+// bench_slicing.cpp
+// Slicing stage: layer contours straight from the analytic gear
+
+#include "../src/manufacturing/Slicing.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+const ContourSlicer& slicer() {
+  static const ContourSlicer s = [] {
+    BevelGearPair pair = bench::gear2();
+    pair.spiralAngle = 30;
+    pair.computeDerivedValues();
+    SliceOptions opt;
+    opt.boreRadius = 8;
+    return ContourSlicer(pair.makeGear(), opt);
+  }();
+  return s;
+}
+
+// One layer through teeth and rim
+Registrar layer("slicing.layer.mid", Kind::Micro, [] {
+  const ContourSlicer& s = slicer();
+  bench::doNotOptimize(s.slice(s.layerZ(s.layerCount() / 2)).contours.size());
+});
+
+}  // namespace
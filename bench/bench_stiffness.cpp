@@ -0,0 +1,40 @@
+// bench_stiffness.cpp
+// Tooth stiffness stage: building the reduced-order model and evaluating it
+
+#include "../src/analysis/ToothStiffness.hpp"
+#include "Bench.hpp"
+#include "ReferenceDesigns.hpp"
+
+namespace {
+
+using bench::Kind;
+using bench::Registrar;
+
+BevelGearPair spiralGear2() {
+  BevelGearPair p = bench::gear2();
+  p.spiralAngle = 30;
+  p.computeDerivedValues();
+  return p;
+}
+
+Registrar build("stiffness.build.gear2", Kind::Macro, [] {
+  static const BevelGearPair pair = spiralGear2();
+  bench::doNotOptimize(ToothStiffnessModel(pair).engagement());
+});
+
+Registrar meshStiffness("stiffness.meshStiffness.gear2", Kind::Micro, [] {
+  static const ToothStiffnessModel model(spiralGear2());
+  static double a = 0;
+  a += 0.37;
+  bench::doNotOptimize(model.meshStiffness(a));
+});
+
+Registrar loadDistribution("stiffness.loadDistribution.gear2", Kind::Micro,
+                           [] {
+  static const ToothStiffnessModel model(spiralGear2());
+  static const std::vector<double> tilt(model.options().faceSlices, 0.001);
+  bench::doNotOptimize(
+      model.loadDistribution(model.engagement() / 2, 1500, tilt).front());
+});
+
+}  // namespace
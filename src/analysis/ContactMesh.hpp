@@ -0,0 +1,474 @@
+// ContactMesh.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+#include "UnloadedTca.hpp"
+
+// Hexahedral FE mesh of one member, fine where the unloaded TCA puts the
+// contact and at the roots of the teeth that carry, coarse everywhere else.
+//
+// Every pitch sector is a rim block under the root cone, split in azimuth
+// into half a tooth space, the tooth and half the next space, with the tooth
+// block on top from the root to the tip cone. A sector is a tensor product of
+// 1D grids graded from a size field: the zone size inside a refinement zone,
+// growing by the growth ratio away from it, capped at coarseSize. The face
+// (R) and rim depth grids are shared by all sectors so neighbours meet node
+// to node and the mesh is conforming; the profile, thickness and space grids
+// are refined per tooth. Sectors are graded and filled in parallel.
+//
+// Elements are 8 node bricks in Abaqus C3D8 node order, ordered by sector.
+
+struct FeMeshOptions {
+  double contactSize = 0.1;  // Element edge in the contact zones (mm)
+  double filletSize = 0.25;  // At the roots of loaded teeth
+  double coarseSize = 2.0;   // Everywhere else
+  double growth = 1.3;       // Size ratio of neighbouring elements
+  double margin = 0.5;       // Around the marking zones, for growth under load
+  double rimThickness = 0;   // Below the root (mm), 0 for one whole depth
+                             // or half way to the axis at the toe
+  std::vector<double> rotations = {0};  // Member rotations to resolve (deg)
+};
+
+struct FeMesh {
+  std::vector<double> x, y, z;
+  std::vector<uint32_t> hex;            // 8 node ids per element
+  std::vector<int> tooth;               // Pitch sector of each element
+  std::vector<uint32_t> fixed;          // Nodes on the rim bottom
+  std::vector<uint32_t> flankElements;  // With a face on a loaded flank
+  int flankFace = 2;                    // C3D8 face of those elements
+  std::vector<int> loadedTeeth;
+  size_t uniformNodes = 0;  // Same mesh at contactSize throughout
+  double contactSize = 0;   // Used in the contact zones, coarser than asked
+                            // when the job budget is tight
+
+  size_t nodes() const { return x.size(); }
+  size_t elements() const { return tooth.size(); }
+  Vec3 node(size_t i) const { return {x[i], y[i], z[i]}; }
+
+  static size_t bytesPerNode() { return 3 * sizeof(double); }
+  static size_t bytesPerElement() {
+    return 8 * sizeof(uint32_t) + sizeof(int);
+  }
+};
+
+class ContactZoneMesher {
+public:
+  explicit ContactZoneMesher(const UnloadedTca& analysis,
+                             FeMeshOptions options = {})
+      : tca(analysis), opt(options) {
+    const ToothFlank& f = tca.toothFlank();
+    const BevelGear& g = f.gear();
+    const double toe = f.innerR() * f.rootAngle(f.innerR());
+    rim = opt.rimThickness > 0 ? opt.rimThickness
+                               : std::min(g.addendum + g.dedendum, toe / 2);
+    if (opt.contactSize <= 0 || opt.filletSize <= 0 ||
+        opt.coarseSize < std::max(opt.contactSize, opt.filletSize) ||
+        opt.growth <= 1 || opt.margin < 0 ||
+        rim >= toe) {
+      throw std::invalid_argument("Invalid FE mesh options");
+    }
+    filletZone = g.dedendum / 2;
+    for (double r : opt.rotations) {
+      for (const ContactZone& z : tca.contact(r)) {
+        if (z.marks())
+          zones.push_back(z);
+      }
+    }
+
+    // Sector dimensions at mid face (mm)
+    const double Rm = (f.innerR() + f.outerR()) / 2;
+    const double root = f.rootAngle(Rm);
+    const double thickness = f.azimuth(FlankSide::Right, Rm, root) -
+                             f.azimuth(FlankSide::Left, Rm, root);
+    faceLength = f.outerR() - f.innerR();
+    profileLength = Rm * (f.tipAngle(Rm) - root);
+    toothWidth = Rm * sin(root) * thickness;
+    spaceWidth = Rm * sin(root) * (f.pitchAngle() - thickness) / 2;
+  }
+
+  const UnloadedTca& analysis() const { return tca; }
+
+  // Marking zones the mesh resolves, over all rotations
+  const std::vector<ContactZone>& contactZones() const { return zones; }
+
+  // Under a job budget that cannot hold the mesh the contact and fillet
+  // sizes are doubled, up to coarseSize, until it fits; if the coarsest mesh
+  // does not fit either, this throws memory::BudgetExceeded
+  FeMesh build(ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("femesh.build");
+    double contact = opt.contactSize, fillet = opt.filletSize;
+    Layout g = layout(contact, fillet, pool);
+    const memory::Budget* budget = memory::currentBudget();
+    while (budget && !budget->fits(g.bytes()) &&
+           std::min(contact, fillet) < opt.coarseSize) {
+      contact = std::min(2 * contact, opt.coarseSize);
+      fillet = std::min(2 * fillet, opt.coarseSize);
+      g = layout(contact, fillet, pool);
+    }
+    if (g.nodes >= UINT32_MAX)
+      throw std::runtime_error("FE mesh exceeds 2^32 nodes");
+
+    memory::Reservation held =
+        memory::Reservation::require(memory::Category::Mesh, g.bytes());
+    FeMesh m;
+    for (const Sector& s : g.sectors) {
+      if (s.loaded)
+        m.loadedTeeth.push_back(int(&s - g.sectors.data()));
+    }
+    m.x.resize(g.nodes);
+    m.y.resize(g.nodes);
+    m.z.resize(g.nodes);
+    m.hex.resize(8 * g.elements);
+    m.tooth.resize(g.elements);
+    m.fixed.resize(g.fixed);
+    m.flankElements.resize(g.flankElements);
+    m.flankFace = tca.options().side == FlankSide::Right ? 2 : 1;
+    m.uniformNodes = uniformNodes();
+    m.contactSize = contact;
+    pool.parallelFor(0, g.sectors.size(), [&](size_t k) {
+      fillSector(int(k), g.R, g.depth, g.sectors, m);
+    });
+    return m;
+  }
+
+  // Node count of the same layout with contactSize everywhere
+  size_t uniformNodes() const {
+    auto n = [&](double L, int minCells) {
+      return grade(L, {}, minCells, opt.contactSize).size();
+    };
+    const size_t nR = n(faceLength, 1), nD = n(rim, 1);
+    const size_t nU = n(profileLength, 2), nW = n(toothWidth, 2);
+    const size_t owned = 2 * (n(spaceWidth, 1) - 1) + nW - 1;
+    return tca.toothFlank().numTeeth() *
+           (nR * nD * owned + nR * (nU - 1) * nW);
+  }
+
+private:
+  struct Zone {
+    double lo, hi, size;  // mm along the grid
+  };
+
+  // Grid parameters in [0, 1] of one pitch sector. Rim columns run from the
+  // left sector edge over the left space, the tooth (w) and the right space;
+  // the last column belongs to the next sector.
+  struct Sector {
+    std::vector<double> u, w, left, right;
+    bool loaded = false;
+    size_t nodes = 0, elements = 0, flank = 0;
+    size_t firstNode = 0, firstElement = 0, firstFixed = 0, firstFlank = 0;
+
+    size_t columns() const {
+      return left.size() + w.size() + right.size() - 2;
+    }
+  };
+
+  // Parameters in [0, 1] of a grid over L (mm): zone size inside each zone,
+  // growing by the growth ratio away from it, at most cap
+  std::vector<double> grade(double L, const std::vector<Zone>& zones,
+                            int minCells, double cap) const {
+    auto size = [&](double x) {
+      double h = cap;
+      for (const Zone& z : zones) {
+        const double d = std::max({z.lo - x, x - z.hi, 0.0});
+        h = std::min(h, z.size + (opt.growth - 1) * d);
+      }
+      return h;
+    };
+    std::vector<double> x{0};
+    while (x.back() < L) {
+      const double h = size(x.back());
+      x.push_back(std::min(L, x.back() + std::min(h, size(x.back() + h))));
+    }
+    // A sliver at the end is merged into its neighbour
+    const size_t n = x.size();
+    if (n > 2 && x[n - 1] - x[n - 2] < 0.5 * (x[n - 2] - x[n - 3]))
+      x.erase(x.end() - 2);
+    if (int(x.size()) - 1 < minCells) {
+      x.resize(minCells + 1);
+      for (int i = 0; i <= minCells; ++i)
+        x[i] = L * i / minCells;
+    }
+    for (double& v : x)
+      v /= L;
+    return x;
+  }
+
+  // Face and depth grids and the graded sectors with their offsets into the
+  // mesh, for the given contact and fillet zone sizes
+  struct Layout {
+    std::vector<double> R, depth;
+    std::vector<Sector> sectors;
+    size_t nodes = 0, elements = 0, fixed = 0, flankElements = 0;
+
+    size_t bytes() const {
+      return nodes * FeMesh::bytesPerNode() +
+             elements * FeMesh::bytesPerElement();
+    }
+  };
+
+  Layout layout(double contact, double fillet, ThreadPool& pool) const {
+    const ToothFlank& f = tca.toothFlank();
+    const int teeth = f.numTeeth();
+    const double Ri = f.innerR();
+    Layout g;
+
+    std::vector<Zone> along;
+    for (const ContactZone& z : zones) {
+      along.push_back({z.minR - Ri - opt.margin, z.maxR - Ri + opt.margin,
+                       contact});
+    }
+    g.R = grade(faceLength, along, 1, opt.coarseSize);
+    for (double& r : g.R)
+      r = Ri + r * faceLength;
+    std::vector<Zone> below;
+    if (!zones.empty())
+      below.push_back({rim - filletZone, rim, fillet});
+    g.depth = grade(rim, below, 1, opt.coarseSize);
+
+    g.sectors.resize(teeth);
+    pool.parallelFor(0, size_t(teeth), [&](size_t k) {
+      gradeSector(int(k), g.R.size(), g.depth.size(), contact, fillet,
+                  g.sectors[k]);
+    });
+    for (Sector& s : g.sectors) {
+      s.firstNode = g.nodes;
+      s.firstElement = g.elements;
+      s.firstFixed = g.fixed;
+      s.firstFlank = g.flankElements;
+      g.nodes += s.nodes;
+      g.elements += s.elements;
+      g.fixed += g.R.size() * (s.columns() - 1);
+      g.flankElements += s.flank;
+    }
+    return g;
+  }
+
+  void gradeSector(int k, size_t nR, size_t nD, double contact,
+                   double fillet, Sector& s) const {
+    std::vector<Zone> profile, across, left, right;
+    double depth = 0;
+    for (const ContactZone& z : zones) {
+      if (z.tooth != k)
+        continue;
+      s.loaded = true;
+      profile.push_back({z.minU * profileLength - opt.margin,
+                         z.maxU * profileLength + opt.margin,
+                         contact});
+      depth = std::max(depth, z.width + opt.margin);
+    }
+    if (s.loaded) {
+      // Subsurface of the loaded flank, then both root fillets
+      if (tca.options().side == FlankSide::Right)
+        across.push_back({toothWidth - depth, toothWidth, contact});
+      else
+        across.push_back({0, depth, contact});
+      across.push_back({0, filletZone, fillet});
+      across.push_back({toothWidth - filletZone, toothWidth, fillet});
+      profile.push_back({0, filletZone, fillet});
+      left.push_back({spaceWidth - filletZone, spaceWidth, fillet});
+      right.push_back({0, filletZone, fillet});
+    }
+    s.u = grade(profileLength, profile, 2, opt.coarseSize);
+    s.w = grade(toothWidth, across, 2, opt.coarseSize);
+    s.left = grade(spaceWidth, left, 1, opt.coarseSize);
+    s.right = grade(spaceWidth, right, 1, opt.coarseSize);
+
+    const size_t owned = s.columns() - 1, nU = s.u.size(), nW = s.w.size();
+    s.nodes = nR * nD * owned + nR * (nU - 1) * nW;
+    s.elements = (nR - 1) * (nD - 1) * owned + (nR - 1) * (nU - 1) * (nW - 1);
+    s.flank = s.loaded ? (nR - 1) * (nU - 1) : 0;
+  }
+
+  void fillSector(int k, const std::vector<double>& R,
+                  const std::vector<double>& depth,
+                  const std::vector<Sector>& sectors, FeMesh& m) const {
+    const ToothFlank& f = tca.toothFlank();
+    const Sector& s = sectors[k];
+    const Sector& next = sectors[(k + 1) % sectors.size()];
+    const size_t nR = R.size(), nD = depth.size(), nA = s.columns();
+    const size_t nL = s.left.size() - 1, nU = s.u.size(), nW = s.w.size();
+    const size_t rimNodes = nR * nD * (nA - 1);
+    const double turn = k * f.pitchAngle();
+
+    auto rimId = [&](size_t i, size_t d, size_t a) {
+      if (a == nA - 1)
+        return uint32_t(next.firstNode + (i * nD + d) * (next.columns() - 1));
+      return uint32_t(s.firstNode + (i * nD + d) * (nA - 1) + a);
+    };
+    auto toothId = [&](size_t i, size_t j, size_t l) {
+      if (j == 0)
+        return rimId(i, nD - 1, nL + l);
+      return uint32_t(s.firstNode + rimNodes + (i * (nU - 1) + j - 1) * nW +
+                      l);
+    };
+    auto put = [&](uint32_t id, double r, double gamma, double phi) {
+      m.x[id] = r * sin(gamma) * cos(phi + turn);
+      m.y[id] = r * sin(gamma) * sin(phi + turn);
+      m.z[id] = r * cos(gamma);
+    };
+
+    for (size_t i = 0; i < nR; ++i) {
+      const double r = R[i], root = f.rootAngle(r);
+      const double aL = f.azimuth(FlankSide::Left, r, root);
+      const double aR = f.azimuth(FlankSide::Right, r, root);
+      const double eL = (aL + aR - f.pitchAngle()) / 2;
+      const double eR = eL + f.pitchAngle();
+      for (size_t a = 0; a + 1 < nA; ++a) {
+        const double phi =
+            a <= nL ? eL + s.left[a] * (aL - eL)
+            : a < nL + nW ? aL + s.w[a - nL] * (aR - aL)
+                          : aR + s.right[a - nL - nW + 1] * (eR - aR);
+        for (size_t d = 0; d < nD; ++d)
+          put(rimId(i, d, a), r, root - (1 - depth[d]) * rim / r, phi);
+        m.fixed[s.firstFixed + i * (nA - 1) + a] = rimId(i, 0, a);
+      }
+      for (size_t j = 1; j < nU; ++j) {
+        const double gamma = f.polarAngle(r, s.u[j]);
+        const double l0 = f.azimuth(FlankSide::Left, r, gamma);
+        const double l1 = f.azimuth(FlankSide::Right, r, gamma);
+        for (size_t l = 0; l < nW; ++l)
+          put(toothId(i, j, l), r, gamma, l0 + s.w[l] * (l1 - l0));
+      }
+    }
+
+    // Bricks over (R, depth or profile, azimuth), right handed like the
+    // spherical (r, polar, azimuth) frame
+    size_t e = s.firstElement;
+    auto brick = [&](auto id, size_t i, size_t v, size_t a) {
+      uint32_t* h = &m.hex[8 * e];
+      h[0] = id(i, v, a);
+      h[1] = id(i + 1, v, a);
+      h[2] = id(i + 1, v + 1, a);
+      h[3] = id(i, v + 1, a);
+      h[4] = id(i, v, a + 1);
+      h[5] = id(i + 1, v, a + 1);
+      h[6] = id(i + 1, v + 1, a + 1);
+      h[7] = id(i, v + 1, a + 1);
+      m.tooth[e++] = k;
+    };
+    for (size_t i = 0; i + 1 < nR; ++i) {
+      for (size_t d = 0; d + 1 < nD; ++d) {
+        for (size_t a = 0; a + 1 < nA; ++a)
+          brick(rimId, i, d, a);
+      }
+    }
+    const size_t flankLayer =
+        tca.options().side == FlankSide::Right ? nW - 2 : 0;
+    size_t flank = s.firstFlank;
+    for (size_t i = 0; i + 1 < nR; ++i) {
+      for (size_t j = 0; j + 1 < nU; ++j) {
+        for (size_t l = 0; l + 1 < nW; ++l) {
+          if (s.loaded && l == flankLayer)
+            m.flankElements[flank++] = uint32_t(e);
+          brick(toothId, i, j, l);
+        }
+      }
+    }
+  }
+
+  UnloadedTca tca;
+  FeMeshOptions opt;
+  std::vector<ContactZone> zones;
+  double rim = 0, filletZone = 0;
+  double faceLength = 0, profileLength = 0, toothWidth = 0, spaceWidth = 0;
+};
+
+namespace feexport {
+
+// Abaqus input deck of a mesh: nodes, C3D8 elements in ELSET GEAR, ELSET
+// TOOTH_k per sector, NSET FIXED on the rim bottom and SURFACE FLANK on the
+// loaded flanks. Ids are 1-based. Node and element lines are formatted in
+// parallel blocks and appended in order through a temporary file. Returns
+// the bytes written.
+inline size_t writeInp(const std::string& path, const FeMesh& m,
+                       ThreadPool& pool = ThreadPool::shared()) {
+  GEARLAB_TRACE_SCOPE("femesh.write");
+  const std::string tmp = path + ".tmp";
+  FILE* out = std::fopen(tmp.c_str(), "wb");
+  if (!out)
+    throw std::runtime_error("Cannot write " + tmp);
+  size_t bytes = 0;
+  bool ok = true;
+  auto put = [&](const std::string& text) {
+    ok = ok && std::fwrite(text.data(), 1, text.size(), out) == text.size();
+    bytes += text.size();
+  };
+  // count lines formatted by line(i, buffer) into blocks
+  auto lines = [&](size_t count, auto line) {
+    constexpr size_t perBlock = 8192;
+    const size_t blocks = (count + perBlock - 1) / perBlock;
+    const size_t batch = std::max<size_t>(1, pool.size() * 4);
+    std::vector<std::string> text(batch);
+    for (size_t first = 0; ok && first < blocks; first += batch) {
+      const size_t n = std::min(batch, blocks - first);
+      pool.parallelFor(0, n, [&](size_t b) {
+        char buf[192];
+        const size_t lo = (first + b) * perBlock;
+        const size_t hi = std::min(count, lo + perBlock);
+        text[b].clear();
+        for (size_t i = lo; i < hi; ++i)
+          text[b].append(buf, line(i, buf));
+      });
+      for (size_t b = 0; b < n; ++b)
+        put(text[b]);
+    }
+  };
+  auto ids = [&](const std::vector<uint32_t>& v) {
+    std::string text;
+    for (size_t i = 0; i < v.size(); ++i) {
+      text += std::to_string(v[i] + 1);
+      text += i + 1 == v.size() || i % 16 == 15 ? "\n" : ", ";
+    }
+    put(text);
+  };
+
+  put("*HEADING\nGearLab contact zone mesh\n*NODE\n");
+  lines(m.nodes(), [&](size_t i, char* buf) {
+    return size_t(std::snprintf(buf, 192, "%zu, %.9g, %.9g, %.9g\n", i + 1,
+                                m.x[i], m.y[i], m.z[i]));
+  });
+  put("*ELEMENT, TYPE=C3D8, ELSET=GEAR\n");
+  lines(m.elements(), [&](size_t e, char* buf) {
+    const uint32_t* h = &m.hex[8 * e];
+    return size_t(std::snprintf(
+        buf, 192, "%zu, %u, %u, %u, %u, %u, %u, %u, %u\n", e + 1, h[0] + 1,
+        h[1] + 1, h[2] + 1, h[3] + 1, h[4] + 1, h[5] + 1, h[6] + 1,
+        h[7] + 1));
+  });
+  // Sectors are contiguous
+  for (size_t first = 0; first < m.elements();) {
+    size_t last = first;
+    while (last + 1 < m.elements() && m.tooth[last + 1] == m.tooth[first])
+      ++last;
+    put("*ELSET, ELSET=TOOTH_" + std::to_string(m.tooth[first]) +
+        ", GENERATE\n" + std::to_string(first + 1) + ", " +
+        std::to_string(last + 1) + ", 1\n");
+    first = last + 1;
+  }
+  put("*NSET, NSET=FIXED\n");
+  ids(m.fixed);
+  if (!m.flankElements.empty()) {
+    put("*ELSET, ELSET=FLANK_ELEMENTS\n");
+    ids(m.flankElements);
+    put("*SURFACE, TYPE=ELEMENT, NAME=FLANK\nFLANK_ELEMENTS, S" +
+        std::to_string(m.flankFace) + "\n");
+  }
+  ok = std::fclose(out) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("Failed to write " + path);
+  }
+  return bytes;
+}
+
+}  // namespace feexport
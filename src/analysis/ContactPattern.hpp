@@ -0,0 +1,226 @@
+// ContactPattern.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../io/Heatmap.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+#include "UnloadedTca.hpp"
+
+// Contact patterns as a marking test leaves them, accumulated from the
+// unloaded TCA over one mesh cycle on a (cone distance x profile) grid of
+// the flank. At every roll position each tooth in engagement marks the cells
+// where its gap to the mate stays below the marking compound thickness. One
+// mesh cycle over all teeth is one tooth over its whole engagement, so a
+// cell's marking time is in mesh cycles and may exceed 1.
+//
+// The unloaded TCA has no pressures, so the compound squeezed out of a cell,
+// marking compound - gap, stands in for contact pressure: it is what makes
+// a mark dark on the shop floor. Roll positions are split into chunks that
+// accumulate private grids on the pool and are summed afterwards.
+
+struct ContactPatternOptions {
+  int faceCells = 96;       // Grid columns, inner to outer cone distance
+  int profileCells = 48;    // Grid rows, root (u = 0) to tip (u = 1)
+  int rollPositions = 128;  // Per mesh cycle
+};
+
+// One set of mounting errors to mark under
+struct ContactPatternCase {
+  std::string name;
+  TcaMisalignment misalignment;
+};
+
+// Pattern of one flank under one case. Cells are row major, row 0 at the
+// root and column 0 at the inner cone distance (toe).
+struct ContactPattern {
+  std::string name;  // Of the case
+  FlankSide side = FlankSide::Right;
+  int faceCells = 0, profileCells = 0;
+  double innerR = 0, outerR = 0;
+  std::vector<float> time;     // Mesh cycles the cell marks for
+  std::vector<float> squeeze;  // Compound squeezed out (mm), cycle mean
+  double markedShare = 0;      // Of the cells that mark at all
+  // Time weighted centre of the pattern
+  double centreR = 0, centreU = 0;
+
+  size_t cell(int column, int row) const {
+    return size_t(row) * faceCells + column;
+  }
+  double cellR(int column) const {
+    return innerR + (outerR - innerR) * (column + 0.5) / faceCells;
+  }
+  double cellU(int row) const { return (row + 0.5) / profileCells; }
+};
+
+class ContactPatternAnalysis {
+public:
+  ContactPatternAnalysis(const BevelGearPair& pair, bool pinion = false,
+                         TcaOptions tca = {}, ContactPatternOptions opt = {})
+      : pair(pair), pinion(pinion), tca(tca), opt(opt) {
+    if (opt.faceCells < 1 || opt.profileCells < 1 || opt.rollPositions < 1)
+      throw std::invalid_argument("Invalid contact pattern options");
+  }
+
+  // Patterns of both flanks under every case, drive side (right) first
+  std::vector<ContactPattern> run(
+      const std::vector<ContactPatternCase>& cases,
+      ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("pattern.run");
+    std::vector<ContactPattern> out(2 * cases.size());
+    pool.parallelFor(0, out.size(), [&](size_t i) {
+      const FlankSide side = i % 2 ? FlankSide::Left : FlankSide::Right;
+      out[i] = pattern(side, cases[i / 2], pool);
+    });
+    return out;
+  }
+
+  // Pattern of one flank under one case
+  ContactPattern pattern(FlankSide side, const ContactPatternCase& c,
+                         ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("pattern.flank");
+    TcaOptions o = tca;
+    o.side = side;
+    o.misalignment = c.misalignment;
+    const UnloadedTca t(pair, pinion, o);
+    const ToothFlank& f = t.toothFlank();
+
+    ContactPattern p;
+    p.name = c.name;
+    p.side = side;
+    p.faceCells = opt.faceCells;
+    p.profileCells = opt.profileCells;
+    p.innerR = f.innerR();
+    p.outerR = f.outerR();
+    const size_t cells = size_t(opt.faceCells) * opt.profileCells;
+
+    // Involute arc of every cell centre and the active profile per column
+    std::vector<double> psi(cells), lo(opt.faceCells), hi(opt.faceCells);
+    for (int col = 0; col < opt.faceCells; ++col) {
+      const double R = p.cellR(col);
+      lo[col] = t.activeLo(R);
+      hi[col] = t.activeHi(R);
+      for (int row = 0; row < opt.profileCells; ++row)
+        psi[p.cell(col, row)] =
+            f.involuteArc(f.polarAngle(R, p.cellU(row)));
+    }
+
+    // Private grids per chunk of roll positions
+    constexpr int rollsPerChunk = 8;
+    const int chunks =
+        (opt.rollPositions + rollsPerChunk - 1) / rollsPerChunk;
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             size_t(chunks) * cells * 2 * sizeof(float));
+    std::vector<std::vector<float>> time(chunks), squeeze(chunks);
+    const double cycle = t.meshCycle(), marking = o.markingCompound;
+    pool.parallelFor(0, size_t(chunks), [&](size_t ch) {
+      std::vector<float>& tc = time[ch];
+      std::vector<float>& sc = squeeze[ch];
+      tc.assign(cells, 0.0f);
+      sc.assign(cells, 0.0f);
+      const int end =
+          std::min(opt.rollPositions, int(ch + 1) * rollsPerChunk);
+      for (int r = int(ch) * rollsPerChunk; r < end; ++r) {
+        const double rotation = cycle * r / opt.rollPositions;
+        const double te = t.transmissionErrorMm(rotation);
+        for (int k = 0; k < f.numTeeth(); ++k) {
+          for (int col = 0; col < opt.faceCells; ++col) {
+            const double R = p.cellR(col);
+            const double c = t.contactArc(k, rotation, R);
+            if (c < lo[col] || c > hi[col])
+              continue;
+            for (int row = 0; row < opt.profileCells; ++row) {
+              const size_t i = p.cell(col, row);
+              if (psi[i] < lo[col] || psi[i] > hi[col])
+                continue;
+              const double g = t.gap(R, c, psi[i], te);
+              if (g < marking) {
+                tc[i] += 1.0f;
+                sc[i] += float(marking - g);
+              }
+            }
+          }
+        }
+      }
+    });
+
+    p.time.assign(cells, 0.0f);
+    p.squeeze.assign(cells, 0.0f);
+    for (int ch = 0; ch < chunks; ++ch) {
+      for (size_t i = 0; i < cells; ++i) {
+        p.time[i] += time[ch][i];
+        p.squeeze[i] += squeeze[ch][i];
+      }
+    }
+    double marked = 0, weight = 0, sumR = 0, sumU = 0;
+    for (int row = 0; row < opt.profileCells; ++row) {
+      for (int col = 0; col < opt.faceCells; ++col) {
+        const size_t i = p.cell(col, row);
+        p.time[i] /= opt.rollPositions;
+        p.squeeze[i] /= opt.rollPositions;
+        marked += p.time[i] > 0;
+        weight += p.time[i];
+        sumR += p.time[i] * p.cellR(col);
+        sumU += p.time[i] * p.cellU(row);
+      }
+    }
+    p.markedShare = marked / cells;
+    if (weight > 0) {
+      p.centreR = sumR / weight;
+      p.centreU = sumU / weight;
+    }
+    return p;
+  }
+
+private:
+  BevelGearPair pair;
+  bool pinion;
+  TcaOptions tca;
+  ContactPatternOptions opt;
+};
+
+// The usual marking test set: nominal mounting and the pinion moved in and
+// out along its axis (H) and along the offset direction (V) by `shift` mm
+inline std::vector<ContactPatternCase> markingTestCases(double shift = 0.05) {
+  std::vector<ContactPatternCase> cases = {{"nominal", {}}};
+  for (double s : {shift, -shift}) {
+    const std::string sign = s > 0 ? "+" : "-";
+    TcaMisalignment h, v;
+    h.pinionAxial = s;
+    v.offset = s;
+    cases.push_back({"H" + sign, h});
+    cases.push_back({"V" + sign, v});
+  }
+  return cases;
+}
+
+// Image and raw grid of the marking time and the squeeze of a pattern:
+// <prefix>.time.ppm, .time.csv, .squeeze.ppm and .squeeze.csv. Images of a
+// set share the colour scale when given the largest values of the set (0
+// scales each image to itself). CSV rows are u, columns cone distance.
+// Returns the bytes written.
+inline size_t writeContactPattern(const std::string& prefix,
+                                  const ContactPattern& p, double maxTime = 0,
+                                  double maxSqueeze = 0, int scale = 4) {
+  std::vector<double> r(p.faceCells), u(p.profileCells);
+  for (int c = 0; c < p.faceCells; ++c)
+    r[c] = p.cellR(c);
+  for (int k = 0; k < p.profileCells; ++k)
+    u[k] = p.cellU(k);
+  size_t bytes = 0;
+  bytes += heatmap::writePpm(prefix + ".time.ppm", p.time, p.faceCells,
+                             p.profileCells, maxTime, scale);
+  bytes += heatmap::writeCsv(prefix + ".time.csv", p.time, p.faceCells,
+                             p.profileCells, r, u, "u/R");
+  bytes += heatmap::writePpm(prefix + ".squeeze.ppm", p.squeeze, p.faceCells,
+                             p.profileCells, maxSqueeze, scale);
+  bytes += heatmap::writeCsv(prefix + ".squeeze.csv", p.squeeze, p.faceCells,
+                             p.profileCells, r, u, "u/R");
+  return bytes;
+}
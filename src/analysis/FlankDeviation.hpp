@@ -0,0 +1,370 @@
+// FlankDeviation.hpp
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "../geometry/KdTree.hpp"
+#include "../geometry/RigidTransform.hpp"
+#include "../geometry/ToothFlank.hpp"
+#include "../io/PointCloud.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Flank deviations of a measured gear against the nominal ToothFlank.
+//
+// Both flanks of every tooth are sampled on a (R, u) grid and the samples go
+// into a k-d tree. A measured point takes its nearest sample as the start of
+// two Gauss-Newton steps onto the analytic flank, using the tangents stored
+// with the sample, and its deviation is the signed distance along the
+// outward flank normal: positive is excess material. Points whose foot falls
+// off the face width or the profile, or that lie farther than maxDistance,
+// are off the flanks (tip and root lands, fixtures, stray returns).
+//
+// The scan is registered to the nominal frame by point-to-plane ICP on an
+// evenly strided subset, so the measuring frame only needs to be close to
+// the gear frame (apex at the origin, axis +z, tooth 0 on +x). All per-point
+// loops run in fixed chunks on the pool; topography cells are then summed in
+// point order so results do not depend on the worker count.
+
+struct InspectionOptions {
+  int faceSamples = 64;     // Nominal samples per flank, toe to heel
+  int profileSamples = 32;  // Root to tip
+  int gridColumns = 9;      // Topography cells along the face
+  int gridRows = 5;         // And root to tip
+  double maxDistance = 0.5;  // Farther points are off the flanks (mm)
+  bool registration = true;
+  int registrationSamples = 20000;
+  int maxIterations = 50;
+};
+
+// Closest point of the nominal flanks
+struct FlankFoot {
+  int tooth = -1;
+  FlankSide side = FlankSide::Left;
+  double R = 0, u = 0;
+  double deviation = 0;  // Along the outward normal (mm)
+  Vec3 normal;           // Outward, in the gear frame
+  bool onFlank = false;
+};
+
+struct FlankTopography {
+  int tooth = 0;
+  FlankSide side = FlankSide::Left;
+  int rows = 0, columns = 0;      // Root to tip, toe to heel
+  std::vector<double> deviation;  // Mean per cell (mm), NaN without points
+  std::vector<uint32_t> count;
+  size_t points = 0;
+  double mean = 0, min = 0, max = 0, rms = 0;
+
+  double at(int row, int column) const {
+    return deviation[size_t(row) * columns + column];
+  }
+};
+
+struct InspectionResult {
+  RigidTransform registration;  // Scan frame to gear frame
+  int iterations = 0;
+  double registrationRms = 0;  // Of the registration subset (mm)
+  std::vector<float> deviation;  // Per point (mm), NaN off the flanks
+  std::vector<int32_t> flank;    // 2 * tooth + side per point, -1 off
+  size_t onFlank = 0;
+  // One per flank, index 2 * tooth + (side == Right)
+  std::vector<FlankTopography> topography;
+};
+
+class FlankInspection {
+public:
+  explicit FlankInspection(const BevelGear& gear,
+                           InspectionOptions options = {})
+      : flank(gear), opt(options) {
+    if (opt.faceSamples < 2 || opt.profileSamples < 2 ||
+        opt.gridColumns < 1 || opt.gridRows < 1 || opt.maxDistance <= 0 ||
+        opt.registrationSamples < 6 || opt.maxIterations < 0) {
+      throw std::invalid_argument("Invalid inspection options");
+    }
+    GEARLAB_TRACE_SCOPE("inspection.nominal");
+    const double Ri = flank.innerR(), Ro = flank.outerR();
+    const double hR = 1e-4 * Ro, hu = 1e-4;
+    for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+      for (int i = 0; i < opt.faceSamples; ++i) {
+        const double R = Ri + (Ro - Ri) * i / (opt.faceSamples - 1);
+        for (int j = 0; j < opt.profileSamples; ++j) {
+          const double u = double(j) / (opt.profileSamples - 1);
+          Sample s;
+          s.p = flank.point(side, R, u);
+          s.tR = (flank.point(side, R + hR, u) -
+                  flank.point(side, R - hR, u)) /
+                 (2 * hR);
+          s.tU = (flank.point(side, R, u + hu) -
+                  flank.point(side, R, u - hu)) /
+                 (2 * hu);
+          s.n = flank.normal(side, R, u);
+          s.R = R;
+          s.u = u;
+          s.side = side;
+          samples.push_back(s);
+        }
+      }
+    }
+    std::vector<Vec3> points;
+    points.reserve(samples.size() * flank.numTeeth());
+    for (int k = 0; k < flank.numTeeth(); ++k) {
+      for (const Sample& s : samples)
+        points.push_back(s.p.rotatedZ(k * flank.pitchAngle()));
+    }
+    held = memory::Reservation(
+        memory::Category::Geometry,
+        samples.size() * sizeof(Sample) + points.size() * 32);
+    tree = KdTree(points);
+  }
+
+  const ToothFlank& toothFlank() const { return flank; }
+  const InspectionOptions& options() const { return opt; }
+
+  // Foot of p (gear frame) on the nominal flanks
+  FlankFoot closest(const Vec3& p) const {
+    FlankFoot f;
+    const size_t id = tree.nearest(p);
+    const Sample& s = samples[id % samples.size()];
+    f.tooth = int(id / samples.size());
+    f.side = s.side;
+    const double turn = f.tooth * flank.pitchAngle();
+    const Vec3 p0 = p.rotatedZ(-turn);
+
+    // Gauss-Newton with the tangents of the sample
+    const double a11 = s.tR.dot(s.tR), a12 = s.tR.dot(s.tU);
+    const double a22 = s.tU.dot(s.tU), det = a11 * a22 - a12 * a12;
+    double R = s.R, u = s.u;
+    Vec3 q = s.p;
+    for (int it = 0; it < 2; ++it) {
+      const Vec3 r = p0 - q;
+      const double b1 = s.tR.dot(r), b2 = s.tU.dot(r);
+      R += (a22 * b1 - a12 * b2) / det;
+      u += (a11 * b2 - a12 * b1) / det;
+      q = flank.point(s.side, R, u);
+    }
+    f.R = R;
+    f.u = u;
+    const Vec3 d = p0 - q;
+    f.deviation = d.dot(s.n);
+    f.normal = s.n.rotatedZ(turn);
+    const double slackR = 1e-3 * (flank.outerR() - flank.innerR());
+    f.onFlank = R >= flank.innerR() - slackR &&
+                R <= flank.outerR() + slackR && u >= -1e-3 &&
+                u <= 1 + 1e-3 && std::fabs(f.deviation) <= opt.maxDistance &&
+                (d - s.n * f.deviation).norm() <= 0.1 * opt.maxDistance;
+    return f;
+  }
+
+  // Transform taking the scan onto the nominal flanks
+  RigidTransform registerCloud(const PointCloud& cloud,
+                               ThreadPool& pool = ThreadPool::shared(),
+                               int* iterations = nullptr,
+                               double* rms = nullptr) const {
+    GEARLAB_TRACE_SCOPE("inspection.register");
+    RigidTransform t;
+    const size_t stride = std::max<size_t>(
+        1, cloud.size() / size_t(opt.registrationSamples));
+    const size_t n = (cloud.size() + stride - 1) / stride;
+    const size_t chunks = (n + chunk - 1) / chunk;
+    // Normal equations of the linearised point-to-plane residual
+    // d + (w x p + v) . normal, unknowns (w, v)
+    struct Sums {
+      std::array<double, 36> A{};
+      std::array<double, 6> b{};
+      double sse = 0;
+      size_t count = 0;
+    };
+    int it = 0;
+    double error = 0;
+    for (; it < opt.maxIterations; ++it) {
+      std::vector<Sums> sums(chunks);
+      pool.parallelFor(0, chunks, [&](size_t c) {
+        Sums& s = sums[c];
+        for (size_t i = c * chunk, e = std::min(n, i + chunk); i < e; ++i) {
+          const Vec3 p = t.apply(cloud.point(i * stride));
+          const FlankFoot f = closest(p);
+          if (!f.onFlank)
+            continue;
+          const Vec3 w = p.cross(f.normal);
+          const double J[6] = {w.x, w.y, w.z,
+                               f.normal.x, f.normal.y, f.normal.z};
+          for (int r = 0; r < 6; ++r) {
+            for (int q = r; q < 6; ++q)
+              s.A[r * 6 + q] += J[r] * J[q];
+            s.b[r] -= J[r] * f.deviation;
+          }
+          s.sse += f.deviation * f.deviation;
+          ++s.count;
+        }
+      });
+      Sums total;
+      for (const Sums& s : sums) {
+        for (int k = 0; k < 36; ++k)
+          total.A[k] += s.A[k];
+        for (int k = 0; k < 6; ++k)
+          total.b[k] += s.b[k];
+        total.sse += s.sse;
+        total.count += s.count;
+      }
+      if (total.count < 6)
+        throw std::runtime_error("Too few scan points on the flanks");
+      error = sqrt(total.sse / total.count);
+      std::array<double, 6> x{};
+      if (!solve6(total.A, total.b, x))
+        break;
+      const Vec3 w(x[0], x[1], x[2]), v(x[3], x[4], x[5]);
+      RigidTransform step = RigidTransform::rotationAbout(w);
+      step.translation = v;
+      t = t.then(step);
+      if (w.norm() * flank.outerR() + v.norm() < 1e-9)
+        break;
+    }
+    if (iterations)
+      *iterations = it;
+    if (rms)
+      *rms = error;
+    return t;
+  }
+
+  InspectionResult inspect(const PointCloud& cloud,
+                           ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("inspection.run");
+    InspectionResult r;
+    if (opt.registration && cloud.size() > 0) {
+      r.registration =
+          registerCloud(cloud, pool, &r.iterations, &r.registrationRms);
+    }
+    const size_t n = cloud.size(), chunks = (n + chunk - 1) / chunk;
+    const int rows = opt.gridRows, cols = opt.gridColumns;
+    const size_t cells = size_t(rows) * cols;
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             n * (sizeof(float) + 2 * sizeof(int32_t)));
+    r.deviation.resize(n);
+    r.flank.resize(n);
+    std::vector<int32_t> cell(n);
+    const double Ri = flank.innerR(), Ro = flank.outerR();
+    pool.parallelFor(0, chunks, [&](size_t c) {
+      for (size_t i = c * chunk, e = std::min(n, i + chunk); i < e; ++i) {
+        const FlankFoot f = closest(r.registration.apply(cloud.point(i)));
+        if (!f.onFlank) {
+          r.deviation[i] = std::numeric_limits<float>::quiet_NaN();
+          r.flank[i] = cell[i] = -1;
+          continue;
+        }
+        r.deviation[i] = float(f.deviation);
+        r.flank[i] = 2 * f.tooth + (f.side == FlankSide::Right);
+        const int col = std::clamp(int((f.R - Ri) / (Ro - Ri) * cols), 0,
+                                   cols - 1);
+        const int row = std::clamp(int(f.u * rows), 0, rows - 1);
+        cell[i] = int32_t(r.flank[i] * cells + row * cols + col);
+      }
+    });
+
+    // Topography in point order
+    const int flanks = 2 * flank.numTeeth();
+    r.topography.resize(flanks);
+    std::vector<double> sum(flanks * cells, 0.0);
+    for (int k = 0; k < flanks; ++k) {
+      FlankTopography& t = r.topography[k];
+      t.tooth = k / 2;
+      t.side = k % 2 ? FlankSide::Right : FlankSide::Left;
+      t.rows = rows;
+      t.columns = cols;
+      t.count.assign(cells, 0);
+      t.min = HUGE_VAL;
+      t.max = -HUGE_VAL;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if (cell[i] < 0)
+        continue;
+      FlankTopography& t = r.topography[r.flank[i]];
+      const double d = r.deviation[i];
+      sum[cell[i]] += d;
+      ++t.count[cell[i] % cells];
+      ++t.points;
+      t.mean += d;
+      t.rms += d * d;
+      t.min = std::min(t.min, d);
+      t.max = std::max(t.max, d);
+    }
+    for (int k = 0; k < flanks; ++k) {
+      FlankTopography& t = r.topography[k];
+      t.deviation.resize(cells);
+      for (size_t c = 0; c < cells; ++c) {
+        t.deviation[c] = t.count[c] ? sum[k * cells + c] / t.count[c]
+                                    : std::numeric_limits<double>::quiet_NaN();
+      }
+      r.onFlank += t.points;
+      if (t.points == 0) {
+        t.min = t.max = 0;
+        continue;
+      }
+      t.mean /= t.points;
+      t.rms = sqrt(t.rms / t.points);
+    }
+    return r;
+  }
+
+private:
+  struct Sample {
+    Vec3 p, tR, tU, n;  // Point, tangents along R and u, outward normal
+    double R = 0, u = 0;
+    FlankSide side = FlankSide::Left;
+  };
+
+  static constexpr size_t chunk = 4096;
+
+  // Symmetric 6x6 system from its upper triangle, Gaussian elimination with
+  // partial pivoting. False when singular.
+  static bool solve6(std::array<double, 36> A, std::array<double, 6> b,
+                     std::array<double, 6>& x) {
+    for (int r = 0; r < 6; ++r) {
+      for (int q = 0; q < r; ++q)
+        A[r * 6 + q] = A[q * 6 + r];
+    }
+    double scale = 0;
+    for (int r = 0; r < 6; ++r)
+      scale = std::max(scale, std::fabs(A[r * 6 + r]));
+    for (int c = 0; c < 6; ++c) {
+      int p = c;
+      for (int r = c + 1; r < 6; ++r) {
+        if (std::fabs(A[r * 6 + c]) > std::fabs(A[p * 6 + c]))
+          p = r;
+      }
+      if (std::fabs(A[p * 6 + c]) <= 1e-14 * scale)
+        return false;
+      if (p != c) {
+        for (int q = 0; q < 6; ++q)
+          std::swap(A[c * 6 + q], A[p * 6 + q]);
+        std::swap(b[c], b[p]);
+      }
+      for (int r = c + 1; r < 6; ++r) {
+        const double f = A[r * 6 + c] / A[c * 6 + c];
+        for (int q = c; q < 6; ++q)
+          A[r * 6 + q] -= f * A[c * 6 + q];
+        b[r] -= f * b[c];
+      }
+    }
+    for (int r = 5; r >= 0; --r) {
+      double v = b[r];
+      for (int q = r + 1; q < 6; ++q)
+        v -= A[r * 6 + q] * x[q];
+      x[r] = v / A[r * 6 + r];
+    }
+    return true;
+  }
+
+  ToothFlank flank;
+  InspectionOptions opt;
+  std::vector<Sample> samples;  // Tooth 0, left then right flank
+  KdTree tree;                  // Samples of all teeth, tooth major
+  memory::Reservation held;
+};
@@ -0,0 +1,325 @@
+// GearDynamics.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+#include "ToothStiffness.hpp"
+
+// Lumped torsional model of a gear pair: pinion and gear inertias coupled by
+// the time-varying mesh stiffness along the line of action and excited by
+// the unloaded transmission error,
+//   me x'' + c x' + k(t) max(x - e(t), 0) = F
+// with x the relative displacement of the base circles, F the static normal
+// mesh force and me the equivalent mass. The mesh force k (x - e) + c x' over
+// F is the dynamic factor.
+//
+// Every speed of a sweep is one lane of a fixed step RK4 integrator. Lanes
+// with similar step counts form a block and advance in lock step, finished
+// ones masked, so the per-step arithmetic vectorises across speeds.
+// Time step is the smaller of a mesh period / stepsPerMesh and a natural
+// period / stepsPerPeriod. Units: N, mm, s, tonnes (t mm^2 for inertia).
+
+struct DynamicsInputs {
+  double torque = 100;       // Pinion torque (Nm)
+  double pinionInertia = 0;  // t mm^2, 0 estimates a solid steel disc
+  double gearInertia = 0;
+  double dampingRatio = 0.07;  // Of the mean mesh stiffness
+  // Unloaded transmission error, harmonics of the mesh frequency (mm)
+  std::vector<double> teAmplitude = {0.002};
+  std::vector<double> tePhase = {0.0};  // rad
+};
+
+struct DynamicsOptions {
+  int stepsPerMesh = 64;
+  int stepsPerPeriod = 32;
+  int warmupCycles = 40;  // Mesh cycles before recording
+  int recordCycles = 10;
+  int maxStepsPerMesh = 4096;  // Slower lanes are solved quasi-statically
+  int tableSize = 512;         // Samples of k and e over one mesh cycle
+};
+
+// Steady state response per speed, same indexing as the input speeds
+struct DynamicsResults {
+  std::vector<double> speed;          // Pinion rpm
+  std::vector<double> meshFrequency;  // Hz
+  std::vector<double> dynamicFactor;  // Max mesh force / static force
+  std::vector<double> minForceRatio;  // 0 means the teeth separated
+  std::vector<double> dteRms;         // RMS dynamic TE about its mean (mm)
+  std::vector<unsigned char> quasiStatic;
+
+  size_t size() const { return speed.size(); }
+};
+
+class GearDynamics {
+public:
+  GearDynamics(const BevelGearPair& pair, DynamicsInputs inputs = {},
+               DynamicsOptions options = {})
+      : in(std::move(inputs)), opt(options) {
+    if (opt.stepsPerMesh < 4 || opt.tableSize < 8 || opt.recordCycles < 1)
+      throw std::invalid_argument("Invalid GearDynamics options");
+    GEARLAB_TRACE_SCOPE("dynamics.setup");
+    stiffness = cachedToothStiffness(pair);
+    z1 = pair.numPinionTeeth;
+
+    const double k = M_PI / 180;
+    const double alpha = pair.pressureAngle * k;
+    const double b = pair.outerConeDistance - pair.innerConeDistance;
+    const double d1 = pair.module * pair.numPinionTeeth;
+    const double d2 = pair.module * pair.numGearTeeth;
+    const double rb1 = d1 / 2 * cos(alpha), rb2 = d2 / 2 * cos(alpha);
+    const double density = 7.85e-9;
+    auto disc = [&](double d) { return density * M_PI * pow(d, 4) * b / 32; };
+    const double J1 = in.pinionInertia > 0 ? in.pinionInertia : disc(d1);
+    const double J2 = in.gearInertia > 0 ? in.gearInertia : disc(d2);
+    mass = J1 * J2 / (J1 * rb2 * rb2 + J2 * rb1 * rb1);
+    force = 1000 * in.torque / rb1;
+
+    // Mesh stiffness and unloaded TE over one mesh cycle
+    const int n = opt.tableSize;
+    kTable.resize(n + 1);
+    eTable.resize(n + 1);
+    double kSum = 0;
+    for (int i = 0; i <= n; ++i) {
+      const double phase = double(i) / n;
+      kTable[i] = stiffness->meshStiffness(phase * stiffness->meshCycle());
+      double e = 0;
+      for (size_t h = 0; h < in.teAmplitude.size(); ++h) {
+        const double ph = h < in.tePhase.size() ? in.tePhase[h] : 0;
+        e += in.teAmplitude[h] * cos(2 * M_PI * (h + 1) * phase + ph);
+      }
+      eTable[i] = e;
+      kSum += i < n ? kTable[i] : 0;
+    }
+    kMean = kSum / n;
+    if (!(kMean > 0))
+      throw std::invalid_argument("Gear pair has no tooth contact");
+    damping = 2 * in.dampingRatio * sqrt(kMean * mass);
+  }
+
+  // Natural frequency of the mesh with mean stiffness (Hz)
+  double naturalFrequency() const {
+    return sqrt(kMean / mass) / (2 * M_PI);
+  }
+
+  // Pinion speed at which the mesh frequency meets the natural one (rpm)
+  double resonanceSpeed() const { return naturalFrequency() * 60 / z1; }
+
+  double staticForce() const { return force; }
+  double equivalentMass() const { return mass; }
+  double meanStiffness() const { return kMean; }
+
+  // Steady state response for every speed (pinion rpm). Speeds are split into
+  // blocks of lanes that run on the pool.
+  DynamicsResults run(const std::vector<double>& speeds,
+                      ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("dynamics.sweep");
+    const size_t n = speeds.size();
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             n * 5 * sizeof(double));
+    DynamicsResults r;
+    r.speed = speeds;
+    r.meshFrequency.resize(n);
+    r.dynamicFactor.resize(n);
+    r.minForceRatio.resize(n);
+    r.dteRms.resize(n);
+    r.quasiStatic.resize(n);
+    // Every lane of a block steps as long as its slowest one, so speeds are
+    // ordered by steps per mesh cycle and a block ends where a lane would
+    // need less than half the steps of its first
+    std::vector<long> perMesh(n);
+    std::vector<size_t> order(n), cuts;
+    for (size_t i = 0; i < n; ++i) {
+      double dt;
+      perMesh[i] = meshSteps(speeds[i] / 60 * z1, dt);
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return perMesh[a] > perMesh[b];
+    });
+    for (size_t i = 0; i < n; ++i) {
+      if (cuts.empty() || i - cuts.back() == lanes ||
+          2 * perMesh[order[i]] < perMesh[order[cuts.back()]])
+        cuts.push_back(i);
+    }
+    cuts.push_back(n);
+    pool.parallelFor(0, cuts.size() - 1, [&](size_t b) {
+      runLanes(r, order.data() + cuts[b], cuts[b + 1] - cuts[b]);
+    });
+    return r;
+  }
+
+  // Evenly spaced speeds in [from, to] (rpm)
+  static std::vector<double> speedRange(double from, double to, size_t n) {
+    std::vector<double> s(n);
+    for (size_t i = 0; i < n; ++i)
+      s[i] = n > 1 ? from + (to - from) * i / (n - 1) : from;
+    return s;
+  }
+
+private:
+  static constexpr size_t lanes = 16;
+
+  // State of one block of lanes, in one struct so the step loop needs no
+  // alias checks between its arrays. k and e are sampled at the start,
+  // middle and end of the current step.
+  struct LaneBlock {
+    double x[lanes], v[lanes], t[lanes], dt[lanes], fm[lanes];
+    double fMax[lanes], fMin[lanes], sum[lanes], sum2[lanes];
+    double k0[lanes], e0[lanes], km[lanes], em[lanes], k1[lanes], e1[lanes];
+    // Step of the lane, 0 once it is done; weight 1 and offset 0 while it
+    // records, 0 and inf outside the record window
+    double h[lanes], w[lanes], off[lanes];
+    long warmup[lanes], steps[lanes];
+  };
+
+  // Linear interpolation in a per-cycle table at phase in cycles
+  double lookup(const std::vector<double>& table, double phase) const {
+    const double x = (phase - std::floor(phase)) * opt.tableSize;
+    const int i = std::min(int(x), opt.tableSize - 1);
+    const double t = x - i;
+    return (1 - t) * table[i] + t * table[i + 1];
+  }
+
+  // Steps per mesh cycle at mesh frequency fm (Hz) and the time step dt;
+  // 0 steps for lanes that are solved quasi-statically
+  long meshSteps(double fm, double& dt) const {
+    const double periodM = fm > 0 ? 1 / fm : HUGE_VAL;
+    const double periodN = 1 / naturalFrequency();
+    dt = std::min(periodM / opt.stepsPerMesh, periodN / opt.stepsPerPeriod);
+    if (periodM / dt > opt.maxStepsPerMesh)
+      return 0;
+    // Whole numbers of steps per mesh cycle keep the record window aligned
+    const long perMesh = long(std::ceil(periodM / dt));
+    dt = periodM / perMesh;
+    return perMesh;
+  }
+
+  // The phase only depends on time, so the table lookups of a step are
+  // gathered per lane first and the RK4 arithmetic then runs over all lanes
+  // without control flow. Every lane takes the block's largest step count;
+  // lanes past their own count, and padding lanes, step with h = 0 and are
+  // masked out of the record.
+  void runLanes(DynamicsResults& r, const size_t* index, size_t n) const {
+    const double k0 = lookup(kTable, 0), e0 = lookup(eTable, 0);
+    LaneBlock b = {};
+    long maxSteps = 0;
+
+    for (size_t l = 0; l < n; ++l) {
+      const size_t i = index[l];
+      b.fm[l] = r.speed[i] / 60 * z1;
+      r.meshFrequency[i] = b.fm[l];
+      const long perMesh = meshSteps(b.fm[l], b.dt[l]);
+      r.quasiStatic[i] = perMesh == 0;
+      b.warmup[l] = perMesh * opt.warmupCycles;
+      b.steps[l] = b.warmup[l] + perMesh * opt.recordCycles;
+      maxSteps = std::max(maxSteps, b.steps[l]);
+      // Static deflection, or the mean one if no tooth is engaged at start
+      b.x[l] = force / (k0 > 0 ? k0 : kMean) + e0;
+      b.k0[l] = k0;
+      b.e0[l] = e0;
+    }
+    for (size_t l = 0; l < lanes; ++l) {
+      b.fMax[l] = 0;
+      b.fMin[l] = HUGE_VAL;
+    }
+
+    // Acceleration with the mesh stiffness k and unloaded TE e at the phase
+    // of the state. Members are copied so the lane loop loads nothing
+    // through this.
+    const double F = force, c = damping, me = mass;
+    auto accel = [F, c, me](double x, double v, double k, double e) {
+      return (F - c * v - k * std::max(x - e, 0.0)) / me;
+    };
+    const size_t width = (n + 3) & ~size_t(3);
+    for (long s = 0; s < maxSteps; ++s) {
+      for (size_t l = 0; l < n; ++l) {
+        const bool active = s < b.steps[l];
+        const bool record = active && s >= b.warmup[l];
+        b.h[l] = active ? b.dt[l] : 0;
+        b.w[l] = record ? 1 : 0;
+        b.off[l] = record ? 0 : HUGE_VAL;
+        if (!active)
+          continue;
+        const double pm = (b.t[l] + b.dt[l] / 2) * b.fm[l];
+        const double p1 = (b.t[l] + b.dt[l]) * b.fm[l];
+        b.km[l] = lookup(kTable, pm);
+        b.em[l] = lookup(eTable, pm);
+        b.k1[l] = lookup(kTable, p1);
+        b.e1[l] = lookup(eTable, p1);
+      }
+      for (size_t l = 0; l < width; ++l) {
+        // RK4 on (x, v), phase advances linearly with time
+        const double h = b.h[l], x = b.x[l], v = b.v[l];
+        const double k1x = v, k1v = accel(x, v, b.k0[l], b.e0[l]);
+        const double k2x = v + h / 2 * k1v;
+        const double k2v = accel(x + h / 2 * k1x, k2x, b.km[l], b.em[l]);
+        const double k3x = v + h / 2 * k2v;
+        const double k3v = accel(x + h / 2 * k2x, k3x, b.km[l], b.em[l]);
+        const double k4x = v + h * k3v;
+        const double k4v = accel(x + h * k3x, k4x, b.k1[l], b.e1[l]);
+        b.x[l] = x + h / 6 * (k1x + 2 * k2x + 2 * k3x + k4x);
+        b.v[l] = v + h / 6 * (k1v + 2 * k2v + 2 * k3v + k4v);
+        b.t[l] += h;
+        // The end of this step is the start of the next
+        b.k0[l] = b.k1[l];
+        b.e0[l] = b.e1[l];
+
+        const double f =
+            b.k1[l] * std::max(b.x[l] - b.e1[l], 0.0) + c * b.v[l];
+        b.fMax[l] = std::max(b.fMax[l], f - b.off[l]);
+        b.fMin[l] = std::min(b.fMin[l], f + b.off[l]);
+        b.sum[l] += b.w[l] * b.x[l];
+        b.sum2[l] += b.w[l] * b.x[l] * b.x[l];
+      }
+    }
+
+    for (size_t l = 0; l < n; ++l) {
+      const size_t i = index[l];
+      if (r.quasiStatic[i]) {
+        // Deflection follows the excitation, the force stays static
+        quasiStatic(r, i);
+        continue;
+      }
+      const double m = double(b.steps[l] - b.warmup[l]);
+      const double mean = b.sum[l] / m;
+      r.dynamicFactor[i] = b.fMax[l] / force;
+      r.minForceRatio[i] = std::max(b.fMin[l], 0.0) / force;
+      r.dteRms[i] = sqrt(std::max(b.sum2[l] / m - mean * mean, 0.0));
+    }
+  }
+
+  // With a contact ratio below 1 no tooth is engaged over part of the mesh
+  // cycle: the mesh loses contact there and those phases carry no force
+  void quasiStatic(DynamicsResults& r, size_t i) const {
+    double sum = 0, sum2 = 0;
+    int engaged = 0;
+    for (int j = 0; j < opt.tableSize; ++j) {
+      if (kTable[j] <= 0)
+        continue;
+      const double x = force / kTable[j] + eTable[j];
+      sum += x;
+      sum2 += x * x;
+      ++engaged;
+    }
+    const double mean = sum / engaged;
+    r.dynamicFactor[i] = 1;
+    r.minForceRatio[i] = engaged < opt.tableSize ? 0 : 1;
+    r.dteRms[i] = sqrt(std::max(sum2 / engaged - mean * mean, 0.0));
+  }
+
+  DynamicsInputs in;
+  DynamicsOptions opt;
+  std::shared_ptr<const ToothStiffnessModel> stiffness;
+  int z1 = 1;
+  double mass = 1, force = 0, kMean = 0, damping = 0;
+  std::vector<double> kTable, eTable;
+};
@@ -0,0 +1,816 @@
+// GearFit.hpp
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../geometry/RigidTransform.hpp"
+#include "../geometry/ToothFlank.hpp"
+#include "../io/PointCloud.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Fit of BevelGear parameters to a scan of an existing gear, for parts that
+// have to be reproduced without drawings.
+//
+// The scan must show the teeth (flanks, tip and root lands) with the gear
+// axis along the scan z axis, as measured on a rotary table; the apex
+// position, the angular position of the teeth and small tilts are found by
+// the fit. Steps:
+//   1. Voxel grid subsample of about `samples` points, so dense or unevenly
+//      dense scans cost the same; sparsely hit cells are stray returns.
+//   2. Starting values: the apex from a cone through all points, the tooth
+//      count from the azimuth spectrum of the polar angle (teeth stand out
+//      as a periodic bump), the tooth phase and the spiral angle from the
+//      phase of that spectrum across the face.
+//   3. Robust Levenberg-Marquardt on the spherical involute model of
+//      ToothFlank. Each point is assigned to a flank, a tip land or a root
+//      land of the current model and its residual is measured along the
+//      latitude circle (flanks) or the meridian (lands). Points beyond a
+//      threshold of a few robust standard deviations do not pull.
+//   4. The flanks only fix the base cone sin(db) = sin(d) cos(a), so the
+//      pitch cone and pressure angle are split by the mate tooth count: each
+//      count whose pressure angle is plausible is fitted and the one with
+//      the smallest residual wins, ties going to the pressure angle nearest
+//      to nominalPressureAngle.
+//
+// The fit runs on the profile shift x, which sets the tooth thickness, at a
+// reference module whose pitch cone distance is the middle of the face. The
+// module of the result then follows from x and the face cone through the
+// addendum (1 + x) m, with the backlash assumed. When the face cone runs
+// through the pitch apex (faceConeOffset 0) the teeth are the same at any
+// module; the module is then the one whose pitch cone distance is the
+// middle of the scanned face, (innerR + outerR) sin(d) / N.
+
+struct GearFitOptions {
+  int samples = 12000;         // Points of the subsample
+  int minTeeth = 5, maxTeeth = 150;
+  int mateTeeth = 0;           // 0 to search
+  bool pinion = false;         // The scan is the member with fewer teeth
+  double shaftAngle = 90;      // deg
+  double backlash = 0;         // Assumed (deg)
+  double coneClearance = 1.5;  // For the pair
+  spiralFunction spiralType = Logarithmic;
+  double nominalPressureAngle = 20;  // deg, tie break for the mate count
+  double minPressureAngle = 10, maxPressureAngle = 35;
+  double cutoff = 3;           // Robust standard deviations of an inlier
+  double minThreshold = 0.002;  // mm
+  int maxIterations = 60;
+};
+
+struct GearFitResult {
+  std::optional<BevelGear> gear;  // The scanned member
+  BevelGearPair pair;             // With the mate, when the scan is the gear
+  bool hasPair = false;
+  int mateTeeth = 0;
+  RigidTransform registration;  // Scan frame to gear frame
+  double rms = 0;               // Of the inliers of the whole scan (mm)
+  size_t points = 0, inliers = 0;
+  size_t flankPoints = 0, tipPoints = 0, rootPoints = 0;
+  int iterations = 0;  // Of the winning mate count
+};
+
+class GearFit {
+public:
+  explicit GearFit(GearFitOptions options = {}) : opt(options) {
+    if (opt.samples < 100 || opt.minTeeth < 3 ||
+        opt.maxTeeth < opt.minTeeth || opt.shaftAngle <= 0 ||
+        opt.shaftAngle >= 180 || opt.cutoff <= 0 || opt.minThreshold <= 0 ||
+        opt.maxIterations < 1) {
+      throw std::invalid_argument("Invalid gear fit options");
+    }
+  }
+
+  const GearFitOptions& options() const { return opt; }
+
+  GearFitResult fit(const PointCloud& cloud,
+                    ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("gearfit.run");
+    if (cloud.size() < 100)
+      throw std::runtime_error("Too few scan points for a gear fit");
+    const std::vector<Vec3> sub = subsample(cloud);
+    memory::Reservation held(memory::Category::Geometry,
+                             sub.size() * (sizeof(Vec3) + 2 * sizeof(double)));
+
+    State s = start(sub);
+    std::vector<int> mates;
+    if (opt.mateTeeth > 0) {
+      s.mate = opt.mateTeeth;
+      mates.push_back(opt.mateTeeth);
+    } else {
+      // First fit at the mate count of the pitch cone guess, then every
+      // plausible count from there
+      const double shaft = opt.shaftAngle * k;
+      const double gear = opt.pinion ? shaft - s.pitchGuess : s.pitchGuess;
+      const double ratio = sin(shaft) / tan(gear);
+      s.mate = int(std::lround(opt.pinion ? s.numTeeth / ratio
+                                          : s.numTeeth * ratio));
+      s.mate = opt.pinion ? std::max(s.mate, s.numTeeth + 1)
+                          : std::clamp(s.mate, 1, s.numTeeth - 1);
+      if (s.mate < 1)
+        throw std::runtime_error("Tooth count too small for a pair");
+      s = solve(s, sub, pool, opt.maxIterations);
+      const double sinBase = sin(pitchCone(s.numTeeth, s.mate)) *
+                             cos(s.g[0] * k);
+      const int lo = opt.pinion ? s.numTeeth + 1 : 1;
+      const int hi = opt.pinion ? 4 * s.numTeeth : s.numTeeth - 1;
+      for (int m = lo; m <= hi; ++m) {
+        const double c = sinBase / sin(pitchCone(s.numTeeth, m));
+        if (c < 1 && acos(c) / k >= opt.minPressureAngle &&
+            acos(c) / k <= opt.maxPressureAngle) {
+          mates.push_back(m);
+        }
+      }
+      if (mates.empty())
+        mates.push_back(s.mate);
+    }
+
+    // Mates are compared at the thresholds of the first fit
+    std::optional<State> best;
+    double bestCost = 0;
+    for (int m : mates) {
+      // Other counts start on the same surface and settle quickly; those
+      // that do not are not the answer
+      State c = s.mate == m ? s : withMate(s, m);
+      if (c.mate != s.mate || !s.solved)
+        c = solve(c, sub, pool, s.solved ? 20 : opt.maxIterations);
+      State common = c;
+      common.threshold = s.solved ? s.threshold : c.threshold;
+      const double cost = evaluate(common, sub, pool, false).cost;
+      const auto key = [&](const State& t) {
+        return std::fabs(t.g[0] - opt.nominalPressureAngle);
+      };
+      // Differences below a tenth of the noise floor are ties
+      const double tie = 0.1 * std::max(cost, bestCost) +
+                         0.01 * sub.size() * opt.minThreshold *
+                             opt.minThreshold;
+      if (!best || cost + tie < bestCost ||
+          (cost <= bestCost + tie && key(c) < key(*best))) {
+        best = c;
+        bestCost = cost;
+      }
+    }
+    return finish(*best, cloud, pool);
+  }
+
+private:
+  static constexpr double k = M_PI / 180;
+  static constexpr size_t chunk = 1024;
+  static constexpr int gearParams = 7;  // a, b, x, FA, fo, RA, ro
+  static constexpr int numParams = gearParams + 6;
+
+  enum class Region : uint8_t { None, Flank, Tip, Root };
+  // Inlier distance of the flanks, tip lands and root lands (mm)
+  using Thresholds = std::array<double, 3>;
+
+  struct State {
+    int numTeeth = 0, mate = 0;
+    std::array<double, gearParams> g{};  // deg and mm
+    RigidTransform pose;
+    double innerR = 0, outerR = 0;       // Of the subsample
+    double Rm = 0;                       // Of the reference module
+    double pitchGuess = 0;               // rad
+    Thresholds threshold{};
+    double cost = std::numeric_limits<double>::infinity();
+    int iterations = 0;
+    bool solved = false;
+  };
+
+  // Pitch cone angle (rad) of the scanned member for a mate count
+  double pitchCone(int teeth, int mate) const {
+    const double shaft = opt.shaftAngle * k;
+    if (!opt.pinion)
+      return atan(sin(shaft) / (double(mate) / teeth));
+    return shaft - atan(sin(shaft) / (double(teeth) / mate));
+  }
+
+  // The same flank surface for another mate count: base cone, tooth
+  // thickness and developed spiral are kept, the face and root cones stay
+  // where they are
+  State withMate(const State& s, int mate) const {
+    const ToothFlank before(makeGear(s, s.g.data()));
+    const double d0 = pitchCone(s.numTeeth, s.mate);
+    const double d1 = pitchCone(s.numTeeth, mate);
+    State t = s;
+    t.mate = mate;
+    t.g[0] = acos(std::min(1.0, sin(d0) * cos(s.g[0] * k) / sin(d1))) / k;
+    t.g[1] = atan(tan(s.g[1] * k) * sin(d1) / sin(d0)) / k;
+    // The half width at the new pitch cone is linear in x
+    t.g[2] = 0;
+    const double plain = ToothFlank(makeGear(t, t.g.data())).halfWidth(d1);
+    t.g[2] = (before.halfWidth(d1) - plain) * s.numTeeth /
+             (2 * tan(t.g[0] * k));
+    t.solved = false;
+    return t;
+  }
+
+  // Model of the fit at the reference module; the addendum only carries
+  // the profile shift to ToothFlank
+  BevelGear makeGear(const State& s, const double* g) const {
+    const double pa = pitchCone(s.numTeeth, s.mate) / k;
+    const double m = 2 * s.Rm * sin(pa * k) / s.numTeeth;
+    const double d = -g[6] * sin(g[5] * k) / cos((pa - g[5]) * k) +
+                     s.Rm * tan((pa - g[5]) * k);
+    return BevelGear(s.numTeeth, pa, g[3], g[5], m, g[4], g[6], s.innerR,
+                     s.outerR, s.Rm, (1 + g[2]) * m, d, opt.backlash,
+                     opt.shaftAngle, g[0], g[1], opt.spiralType);
+  }
+
+  // Signed distance of p (gear frame) to a region of the model, positive
+  // for excess material
+  static double residual(const ToothFlank& f, Region r, const Vec3& p) {
+    const double R = p.norm();
+    const double gamma = acos(std::clamp(p.z / R, -1.0, 1.0));
+    switch (r) {
+      case Region::Tip:
+        return (gamma - f.tipAngle(R)) * R;
+      case Region::Root:
+        return (gamma - f.rootAngle(R)) * R;
+      default: {
+        const double psi = atan2(p.y, p.x) - f.spiralOffset(R);
+        const double phi = psi - f.pitchAngle() *
+                                     std::nearbyint(psi / f.pitchAngle());
+        return (std::fabs(phi) - f.halfWidth(gamma)) * R * sin(gamma);
+      }
+    }
+  }
+
+  // Region of the model nearest to p within its threshold, None if there
+  // is none; its residual goes to e
+  static Region classify(const ToothFlank& f, const Vec3& p,
+                         const Thresholds& threshold, double& e) {
+    const double R = p.norm();
+    const double gamma = acos(std::clamp(p.z / R, -1.0, 1.0));
+    const double tip = f.tipAngle(R), root = f.rootAngle(R);
+    const double psi = atan2(p.y, p.x) - f.spiralOffset(R);
+    const double phi = std::fabs(
+        psi - f.pitchAngle() * std::nearbyint(psi / f.pitchAngle()));
+    const double lands = std::max(threshold[1], threshold[2]);
+    Region best = Region::None;
+    e = HUGE_VAL;
+    const auto offer = [&](Region r, double v) {
+      if (std::fabs(v) <= threshold[int(r) - 1] &&
+          std::fabs(v) < std::fabs(e)) {
+        e = v;
+        best = r;
+      }
+    };
+    if (gamma >= root - threshold[0] / R && gamma <= tip + threshold[0] / R)
+      offer(Region::Flank, (phi - f.halfWidth(gamma)) * R * sin(gamma));
+    if (phi <= f.halfWidth(tip) + lands / (R * sin(tip)))
+      offer(Region::Tip, (gamma - tip) * R);
+    if (phi >= f.halfWidth(root) - lands / (R * sin(root)))
+      offer(Region::Root, (gamma - root) * R);
+    return best;
+  }
+
+  // Voxel grid thinning, first point of every cell in scan order. Cells
+  // holding far fewer points than is usual for the scan are stray returns
+  // and left out, as a grid would otherwise favour them. Very large scans
+  // are strided first to bound the hash map.
+  std::vector<Vec3> subsample(const PointCloud& c) const {
+    GEARLAB_TRACE_SCOPE("gearfit.subsample");
+    const size_t target = size_t(opt.samples);
+    const size_t stride = std::max<size_t>(1, c.size() / (16 * target));
+    Vec3 lo = c.point(0), hi = lo;
+    for (size_t i = 0; i < c.size(); i += stride) {
+      const Vec3 p = c.point(i);
+      lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+      hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+    }
+    const Vec3 e = hi - lo;
+    // A scan is a surface: start from the cell of a plane of that extent
+    double cell = std::sqrt((e.x * e.y + e.y * e.z + e.z * e.x) / target);
+    std::vector<Vec3> out;
+    for (int pass = 0; pass < 4; ++pass) {
+      std::unordered_map<uint64_t, uint32_t> slot;
+      slot.reserve(4 * target);
+      std::vector<size_t> first;
+      std::vector<uint32_t> count;
+      for (size_t i = 0; i < c.size(); i += stride) {
+        const Vec3 p = c.point(i) - lo;
+        const uint64_t key = uint64_t(p.x / cell) |
+                             uint64_t(p.y / cell) << 21 |
+                             uint64_t(p.z / cell) << 42;
+        const auto it = slot.emplace(key, uint32_t(first.size()));
+        if (it.second) {
+          first.push_back(i);
+          count.push_back(0);
+        }
+        ++count[it.first->second];
+      }
+      std::vector<uint32_t> sorted = count;
+      const auto mid = sorted.begin() + sorted.size() / 2;
+      std::nth_element(sorted.begin(), mid, sorted.end());
+      const uint32_t support = std::max<uint32_t>(1, *mid / 4);
+      out.clear();
+      for (size_t j = 0; j < first.size(); ++j) {
+        if (count[j] >= support)
+          out.push_back(c.point(first[j]));
+      }
+      const double ratio = double(out.size()) / target;
+      if (ratio > 0.8 && ratio < 1.25)
+        break;
+      cell *= std::sqrt(ratio);
+    }
+    return out;
+  }
+
+  // Starting values from the geometry of the cloud
+  State start(const std::vector<Vec3>& sub) const {
+    GEARLAB_TRACE_SCOPE("gearfit.start");
+    State s;
+    // Cone r = b (z - zA) through all points
+    double mz = 0, mr = 0;
+    for (const Vec3& p : sub) {
+      mz += p.z;
+      mr += std::hypot(p.x, p.y);
+    }
+    mz /= sub.size();
+    mr /= sub.size();
+    double szz = 0, szr = 0;
+    for (const Vec3& p : sub) {
+      szz += (p.z - mz) * (p.z - mz);
+      szr += (p.z - mz) * (std::hypot(p.x, p.y) - mr);
+    }
+    if (szz <= 0 || szr == 0)
+      throw std::runtime_error("Scan does not look like a bevel gear");
+    double slope = szr / szz;
+    if (slope < 0) {
+      // Apex up: turn the scan over about x
+      s.pose.rotation = {1, 0, 0, 0, -1, 0, 0, 0, -1};
+      slope = -slope;
+      mz = -mz;
+    }
+    s.pose.translation = Vec3(0, 0, -(mz - mr / slope));
+
+    // That cone leans on the thick end of the teeth. With the apex off by
+    // dz along the axis, polar angles change by about dz sin(g) / R, so the
+    // median polar angle across the face is levelled against 1 / R.
+    constexpr int bands = 16;
+    std::vector<Vec3> p(sub.size());
+    std::vector<double> R(sub.size());
+    for (int pass = 0;; ++pass) {
+      for (size_t i = 0; i < sub.size(); ++i) {
+        p[i] = s.pose.apply(sub[i]);
+        R[i] = p[i].norm();
+      }
+      std::vector<double> sorted = R;
+      std::sort(sorted.begin(), sorted.end());
+      s.innerR = sorted[sorted.size() / 200];
+      s.outerR = sorted[sorted.size() - 1 - sorted.size() / 200];
+      if (s.innerR <= 0 || s.outerR <= s.innerR)
+        throw std::runtime_error("Scan does not look like a bevel gear");
+      if (pass == 8)
+        break;
+      std::array<std::vector<double>, bands> gamma;
+      for (size_t i = 0; i < sub.size(); ++i) {
+        const double t = (R[i] - s.innerR) / (s.outerR - s.innerR);
+        if (t >= 0 && t < 1) {
+          gamma[int(t * bands)].push_back(
+              acos(std::clamp(p[i].z / R[i], -1.0, 1.0)));
+        }
+      }
+      double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0;
+      for (int b = 0; b < bands; ++b) {
+        std::vector<double>& g = gamma[b];
+        if (g.size() < 10)
+          continue;
+        std::nth_element(g.begin(), g.begin() + g.size() / 2, g.end());
+        const double x =
+            1 / (s.innerR + (b + 0.5) / bands * (s.outerR - s.innerR));
+        const double y = g[g.size() / 2];
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n += 1;
+      }
+      if (n < 3)
+        break;
+      const double lean = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+      s.pose.translation.z += lean / sin(sy / n);
+    }
+    // Azimuth spectrum of the polar angle in bands across the face
+    std::vector<int> band(sub.size());
+    std::vector<double> weight(sub.size());
+    std::array<double, bands> mean{}, count{};
+    for (size_t i = 0; i < sub.size(); ++i) {
+      const double t = (R[i] - s.innerR) / (s.outerR - s.innerR);
+      band[i] = std::clamp(int(t * bands), 0, bands - 1);
+      weight[i] = acos(std::clamp(p[i].z / R[i], -1.0, 1.0));
+      mean[band[i]] += weight[i];
+      count[band[i]] += 1;
+    }
+    for (size_t i = 0; i < sub.size(); ++i)
+      weight[i] -= mean[band[i]] / std::max(1.0, count[band[i]]);
+    const auto spectrum = [&](int n) {
+      std::array<std::complex<double>, bands> c{};
+      for (size_t i = 0; i < sub.size(); ++i)
+        c[band[i]] += weight[i] * std::polar(1.0, n * atan2(p[i].y, p[i].x));
+      return c;
+    };
+    double bestScore = -1;
+    for (int n = opt.minTeeth; n <= opt.maxTeeth; ++n) {
+      double score = 0;
+      for (const auto& c : spectrum(n))
+        score += std::abs(c);
+      if (score > bestScore) {
+        bestScore = score;
+        s.numTeeth = n;
+      }
+    }
+
+    // Tooth centre azimuth per band, unwrapped from the middle band, then
+    // fitted as the logarithmic spiral of the mean cone
+    const auto c = spectrum(s.numTeeth);
+    const double pitch = 2 * M_PI / s.numTeeth;
+    std::array<double, bands> centre{};
+    centre[bands / 2] = std::arg(c[bands / 2]) / s.numTeeth;
+    for (int b = bands / 2 + 1; b < bands; ++b) {
+      const double d = std::arg(c[b]) / s.numTeeth - centre[b - 1];
+      centre[b] = centre[b - 1] + d - pitch * std::nearbyint(d / pitch);
+    }
+    for (int b = bands / 2 - 1; b >= 0; --b) {
+      const double d = std::arg(c[b]) / s.numTeeth - centre[b + 1];
+      centre[b] = centre[b + 1] + d - pitch * std::nearbyint(d / pitch);
+    }
+    const double Rm = 0.5 * (s.innerR + s.outerR);
+    s.Rm = Rm;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0;
+    for (int b = 0; b < bands; ++b) {
+      if (count[b] < 10)
+        continue;
+      const double x = log((s.innerR + (b + 0.5) / bands *
+                                           (s.outerR - s.innerR)) /
+                           Rm);
+      sx += x;
+      sy += centre[b];
+      sxx += x * x;
+      sxy += x * centre[b];
+      n += 1;
+    }
+    const double spiral = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    const double phase = (sy - spiral * sx) / n;
+    s.pose = s.pose.then(RigidTransform::rotationAbout(Vec3(0, 0, -phase)));
+
+    // Cone angles from the spread of the polar angle
+    std::vector<double> gamma(sub.size());
+    for (size_t i = 0; i < sub.size(); ++i)
+      gamma[i] = acos(std::clamp(p[i].z / R[i], -1.0, 1.0));
+    std::sort(gamma.begin(), gamma.end());
+    const double tip = gamma[gamma.size() - 1 - gamma.size() / 100];
+    const double root = gamma[gamma.size() / 100];
+    s.pitchGuess = 0.5 * (tip + root);
+    s.g[0] = opt.nominalPressureAngle;
+    s.g[1] = atan(spiral * sin(s.pitchGuess)) / k;
+    s.g[2] = 0;
+    s.g[3] = tip / k;
+    s.g[4] = 0;
+    s.g[5] = root / k;
+    s.g[6] = 0;
+    if (opt.spiralType == Logarithmic && std::fabs(s.g[1]) < 0.5)
+      s.g[1] = 0;
+    return s;
+  }
+
+  // Truncated least squares cost and, if wanted, the normal equations
+  struct Sums {
+    std::array<double, numParams * numParams> A{};
+    std::array<double, numParams> b{};
+    double cost = 0;
+    size_t inliers = 0;
+  };
+
+  // Nearest region without thresholds, for the robust scales
+  struct Nearest {
+    Region region = Region::None;
+    double error = 0;
+  };
+
+  Sums evaluate(const State& s, const std::vector<Vec3>& sub,
+                ThreadPool& pool, bool jacobian,
+                std::vector<Nearest>* nearest = nullptr) const {
+    const BevelGear base = makeGear(s, s.g.data());
+    const ToothFlank f(base);
+    // Models with one gear parameter stepped
+    std::vector<ToothFlank> stepped;
+    std::array<double, numParams> h{};
+    if (jacobian) {
+      h = {1e-4, 1e-4, 1e-6, 1e-4, 1e-4, 1e-4, 1e-4,
+           1e-7, 1e-7, 1e-7, 1e-6, 1e-6, 1e-6};
+      for (int j = 0; j < gearParams; ++j) {
+        std::array<double, gearParams> g = s.g;
+        g[j] += h[j];
+        stepped.emplace_back(makeGear(s, g.data()));
+      }
+    }
+    const double outlier =
+        *std::max_element(s.threshold.begin(), s.threshold.end());
+    const Thresholds open{HUGE_VAL, HUGE_VAL, HUGE_VAL};
+    const size_t chunks = (sub.size() + chunk - 1) / chunk;
+    std::vector<Sums> sums(chunks);
+    pool.parallelFor(0, chunks, [&](size_t c) {
+      Sums& out = sums[c];
+      for (size_t i = c * chunk, e = std::min(sub.size(), i + chunk); i < e;
+           ++i) {
+        const Vec3 p = s.pose.apply(sub[i]);
+        double r = 0;
+        if (nearest) {
+          Nearest& n = (*nearest)[i];
+          n.region = classify(f, p, open, n.error);
+          n.error = std::fabs(n.error);
+        }
+        const Region region = classify(f, p, s.threshold, r);
+        if (region == Region::None) {
+          out.cost += outlier * outlier;
+          continue;
+        }
+        out.cost += r * r;
+        ++out.inliers;
+        if (!jacobian)
+          continue;
+        double J[numParams];
+        for (int j = 0; j < gearParams; ++j)
+          J[j] = (residual(stepped[j], region, p) - r) / h[j];
+        for (int a = 0; a < 3; ++a) {
+          Vec3 w;
+          (a == 0 ? w.x : a == 1 ? w.y : w.z) = h[gearParams + a];
+          J[gearParams + a] =
+              (residual(f, region, p + w.cross(p)) - r) / h[gearParams + a];
+          Vec3 v;
+          (a == 0 ? v.x : a == 1 ? v.y : v.z) = h[gearParams + 3 + a];
+          J[gearParams + 3 + a] =
+              (residual(f, region, p + v) - r) / h[gearParams + 3 + a];
+        }
+        for (int a = 0; a < numParams; ++a) {
+          for (int q = a; q < numParams; ++q)
+            out.A[a * numParams + q] += J[a] * J[q];
+          out.b[a] -= J[a] * r;
+        }
+      }
+    });
+    Sums total;
+    for (const Sums& c : sums) {
+      for (size_t j = 0; j < total.A.size(); ++j)
+        total.A[j] += c.A[j];
+      for (int j = 0; j < numParams; ++j)
+        total.b[j] += c.b[j];
+      total.cost += c.cost;
+      total.inliers += c.inliers;
+    }
+    return total;
+  }
+
+  // Robust thresholds from the residuals of the last pass, per region so
+  // a land that is still far off keeps pulling. Points already beyond the
+  // last threshold are stray returns and do not widen it again.
+  Thresholds thresholds(const std::vector<Nearest>& nearest,
+                        const Thresholds& last) const {
+    Thresholds t = last;
+    std::vector<double> e;
+    for (int r = 0; r < 3; ++r) {
+      e.clear();
+      for (const Nearest& n : nearest) {
+        if (int(n.region) == r + 1 && n.error <= last[r])
+          e.push_back(n.error);
+      }
+      if (e.size() < 10)
+        continue;
+      auto mid = e.begin() + e.size() / 2;
+      std::nth_element(e.begin(), mid, e.end());
+      t[r] = std::max(opt.cutoff * 1.4826 * *mid, opt.minThreshold);
+    }
+    return t;
+  }
+
+  // Damped step (A + lambda diag A) x = b; parameters without any pull
+  // stay where they are
+  static bool step(const Sums& s, double lambda,
+                   std::array<double, numParams>& x) {
+    double M[numParams][numParams + 1];
+    double top = 0;
+    for (int a = 0; a < numParams; ++a)
+      top = std::max(top, s.A[a * numParams + a]);
+    for (int a = 0; a < numParams; ++a) {
+      for (int q = 0; q < numParams; ++q) {
+        M[a][q] = a <= q ? s.A[a * numParams + q] : s.A[q * numParams + a];
+      }
+      const double d = s.A[a * numParams + a];
+      if (d <= 1e-12 * top) {
+        for (int q = 0; q < numParams; ++q)
+          M[a][q] = M[q][a] = 0;
+        M[a][a] = 1;
+        M[a][numParams] = 0;
+      } else {
+        M[a][a] += lambda * d;
+        M[a][numParams] = s.b[a];
+      }
+    }
+    for (int c = 0; c < numParams; ++c) {
+      int p = c;
+      for (int r = c + 1; r < numParams; ++r) {
+        if (std::fabs(M[r][c]) > std::fabs(M[p][c]))
+          p = r;
+      }
+      if (M[p][c] == 0)
+        return false;
+      for (int q = 0; q <= numParams; ++q)
+        std::swap(M[c][q], M[p][q]);
+      for (int r = c + 1; r < numParams; ++r) {
+        const double f = M[r][c] / M[c][c];
+        for (int q = c; q <= numParams; ++q)
+          M[r][q] -= f * M[c][q];
+      }
+    }
+    for (int r = numParams - 1; r >= 0; --r) {
+      double v = M[r][numParams];
+      for (int q = r + 1; q < numParams; ++q)
+        v -= M[r][q] * x[q];
+      x[r] = v / M[r][r];
+    }
+    return true;
+  }
+
+  State apply(const State& s, const std::array<double, numParams>& x) const {
+    State t = s;
+    for (int j = 0; j < gearParams; ++j)
+      t.g[j] += x[j];
+    RigidTransform move = RigidTransform::rotationAbout(
+        Vec3(x[gearParams], x[gearParams + 1], x[gearParams + 2]));
+    move.translation =
+        Vec3(x[gearParams + 3], x[gearParams + 4], x[gearParams + 5]);
+    t.pose = s.pose.then(move);
+    return t;
+  }
+
+  static bool plausible(const State& s) {
+    return std::fabs(s.g[2]) < 1.5 && s.g[0] > 0 && s.g[0] < 60 &&
+           std::fabs(s.g[1]) < 75 && s.g[3] < 180 && s.g[5] > 0 &&
+           s.g[5] < s.g[3];
+  }
+
+  State solve(State s, const std::vector<Vec3>& sub, ThreadPool& pool,
+              int maxIterations) const {
+    GEARLAB_TRACE_SCOPE("gearfit.solve");
+    std::vector<Nearest> nearest(sub.size());
+    // Everything within a module pulls at first, a mate count of a fitted
+    // surface goes on at the thresholds it had
+    if (s.threshold[0] == 0) {
+      const double module =
+          2 * s.Rm * sin(pitchCone(s.numTeeth, s.mate)) / s.numTeeth;
+      s.threshold = {module, module, module};
+    }
+    double lambda = 1e-3;
+    int it = 0;
+    for (; it < maxIterations; ++it) {
+      const Sums sums = evaluate(s, sub, pool, true, &nearest);
+      if (sums.inliers < numParams)
+        throw std::runtime_error("Gear fit lost the scan");
+      bool moved = false, small = true;
+      for (int tries = 0; tries < 8 && !moved; ++tries) {
+        std::array<double, numParams> x{};
+        if (!step(sums, lambda, x))
+          break;
+        const State t = apply(s, x);
+        const double cost = plausible(t)
+                                ? evaluate(t, sub, pool, false).cost
+                                : std::numeric_limits<double>::infinity();
+        if (cost < sums.cost) {
+          moved = true;
+          small = sums.cost - cost < 1e-10 * sums.cost;
+          lambda = std::max(lambda / 10, 1e-9);
+          s = t;
+        } else {
+          lambda *= 10;
+        }
+      }
+      // Thresholds only tighten; done once they and the cost settle
+      const Thresholds next = thresholds(nearest, s.threshold);
+      bool settled = true;
+      for (int r = 0; r < 3; ++r) {
+        settled &= next[r] > 0.99 * s.threshold[r];
+        s.threshold[r] = std::min(s.threshold[r], next[r]);
+      }
+      if (settled && small)
+        break;
+    }
+    s.cost = evaluate(s, sub, pool, false).cost;
+    s.iterations = it;
+    s.solved = true;
+    return s;
+  }
+
+  // Final statistics over the whole scan. The flank extents are the outer
+  // cone distance bins holding a usual share of flank points, so stray
+  // returns that happen to lie on a flank do not widen the face.
+  GearFitResult finish(State s, const PointCloud& cloud,
+                       ThreadPool& pool) const {
+    GEARLAB_TRACE_SCOPE("gearfit.finish");
+    GearFitResult r;
+    const ToothFlank f(makeGear(s, s.g.data()));
+    constexpr size_t blocks = 64, bins = 4096;
+    const double binWidth = 1.5 * s.outerR / bins;
+    struct Stats {
+      double sse = 0;
+      size_t region[4] = {0, 0, 0, 0};
+      std::vector<uint32_t> R = std::vector<uint32_t>(bins);
+    };
+    std::vector<Stats> stats(blocks);
+    memory::Reservation held(memory::Category::Other,
+                             blocks * bins * sizeof(uint32_t));
+    pool.parallelFor(0, blocks, [&](size_t c) {
+      Stats& out = stats[c];
+      for (size_t i = cloud.size() * c / blocks,
+                  e = cloud.size() * (c + 1) / blocks;
+           i < e; ++i) {
+        const Vec3 p = s.pose.apply(cloud.point(i));
+        double d = 0;
+        const Region region = classify(f, p, s.threshold, d);
+        ++out.region[int(region)];
+        if (region == Region::None)
+          continue;
+        out.sse += d * d;
+        if (region == Region::Flank)
+          ++out.R[std::min(bins - 1, size_t(p.norm() / binWidth))];
+      }
+    });
+    Stats total;
+    for (const Stats& c : stats) {
+      total.sse += c.sse;
+      for (int j = 0; j < 4; ++j)
+        total.region[j] += c.region[j];
+      for (size_t j = 0; j < bins; ++j)
+        total.R[j] += c.R[j];
+    }
+    std::vector<uint32_t> used;
+    for (uint32_t n : total.R) {
+      if (n > 0)
+        used.push_back(n);
+    }
+    if (!used.empty()) {
+      const auto mid = used.begin() + used.size() / 2;
+      std::nth_element(used.begin(), mid, used.end());
+      const uint32_t support = std::max<uint32_t>(1, *mid / 4);
+      size_t lo = 0, hi = bins - 1;
+      while (total.R[lo] < support)
+        ++lo;
+      while (total.R[hi] < support)
+        --hi;
+      s.innerR = lo * binWidth;
+      s.outerR = (hi + 1) * binWidth;
+    }
+    // Module from the addendum (1 + x) m = tip0 + Rm tip1 of the face cone
+    const double pa = pitchCone(s.numTeeth, s.mate);
+    const double fa = s.g[3] * k;
+    const double tip0 = s.g[4] * sin(fa) / cos(fa - pa);
+    const double den = 1 + s.g[2] - tan(fa - pa) * s.numTeeth / (2 * sin(pa));
+    double m = (s.innerR + s.outerR) * sin(pa) / s.numTeeth;
+    if (std::fabs(tip0) > 1e-3 * m && tip0 / den > 0.1 * m &&
+        tip0 / den < 10 * m) {
+      m = tip0 / den;
+    }
+    const double Rm = m * s.numTeeth / (2 * sin(pa));
+    if (!opt.pinion) {
+      r.pair = BevelGearPair(s.numTeeth, s.mate, m, opt.backlash,
+                             opt.coneClearance, opt.shaftAngle, s.g[3],
+                             s.g[5], s.g[4], s.g[6], s.innerR, s.outerR,
+                             s.g[0], s.g[1], opt.spiralType);
+      r.hasPair = true;
+      r.gear = r.pair.makeGear();
+    } else {
+      const double ra = s.g[5] * k;
+      r.gear = BevelGear(s.numTeeth, pa / k, s.g[3], s.g[5], m, s.g[4],
+                         s.g[6], s.innerR, s.outerR, Rm,
+                         tip0 + Rm * tan(fa - pa),
+                         -s.g[6] * sin(ra) / cos(pa - ra) + Rm * tan(pa - ra),
+                         opt.backlash, opt.shaftAngle, s.g[0], s.g[1],
+                         opt.spiralType);
+    }
+    // The spiral is centred on the new pitch cone distance: keep tooth 0
+    // centred on +x there
+    r.registration = s.pose.then(RigidTransform::rotationAbout(
+        Vec3(0, 0, ToothFlank(*r.gear).spiralOffset(s.Rm))));
+    r.mateTeeth = s.mate;
+    r.points = cloud.size();
+    r.flankPoints = total.region[int(Region::Flank)];
+    r.tipPoints = total.region[int(Region::Tip)];
+    r.rootPoints = total.region[int(Region::Root)];
+    r.inliers = r.flankPoints + r.tipPoints + r.rootPoints;
+    r.rms = r.inliers ? sqrt(total.sse / r.inliers) : 0;
+    r.iterations = s.iterations;
+    return r;
+  }
+
+  GearFitOptions opt;
+};
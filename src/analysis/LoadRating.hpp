@@ -0,0 +1,406 @@
+// LoadRating.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Pitting and tooth root bending rating of bevel gear pairs following the
+// structure of ISO 10300 method B1: each member is replaced by its virtual
+// cylindrical gear at the mean cone distance and rated with the cylindrical
+// gear relations. Module and addenda of GearLab pairs are defined at the
+// pitch (mean) cone distance, face width is outer - inner cone distance.
+//
+// Simplifications against the full standard, good enough for ranking and
+// screening designs in sweeps:
+//  - load factors KA, KV, KHb, KHa are inputs (ISO 10300 method C style)
+//  - the combined tooth form factor YFS = YFa * YSa uses the approximation
+//    for a 20 deg standard rack in terms of virtual tooth count and the
+//    addendum modification implied by the mean addendum
+//  - life factors use the case hardened steel S-N curves of ISO 6336
+//  - ZL, ZV, ZR, ZW, ZX and YdrelT, YRrelT, YX are taken as 1
+
+// Material of one member (N/mm^2)
+struct RatingMaterial {
+  double youngsModulus = 206000;
+  double poissonRatio = 0.3;
+  double sigmaHlim = 1500;  // Pitting endurance limit
+  double sigmaFlim = 500;   // Nominal bending endurance limit
+};
+
+// Load factors applied to the nominal mesh force
+struct RatingFactors {
+  double KA = 1.0;    // Application
+  double KV = 1.05;   // Dynamic
+  double KHb = 1.65;  // Face load (1.5 * KHb-be, one member cantilevered)
+  double KHa = 1.0;   // Transverse load, pitting
+  double KFa = 1.0;   // Transverse load, bending
+};
+
+// One bin of a load spectrum, torque and speed at the pinion
+struct LoadBin {
+  double torque;  // Nm
+  double speed;   // rpm
+  double hours;
+};
+
+using LoadSpectrum = std::vector<LoadBin>;
+
+// Virtual cylindrical gear pair data of one design
+struct VirtualCylindricalGears {
+  double dv1, dv2;      // Reference diameters
+  double zv1, zv2;      // Virtual tooth counts
+  double zvn1, zvn2;    // Virtual tooth counts of the normal section
+  double uv;            // Virtual gear ratio dv2 / dv1
+  double alphaVt;       // Transverse pressure angle (rad)
+  double betaVb;        // Base helix angle (rad)
+  double epsAlpha;      // Transverse contact ratio
+  double epsBeta;       // Face contact ratio
+  double faceWidth;
+  double normalModule;  // Mean normal module
+};
+
+// Gear pairs in structure-of-arrays layout, index 1 is the pinion and
+// index 2 the gear as in ISO 10300
+struct RatingInputs {
+  std::vector<double> z1, z2;
+  std::vector<double> delta1, delta2;  // Pitch cone angles (deg)
+  std::vector<double> ha1, ha2;        // Mean addenda
+  std::vector<double> module;          // Mean transverse module
+  std::vector<double> faceWidth;
+  std::vector<double> pressureAngle;   // Normal pressure angle (deg)
+  std::vector<double> spiralAngle;     // Mean spiral angle (deg)
+
+  size_t size() const { return z1.size(); }
+
+  void reserve(size_t n) {
+    for (auto* v : columns())
+      v->reserve(n);
+  }
+
+  // Pair from the pinion and gear members of a BevelGearPair
+  void push_back(const BevelGear& pinion, const BevelGear& gear) {
+    z1.push_back(pinion.numTeeth);
+    z2.push_back(gear.numTeeth);
+    delta1.push_back(pinion.pitchConeAngle);
+    delta2.push_back(gear.pitchConeAngle);
+    ha1.push_back(pinion.addendum);
+    ha2.push_back(gear.addendum);
+    module.push_back(gear.module);
+    faceWidth.push_back(gear.outerConeDistance - gear.innerConeDistance);
+    pressureAngle.push_back(gear.pressureAngle);
+    spiralAngle.push_back(gear.spiralAngle);
+  }
+
+  void push_back(const BevelGearPair& pair) {
+    push_back(pair.makePinion(), pair.makeGear());
+  }
+
+private:
+  std::vector<std::vector<double>*> columns() {
+    return {&z1, &z2,      &delta1,    &delta2,        &ha1,
+            &ha2, &module, &faceWidth, &pressureAngle, &spiralAngle};
+  }
+};
+
+// Rating results, same layout and indexing as RatingInputs. Safety factors
+// are the minimum over the spectrum bins, damage is the Miner sum over the
+// spectrum (1 = end of life).
+struct RatingResults {
+  std::vector<double> pittingSafety1, pittingSafety2;
+  std::vector<double> bendingSafety1, bendingSafety2;
+  std::vector<double> pittingDamage1, pittingDamage2;
+  std::vector<double> bendingDamage1, bendingDamage2;
+
+  size_t size() const { return pittingSafety1.size(); }
+
+  void resize(size_t n) {
+    for (auto* v : {&pittingSafety1, &pittingSafety2, &bendingSafety1,
+                    &bendingSafety2, &pittingDamage1, &pittingDamage2,
+                    &bendingDamage1, &bendingDamage2})
+      v->assign(n, 0.0);
+  }
+
+  double minPittingSafety(size_t i) const {
+    return std::min(pittingSafety1[i], pittingSafety2[i]);
+  }
+  double minBendingSafety(size_t i) const {
+    return std::min(bendingSafety1[i], bendingSafety2[i]);
+  }
+};
+
+struct LoadRating {
+  RatingMaterial pinionMaterial;
+  RatingMaterial gearMaterial;
+  RatingFactors factors;
+  double effectiveWidthRatio = 0.85;  // Loaded share of the face width
+  double bevelFactor = 0.85;          // ZK
+
+  // Virtual cylindrical gears of design i
+  static VirtualCylindricalGears virtualGears(const RatingInputs& in,
+                                              size_t i) {
+    const double k = M_PI / 180;
+    VirtualCylindricalGears v;
+    const double beta = in.spiralAngle[i] * k;
+    const double alphaN = in.pressureAngle[i] * k;
+    // Crown gears (delta = 90 deg) have an infinite virtual diameter
+    const double c1 = std::fmax(std::fabs(cos(in.delta1[i] * k)), 1e-6);
+    const double c2 = std::fmax(std::fabs(cos(in.delta2[i] * k)), 1e-6);
+    const double m = in.module[i];
+    v.dv1 = m * in.z1[i] / c1;
+    v.dv2 = m * in.z2[i] / c2;
+    v.zv1 = in.z1[i] / c1;
+    v.zv2 = in.z2[i] / c2;
+    v.uv = v.dv2 / v.dv1;
+    v.normalModule = m * cos(beta);
+    v.alphaVt = atan(tan(alphaN) / cos(beta));
+    v.betaVb = asin(sin(beta) * cos(alphaN));
+    const double cb = cos(v.betaVb);
+    v.zvn1 = v.zv1 / (cb * cb * cos(beta));
+    v.zvn2 = v.zv2 / (cb * cb * cos(beta));
+    v.faceWidth = in.faceWidth[i];
+
+    // Length of path of contact over the transverse base pitch
+    const double db1 = v.dv1 * cos(v.alphaVt), db2 = v.dv2 * cos(v.alphaVt);
+    const double da1 = v.dv1 + 2 * in.ha1[i], da2 = v.dv2 + 2 * in.ha2[i];
+    const double av = (v.dv1 + v.dv2) / 2;
+    const double gva = 0.5 * sqrt(std::fmax(da1 * da1 - db1 * db1, 0)) +
+                       0.5 * sqrt(std::fmax(da2 * da2 - db2 * db2, 0)) -
+                       av * sin(v.alphaVt);
+    v.epsAlpha = gva / (M_PI * m * cos(v.alphaVt));
+    v.epsBeta = v.faceWidth * sin(beta) / (M_PI * v.normalModule);
+    return v;
+  }
+
+  // Combined tooth form factor YFa * YSa for a 20 deg standard rack
+  static double toothFormFactor(double zvn, double x) {
+    return 3.47 + 13.17 / zvn - 27.9 * x / zvn + 0.092 * x * x;
+  }
+
+  // Life factors of case hardened steel for n load cycles: (knee / n)^e
+  // between the static limit and the endurance knee
+  static constexpr double pittingKnee = 5e7, pittingExponent = 0.0756;
+  static constexpr double bendingKnee = 3e6, bendingExponent = 0.115;
+
+  static double pittingLifeFactor(double n) {
+    return n <= 1e5           ? 1.6
+           : n >= pittingKnee ? 1.0
+                              : pow(pittingKnee / n, pittingExponent);
+  }
+  static double bendingLifeFactor(double n) {
+    return n <= 1e3           ? 2.5
+           : n >= bendingKnee ? 1.0
+                              : pow(bendingKnee / n, bendingExponent);
+  }
+
+  // Rate all designs under the spectrum. Designs are split into blocks that
+  // run on the pool. A block first derives the per design stresses at unit
+  // torque, then runs one branch-free loop over its designs per load bin;
+  // those loops are the vectorised kernel (see rateRange).
+  RatingResults rate(const RatingInputs& in, const LoadSpectrum& spectrum,
+                     ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("loadRating");
+    const size_t n = in.size();
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             n * 8 * sizeof(double));
+    RatingResults out;
+    out.resize(n);
+    pool.parallelFor(0, (n + block - 1) / block, [&](size_t b) {
+      rateRange(in, spectrum, out, b * block, std::min(n, (b + 1) * block));
+    });
+    return out;
+  }
+
+  // Single pair convenience wrapper
+  RatingResults rate(const BevelGearPair& pair,
+                     const LoadSpectrum& spectrum) const {
+    RatingInputs in;
+    in.push_back(pair);
+    RatingResults out;
+    out.resize(1);
+    rateRange(in, spectrum, out, 0, 1);
+    return out;
+  }
+
+private:
+  static constexpr size_t block = 256;
+
+  // Per design terms of a block, structure-of-arrays. Stresses are at a
+  // pinion torque of 1 Nm: contact stress grows with sqrt(T), root stress
+  // with T, so a bin only scales them. Fixed arrays in one local object
+  // let the compiler prove the kernel's loads and stores do not overlap;
+  // through separate heap buffers it would need more runtime alias checks
+  // than it versions a loop for.
+  struct BlockTerms {
+    double sigmaH[block], sigmaF1[block], sigmaF2[block];
+    double ratio[block];               // Gear cycles per pinion cycle
+    double lifeH[block], lifeF[block];  // ratio^-e, gear life factor scale
+    // (sigma / limit)^(1 / e) / knee: Miner damage per cycle at 1 Nm
+    double damageH1[block], damageH2[block], damageF1[block],
+        damageF2[block];
+    // Results
+    double SH1[block], SH2[block], SF1[block], SF2[block];
+    double DH1[block], DH2[block], DF1[block], DF2[block];
+  };
+
+  void blockTerms(const RatingInputs& in, size_t begin, size_t end,
+                  BlockTerms& t) const {
+    const double ZE = elasticityFactor();
+    const RatingFactors& f = factors;
+    const double KH = f.KA * f.KV * f.KHb * f.KHa;
+    const double KF = f.KA * f.KV * f.KHb * f.KFa;  // KFb = KHb for spiral
+    const double limH1 = pinionMaterial.sigmaHlim;
+    const double limH2 = gearMaterial.sigmaHlim;
+    // YST = 2 turns the nominal limit into the test gear limit
+    const double limF1 = 2 * pinionMaterial.sigmaFlim;
+    const double limF2 = 2 * gearMaterial.sigmaFlim;
+
+    for (size_t k = 0; k < end - begin; ++k) {
+      const size_t i = begin + k;
+      const VirtualCylindricalGears v = virtualGears(in, i);
+      const double beta = in.spiralAngle[i] * M_PI / 180;
+      const double cb = cos(v.betaVb);
+
+      // Pitting: nominal stress per unit sqrt(Ft)
+      const double ZH =
+          sqrt(2 * cb / (cos(v.alphaVt) * cos(v.alphaVt) * tan(v.alphaVt)));
+      const double eb = std::fmin(v.epsBeta, 1.0);
+      const double Zeps =
+          sqrt((4 - v.epsAlpha) / 3 * (1 - eb) + eb / v.epsAlpha);
+      const double Zbeta = sqrt(cos(beta));
+      const double bH = effectiveWidthRatio * v.faceWidth;
+      const double sigmaH0PerSqrtF = ZH * ZE * Zeps * Zbeta * bevelFactor *
+                                     sqrt((v.uv + 1) / (v.dv1 * bH * v.uv));
+
+      // Bending: nominal stress per unit Ft for each member
+      const double mn = v.normalModule;
+      const double x1 = (in.ha1[i] - in.module[i]) / in.module[i];
+      const double x2 = (in.ha2[i] - in.module[i]) / in.module[i];
+      const double epsAlphaN = v.epsAlpha / (cb * cb);
+      const double Yeps = 0.25 + 0.75 / epsAlphaN;
+      const double Ybeta = std::fmax(1 - v.epsBeta * in.spiralAngle[i] / 120,
+                                     std::fmax(1 - 0.25 * v.epsBeta, 0.75));
+      const double bF = effectiveWidthRatio * v.faceWidth;
+      const double sigmaF1PerF =
+          toothFormFactor(v.zvn1, x1) * Yeps * Ybeta / (bF * mn);
+      const double sigmaF2PerF =
+          toothFormFactor(v.zvn2, x2) * Yeps * Ybeta / (bF * mn);
+
+      // Tangential force per Nm at the mean pinion diameter
+      const double FtPerT = 2000 / (in.module[i] * in.z1[i]);
+      t.sigmaH[k] = sigmaH0PerSqrtF * sqrt(FtPerT * KH);
+      t.sigmaF1[k] = sigmaF1PerF * FtPerT * KF;
+      t.sigmaF2[k] = sigmaF2PerF * FtPerT * KF;
+      t.ratio[k] = in.z1[i] / in.z2[i];
+      t.lifeH[k] = pow(t.ratio[k], -pittingExponent);
+      t.lifeF[k] = pow(t.ratio[k], -bendingExponent);
+      t.damageH1[k] =
+          pow(t.sigmaH[k] / limH1, 1 / pittingExponent) / pittingKnee;
+      t.damageH2[k] =
+          pow(t.sigmaH[k] / limH2, 1 / pittingExponent) / pittingKnee;
+      t.damageF1[k] =
+          pow(t.sigmaF1[k] / limF1, 1 / bendingExponent) / bendingKnee;
+      t.damageF2[k] =
+          pow(t.sigmaF2[k] / limF2, 1 / bendingExponent) / bendingKnee;
+    }
+  }
+
+  // Safety factors are the minimum over the bins of limit * life / stress.
+  // Miner damage adds n / N with the cycles to failure
+  // N = knee * (stress / limit)^(-1 / e) above the limit, infinite below.
+  // Everything that depends only on the bin is hoisted out of the design
+  // loop, so the loop body is products, divisions and selects.
+  void rateRange(const RatingInputs& in, const LoadSpectrum& spectrum,
+                 RatingResults& out, size_t begin, size_t end) const {
+    for (; begin < end; begin += block)
+      rateBlock(in, spectrum, out, begin, std::min(end, begin + block));
+  }
+
+  void rateBlock(const RatingInputs& in, const LoadSpectrum& spectrum,
+                 RatingResults& out, size_t begin, size_t end) const {
+    const size_t m = end - begin;
+    BlockTerms t;
+    blockTerms(in, begin, end, t);
+    const double limH1 = pinionMaterial.sigmaHlim;
+    const double limH2 = gearMaterial.sigmaHlim;
+    const double limF1 = 2 * pinionMaterial.sigmaFlim;
+    const double limF2 = 2 * gearMaterial.sigmaFlim;
+    const double inf = std::numeric_limits<double>::infinity();
+    for (size_t k = 0; k < m; ++k) {
+      t.SH1[k] = t.SH2[k] = t.SF1[k] = t.SF2[k] = inf;
+      t.DH1[k] = t.DH2[k] = t.DF1[k] = t.DF2[k] = 0;
+    }
+
+    for (const LoadBin& bin : spectrum) {
+      const double sqrtT = sqrt(bin.torque);
+      const double n1 = bin.speed * 60 * bin.hours;
+      // Pinion life factors, and the gear ones before the ratio^-e scale
+      const double ZNT1 = pittingLifeFactor(n1);
+      const double YNT1 = bendingLifeFactor(n1);
+      const double powH = pow(pittingKnee / n1, pittingExponent);
+      const double powF = pow(bendingKnee / n1, bendingExponent);
+      // Cycles times the torque term of (stress / limit)^(1 / e)
+      const double cyclesH = n1 * pow(sqrtT, 1 / pittingExponent);
+      const double cyclesF = n1 * pow(bin.torque, 1 / bendingExponent);
+
+      // The loop must stay free of branches to vectorise. GCC sinks an
+      // operation that only one arm of a select uses into a branch, and as
+      // floating point may trap it cannot if-convert it back, so every
+      // value is used unconditionally and the cases only pick constants
+      // for min/max clamps.
+      for (size_t k = 0; k < m; ++k) {
+        const double n2 = n1 * t.ratio[k];
+        // Static limit below 1e5 (1e3) cycles, 1 past the knee
+        const double ZNT2 = std::min(std::max(powH * t.lifeH[k],
+                                              n2 <= 1e5 ? 1.6 : 1.0),
+                                     n2 <= 1e5 ? 1.6 : inf);
+        const double YNT2 = std::min(std::max(powF * t.lifeF[k],
+                                              n2 <= 1e3 ? 2.5 : 1.0),
+                                     n2 <= 1e3 ? 2.5 : inf);
+        const double sH = t.sigmaH[k] * sqrtT;
+        const double sF1 = t.sigmaF1[k] * bin.torque;
+        const double sF2 = t.sigmaF2[k] * bin.torque;
+
+        t.SH1[k] = std::min(t.SH1[k], limH1 * ZNT1 / sH);
+        t.SH2[k] = std::min(t.SH2[k], limH2 * ZNT2 / sH);
+        t.SF1[k] = std::min(t.SF1[k], limF1 * YNT1 / sF1);
+        t.SF2[k] = std::min(t.SF2[k], limF2 * YNT2 / sF2);
+
+        const double dH1 = cyclesH * t.damageH1[k];
+        const double dH2 = cyclesH * t.ratio[k] * t.damageH2[k];
+        const double dF1 = cyclesF * t.damageF1[k];
+        const double dF2 = cyclesF * t.ratio[k] * t.damageF2[k];
+        // No damage at or below the limit; the terms are not negative
+        t.DH1[k] += std::min(dH1, sH > limH1 ? inf : 0.0);
+        t.DH2[k] += std::min(dH2, sH > limH2 ? inf : 0.0);
+        t.DF1[k] += std::min(dF1, sF1 > limF1 ? inf : 0.0);
+        t.DF2[k] += std::min(dF2, sF2 > limF2 ? inf : 0.0);
+      }
+    }
+
+    std::copy(t.SH1, t.SH1 + m, out.pittingSafety1.begin() + begin);
+    std::copy(t.SH2, t.SH2 + m, out.pittingSafety2.begin() + begin);
+    std::copy(t.SF1, t.SF1 + m, out.bendingSafety1.begin() + begin);
+    std::copy(t.SF2, t.SF2 + m, out.bendingSafety2.begin() + begin);
+    std::copy(t.DH1, t.DH1 + m, out.pittingDamage1.begin() + begin);
+    std::copy(t.DH2, t.DH2 + m, out.pittingDamage2.begin() + begin);
+    std::copy(t.DF1, t.DF1 + m, out.bendingDamage1.begin() + begin);
+    std::copy(t.DF2, t.DF2 + m, out.bendingDamage2.begin() + begin);
+  }
+
+  double elasticityFactor() const {
+    const RatingMaterial& a = pinionMaterial;
+    const RatingMaterial& b = gearMaterial;
+    return sqrt(1 / (M_PI * ((1 - a.poissonRatio * a.poissonRatio) /
+                                 a.youngsModulus +
+                             (1 - b.poissonRatio * b.poissonRatio) /
+                                 b.youngsModulus)));
+  }
+};
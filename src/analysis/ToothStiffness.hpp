@@ -0,0 +1,493 @@
+// ToothStiffness.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/Trace.hpp"
+#include "LoadRating.hpp"
+
+// Reduced-order model of tooth pair stiffness and root stress as functions of
+// the pinion roll angle.
+//
+// The flank of one tooth pair is discretised on the plane of action of the
+// virtual cylindrical gears into faceSlices x profilePoints nodes. The
+// influence coefficients of every node on every other node are assembled
+// once: cantilever bending, shear and foundation (Weber) compliance of both
+// teeth, coupled across the face width by an exponential plate decay.
+// For a grid of contact line positions over the engagement the compliance is
+// condensed onto the contact points and inverted, giving a small stiffness
+// matrix per position. Those are cached, so evaluating stiffness, load
+// sharing and root stress at any load is a matrix-vector product.
+//
+// Roll angles are pinion rotation in deg from the first contact of a tooth
+// pair; one mesh cycle is 360 / z1.
+
+struct ToothStiffnessOptions {
+  int faceSlices = 12;
+  int profilePoints = 16;
+  int positions = 128;  // Cached contact line positions over the engagement
+  double youngsModulus = 206000;
+  double poissonRatio = 0.3;
+};
+
+// Combined state of all tooth pairs in mesh at one roll angle
+struct MeshLoadState {
+  double stiffness = 0;     // Combined mesh stiffness (N/mm)
+  double deflection = 0;    // Mesh deflection along the line of action (mm)
+  double pinionRootStress = 0;  // Largest root stress over pairs (N/mm^2)
+  double gearRootStress = 0;
+  int pairsInContact = 0;
+};
+
+class ToothStiffnessModel {
+public:
+  explicit ToothStiffnessModel(const BevelGearPair& pair,
+                               ToothStiffnessOptions options = {})
+      : opt(options) {
+    if (!pair.validateToothCounts() || opt.faceSlices < 1 ||
+        opt.profilePoints < 2 || opt.positions < 2) {
+      throw std::invalid_argument("Invalid input for ToothStiffnessModel");
+    }
+    GEARLAB_TRACE_SCOPE("toothStiffness.build");
+    z1 = pair.numPinionTeeth;
+    setupGeometry(pair);
+    assembleInfluence();
+    condensePositions();
+    // Only the condensed positions are needed from here on
+    std::vector<double>().swap(C);
+    std::vector<double>().swap(R1);
+    std::vector<double>().swap(R2);
+    influence.reset();
+  }
+
+  // Pinion roll angle of one mesh cycle (deg)
+  double meshCycle() const { return 360.0 / z1; }
+
+  // Pinion roll angle over which one tooth pair is in contact (deg)
+  double engagement() const { return (xiEnd - xiBegin) * meshCycle(); }
+
+  // Stiffness of one tooth pair (N/mm), 0 outside its engagement
+  double singleStiffness(double rollAngle) const {
+    return interpolate(rollAngle, [](const Position& p) { return p.k; });
+  }
+
+  // Sum over all tooth pairs in contact, periodic in the mesh cycle
+  double meshStiffness(double rollAngle) const {
+    double k = 0;
+    forEachPair(rollAngle, [&](double a) { k += singleStiffness(a); });
+    return k;
+  }
+
+  // Batched evaluation for dynamics and sweeps
+  void meshStiffness(const double* rollAngles, size_t n, double* out) const {
+    for (size_t i = 0; i < n; ++i)
+      out[i] = meshStiffness(rollAngles[i]);
+  }
+
+  // Combined mesh under a normal force (N). Pairs share the force in
+  // proportion to their stiffness at the common mesh deflection.
+  MeshLoadState evaluate(double rollAngle, double force) const {
+    MeshLoadState s;
+    s.stiffness = meshStiffness(rollAngle);
+    if (s.stiffness <= 0)
+      return s;
+    s.deflection = force / s.stiffness;
+    forEachPair(rollAngle, [&](double a) {
+      const double k = singleStiffness(a);
+      if (k <= 0)
+        return;
+      ++s.pairsInContact;
+      const double d = s.deflection;
+      s.pinionRootStress = std::max(
+          s.pinionRootStress,
+          d * interpolate(a, [](const Position& p) { return p.sigma1; }));
+      s.gearRootStress = std::max(
+          s.gearRootStress,
+          d * interpolate(a, [](const Position& p) { return p.sigma2; }));
+    });
+    return s;
+  }
+
+  // Load per face slice (N) of one tooth pair carrying force (N) with an
+  // initial separation per slice (mm, e.g. from misalignment or crowning).
+  // Uses the cached stiffness matrix of the nearest position: p = K (d - e)
+  // with d chosen so the loads sum to force. Slices that would pull are
+  // clipped to zero without re-condensing.
+  std::vector<double> loadDistribution(
+      double rollAngle, double force,
+      const std::vector<double>& separation) const {
+    std::vector<double> load(opt.faceSlices, 0.0);
+    const Position* p = nearest(rollAngle);
+    if (!p || p->slices.empty())
+      return load;
+    const size_t m = p->slices.size();
+    std::vector<double> e(m), Ke(m, 0.0);
+    for (size_t a = 0; a < m; ++a)
+      e[a] = separation.empty() ? 0 : separation[p->slices[a]];
+    double sumKe = 0;
+    for (size_t a = 0; a < m; ++a) {
+      for (size_t b = 0; b < m; ++b)
+        Ke[a] += p->K[a * m + b] * e[b];
+      sumKe += Ke[a];
+    }
+    const double d = (force + sumKe) / p->k;
+    double sum = 0;
+    for (size_t a = 0; a < m; ++a) {
+      const double v = std::max(0.0, d * p->unitLoad[a] - Ke[a]);
+      load[p->slices[a]] = v;
+      sum += v;
+    }
+    // Keep the total after clipping
+    if (sum > 0) {
+      for (double& v : load)
+        v *= force / sum;
+    }
+    return load;
+  }
+
+  // Root stress per face slice (N/mm^2) of the pinion or gear for a load
+  // distribution from loadDistribution()
+  std::vector<double> rootStress(double rollAngle,
+                                 const std::vector<double>& load,
+                                 bool pinion) const {
+    std::vector<double> sigma(opt.faceSlices, 0.0);
+    const Position* p = nearest(rollAngle);
+    if (!p)
+      return sigma;
+    const std::vector<double>& S = pinion ? p->S1 : p->S2;
+    const size_t m = p->slices.size();
+    for (int r = 0; r < opt.faceSlices; ++r) {
+      for (size_t a = 0; a < m; ++a)
+        sigma[r] += S[r * m + a] * load[p->slices[a]];
+    }
+    return sigma;
+  }
+
+  const ToothStiffnessOptions& options() const { return opt; }
+  double faceWidth() const { return b; }
+
+private:
+  // Cached condensation at one contact line position
+  struct Position {
+    std::vector<int> slices;        // Face slices in contact
+    std::vector<double> K;          // Condensed stiffness, m x m
+    std::vector<double> unitLoad;   // K * 1, loads at unit deflection
+    std::vector<double> S1, S2;     // Root stress per slice load, nw x m
+    double k = 0;                   // 1' K 1
+    double sigma1 = 0, sigma2 = 0;  // Max root stress at unit deflection
+  };
+
+  void setupGeometry(const BevelGearPair& pair) {
+    RatingInputs in;
+    in.push_back(pair);
+    const VirtualCylindricalGears v = LoadRating::virtualGears(in, 0);
+    const double alphaN = pair.pressureAngle * M_PI / 180;
+    b = v.faceWidth;
+    cosAlpha = cos(v.alphaVt);
+    const double rb1 = v.dv1 / 2 * cosAlpha, rb2 = v.dv2 / 2 * cosAlpha;
+    const double ra1 = v.dv1 / 2 + pair.pinionAddendum;
+    const double ra2 = v.dv2 / 2 + pair.addendum;
+    rf1 = v.dv1 / 2 - pair.pinionDedendum;
+    rf2 = v.dv2 / 2 - pair.dedendum;
+    const double av = (v.dv1 + v.dv2) / 2;
+    g2 = sqrt(std::max(ra2 * ra2 - rb2 * rb2, 0.0));
+    t1 = av * sin(v.alphaVt) - g2;
+    pathLength = sqrt(std::max(ra1 * ra1 - rb1 * rb1, 0.0)) - t1;
+    pitch = M_PI * pair.module * cosAlpha;
+    tanBetaB = tan(v.betaVb);
+    this->rb1 = rb1;
+    this->rb2 = rb2;
+
+    // Root chord from the basic rack, widened over half the dedendum to
+    // stay clear of the fillet
+    const double mn = v.normalModule;
+    const double x1 = (pair.pinionAddendum - pair.module) / pair.module;
+    const double x2 = (pair.addendum - pair.module) / pair.module;
+    sF1 = mn * (M_PI / 2 + 2 * x1 * tan(alphaN)) +
+          pair.pinionDedendum * tan(alphaN);
+    sF2 = mn * (M_PI / 2 + 2 * x2 * tan(alphaN)) +
+          pair.dedendum * tan(alphaN);
+    lambda1 = pair.pinionAddendum + pair.pinionDedendum;
+    lambda2 = pair.addendum + pair.dedendum;
+
+    // Contact line s = s0 + y tan(betaB) touches the flank for
+    // s0 in [-b tan(betaB), pathLength], in units of the base pitch
+    xiBegin = -b * tanBetaB / pitch;
+    xiEnd = pathLength / pitch;
+  }
+
+  int nodes() const { return opt.faceSlices * opt.profilePoints; }
+  double sliceY(int i) const { return (i + 0.5) * b / opt.faceSlices; }
+  double nodeS(int j) const {
+    return pathLength * j / (opt.profilePoints - 1);
+  }
+  double height1(double s) const {
+    return sqrt(rb1 * rb1 + (t1 + s) * (t1 + s)) - rf1;
+  }
+  double height2(double s) const {
+    return sqrt(rb2 * rb2 + (g2 - s) * (g2 - s)) - rf2;
+  }
+
+  // Per unit width compliance of one tooth for loads at heights ha, hb
+  double toothCompliance(double ha, double hb, double sF) const {
+    const double E = opt.youngsModulus, nu = opt.poissonRatio;
+    const double G = E / (2 * (1 + nu));
+    const double lo = std::min(ha, hb), hi = std::max(ha, hb);
+    const double bending = 2 * lo * lo * (3 * hi - lo) / (E * sF * sF * sF);
+    const double shear = 1.2 * lo / (G * sF);
+    const double foundation =
+        cosAlpha * cosAlpha / E *
+        (5.306 * ha * hb / (sF * sF) + (1 - nu) * (ha + hb) / sF + 1.534);
+    return cosAlpha * cosAlpha * (bending + shear) + foundation;
+  }
+
+  static double plate(double dy, double lambda) {
+    return exp(-std::fabs(dy) / lambda) / (2 * lambda);
+  }
+
+  // Node influence coefficients of both teeth in series and root stress
+  // influence per face slice, computed once
+  void assembleInfluence() {
+    const int N = nodes(), nw = opt.faceSlices, np = opt.profilePoints;
+    influence = memory::Reservation(memory::Category::InfluenceMatrix,
+                                    (size_t(N) * N + 2 * size_t(nw) * N) *
+                                        sizeof(double));
+    C.assign(size_t(N) * N, 0.0);
+    R1.assign(size_t(nw) * N, 0.0);
+    R2.assign(size_t(nw) * N, 0.0);
+    for (int a = 0; a < N; ++a) {
+      const int ia = a / np, ja = a % np;
+      const double ha1 = height1(nodeS(ja)), ha2 = height2(nodeS(ja));
+      for (int c = 0; c < N; ++c) {
+        const int ic = c / np, jc = c % np;
+        const double dy = sliceY(ia) - sliceY(ic);
+        const double hc1 = height1(nodeS(jc)), hc2 = height2(nodeS(jc));
+        C[size_t(a) * N + c] =
+            toothCompliance(ha1, hc1, sF1) * plate(dy, lambda1) +
+            toothCompliance(ha2, hc2, sF2) * plate(dy, lambda2);
+      }
+    }
+    // Bending stress at the root of slice r from a load at node c
+    for (int r = 0; r < nw; ++r) {
+      for (int c = 0; c < N; ++c) {
+        const int ic = c / np, jc = c % np;
+        const double dy = sliceY(r) - sliceY(ic);
+        const double s = nodeS(jc);
+        R1[size_t(r) * N + c] = 6 * height1(s) * cosAlpha / (sF1 * sF1) *
+                                plate(dy, lambda1);
+        R2[size_t(r) * N + c] = 6 * height2(s) * cosAlpha / (sF2 * sF2) *
+                                plate(dy, lambda2);
+      }
+    }
+  }
+
+  // Condense onto the contact points of every cached position
+  void condensePositions() {
+    const int N = nodes(), nw = opt.faceSlices, np = opt.profilePoints;
+    const double E = opt.youngsModulus, nu = opt.poissonRatio;
+    const double hertz = 4 * (1 - nu * nu) / (M_PI * E * (b / nw));
+    const double ds = pathLength / (np - 1);
+    positions.resize(opt.positions);
+    size_t bytes = 0;
+    for (int q = 0; q < opt.positions; ++q) {
+      Position& pos = positions[q];
+      const double xi =
+          xiBegin + (xiEnd - xiBegin) * q / (opt.positions - 1);
+      const double s0 = xi * pitch;
+
+      // Interpolation of contact points between profile nodes
+      std::vector<int> node;
+      std::vector<double> weight;
+      for (int i = 0; i < nw; ++i) {
+        const double s = s0 + sliceY(i) * tanBetaB;
+        if (s < 0 || s > pathLength)
+          continue;
+        const int j = std::min(int(s / ds), np - 2);
+        const double t = s / ds - j;
+        pos.slices.push_back(i);
+        node.push_back(i * np + j);
+        weight.push_back(t);
+      }
+      const size_t m = pos.slices.size();
+      if (m == 0)
+        continue;
+
+      // Cc = T C T' + Hertz
+      auto cAt = [&](int a, int c) { return C[size_t(a) * N + c]; };
+      std::vector<double> Cc(m * m);
+      for (size_t a = 0; a < m; ++a) {
+        for (size_t c = 0; c < m; ++c) {
+          const double ta = weight[a], tc = weight[c];
+          const int na = node[a], nc = node[c];
+          Cc[a * m + c] = (1 - ta) * (1 - tc) * cAt(na, nc) +
+                          (1 - ta) * tc * cAt(na, nc + 1) +
+                          ta * (1 - tc) * cAt(na + 1, nc) +
+                          ta * tc * cAt(na + 1, nc + 1);
+        }
+        Cc[a * m + a] += hertz;
+      }
+      pos.K = invertSpd(Cc, m);
+      pos.unitLoad.assign(m, 0.0);
+      for (size_t a = 0; a < m; ++a) {
+        for (size_t c = 0; c < m; ++c)
+          pos.unitLoad[a] += pos.K[a * m + c];
+        pos.k += pos.unitLoad[a];
+      }
+
+      pos.S1.assign(nw * m, 0.0);
+      pos.S2.assign(nw * m, 0.0);
+      for (int r = 0; r < nw; ++r) {
+        double s1 = 0, s2 = 0;
+        for (size_t a = 0; a < m; ++a) {
+          const size_t row = size_t(r) * N;
+          const double t = weight[a];
+          pos.S1[r * m + a] =
+              (1 - t) * R1[row + node[a]] + t * R1[row + node[a] + 1];
+          pos.S2[r * m + a] =
+              (1 - t) * R2[row + node[a]] + t * R2[row + node[a] + 1];
+          s1 += pos.S1[r * m + a] * pos.unitLoad[a];
+          s2 += pos.S2[r * m + a] * pos.unitLoad[a];
+        }
+        pos.sigma1 = std::max(pos.sigma1, s1);
+        pos.sigma2 = std::max(pos.sigma2, s2);
+      }
+      bytes += (m * m + m + 2 * nw * m) * sizeof(double);
+    }
+    condensed = memory::Reservation(memory::Category::InfluenceMatrix, bytes);
+  }
+
+  // Inverse of a small symmetric positive definite matrix via Cholesky
+  static std::vector<double> invertSpd(std::vector<double> A, size_t m) {
+    for (size_t j = 0; j < m; ++j) {
+      double d = A[j * m + j];
+      for (size_t k = 0; k < j; ++k)
+        d -= A[j * m + k] * A[j * m + k];
+      if (d <= 0)
+        throw std::runtime_error("Tooth compliance is not positive definite");
+      A[j * m + j] = sqrt(d);
+      for (size_t i = j + 1; i < m; ++i) {
+        double v = A[i * m + j];
+        for (size_t k = 0; k < j; ++k)
+          v -= A[i * m + k] * A[j * m + k];
+        A[i * m + j] = v / A[j * m + j];
+      }
+    }
+    std::vector<double> inv(m * m, 0.0), col(m);
+    for (size_t c = 0; c < m; ++c) {
+      // Solve L L' x = e_c
+      for (size_t i = 0; i < m; ++i) {
+        double v = i == c ? 1.0 : 0.0;
+        for (size_t k = 0; k < i; ++k)
+          v -= A[i * m + k] * col[k];
+        col[i] = v / A[i * m + i];
+      }
+      for (size_t i = m; i-- > 0;) {
+        double v = col[i];
+        for (size_t k = i + 1; k < m; ++k)
+          v -= A[k * m + i] * col[k];
+        col[i] = v / A[i * m + i];
+      }
+      for (size_t i = 0; i < m; ++i)
+        inv[i * m + c] = col[i];
+    }
+    return inv;
+  }
+
+  double toPosition(double rollAngle) const {
+    const double xi = xiBegin + rollAngle / meshCycle();
+    return (xi - xiBegin) / (xiEnd - xiBegin) * (opt.positions - 1);
+  }
+
+  template <typename F>
+  double interpolate(double rollAngle, F value) const {
+    const double x = toPosition(rollAngle);
+    if (x < 0 || x > opt.positions - 1)
+      return 0;
+    const int q = std::min(int(x), opt.positions - 2);
+    const double t = x - q;
+    return (1 - t) * value(positions[q]) + t * value(positions[q + 1]);
+  }
+
+  const Position* nearest(double rollAngle) const {
+    const double x = toPosition(rollAngle);
+    if (x < -0.5 || x > opt.positions - 0.5)
+      return nullptr;
+    return &positions[std::clamp(int(std::lround(x)), 0, opt.positions - 1)];
+  }
+
+  // Calls f with the engagement roll angle of every pair that can be in
+  // contact at rollAngle
+  template <typename F>
+  void forEachPair(double rollAngle, F f) const {
+    const double cycle = meshCycle();
+    double a = std::fmod(rollAngle, cycle);
+    if (a < 0)
+      a += cycle;
+    for (; a <= engagement(); a += cycle)
+      f(a);
+  }
+
+  ToothStiffnessOptions opt;
+  int z1 = 0;
+  double b = 0, cosAlpha = 1, pitch = 1, tanBetaB = 0;
+  double rb1 = 0, rb2 = 0, rf1 = 0, rf2 = 0, t1 = 0, g2 = 0;
+  double pathLength = 0;
+  double sF1 = 1, sF2 = 1, lambda1 = 1, lambda2 = 1;
+  double xiBegin = 0, xiEnd = 1;
+  std::vector<double> C, R1, R2;
+  std::vector<Position> positions;
+  memory::Reservation influence, condensed;
+};
+
+// Models shared between analyses of the same geometry, e.g. a dynamics speed
+// sweep and a rating at several loads. Keyed by all pair inputs and options;
+// the cache is dropped when it grows past maxEntries. Cached models are not
+// charged to the budget of the job that built them.
+inline std::shared_ptr<const ToothStiffnessModel> cachedToothStiffness(
+    const BevelGearPair& pair, const ToothStiffnessOptions& options = {}) {
+  constexpr size_t maxEntries = 64;
+  static std::mutex mutex;
+  static std::map<std::vector<double>,
+                  std::shared_ptr<const ToothStiffnessModel>>
+      cache;
+
+  std::vector<double> key;
+  for (const char* name : PairFieldUtils::names) {
+    double v = 0;
+    PairFieldUtils::get(pair, name, v);
+    key.push_back(v);
+  }
+  for (double v : {double(options.faceSlices), double(options.profilePoints),
+                   double(options.positions), options.youngsModulus,
+                   options.poissonRatio})
+    key.push_back(v);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end())
+      return it->second;
+  }
+  // Build outside the lock; a concurrent build of the same key is harmless.
+  // The model outlives the calling job, so its buffers are charged to the
+  // global counters only, never to the job's budget.
+  std::shared_ptr<const ToothStiffnessModel> model;
+  {
+    memory::BudgetScope detached(nullptr);
+    model = std::make_shared<const ToothStiffnessModel>(pair, options);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache.size() >= maxEntries)
+    cache.clear();
+  return cache.emplace(std::move(key), std::move(model)).first->second;
+}
@@ -0,0 +1,381 @@
+// UnloadedTca.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../geometry/ToothFlank.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Unloaded tooth contact analysis of one member of a pair.
+//
+// Both members carry spherical involute flanks (ToothFlank), which are
+// conjugate: unmodified they touch along a line that sweeps the flank as the
+// pair turns. Contact is localised by a parabolic ease-off of the mate,
+// lengthwise and along the active profile. On every sphere of cone distance R
+// contact lies on the great circle of action, so the contact line of tooth k
+// at a rotation is known in closed form as an involute arc psi(R). The tooth
+// with the least ease-off on its line carries; its lead over the conjugate
+// position is the unloaded transmission error and the lead over the others
+// is their gap.
+//
+// The contact zone is where the gap to the mate, ease-off plus the curvature
+// gap across the contact line, stays below the marking compound thickness:
+// the pattern a marking test shows, the unloaded contact ellipse.
+//
+// Mounting errors move the mate rigidly. To first order that adds
+// (d + w x P) . n to the gap at contact point P with flank normal n, for a
+// translation d and a rotation w about the axis crossing. Contact points on
+// the surface of action are fixed by (R, contact arc), so the term is
+// tabulated once per cone distance.
+//
+// Flank coordinates are ToothFlank's (R, u). Rotations are deg of the
+// analysed member, 0 with tooth 0 touching the pitch cone at mid face.
+
+// Mounting errors as set on a test machine for a marking test (mm, deg)
+struct TcaMisalignment {
+  double pinionAxial = 0;  // H: pinion moved along its axis, off the crossing
+  double gearAxial = 0;    // G: gear moved along its axis, off the crossing
+  double offset = 0;       // V: pinion moved along gear axis x pinion axis
+  double shaftAngle = 0;   // Shaft angle opened by this much (deg)
+
+  bool any() const {
+    return pinionAxial != 0 || gearAxial != 0 || offset != 0 ||
+           shaftAngle != 0;
+  }
+};
+
+struct TcaOptions {
+  FlankSide side = FlankSide::Right;  // Loaded flank of the analysed member
+  double lengthwiseCrowning = 0.02;   // Ease-off at toe and heel (mm)
+  double profileCrowning = 0.01;      // At the ends of the active profile
+  double markingCompound = 0.0065;    // Largest gap that still marks (mm)
+  int faceSamples = 128;              // Cone distances along a contact line
+  TcaMisalignment misalignment;
+};
+
+// Contact of one tooth at one rotation
+struct ContactZone {
+  int tooth = 0;
+  double gap = 0;                   // At the closest point (mm), 0 carrying
+  double centreR = 0, centreU = 0;  // Closest point
+  double minR = 0, maxR = 0;        // Extent of the marking zone
+  double minU = 0, maxU = 0;
+  double length = 0;  // Along the face (mm)
+  double width = 0;   // Widest across the contact line (mm)
+  double area = 0;    // mm^2
+
+  bool marks() const { return area > 0; }
+};
+
+// Rotations where no tooth is engaged (contact ratio below 1) have no
+// carrying tooth: contact.tooth is -1 and the transmission error NaN.
+struct TcaPoint {
+  double rotation = 0;           // deg
+  double transmissionError = 0;  // Lag behind the conjugate position (arcsec)
+  ContactZone contact;           // Of the carrying tooth
+
+  bool engaged() const { return contact.tooth >= 0; }
+};
+
+class UnloadedTca {
+public:
+  UnloadedTca(const BevelGearPair& pair, bool pinion = false,
+              TcaOptions options = {})
+      : flank(pinion ? pair.makePinion() : pair.makeGear()),
+        mate(pinion ? pair.makeGear() : pair.makePinion()),
+        opt(options) {
+    if (!pair.validateToothCounts() || opt.lengthwiseCrowning < 0 ||
+        opt.profileCrowning < 0 || opt.markingCompound <= 0 ||
+        opt.faceSamples < 2) {
+      throw std::invalid_argument("Invalid input for UnloadedTca");
+    }
+    const double k = M_PI / 180;
+    sigma = opt.side == FlankSide::Right ? 1 : -1;
+    sinB = sin(flank.baseAngle());
+    Rmid = (flank.innerR() + flank.outerR()) / 2;
+    halfFace = (flank.outerR() - flank.innerR()) / 2;
+    // Arc between the tangent points of the two base cones on the great
+    // circle of action, through the pitch point
+    const double psiPitch = flank.involuteArc(flank.gear().pitchConeAngle * k);
+    arcOfAction = psiPitch + mate.involuteArc(mate.gear().pitchConeAngle * k);
+    const double lo = activeLo(Rmid), hi = activeHi(Rmid);
+    if (hi <= lo)
+      throw std::invalid_argument("Pair has no active profile");
+    psiMid = (lo + hi) / 2;
+    psiHalf = (hi - lo) / 2;
+    psiRef = psiPitch - sigma * sinB * flank.spiralOffset(Rmid);
+    if (opt.misalignment.any())
+      tabulateMisalignment(pair, pinion);
+  }
+
+  const ToothFlank& toothFlank() const { return flank; }
+  const TcaOptions& options() const { return opt; }
+  double meshCycle() const { return 360.0 / flank.numTeeth(); }
+
+  // Active involute arc at R: above the mate's tip and below our tip
+  double activeLo(double R) const {
+    return std::max(flank.involuteArc(flank.rootAngle(R)),
+                    arcOfAction - mate.involuteArc(mate.tipAngle(R)));
+  }
+  double activeHi(double R) const {
+    return std::min(flank.involuteArc(flank.tipAngle(R)),
+                    arcOfAction - mate.involuteArc(mate.rootAngle(R)));
+  }
+
+  // Involute arc of the contact line of tooth k at R
+  double contactArc(int k, double rotation, double R) const {
+    const double turn = std::remainder(
+        rotation * M_PI / 180 + k * flank.pitchAngle(), 2 * M_PI);
+    return psiRef + sigma * sinB * (turn + flank.spiralOffset(R));
+  }
+
+  // Ease-off of the mate at R and involute arc psi (mm)
+  double easeOff(double R, double psi) const {
+    const double a = (R - Rmid) / halfFace, b = (psi - psiMid) / psiHalf;
+    return opt.lengthwiseCrowning * a * a + opt.profileCrowning * b * b;
+  }
+
+  // Gap added by the mounting errors where the contact line of a tooth is
+  // at arc c on the sphere R (mm)
+  double misalignmentGap(double R, double c) const {
+    if (misTable.empty())
+      return 0;
+    const double f = std::clamp((R - flank.innerR()) /
+                                    (flank.outerR() - flank.innerR()) *
+                                    (opt.faceSamples - 1),
+                                0.0, double(opt.faceSamples - 1));
+    const int i = std::min(int(f), opt.faceSamples - 2);
+    const double t = f - i;
+    return (1 - t) * misalignmentRow(i, c) + t * misalignmentRow(i + 1, c);
+  }
+
+  // Transmission error at a rotation: the least gap of any contact line
+  // before the pair closes it (mm)
+  double transmissionErrorMm(double rotation) const {
+    return lead(rotation).first;
+  }
+
+  // Gap to the mate at cone distance R and involute arc psi (mm) of a tooth
+  // whose contact line crosses R at arc c, given the transmission error te
+  // of the rotation
+  double gap(double R, double c, double psi, double te) const {
+    return easeOff(R, psi) + curvatureGap(R, c) * (psi - c) * (psi - c) +
+           misalignmentGap(R, c) - te;
+  }
+
+  // Gap to the mate at flank point (R, u) of tooth k (mm), HUGE_VAL for
+  // teeth out of engagement
+  double separation(int k, double rotation, double R, double u) const {
+    const double te = lead(rotation).first;
+    const double psi = flank.involuteArc(flank.polarAngle(R, u));
+    const double c = contactArc(k, rotation, R);
+    if (c < activeLo(R) || c > activeHi(R))
+      return HUGE_VAL;
+    return gap(R, c, psi, te);
+  }
+
+  // Contact zones of every tooth in engagement at a rotation (deg)
+  std::vector<ContactZone> contact(double rotation) const {
+    GEARLAB_TRACE_SCOPE("tca.contact");
+    std::vector<ContactZone> zones;
+    const double te = lead(rotation).first;
+    for (int k = 0; k < flank.numTeeth(); ++k) {
+      ContactZone z;
+      if (zone(k, rotation, te, z))
+        zones.push_back(z);
+    }
+    return zones;
+  }
+
+  // Contact path and transmission error over one mesh cycle
+  std::vector<TcaPoint> path(int steps) const {
+    GEARLAB_TRACE_SCOPE("tca.path");
+    std::vector<TcaPoint> points(std::max(steps, 1));
+    for (size_t i = 0; i < points.size(); ++i) {
+      TcaPoint& p = points[i];
+      p.rotation = meshCycle() * i / points.size();
+      const auto [te, k] = lead(p.rotation);
+      if (!zone(k, p.rotation, te, p.contact)) {
+        p.contact.tooth = -1;
+        p.transmissionError = NAN;
+        continue;
+      }
+      p.transmissionError =
+          te / (p.contact.centreR * sinB) * 180 / M_PI * 3600;
+    }
+    return points;
+  }
+
+private:
+  double faceR(int i) const {
+    return flank.innerR() + (flank.outerR() - flank.innerR()) * i /
+                                (opt.faceSamples - 1);
+  }
+
+  // Coefficient of (psi - c)^2 in the gap across the contact line: two
+  // involutes of curvature radius R psi and R (L - psi) touching at arc c
+  double curvatureGap(double R, double c) const {
+    const double s = R * c;  // Flank length per unit arc
+    const double kr = 1 / (R * std::max(c, 1e-6)) +
+                      1 / (R * std::max(arcOfAction - c, 1e-6));
+    return s * s * kr / 2;
+  }
+
+  // Least ease-off on the contact line of tooth k, HUGE_VAL out of
+  // engagement
+  double lineMinimum(int k, double rotation, int* at = nullptr) const {
+    double best = HUGE_VAL;
+    for (int i = 0; i < opt.faceSamples; ++i) {
+      const double R = faceR(i), c = contactArc(k, rotation, R);
+      if (c < activeLo(R) || c > activeHi(R))
+        continue;
+      const double e = easeOff(R, c) + misalignmentRow(i, c);
+      if (e < best) {
+        best = e;
+        if (at)
+          *at = i;
+      }
+    }
+    return best;
+  }
+
+  // Transmission error (mm) and carrying tooth
+  std::pair<double, int> lead(double rotation) const {
+    double te = HUGE_VAL;
+    int carrying = 0;
+    for (int k = 0; k < flank.numTeeth(); ++k) {
+      const double m = lineMinimum(k, rotation);
+      if (m < te) {
+        te = m;
+        carrying = k;
+      }
+    }
+    return {te, carrying};
+  }
+
+  // Marking zone of tooth k. Per cone distance the gap is quadratic in psi,
+  // so the marking interval is solved in closed form.
+  bool zone(int k, double rotation, double te, ContactZone& z) const {
+    int at = 0;
+    const double m = lineMinimum(k, rotation, &at);
+    if (m == HUGE_VAL)
+      return false;
+    z = ContactZone();
+    z.tooth = k;
+    z.gap = m - te;
+    z.centreR = faceR(at);
+    auto uOf = [&](double R, double psi) {
+      return std::clamp(
+          flank.profileParam(R, flank.polarAngleAtArc(psi)), 0.0, 1.0);
+    };
+    z.centreU = uOf(z.centreR, contactArc(k, rotation, z.centreR));
+
+    const double q = opt.profileCrowning / (psiHalf * psiHalf);
+    const double dR = (flank.outerR() - flank.innerR()) / (opt.faceSamples - 1);
+    bool any = false;
+    for (int i = 0; i < opt.faceSamples; ++i) {
+      const double R = faceR(i), c = contactArc(k, rotation, R);
+      const double lo = activeLo(R), hi = activeHi(R);
+      if (c < lo || c > hi)
+        continue;
+      // (q + g) psi^2 - 2 (q psiMid + g c) psi + ... <= marking
+      const double g = curvatureGap(R, c);
+      const double a = q + g, b = -2 * (q * psiMid + g * c);
+      const double e0 = opt.lengthwiseCrowning * (R - Rmid) * (R - Rmid) /
+                        (halfFace * halfFace);
+      const double cc = q * psiMid * psiMid + g * c * c + e0 +
+                        misalignmentRow(i, c) - te - opt.markingCompound;
+      const double disc = b * b - 4 * a * cc;
+      if (disc < 0)
+        continue;
+      const double p0 = std::max((-b - sqrt(disc)) / (2 * a), lo);
+      const double p1 = std::min((-b + sqrt(disc)) / (2 * a), hi);
+      if (p1 <= p0)
+        continue;
+      const double u0 = uOf(R, p0), u1 = uOf(R, p1);
+      const double w = (flank.point(opt.side, R, u1) -
+                        flank.point(opt.side, R, u0))
+                           .norm();
+      if (!any) {
+        z.minR = z.maxR = R;
+        z.minU = u0;
+        z.maxU = u1;
+        any = true;
+      }
+      z.minR = std::min(z.minR, R);
+      z.maxR = std::max(z.maxR, R);
+      z.minU = std::min(z.minU, u0);
+      z.maxU = std::max(z.maxU, u1);
+      z.width = std::max(z.width, w);
+      z.area += w * dR;
+    }
+    if (any)
+      z.length = z.maxR - z.minR + dR;
+    return true;
+  }
+
+  static constexpr int misalignmentArcs = 16;
+
+  // Misalignment gap at face sample i, linear in the arc between samples
+  // spanning the active profile
+  double misalignmentRow(int i, double c) const {
+    if (misTable.empty())
+      return 0;
+    const double* row = &misTable[size_t(i) * misalignmentArcs];
+    const double lo = misLo[i], hi = misHi[i];
+    if (hi <= lo)
+      return row[0];
+    const double f = std::clamp((c - lo) / (hi - lo), 0.0, 1.0) *
+                     (misalignmentArcs - 1);
+    const int j = std::min(int(f), misalignmentArcs - 2);
+    const double t = f - j;
+    return (1 - t) * row[j] + t * row[j + 1];
+  }
+
+  // (d + w x P) . n over the surface of action. Frame of the analysed
+  // member: the mate axis m lies in the xz plane at the shaft angle from z,
+  // and y = z x m is the common normal of the axes.
+  void tabulateMisalignment(const BevelGearPair& pair, bool pinion) {
+    const TcaMisalignment& e = opt.misalignment;
+    const double shaft = pair.shaftAngle * M_PI / 180;
+    const Vec3 z(0, 0, 1), m(sin(shaft), 0, cos(shaft)), y(0, 1, 0);
+    const double own = pinion ? e.pinionAxial : e.gearAxial;
+    const double other = pinion ? e.gearAxial : e.pinionAxial;
+    // Mate displacement relative to the analysed member. Moving the pinion
+    // along y_gear = -y_pinion is the same relative move in both frames.
+    const Vec3 d = m * other - z * own + y * e.offset;
+    const Vec3 w = y * (e.shaftAngle * M_PI / 180);
+    misTable.assign(size_t(opt.faceSamples) * misalignmentArcs, 0.0);
+    misLo.assign(opt.faceSamples, 0.0);
+    misHi.assign(opt.faceSamples, 0.0);
+    for (int i = 0; i < opt.faceSamples; ++i) {
+      const double R = faceR(i);
+      misLo[i] = activeLo(R);
+      misHi[i] = activeHi(R);
+      for (int j = 0; j < misalignmentArcs; ++j) {
+        const double c =
+            misLo[i] + (misHi[i] - misLo[i]) * j / (misalignmentArcs - 1);
+        const double u = std::clamp(
+            flank.profileParam(R, flank.polarAngleAtArc(c)), 0.0, 1.0);
+        // Tooth 0 turned so that its contact line passes through arc c
+        const double turn =
+            (c - psiRef) / (sigma * sinB) - flank.spiralOffset(R);
+        const Vec3 P = flank.point(opt.side, R, u).rotatedZ(turn);
+        const Vec3 n = flank.normal(opt.side, R, u).rotatedZ(turn);
+        misTable[size_t(i) * misalignmentArcs + j] = (d + w.cross(P)).dot(n);
+      }
+    }
+  }
+
+  ToothFlank flank, mate;
+  TcaOptions opt;
+  double sigma = 1, sinB = 1;
+  double Rmid = 0, halfFace = 1;
+  double arcOfAction = 0, psiRef = 0, psiMid = 0, psiHalf = 1;
+  std::vector<double> misTable, misLo, misHi;
+};
@@ -0,0 +1,490 @@
+// GearLabC.cpp
+// C interface of gearlab.h over the header-only core. Every entry point
+// catches what the core throws and turns it into a status and message.
+
+#include "gearlab.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../analysis/LoadRating.hpp"
+#include "../analysis/UnloadedTca.hpp"
+#include "../geometry/GearSurface.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../geometry/ToothFlank.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/Pipeline.hpp"
+
+struct gearlab_pair {
+  BevelGearPair pair;
+};
+
+// Buffers point into `owner`, which lives as long as the result
+struct gearlab_result {
+  std::shared_ptr<const void> owner;
+  std::vector<std::string> names;
+  std::vector<gearlab_buffer> buffers;
+
+  void add(const std::string& name, const void* data, gearlab_dtype dtype,
+           std::initializer_list<int64_t> shape,
+           std::initializer_list<int64_t> strides) {
+    gearlab_buffer b = {};
+    b.data = data;
+    b.dtype = dtype;
+    b.ndim = int32_t(shape.size());
+    std::copy(shape.begin(), shape.end(), b.shape);
+    std::copy(strides.begin(), strides.end(), b.strides);
+    names.push_back(name);
+    buffers.push_back(b);
+  }
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+constexpr size_t minFields = 13;  // Up to pressureAngle
+constexpr size_t numFields = std::size(PairFieldUtils::names);
+
+struct DesignError : std::runtime_error {
+  DesignError() : std::runtime_error("Parameters fail validation") {}
+};
+
+template <typename F>
+gearlab_status guarded(F&& f) {
+  try {
+    f();
+    lastError.clear();
+    return GEARLAB_OK;
+  } catch (const DesignError& e) {
+    lastError = e.what();
+    return GEARLAB_ERR_DESIGN;
+  } catch (const std::invalid_argument& e) {
+    lastError = e.what();
+    return GEARLAB_ERR_ARGUMENT;
+  } catch (const std::bad_alloc& e) {
+    lastError = e.what();
+    return GEARLAB_ERR_MEMORY;
+  } catch (const std::exception& e) {
+    lastError = e.what();
+    return GEARLAB_ERR_INTERNAL;
+  } catch (...) {
+    lastError = "Unknown error";
+    return GEARLAB_ERR_INTERNAL;
+  }
+}
+
+void require(bool condition, const std::string& message) {
+  if (!condition)
+    throw std::invalid_argument(message);
+}
+
+// Element (i, j) of a 2-D F64 buffer. Copied out, so host arrays need not
+// be aligned.
+double f64(const gearlab_buffer& b, int64_t i, int64_t j) {
+  double v;
+  std::memcpy(&v,
+              static_cast<const char*>(b.data) + i * b.strides[0] +
+                  j * b.strides[1],
+              sizeof(v));
+  return v;
+}
+
+void require2d(const gearlab_buffer* b, const char* what) {
+  require(b && b->dtype == GEARLAB_F64 && b->ndim == 2 && b->shape[0] >= 0 &&
+              b->shape[1] >= 0 && (b->data || b->shape[0] * b->shape[1] == 0),
+          std::string(what) + " must be a 2-D F64 buffer");
+}
+
+template <typename Value>
+BevelGearPair pairFrom(size_t count, Value&& value) {
+  BevelGearPair p;
+  for (size_t j = 0; j < count; ++j) {
+    const char* name = PairFieldUtils::names[j];
+    require(PairFieldUtils::valid(name, value(j)),
+            std::string(name) + " out of range");
+    PairFieldUtils::set(p, name, value(j));
+  }
+  return PairFieldUtils::recompute(p);
+}
+
+// Designs from a [n, k] buffer of inputs
+std::vector<BevelGearPair> designsFrom(const gearlab_buffer* b) {
+  require2d(b, "Designs");
+  const int64_t n = b->shape[0], k = b->shape[1];
+  require(k >= int64_t(minFields) && k <= int64_t(numFields),
+          "Designs need 13 to 15 inputs per row");
+  std::vector<BevelGearPair> designs(n);
+  for (int64_t i = 0; i < n; ++i)
+    designs[i] = pairFrom(k, [&](size_t j) { return f64(*b, i, j); });
+  return designs;
+}
+
+// Caller options over the defaults, as far as the caller's struct reaches
+template <typename Options>
+Options optionsFrom(const Options* given, void (*init)(Options*, size_t)) {
+  Options o;
+  init(&o, sizeof(o));
+  if (given) {
+    require(given->size >= sizeof(given->size), "Options size unset");
+    std::memcpy(&o, given, std::min(given->size, sizeof(o)));
+    o.size = sizeof(o);
+  }
+  return o;
+}
+
+const BevelGearPair& validPair(const gearlab_pair* pair) {
+  require(pair, "Null pair");
+  if (!pair->pair.validateParam())
+    throw DesignError();
+  return pair->pair;
+}
+
+BevelGear memberOf(const BevelGearPair& pair, gearlab_member member) {
+  require(member == GEARLAB_GEAR || member == GEARLAB_PINION,
+          "Unknown member");
+  return member == GEARLAB_PINION ? pair.makePinion() : pair.makeGear();
+}
+
+gearlab_status start(gearlab_result** out) {
+  if (!out) {
+    lastError = "Null result pointer";
+    return GEARLAB_ERR_ARGUMENT;
+  }
+  *out = nullptr;
+  return GEARLAB_OK;
+}
+
+// Values of one member reported by gearlab_evaluate
+constexpr const char* memberValues[] = {
+    "pitchConeAngle", "faceConeAngle",     "rootConeAngle", "faceConeOffset",
+    "rootConeOffset", "pitchConeDistance", "addendum",      "dedendum"};
+constexpr size_t valuesPerDesign = 1 + 2 * std::size(memberValues);
+
+void memberRow(const BevelGear& g, double* row) {
+  const double v[] = {g.pitchConeAngle, g.faceConeAngle,
+                      g.rootConeAngle,  g.faceConeOffset,
+                      g.rootConeOffset, g.pitchConeDistance,
+                      g.addendum,       g.dedendum};
+  std::copy(std::begin(v), std::end(v), row);
+}
+
+}  // namespace
+
+extern "C" {
+
+int gearlab_api_version(void) { return GEARLAB_API_VERSION; }
+
+const char* gearlab_last_error(void) { return lastError.c_str(); }
+
+size_t gearlab_pair_field_count(void) { return numFields; }
+
+const char* gearlab_pair_field_name(size_t i) {
+  return i < numFields ? PairFieldUtils::names[i] : nullptr;
+}
+
+gearlab_status gearlab_pair_create(const double* values, size_t count,
+                                   gearlab_pair** out) {
+  return guarded([&] {
+    require(out, "Null pair pointer");
+    *out = nullptr;
+    require(values && count >= minFields && count <= numFields,
+            "A pair needs 13 to 15 inputs");
+    *out = new gearlab_pair{
+        pairFrom(count, [&](size_t j) { return values[j]; })};
+  });
+}
+
+void gearlab_pair_destroy(gearlab_pair* pair) { delete pair; }
+
+gearlab_status gearlab_pair_set(gearlab_pair* pair, const char* name,
+                                double value) {
+  return guarded([&] {
+    require(pair && name, "Null pair or name");
+    BevelGearPair p = pair->pair;
+    double old;
+    require(PairFieldUtils::get(p, name, old),
+            "Unknown input " + std::string(name));
+    require(PairFieldUtils::valid(name, value),
+            std::string(name) + " out of range");
+    PairFieldUtils::set(p, name, value);
+    pair->pair = PairFieldUtils::recompute(p);
+  });
+}
+
+gearlab_status gearlab_pair_get(const gearlab_pair* pair, const char* name,
+                                double* value) {
+  return guarded([&] {
+    require(pair && name && value, "Null pair, name or value");
+    require(PairFieldUtils::get(pair->pair, name, *value),
+            "Unknown input " + std::string(name));
+  });
+}
+
+int gearlab_pair_valid(const gearlab_pair* pair) {
+  return pair && pair->pair.validateParam();
+}
+
+size_t gearlab_result_count(const gearlab_result* result) {
+  return result ? result->buffers.size() : 0;
+}
+
+const char* gearlab_result_name(const gearlab_result* result, size_t i) {
+  return result && i < result->names.size() ? result->names[i].c_str()
+                                            : nullptr;
+}
+
+const gearlab_buffer* gearlab_result_buffer(const gearlab_result* result,
+                                            size_t i) {
+  return result && i < result->buffers.size() ? &result->buffers[i] : nullptr;
+}
+
+const gearlab_buffer* gearlab_result_get(const gearlab_result* result,
+                                         const char* name) {
+  if (!result || !name)
+    return nullptr;
+  for (size_t i = 0; i < result->names.size(); ++i) {
+    if (result->names[i] == name)
+      return &result->buffers[i];
+  }
+  return nullptr;
+}
+
+void gearlab_result_destroy(gearlab_result* result) { delete result; }
+
+gearlab_status gearlab_evaluate(const gearlab_buffer* inputs,
+                                gearlab_result** out) {
+  if (gearlab_status s = start(out))
+    return s;
+  return guarded([&] {
+    const std::vector<PairPipelineResult> pairs =
+        runPairSweep(designsFrom(inputs));
+    const size_t n = pairs.size(), k = valuesPerDesign;
+    auto values = std::make_shared<std::vector<double>>(n * k);
+    for (size_t i = 0; i < n; ++i) {
+      double* row = values->data() + i * k;
+      row[0] = pairs[i].valid;
+      memberRow(*pairs[i].gear, row + 1);
+      memberRow(*pairs[i].pinion, row + 1 + std::size(memberValues));
+    }
+    auto r = std::make_unique<gearlab_result>();
+    const double* d = values->data();
+    const int64_t rowBytes = k * sizeof(double);
+    r->add("values", d, GEARLAB_F64, {int64_t(n), int64_t(k)},
+           {rowBytes, sizeof(double)});
+    r->add("valid", d, GEARLAB_F64, {int64_t(n)}, {rowBytes});
+    size_t column = 1;
+    for (const char* member : {"gear.", "pinion."}) {
+      for (const char* name : memberValues)
+        r->add(member + std::string(name), d + column++, GEARLAB_F64,
+               {int64_t(n)}, {rowBytes});
+    }
+    r->owner = std::move(values);
+    *out = r.release();
+  });
+}
+
+gearlab_status gearlab_flank(const gearlab_pair* pair, gearlab_member member,
+                             gearlab_side side, int faceSteps,
+                             int profileSteps, gearlab_result** out) {
+  if (gearlab_status s = start(out))
+    return s;
+  return guarded([&] {
+    require(faceSteps >= 1 && profileSteps >= 1, "Steps must be at least 1");
+    require(side == GEARLAB_RIGHT || side == GEARLAB_LEFT, "Unknown side");
+    const ToothFlank f(memberOf(validPair(pair), member));
+    const FlankSide s =
+        side == GEARLAB_LEFT ? FlankSide::Left : FlankSide::Right;
+    struct Grid {
+      std::vector<double> R, u, point, normal;
+    };
+    const size_t nR = size_t(faceSteps) + 1, nU = size_t(profileSteps) + 1;
+    auto g = std::make_shared<Grid>();
+    g->R.resize(nR);
+    g->u.resize(nU);
+    g->point.resize(nR * nU * 3);
+    g->normal.resize(nR * nU * 3);
+    for (size_t i = 0; i < nR; ++i)
+      g->R[i] = f.innerR() + (f.outerR() - f.innerR()) * i / faceSteps;
+    for (size_t j = 0; j < nU; ++j)
+      g->u[j] = double(j) / profileSteps;
+    for (size_t i = 0; i < nR; ++i) {
+      for (size_t j = 0; j < nU; ++j) {
+        const Vec3 p = f.point(s, g->R[i], g->u[j]);
+        const Vec3 n = f.normal(s, g->R[i], g->u[j]);
+        double* pp = &g->point[(i * nU + j) * 3];
+        double* np = &g->normal[(i * nU + j) * 3];
+        pp[0] = p.x, pp[1] = p.y, pp[2] = p.z;
+        np[0] = n.x, np[1] = n.y, np[2] = n.z;
+      }
+    }
+    auto r = std::make_unique<gearlab_result>();
+    const int64_t d = sizeof(double);
+    r->add("R", g->R.data(), GEARLAB_F64, {int64_t(nR)}, {d});
+    r->add("u", g->u.data(), GEARLAB_F64, {int64_t(nU)}, {d});
+    for (auto [name, v] : {std::make_pair("point", &g->point),
+                           std::make_pair("normal", &g->normal)})
+      r->add(name, v->data(), GEARLAB_F64, {int64_t(nR), int64_t(nU), 3},
+             {int64_t(nU) * 3 * d, 3 * d, d});
+    r->owner = std::move(g);
+    *out = r.release();
+  });
+}
+
+void gearlab_surface_options_init(gearlab_surface_options* o, size_t size) {
+  if (!o || size < sizeof(o->size))
+    return;
+  const GearSurfaceOptions d;
+  gearlab_surface_options full = {sizeof(full),  d.faceSteps, d.profileSteps,
+                                  d.landSteps,   d.bodySteps, d.boreRadius};
+  size = std::min(size, sizeof(full));
+  std::memcpy(o, &full, size);
+  o->size = size;
+}
+
+gearlab_status gearlab_surface(const gearlab_pair* pair,
+                               gearlab_member member,
+                               const gearlab_surface_options* options,
+                               gearlab_result** out) {
+  if (gearlab_status s = start(out))
+    return s;
+  return guarded([&] {
+    const gearlab_surface_options o =
+        optionsFrom(options, gearlab_surface_options_init);
+    GearSurfaceOptions opt;
+    opt.faceSteps = o.faceSteps;
+    opt.profileSteps = o.profileSteps;
+    opt.landSteps = o.landSteps;
+    opt.bodySteps = o.bodySteps;
+    opt.boreRadius = o.boreRadius;
+    auto m = std::make_shared<GearSurfaceMesh>(
+        GearSurface(memberOf(validPair(pair), member), opt).build());
+    auto r = std::make_unique<gearlab_result>();
+    const int64_t n = m->size(), d = sizeof(double);
+    const std::pair<const char*, std::vector<double>*> coords[] = {
+        {"ax", &m->ax}, {"ay", &m->ay}, {"az", &m->az},
+        {"bx", &m->bx}, {"by", &m->by}, {"bz", &m->bz},
+        {"cx", &m->cx}, {"cy", &m->cy}, {"cz", &m->cz}};
+    for (const auto& [name, v] : coords)
+      r->add(name, v->data(), GEARLAB_F64, {n}, {d});
+    static_assert(sizeof(SurfaceRegion) == 1, "Regions are passed as U8");
+    r->add("region", m->region.data(), GEARLAB_U8, {n}, {1});
+    r->add("tooth", m->tooth.data(), GEARLAB_I32, {n}, {sizeof(int)});
+    r->owner = std::move(m);
+    *out = r.release();
+  });
+}
+
+void gearlab_tca_options_init(gearlab_tca_options* o, size_t size) {
+  if (!o || size < sizeof(o->size))
+    return;
+  const TcaOptions d;
+  gearlab_tca_options full;
+  std::memset(&full, 0, sizeof(full));
+  full.size = sizeof(full);
+  full.side = GEARLAB_RIGHT;
+  full.steps = 32;
+  full.lengthwiseCrowning = d.lengthwiseCrowning;
+  full.profileCrowning = d.profileCrowning;
+  full.markingCompound = d.markingCompound;
+  full.faceSamples = d.faceSamples;
+  size = std::min(size, sizeof(full));
+  std::memcpy(o, &full, size);
+  o->size = size;
+}
+
+gearlab_status gearlab_tca(const gearlab_pair* pair, gearlab_member member,
+                           const gearlab_tca_options* options,
+                           gearlab_result** out) {
+  if (gearlab_status s = start(out))
+    return s;
+  return guarded([&] {
+    const gearlab_tca_options o =
+        optionsFrom(options, gearlab_tca_options_init);
+    require(o.side == GEARLAB_RIGHT || o.side == GEARLAB_LEFT,
+            "Unknown side");
+    require(o.steps >= 1, "Steps must be at least 1");
+    TcaOptions t;
+    t.side = o.side == GEARLAB_LEFT ? FlankSide::Left : FlankSide::Right;
+    t.lengthwiseCrowning = o.lengthwiseCrowning;
+    t.profileCrowning = o.profileCrowning;
+    t.markingCompound = o.markingCompound;
+    t.faceSamples = o.faceSamples;
+    t.misalignment = {o.pinionAxial, o.gearAxial, o.offset, o.shaftAngle};
+    require(member == GEARLAB_GEAR || member == GEARLAB_PINION,
+            "Unknown member");
+    auto path = std::make_shared<std::vector<TcaPoint>>(
+        UnloadedTca(validPair(pair), member == GEARLAB_PINION, t)
+            .path(o.steps));
+
+    // Views straight into the TcaPoint array
+    auto r = std::make_unique<gearlab_result>();
+    const char* base = reinterpret_cast<const char*>(path->data());
+    const int64_t n = path->size(), stride = sizeof(TcaPoint);
+    auto field = [&](const char* name, size_t offset, gearlab_dtype t) {
+      r->add(name, base + offset, t, {n}, {stride});
+    };
+    const size_t zone = offsetof(TcaPoint, contact);
+    field("rotation", offsetof(TcaPoint, rotation), GEARLAB_F64);
+    field("transmissionError", offsetof(TcaPoint, transmissionError),
+          GEARLAB_F64);
+    static_assert(sizeof(int) == sizeof(int32_t), "Teeth are passed as I32");
+    field("tooth", zone + offsetof(ContactZone, tooth), GEARLAB_I32);
+    field("gap", zone + offsetof(ContactZone, gap), GEARLAB_F64);
+    field("centreR", zone + offsetof(ContactZone, centreR), GEARLAB_F64);
+    field("centreU", zone + offsetof(ContactZone, centreU), GEARLAB_F64);
+    field("length", zone + offsetof(ContactZone, length), GEARLAB_F64);
+    field("width", zone + offsetof(ContactZone, width), GEARLAB_F64);
+    field("area", zone + offsetof(ContactZone, area), GEARLAB_F64);
+    r->owner = std::move(path);
+    *out = r.release();
+  });
+}
+
+gearlab_status gearlab_rate(const gearlab_buffer* designs,
+                            const gearlab_buffer* spectrum,
+                            gearlab_result** out) {
+  if (gearlab_status s = start(out))
+    return s;
+  return guarded([&] {
+    require2d(spectrum, "Spectrum");
+    require(spectrum->shape[0] >= 1 && spectrum->shape[1] == 3,
+            "Spectrum needs [bins, 3] of torque, speed and hours");
+    LoadSpectrum bins(spectrum->shape[0]);
+    for (size_t i = 0; i < bins.size(); ++i)
+      bins[i] = {f64(*spectrum, i, 0), f64(*spectrum, i, 1),
+                 f64(*spectrum, i, 2)};
+
+    RatingInputs in;
+    const std::vector<BevelGearPair> pairs = designsFrom(designs);
+    in.reserve(pairs.size());
+    for (const BevelGearPair& p : pairs)
+      in.push_back(p);
+    auto rated = std::make_shared<RatingResults>(LoadRating().rate(in, bins));
+    auto r = std::make_unique<gearlab_result>();
+    const int64_t n = rated->size(), d = sizeof(double);
+    const std::pair<const char*, std::vector<double>*> columns[] = {
+        {"pittingSafety1", &rated->pittingSafety1},
+        {"pittingSafety2", &rated->pittingSafety2},
+        {"bendingSafety1", &rated->bendingSafety1},
+        {"bendingSafety2", &rated->bendingSafety2},
+        {"pittingDamage1", &rated->pittingDamage1},
+        {"pittingDamage2", &rated->pittingDamage2},
+        {"bendingDamage1", &rated->bendingDamage1},
+        {"bendingDamage2", &rated->bendingDamage2}};
+    for (const auto& [name, v] : columns)
+      r->add(name, v->data(), GEARLAB_F64, {n}, {d});
+    r->owner = std::move(rated);
+    *out = r.release();
+  });
+}
+
+}  // extern "C"
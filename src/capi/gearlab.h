@@ -0,0 +1,211 @@
+/* gearlab.h */
+#ifndef GEARLAB_H
+#define GEARLAB_H
+
+/*
+ * C interface to the GearLab core for embedding in other languages (Python
+ * ctypes/cffi, Julia ccall, ...). Plain C99, no C++ types cross it and no
+ * exception escapes it.
+ *
+ * Handles:
+ *  - gearlab_pair:   one design, inputs by the PairFieldUtils names of the
+ *                    TOML files
+ *  - gearlab_result: the output of one call, a list of named buffers
+ *
+ * Results are returned without copying: every buffer points into memory the
+ * result handle owns, described by dtype, shape and byte strides the way
+ * numpy and Julia arrays are. The data stays valid and unchanged until
+ * gearlab_result_destroy and must not be written or freed by the caller; a
+ * host wrapper keeps the result alive as long as any array viewing it.
+ * Results do not reference the pair they came from, so pairs may be
+ * destroyed first. Input arrays are read during the call only.
+ *
+ * Every function that can fail returns a gearlab_status and sets the thread
+ * local message of gearlab_last_error. Functions may be called from any
+ * thread; one handle may be read from several threads at once but not
+ * changed (gearlab_pair_set) while it is read. Work runs on the shared pool
+ * of the library.
+ *
+ * The ABI is versioned by GEARLAB_API_VERSION. Option structs start with
+ * their size, so fields can be appended without breaking older callers:
+ * always fill them with the matching _init function first.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(GEARLAB_C_BUILD)
+#define GEARLAB_API __declspec(dllexport)
+#else
+#define GEARLAB_API __declspec(dllimport)
+#endif
+#else
+#define GEARLAB_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GEARLAB_API_VERSION 1
+#define GEARLAB_MAX_DIMS 3
+
+typedef enum gearlab_status {
+  GEARLAB_OK = 0,
+  GEARLAB_ERR_ARGUMENT = 1, /* Null handle, bad shape, unknown name, ... */
+  GEARLAB_ERR_DESIGN = 2,   /* Pair fails validation, no geometry */
+  GEARLAB_ERR_MEMORY = 3,   /* Allocation or memory budget */
+  GEARLAB_ERR_INTERNAL = 4
+} gearlab_status;
+
+typedef enum gearlab_dtype {
+  GEARLAB_F64 = 0,
+  GEARLAB_F32 = 1,
+  GEARLAB_I32 = 2,
+  GEARLAB_U8 = 3
+} gearlab_dtype;
+
+typedef enum gearlab_member {
+  GEARLAB_GEAR = 0,
+  GEARLAB_PINION = 1
+} gearlab_member;
+
+typedef enum gearlab_side {
+  GEARLAB_RIGHT = 0, /* Drive side */
+  GEARLAB_LEFT = 1
+} gearlab_side;
+
+/* Strided array view. Element (i, j, k) is at
+ * (const char*)data + i * strides[0] + j * strides[1] + k * strides[2]. */
+typedef struct gearlab_buffer {
+  const void* data; /* May be NULL when an extent is 0 */
+  int32_t dtype;    /* gearlab_dtype */
+  int32_t ndim;     /* 1 to GEARLAB_MAX_DIMS */
+  int64_t shape[GEARLAB_MAX_DIMS];
+  int64_t strides[GEARLAB_MAX_DIMS]; /* Bytes */
+} gearlab_buffer;
+
+typedef struct gearlab_pair gearlab_pair;
+typedef struct gearlab_result gearlab_result;
+
+GEARLAB_API int gearlab_api_version(void);
+
+/* Message of the last failed call on this thread, "" after success. Valid
+ * until the next call on the same thread. */
+GEARLAB_API const char* gearlab_last_error(void);
+
+/* ---- Pairs ---- */
+
+/* Inputs in constructor order: numGearTeeth, numPinionTeeth, module,
+ * backlash, coneClearance, shaftAngle, faceConeAngle, rootConeAngle,
+ * faceConeOffset, rootConeOffset, innerConeDistance, outerConeDistance,
+ * pressureAngle, spiralAngle, spiralType. The last two are optional.
+ * Inputs must be finite, the tooth counts integers from 1 to 10000 and
+ * spiralType 0, 1 or 2; other values give GEARLAB_ERR_ARGUMENT wherever
+ * inputs are passed, pairs and design buffers alike. */
+GEARLAB_API size_t gearlab_pair_field_count(void);
+GEARLAB_API const char* gearlab_pair_field_name(size_t i); /* NULL past end */
+
+/* New pair from the first `count` inputs (13 to 15). Designs that fail
+ * validation are created; check them with gearlab_pair_valid. */
+GEARLAB_API gearlab_status gearlab_pair_create(const double* values,
+                                               size_t count,
+                                               gearlab_pair** out);
+GEARLAB_API void gearlab_pair_destroy(gearlab_pair* pair); /* NULL is ok */
+
+/* Set or read one input by name; set recomputes the derived values */
+GEARLAB_API gearlab_status gearlab_pair_set(gearlab_pair* pair,
+                                            const char* name, double value);
+GEARLAB_API gearlab_status gearlab_pair_get(const gearlab_pair* pair,
+                                            const char* name, double* value);
+
+/* 1 if the pair passes validation, 0 if not or NULL */
+GEARLAB_API int gearlab_pair_valid(const gearlab_pair* pair);
+
+/* ---- Results ---- */
+
+GEARLAB_API size_t gearlab_result_count(const gearlab_result* result);
+GEARLAB_API const char* gearlab_result_name(const gearlab_result* result,
+                                            size_t i);
+/* Buffer by index or name, NULL if there is none. Owned by the result. */
+GEARLAB_API const gearlab_buffer* gearlab_result_buffer(
+    const gearlab_result* result, size_t i);
+GEARLAB_API const gearlab_buffer* gearlab_result_get(
+    const gearlab_result* result, const char* name);
+GEARLAB_API void gearlab_result_destroy(gearlab_result* result);
+
+/* ---- Computations ---- */
+
+/* Batch evaluation of designs: a [n, k] F64 buffer of inputs in the order of
+ * gearlab_pair_field_name, k from 13 to 15, any strides. Runs the pair
+ * sweep. Result: "values" [n, 17] F64 with one view per column, "valid"
+ * (1 or 0), then "gear.<name>" and "pinion.<name>" for pitchConeAngle,
+ * faceConeAngle, rootConeAngle, faceConeOffset, rootConeOffset,
+ * pitchConeDistance, addendum and dedendum, each [n] with a row stride. */
+GEARLAB_API gearlab_status gearlab_evaluate(const gearlab_buffer* inputs,
+                                            gearlab_result** out);
+
+/* Tooth flank of one side on a grid of cone distance x profile parameter.
+ * Result: "R" [faceSteps + 1], "u" [profileSteps + 1] (0 root, 1 tip),
+ * "point" and "normal" [faceSteps + 1, profileSteps + 1, 3] F64. */
+GEARLAB_API gearlab_status gearlab_flank(const gearlab_pair* pair,
+                                         gearlab_member member,
+                                         gearlab_side side, int faceSteps,
+                                         int profileSteps,
+                                         gearlab_result** out);
+
+typedef struct gearlab_surface_options {
+  size_t size;
+  int faceSteps, profileSteps, landSteps, bodySteps;
+  double boreRadius;
+} gearlab_surface_options;
+
+GEARLAB_API void gearlab_surface_options_init(gearlab_surface_options* o,
+                                              size_t size);
+
+/* Triangulated surface of the gear solid, options NULL for the defaults.
+ * Result: "ax", "ay", "az", "bx", ... "cz" [n] F64 vertex coordinates per
+ * triangle, wound outwards, "region" [n] U8 (flank, tip land, root land,
+ * tooth end, body, bore) and "tooth" [n] I32. */
+GEARLAB_API gearlab_status gearlab_surface(
+    const gearlab_pair* pair, gearlab_member member,
+    const gearlab_surface_options* options, gearlab_result** out);
+
+typedef struct gearlab_tca_options {
+  size_t size;
+  int side; /* gearlab_side */
+  int steps;
+  double lengthwiseCrowning, profileCrowning, markingCompound;
+  int faceSamples;
+  /* Mounting errors (mm, deg) */
+  double pinionAxial, gearAxial, offset, shaftAngle;
+} gearlab_tca_options;
+
+GEARLAB_API void gearlab_tca_options_init(gearlab_tca_options* o,
+                                          size_t size);
+
+/* Unloaded tooth contact analysis over one mesh cycle of `member`, options
+ * NULL for the defaults. Result, all [steps]: "rotation" (deg),
+ * "transmissionError" (arcsec), "tooth" I32, and of its contact zone "gap",
+ * "centreR", "centreU", "length", "width", "area", all F64. Rotations where
+ * no tooth is engaged have tooth -1 and a NaN transmission error. */
+GEARLAB_API gearlab_status gearlab_tca(const gearlab_pair* pair,
+                                       gearlab_member member,
+                                       const gearlab_tca_options* options,
+                                       gearlab_result** out);
+
+/* Load rating of designs (as for gearlab_evaluate) under a spectrum, a
+ * [bins, 3] F64 buffer of pinion torque (Nm), pinion speed (rpm) and hours,
+ * with the default materials and factors. Result, all [n] F64:
+ * "pittingSafety1", "pittingSafety2", "bendingSafety1", "bendingSafety2",
+ * "pittingDamage1", ... "bendingDamage2"; 1 is the pinion, 2 the gear. */
+GEARLAB_API gearlab_status gearlab_rate(const gearlab_buffer* designs,
+                                        const gearlab_buffer* spectrum,
+                                        gearlab_result** out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEARLAB_H */
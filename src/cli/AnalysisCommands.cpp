@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../analysis/ContactMesh.hpp"
+#include "../analysis/ContactPattern.hpp"
+#include "../analysis/FlankDeviation.hpp"
+#include "../analysis/GearDynamics.hpp"
+#include "../analysis/GearFit.hpp"
+#include "../analysis/UnloadedTca.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../pipeline/Pipeline.hpp"
+#include "../pipeline/Trace.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+
+int femesh(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.femesh");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  const std::string out = option(argc, argv, "out");
+  if (out.empty()) {
+    std::cerr << "Femesh needs --out=file.inp" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  TcaOptions tca;
+  if (hasFlag(argc, argv, "coast"))
+    tca.side = FlankSide::Left;
+  FeMeshOptions opt;
+  const std::string rotation = option(argc, argv, "rotation");
+  if (!rotation.empty())
+    opt.rotations = {std::strtod(rotation.c_str(), nullptr)};
+  const std::string size = option(argc, argv, "size");
+  if (!size.empty())
+    opt.contactSize = std::strtod(size.c_str(), nullptr);
+  opt.filletSize = std::max(opt.filletSize, opt.contactSize);
+
+  const bool pinion = hasFlag(argc, argv, "pinion");
+  FeMesh m;
+  size_t bytes = 0;
+  try {
+    m = ContactZoneMesher(UnloadedTca(r.pair, pinion, tca), opt).build();
+    bytes = feexport::writeInp(out, m);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << "Wrote " << m.nodes() << " nodes (" << m.uniformNodes
+            << " uniform), " << m.elements() << " elements, "
+            << m.loadedTeeth.size() << " loaded teeth, " << bytes
+            << " bytes to " << out << std::endl;
+  return EXIT_SUCCESS;
+}
+
+int pattern(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.pattern");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  const std::string out = option(argc, argv, "out");
+  if (out.empty()) {
+    std::cerr << "Pattern needs --out=prefix" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ContactPatternOptions opt;
+  const std::string grid = option(argc, argv, "grid");
+  if (!grid.empty() && std::sscanf(grid.c_str(), "%dx%d", &opt.faceCells,
+                                   &opt.profileCells) != 2) {
+    std::cerr << "Expected --grid=CxR, got " << grid << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string rolls = option(argc, argv, "rolls");
+  if (!rolls.empty())
+    opt.rollPositions = std::atoi(rolls.c_str());
+  const std::string shift = option(argc, argv, "shift");
+  const std::vector<ContactPatternCase> cases = markingTestCases(
+      shift.empty() ? 0.05 : std::strtod(shift.c_str(), nullptr));
+
+  std::vector<ContactPattern> patterns;
+  size_t bytes = 0;
+  try {
+    const bool pinion = hasFlag(argc, argv, "pinion");
+    patterns = ContactPatternAnalysis(r.pair, pinion, {}, opt).run(cases);
+    // One colour scale for the whole set, so the images compare
+    double maxTime = 0, maxSqueeze = 0;
+    for (const ContactPattern& p : patterns) {
+      for (size_t i = 0; i < p.time.size(); ++i) {
+        maxTime = std::max(maxTime, double(p.time[i]));
+        maxSqueeze = std::max(maxSqueeze, double(p.squeeze[i]));
+      }
+    }
+    for (const ContactPattern& p : patterns) {
+      const char* side = p.side == FlankSide::Right ? "drive" : "coast";
+      bytes += writeContactPattern(out + "." + p.name + "." + side, p,
+                                   maxTime, maxSqueeze);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::printf("case,side,markedShare,centreR,centreU\n");
+  for (const ContactPattern& p : patterns) {
+    std::printf("%s,%s,%.4f,%.4f,%.4f\n", p.name.c_str(),
+                p.side == FlankSide::Right ? "drive" : "coast",
+                p.markedShare, p.centreR, p.centreU);
+  }
+  std::cerr << "Wrote " << 4 * patterns.size() << " files, " << bytes
+            << " bytes to " << out << ".*" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+int inspect(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.inspect");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  const std::string scan = option(argc, argv, "scan");
+  if (scan.empty()) {
+    std::cerr << "Inspect needs --scan=file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  InspectionOptions opt;
+  const std::string grid = option(argc, argv, "grid");
+  if (!grid.empty() && std::sscanf(grid.c_str(), "%dx%d", &opt.gridColumns,
+                                   &opt.gridRows) != 2) {
+    std::cerr << "Expected --grid=CxR, got " << grid << std::endl;
+    return EXIT_FAILURE;
+  }
+  opt.registration = !hasFlag(argc, argv, "no-register");
+
+  const bool pinion = hasFlag(argc, argv, "pinion");
+  InspectionResult d;
+  size_t points = 0;
+  try {
+    const PointCloud cloud = pointcloud::read(scan);
+    points = cloud.size();
+    d = FlankInspection(pinion ? *r.pinion : *r.gear, opt).inspect(cloud);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  const Vec3 w = d.registration.rotationVector();
+  const Vec3& t = d.registration.translation;
+  std::printf("points = %zu\n", points);
+  std::printf("onFlank = %zu\n", d.onFlank);
+  std::printf("iterations = %d\n", d.iterations);
+  std::printf("registrationRms = %.4f\n", d.registrationRms * 1e3);
+  std::printf("rotation = %.9f %.9f %.9f\n", w.x, w.y, w.z);
+  std::printf("translation = %.6f %.6f %.6f\n\n", t.x, t.y, t.z);
+  std::printf("tooth,side,points,mean,min,max,rms\n");
+  for (const FlankTopography& f : d.topography) {
+    std::printf("%d,%s,%zu,%.3f,%.3f,%.3f,%.3f\n", f.tooth,
+                f.side == FlankSide::Right ? "right" : "left", f.points,
+                f.mean * 1e3, f.min * 1e3, f.max * 1e3, f.rms * 1e3);
+  }
+  if (hasFlag(argc, argv, "cells")) {
+    std::printf("\ntooth,side,row,column,points,deviation\n");
+    for (const FlankTopography& f : d.topography) {
+      for (int i = 0; i < f.rows; ++i) {
+        for (int j = 0; j < f.columns; ++j) {
+          std::printf("%d,%s,%d,%d,%u,%.3f\n", f.tooth,
+                      f.side == FlankSide::Right ? "right" : "left", i, j,
+                      f.count[size_t(i) * f.columns + j], f.at(i, j) * 1e3);
+        }
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+int dynamics(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.dynamics");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto number = [&](const char* name, double fallback) {
+    const std::string v = option(argc, argv, name);
+    return v.empty() ? fallback : std::strtod(v.c_str(), nullptr);
+  };
+  DynamicsInputs in;
+  in.torque = number("torque", in.torque);
+  in.dampingRatio = number("damping", in.dampingRatio);
+  in.pinionInertia = number("pinion-inertia", in.pinionInertia);
+  in.gearInertia = number("gear-inertia", in.gearInertia);
+  in.teAmplitude = {number("te", in.teAmplitude[0] * 1e3) * 1e-3};
+  const double from = number("from", 0), to = number("to", 10000);
+  const std::string speeds = option(argc, argv, "speeds");
+  const int count = speeds.empty() ? 200 : std::atoi(speeds.c_str());
+  if (!(count >= 1 && from >= 0 && to >= from)) {
+    std::cerr << "Expected 0 <= --from <= --to and --speeds >= 1"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  DynamicsResults d;
+  double resonance = 0, natural = 0;
+  try {
+    const GearDynamics dyn(r.pair, in);
+    resonance = dyn.resonanceSpeed();
+    natural = dyn.naturalFrequency();
+    d = dyn.run(GearDynamics::speedRange(from, to, size_t(count)));
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t contactLoss = 0;
+  for (size_t i = 0; i < d.size(); ++i)
+    contactLoss += d.minForceRatio[i] == 0;
+  std::printf("naturalFrequency = %.3f\n", natural);
+  std::printf("resonanceSpeed = %.3f\n", resonance);
+  std::printf("contactLoss = %zu\n\n", contactLoss);
+  std::printf("speed,meshFrequency,dynamicFactor,minForceRatio,dteRms,"
+              "quasiStatic\n");
+  for (size_t i = 0; i < d.size(); ++i) {
+    std::printf("%.3f,%.3f,%.6f,%.6f,%.4f,%d\n", d.speed[i],
+                d.meshFrequency[i], d.dynamicFactor[i], d.minForceRatio[i],
+                d.dteRms[i] * 1e3, int(d.quasiStatic[i]));
+  }
+  if (contactLoss > 0) {
+    std::cerr << "Teeth lose contact at " << contactLoss << " of "
+              << d.size() << " speeds" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+int fit(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.fit");
+  const std::string scan = option(argc, argv, "scan");
+  if (scan.empty()) {
+    std::cerr << "Fit needs --scan=file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  GearFitOptions opt;
+  opt.pinion = hasFlag(argc, argv, "pinion");
+  const std::string mate = option(argc, argv, "mate");
+  const std::string shaft = option(argc, argv, "shaft");
+  const std::string backlash = option(argc, argv, "backlash");
+  const std::string spiral = option(argc, argv, "spiral-type");
+  if (!mate.empty())
+    opt.mateTeeth = std::atoi(mate.c_str());
+  if (!shaft.empty())
+    opt.shaftAngle = std::strtod(shaft.c_str(), nullptr);
+  if (!backlash.empty())
+    opt.backlash = std::strtod(backlash.c_str(), nullptr);
+  if (!spiral.empty())
+    opt.spiralType = static_cast<spiralFunction>(std::atoi(spiral.c_str()));
+
+  GearFitResult r;
+  try {
+    const PointCloud cloud = pointcloud::read(scan);
+    r = GearFit(opt).fit(cloud);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  // The pair in the key=value form of compute, so it can be fed back
+  if (r.hasPair) {
+    for (const char* name : PairFieldUtils::names) {
+      double v = 0;
+      PairFieldUtils::get(r.pair, name, v);
+      std::printf("%s = %.10g\n", name, std::fabs(v) < 1e-9 ? 0.0 : v);
+    }
+    std::printf("\n");
+  }
+  printGear(opt.pinion ? "pinion" : "gear", *r.gear);
+  const Vec3 w = r.registration.rotationVector();
+  const Vec3& t = r.registration.translation;
+  std::printf("mateTeeth = %d\n", r.mateTeeth);
+  std::printf("pressureAngle = %.6f\n", r.gear->pressureAngle);
+  std::printf("spiralAngle = %.6f\n", r.gear->spiralAngle);
+  std::printf("module = %.6f\n", r.gear->module);
+  std::printf("points = %zu\n", r.points);
+  std::printf("inliers = %zu (flank %zu, tip %zu, root %zu)\n", r.inliers,
+              r.flankPoints, r.tipPoints, r.rootPoints);
+  std::printf("iterations = %d\n", r.iterations);
+  std::printf("rms = %.4f\n", r.rms * 1e3);
+  std::printf("rotation = %.9f %.9f %.9f\n", w.x, w.y, w.z);
+  std::printf("translation = %.6f %.6f %.6f\n", t.x, t.y, t.z);
+  return EXIT_SUCCESS;
+}
+
+}  // namespace cli
@@ -0,0 +1,109 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../geometry/PairFields.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+
+BevelGearPair defaultPair() {
+  // assets/CAD/Gear_1.FCStd, same defaults as BevelGearForm
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                       60, 20);
+}
+
+std::string option(int argc, char* argv[], const std::string& name) {
+  const std::string prefix = "--" + name + "=";
+  for (int i = 2; i < argc; ++i) {
+    if (std::string(argv[i]).rfind(prefix, 0) == 0)
+      return argv[i] + prefix.size();
+  }
+  return "";
+}
+
+bool hasFlag(int argc, char* argv[], const std::string& name) {
+  for (int i = 2; i < argc; ++i) {
+    if (argv[i] == "--" + name)
+      return true;
+  }
+  return false;
+}
+
+bool countOption(int argc, char* argv[], const std::string& name, size_t min,
+                 size_t& value) {
+  const std::string text = option(argc, argv, name);
+  if (text.empty())
+    return true;
+  char* end = nullptr;
+  errno = 0;
+  const unsigned long long n = std::strtoull(text.c_str(), &end, 10);
+  if (text.find_first_not_of("0123456789") != std::string::npos ||
+      *end != '\0' || errno == ERANGE || n < min) {
+    std::cerr << "--" << name << " must be a whole number of at least "
+              << min << ", got " << text << std::endl;
+    return false;
+  }
+  value = size_t(n);
+  return true;
+}
+
+bool parseArgs(int argc, char* argv[], BevelGearPair& pair,
+               std::vector<SweepAxis>* axes) {
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) == 0)
+      continue;
+    const size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Expected key=value, got " << arg << std::endl;
+      return false;
+    }
+    const std::string key = arg.substr(0, eq);
+    const std::string value = arg.substr(eq + 1);
+    SweepAxis axis{key, 0, 0, 0};
+    if (axes && std::sscanf(value.c_str(), "%lf:%lf:%d", &axis.start,
+                            &axis.stop, &axis.count) == 3) {
+      if (axis.count < 1) {
+        std::cerr << "Sweep count must be positive for " << key << std::endl;
+        return false;
+      }
+      double probe;
+      if (!PairFieldUtils::get(pair, key, probe)) {
+        std::cerr << "Unknown key " << key << std::endl;
+        return false;
+      }
+      axes->push_back(axis);
+      continue;
+    }
+    char* end = nullptr;
+    const double v = std::strtod(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0') {
+      std::cerr << "Invalid number for " << key << ": " << value << std::endl;
+      return false;
+    }
+    if (!PairFieldUtils::set(pair, key, v)) {
+      std::cerr << "Unknown key " << key << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void printGear(const char* label, const BevelGear& g) {
+  std::printf("[%s]\n", label);
+  std::printf("numTeeth = %d\n", g.numTeeth);
+  std::printf("pitchConeAngle = %.6f\n", g.pitchConeAngle);
+  std::printf("faceConeAngle = %.6f\n", g.faceConeAngle);
+  std::printf("rootConeAngle = %.6f\n", g.rootConeAngle);
+  std::printf("faceConeOffset = %.6f\n", g.faceConeOffset);
+  std::printf("rootConeOffset = %.6f\n", g.rootConeOffset);
+  std::printf("pitchConeDistance = %.6f\n", g.pitchConeDistance);
+  std::printf("addendum = %.6f\n", g.addendum);
+  std::printf("dedendum = %.6f\n\n", g.dedendum);
+}
+
+}  // namespace cli
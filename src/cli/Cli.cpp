@@ -0,0 +1,172 @@
+#include "Cli.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../geometry/PairFields.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ShardedSweep.hpp"
+#include "../pipeline/Trace.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+namespace {
+
+void printUsage() {
+  std::cerr << "Usage:\n"
+               "  gearlab                       start the GUI\n"
+               "  gearlab compute [key=value]   compute one gear pair\n"
+               "  gearlab sweep key=a:b:n ...   sweep a grid of gear pairs\n"
+               "        [--out=file.glr]        write a result store, not CSV\n"
+               "        [--out=file.glrc]       columnar store, appendable:\n"
+               "        [--te-steps=N]          add transmission error curves\n"
+               "        [--append]              add rows to an existing store\n"
+               "        [--torque=Nm]           add pitting/bending safety at\n"
+               "        [--speed=rpm]           this pinion torque and speed\n"
+               "        [--hours=h]             (defaults 1000 rpm, 20000 h)\n"
+               "        [--run=dir]             sharded on worker processes,\n"
+               "                                checkpointed; rerun resumes\n"
+               "        [--shard-size=N]        designs per shard (4096)\n"
+               "        [--workers=N]           worker processes (1), 0 runs\n"
+               "                                the shards in this process\n"
+               "        [--launch=cmd]          worker command, {worker} is\n"
+               "                                its number (e.g. ssh host)\n"
+               "        [--pareto=col:max,...]  Pareto front of the catalog\n"
+               "        [--merge-only]          merge finished shards only\n"
+               "  gearlab query file.glrc       columnar store rows as CSV\n"
+               "        [column=min:max ...]    ranges the rows must be in\n"
+               "        [--columns=a,b,...]     printed columns (all scalars)\n"
+               "        [--limit=N]             at most N rows\n"
+               "  gearlab mill [key=value]      5-axis finishing G-code\n"
+               "        --out=file.nc           program for all tooth spaces\n"
+               "        [--pinion]              mill the pinion, not the gear\n"
+               "        [--tool=ball|flank]     tool type (default ball)\n"
+               "        [--tool-radius=mm]      default 1\n"
+               "        [--scallop=mm]          ball scallop height (0.005)\n"
+               "  gearlab slice [key=value]     3D print layer contours\n"
+               "        --out=file.glc          contour file for the slicer\n"
+               "        [--pinion]              slice the pinion instead\n"
+               "        [--layer=mm]            layer height (default 0.1)\n"
+               "        [--cell=mm]             contouring grid (default 0.1)\n"
+               "        [--bore=mm]             bore radius (default solid)\n"
+               "  gearlab draft [key=value]     draft and undercut check for\n"
+               "        [--draft=deg]           moulding/forging (default 1)\n"
+               "        [--pinion] [--bore=mm]\n"
+               "  gearlab femesh [key=value]    FE mesh refined at the contact\n"
+               "        --out=file.inp          Abaqus input deck\n"
+               "        [--rotation=deg]        load step (default 0)\n"
+               "        [--size=mm]             contact element (default 0.1)\n"
+               "        [--pinion] [--coast]\n"
+               "  gearlab pattern [key=value]   marking test contact patterns\n"
+               "        --out=prefix            images and grids per case and\n"
+               "                                flank, prefix.case.side.*\n"
+               "        [--shift=mm]            H and V of the cases (0.05)\n"
+               "        [--grid=CxR]            face x profile cells (96x48)\n"
+               "        [--rolls=N]             roll positions per mesh cycle\n"
+               "        [--pinion]\n"
+               "  gearlab inspect [key=value]   CMM flank deviations\n"
+               "        --scan=file             XYZ/CSV text or PLY points\n"
+               "        [--pinion] [--grid=CxR] [--no-register] [--cells]\n"
+               "  gearlab dynamics [key=value]  dynamic factor over speed\n"
+               "        [--from=rpm] [--to=rpm] pinion speeds (0 to 10000)\n"
+               "        [--speeds=N]            number of speeds (200)\n"
+               "        [--torque=Nm]           pinion torque (100)\n"
+               "        [--damping=ratio]       of the mesh stiffness (0.07)\n"
+               "        [--te=um]               TE amplitude (2)\n"
+               "        [--pinion-inertia=t*mm2] [--gear-inertia=t*mm2]\n"
+               "                                (default solid discs)\n"
+               "  gearlab fit --scan=file       gear parameters of a scan,\n"
+               "        [--mate=N]              gear axis along z (mate count\n"
+               "        [--pinion]              searched by default)\n"
+               "        [--shaft=deg] [--backlash=deg] [--spiral-type=0|1|2]\n"
+               "  gearlab serve --socket=path   JSON-RPC compute server, one\n"
+               "        [key=value]             request per line; base design\n"
+               "        [--cache=MB]            result cache (default 64)\n"
+               "Options:\n"
+               "  --trace=file.json             write a Chrome trace of the run\n"
+               "                                (or set GEARLAB_TRACE=file.json)\n"
+               "  --memory-budget=MB            limit the memory of the job;\n"
+               "                                sweeps stream results in blocks\n"
+               "  --memory-report               print current/peak memory per\n"
+               "                                category on exit\n"
+               "Keys:";
+  for (const char* name : PairFieldUtils::names)
+    std::cerr << " " << name;
+  std::cerr << std::endl;
+}
+
+int sweepWorker(int, char*[]) { return runSweepWorker(); }
+
+struct Command {
+  const char* name;
+  int (*run)(int argc, char* argv[]);
+};
+
+const Command commands[] = {{"compute", compute},
+                             {"sweep", sweep},
+                             {"query", query},
+                             {"mill", mill},
+                             {"slice", slice},
+                             {"draft", draft},
+                             {"femesh", femesh},
+                             {"pattern", pattern},
+                             {"inspect", inspect},
+                             {"dynamics", dynamics},
+                             {"fit", fit},
+                             {"sweep-worker", sweepWorker},
+                             {"serve", serve}};
+
+const Command* findCommand(const std::string& name) {
+  for (const Command& c : commands) {
+    if (name == c.name)
+      return &c;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+bool isCommand(const char* arg) {
+  const std::string name = arg;
+  return findCommand(name) || name == "help" || name == "--help";
+}
+
+int run(int argc, char* argv[]) {
+  const std::string cmd = argv[1];
+  std::string tracePath = option(argc, argv, "trace");
+  if (tracePath.empty())
+    tracePath = trace::enableFromEnvironment();
+  trace::setEnabled(!tracePath.empty());
+  trace::setThreadName("main");
+
+  const std::string budgetMb = option(argc, argv, "memory-budget");
+  memory::Budget budget(
+      budgetMb.empty() ? 0 : size_t(std::strtod(budgetMb.c_str(), nullptr) *
+                                    1024 * 1024));
+  memory::BudgetScope budgetScope(&budget);
+
+  int status = EXIT_FAILURE;
+  try {
+    if (const Command* c = findCommand(cmd)) {
+      status = c->run(argc, argv);
+    } else {
+      printUsage();
+      status = cmd == "help" || cmd == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  } catch (const memory::BudgetExceeded& e) {
+    std::cerr << e.what() << " (--memory-budget=" << budgetMb << ")"
+              << std::endl;
+  }
+
+  if (hasFlag(argc, argv, "memory-report")) {
+    std::cerr << "Memory usage of the job:\n";
+    budget.jobUsage().write(std::cerr);
+  }
+
+  if (!tracePath.empty() && !trace::dumpChromeTrace(tracePath))
+    std::cerr << "Could not write trace to " << tracePath << std::endl;
+  return status;
+}
+
+}  // namespace cli
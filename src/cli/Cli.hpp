@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * @brief Command line front end of the `gearlab` executable.
+ *
+ * Commands, by translation unit (the table and the usage text with every
+ * option are in Cli.cpp):
+ *  - SweepCommands.cpp
+ *    - `compute [key=value ...]`: run the pair pipeline for one design and
+ *      print the gear and pinion values.
+ *    - `sweep key=start:stop:count [key=value ...]`: run the pair pipeline
+ *      for every grid point and print CSV, or write a result store, or run
+ *      sharded on worker processes (`--run`).
+ *    - `query file.glrc [column=min:max ...]`: selected rows of a columnar
+ *      store as CSV.
+ *  - ManufacturingCommands.cpp
+ *    - `mill`: 5-axis finishing G-code for all tooth spaces.
+ *    - `slice`: layer contours for 3D printing.
+ *    - `draft`: draft and undercut check for moulding or forging.
+ *  - AnalysisCommands.cpp
+ *    - `femesh`: FE mesh refined at the contact, as an Abaqus deck.
+ *    - `pattern`: contact patterns of the marking test.
+ *    - `inspect`: flank deviations of a CMM scan.
+ *    - `dynamics`: dynamic factor over the pinion speed.
+ *    - `fit`: gear parameters recovered from a scan.
+ *  - ServeCommand.cpp
+ *    - `serve --socket=path`: JSON-RPC compute server.
+ *  - Cli.cpp
+ *    - `sweep-worker`: internal, the worker process that `sweep --run`
+ *      launches (see ShardedSweep).
+ *
+ * Keys are the BevelGearPair input names (see PairFieldUtils). Unset keys
+ * default to the Gear_1 reference design. Cli.cpp only dispatches and sets
+ * up tracing and the memory budget; the commands are declared in
+ * Commands.hpp.
+ */
+namespace cli {
+
+/**
+ * @brief Check whether the first argument selects a CLI command.
+ * @param arg argv[1] of the process.
+ * @return true if @ref run should handle the invocation instead of the GUI.
+ */
+bool isCommand(const char* arg);
+
+/**
+ * @brief Run a CLI command.
+ * @return Process exit code.
+ */
+int run(int argc, char* argv[]);
+
+}  // namespace cli
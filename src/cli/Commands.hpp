@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../pipeline/SweepSpec.hpp"
+
+// Shared argument helpers and the entry points of the command families.
+// Every command takes the process argv with the command name at argv[1]
+// and returns the process exit code; `run` in Cli.cpp dispatches to them.
+namespace cli {
+
+// ---- Args.cpp ----
+
+// Gear_1 reference design that unset keys default to
+BevelGearPair defaultPair();
+
+// Value of `--name=value` if present, empty otherwise
+std::string option(int argc, char* argv[], const std::string& name);
+
+bool hasFlag(int argc, char* argv[], const std::string& name);
+
+// Whole number `--name=N` of at least `min` into `value`, which is kept if
+// the option is absent. Prints an error and returns false if malformed.
+bool countOption(int argc, char* argv[], const std::string& name, size_t min,
+                 size_t& value);
+
+// Parse `key=value` or `key=start:stop:count` arguments. Options starting
+// with `--` are left to the command. Sweep ranges are rejected when `axes`
+// is null.
+bool parseArgs(int argc, char* argv[], BevelGearPair& pair,
+               std::vector<SweepAxis>* axes);
+
+// `[label]` section with the derived values of one member
+void printGear(const char* label, const BevelGear& g);
+
+// ---- SweepCommands.cpp: pair pipeline and result stores ----
+
+int compute(int argc, char* argv[]);
+int sweep(int argc, char* argv[]);
+int query(int argc, char* argv[]);
+
+// ---- ManufacturingCommands.cpp ----
+
+int mill(int argc, char* argv[]);
+int slice(int argc, char* argv[]);
+int draft(int argc, char* argv[]);
+
+// ---- AnalysisCommands.cpp ----
+
+int femesh(int argc, char* argv[]);
+int pattern(int argc, char* argv[]);
+int inspect(int argc, char* argv[]);
+int dynamics(int argc, char* argv[]);
+int fit(int argc, char* argv[]);
+
+// ---- ServeCommand.cpp ----
+
+int serve(int argc, char* argv[]);
+
+}  // namespace cli
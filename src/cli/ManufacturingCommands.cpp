@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../manufacturing/Draft.hpp"
+#include "../manufacturing/Milling.hpp"
+#include "../manufacturing/Slicing.hpp"
+#include "../pipeline/Pipeline.hpp"
+#include "../pipeline/Trace.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+
+int mill(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.mill");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  const std::string out = option(argc, argv, "out");
+  if (out.empty()) {
+    std::cerr << "Mill needs --out=file.nc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  MillingOptions opt;
+  const std::string tool = option(argc, argv, "tool");
+  if (tool == "flank") {
+    opt.tool = MillingTool::Flank;
+  } else if (!tool.empty() && tool != "ball") {
+    std::cerr << "Unknown tool " << tool << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string radius = option(argc, argv, "tool-radius");
+  if (!radius.empty())
+    opt.toolRadius = std::strtod(radius.c_str(), nullptr);
+  const std::string scallop = option(argc, argv, "scallop");
+  if (!scallop.empty())
+    opt.scallopHeight = std::strtod(scallop.c_str(), nullptr);
+
+  const bool pinion = hasFlag(argc, argv, "pinion");
+  MillingStats stats;
+  try {
+    stats = MillingPlanner(pinion ? *r.pinion : *r.gear, opt).writeGcode(out);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << "Wrote " << stats.teeth << " tooth spaces, "
+            << stats.passesPerTooth << " passes and " << stats.pointsPerTooth
+            << " points each, " << stats.bytes << " bytes to " << out
+            << std::endl;
+  if (stats.gouges > 0) {
+    std::cerr << "Warning: " << stats.gouges
+              << " points per tooth space gouge the part" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+int slice(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.slice");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  const std::string out = option(argc, argv, "out");
+  if (out.empty()) {
+    std::cerr << "Slice needs --out=file.glc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  SliceOptions opt;
+  const std::string layer = option(argc, argv, "layer");
+  if (!layer.empty())
+    opt.layerHeight = std::strtod(layer.c_str(), nullptr);
+  const std::string cell = option(argc, argv, "cell");
+  if (!cell.empty())
+    opt.cellSize = std::strtod(cell.c_str(), nullptr);
+  const std::string bore = option(argc, argv, "bore");
+  if (!bore.empty())
+    opt.boreRadius = std::strtod(bore.c_str(), nullptr);
+
+  const bool pinion = hasFlag(argc, argv, "pinion");
+  SliceStats stats;
+  try {
+    stats = ContourSlicer(pinion ? *r.pinion : *r.gear, opt).write(out);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << "Wrote " << stats.layers << " layers, " << stats.contours
+            << " contours, " << stats.points << " points, " << stats.bytes
+            << " bytes to " << out << std::endl;
+  return EXIT_SUCCESS;
+}
+
+int draft(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.draft");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid) {
+    std::cerr << "Parameters fail validation" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  DraftOptions opt;
+  const std::string angle = option(argc, argv, "draft");
+  if (!angle.empty())
+    opt.draftAngle = std::strtod(angle.c_str(), nullptr);
+  const std::string bore = option(argc, argv, "bore");
+  if (!bore.empty())
+    opt.surface.boreRadius = std::strtod(bore.c_str(), nullptr);
+
+  const bool pinion = hasFlag(argc, argv, "pinion");
+  DraftResult d;
+  try {
+    d = DraftAnalysis(pinion ? *r.pinion : *r.gear, opt).run();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::printf("partingZ = %.4f\n", d.partingZ);
+  std::printf("requiredDraft = %.4f\n", d.requiredDraft);
+  std::printf("minDraft = %.4f\n", d.minDraft);
+  std::printf("totalArea = %.4f\n", d.totalArea);
+  std::printf("undercutArea = %.4f\n", d.undercutArea);
+  std::printf("belowDraftArea = %.4f\n\n", d.belowDraftArea);
+  std::printf("region,undercutArea,belowDraftArea\n");
+  for (size_t g = 0; g < numSurfaceRegions; ++g) {
+    std::printf("%s,%.4f,%.4f\n", toString(SurfaceRegion(g)),
+                d.regionUndercutArea[g], d.regionBelowDraftArea[g]);
+  }
+  return d.undercutArea > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}  // namespace cli
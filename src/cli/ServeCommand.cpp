@@ -0,0 +1,61 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../io/UnixSocketServer.hpp"
+#include "../pipeline/ComputeService.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+namespace {
+
+UnixSocketServer* runningServer = nullptr;
+
+void stopServer(int) {
+  if (runningServer)
+    runningServer->stop();
+}
+
+}  // namespace
+
+int serve(int argc, char* argv[]) {
+  const std::string path = option(argc, argv, "socket");
+  if (path.empty()) {
+    std::cerr << "Serve needs --socket=path" << std::endl;
+    return EXIT_FAILURE;
+  }
+  BevelGearPair base = defaultPair();
+  if (!parseArgs(argc, argv, base, nullptr))
+    return EXIT_FAILURE;
+  ComputeServiceOptions opt;
+  const std::string cacheMb = option(argc, argv, "cache");
+  if (!cacheMb.empty())
+    opt.cacheBytes =
+        size_t(std::strtod(cacheMb.c_str(), nullptr) * 1024 * 1024);
+  ComputeService service(base, opt);
+  try {
+    UnixSocketServer server(path, [&](const std::string& line) {
+      return service.handle(line);
+    });
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cerr << "Listening on " << path << std::endl;
+    server.serve();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    runningServer = nullptr;
+  } catch (const std::exception& e) {
+    runningServer = nullptr;
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  const ComputeServiceStats s = service.stats();
+  std::cerr << s.requests << " requests, " << s.cacheHits << " from the cache, "
+            << s.computed << " computed in " << s.batches << " batches"
+            << std::endl;
+  return EXIT_SUCCESS;
+}
+
+}  // namespace cli
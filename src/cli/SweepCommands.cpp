@@ -0,0 +1,330 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../analysis/LoadRating.hpp"
+#include "../analysis/UnloadedTca.hpp"
+#include "../io/ColumnarStore.hpp"
+#include "../io/ResultStore.hpp"
+#include "../pipeline/Pipeline.hpp"
+#include "../pipeline/ShardedSweep.hpp"
+#include "../pipeline/SweepSpec.hpp"
+#include "../pipeline/Trace.hpp"
+#include "Commands.hpp"
+
+namespace cli {
+namespace {
+
+// Sharded sweep into a run directory, resumed if it already exists
+int shardedSweep(int argc, char* argv[], const SweepSpec& spec,
+                 const std::string& dir) {
+  size_t shardSize = 4096;
+  if (!countOption(argc, argv, "shard-size", 1, shardSize))
+    return EXIT_FAILURE;
+  ShardedSweep sweep(dir, spec, shardSize);
+  std::vector<ParetoObjective> objectives;
+  const std::string pareto = option(argc, argv, "pareto");
+  const std::vector<std::string> columns = sweep.columns();
+  for (size_t b = 0; b < pareto.size();) {
+    size_t e = pareto.find(',', b);
+    if (e == std::string::npos)
+      e = pareto.size();
+    const std::string item = pareto.substr(b, e - b);
+    const size_t colon = item.find(':');
+    const std::string name = item.substr(0, colon);
+    const std::string sense =
+        colon == std::string::npos ? "min" : item.substr(colon + 1);
+    const auto c = std::find(columns.begin(), columns.end(), name);
+    if (c == columns.end() || (sense != "min" && sense != "max")) {
+      std::cerr << "Invalid Pareto objective " << item << std::endl;
+      return EXIT_FAILURE;
+    }
+    objectives.push_back({size_t(c - columns.begin()), sense == "max"});
+    b = e + 1;
+  }
+
+  if (!hasFlag(argc, argv, "merge-only")) {
+    ShardedSweepOptions opt;
+    const std::string workers = option(argc, argv, "workers");
+    if (!workers.empty())
+      opt.workers = std::atoi(workers.c_str());
+    opt.command = option(argc, argv, "launch");
+    if (opt.command.empty()) {
+      char self[4096];
+      const ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+      opt.command =
+          (n > 0 ? std::string(self, size_t(n)) : std::string(argv[0])) +
+          " sweep-worker";
+    }
+    const size_t pending = sweep.pendingShards().size();
+    std::cerr << sweep.shardCount() - pending << " of " << sweep.shardCount()
+              << " shards already done" << std::endl;
+    sweep.run(opt);
+  }
+  const ShardedSweepMerge m = sweep.merge(objectives);
+  std::cerr << "Merged " << m.rows << " rows into " << dir << "/catalog.glr";
+  if (m.missingShards)
+    std::cerr << " (" << m.missingShards << " shards missing)";
+  if (!objectives.empty())
+    std::cerr << ", " << m.paretoRows << " on the Pareto front";
+  std::cerr << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// Sweep into a columnar store, optionally with the unloaded transmission
+// error curve of every design as an array column
+int columnarSweep(int argc, char* argv[], const SweepSpec& spec,
+                  const std::string& out) {
+  const std::string steps = option(argc, argv, "te-steps");
+  const int teSteps = steps.empty() ? 0 : std::atoi(steps.c_str());
+  std::vector<ColumnSpec> columns;
+  for (const std::string& name : spec.columns())
+    columns.push_back({name});
+  const size_t width = columns.size();
+  if (teSteps > 0) {
+    columns.push_back({"transmissionErrorPP"});
+    columns.push_back({"transmissionError", ColumnKind::Array});
+  }
+  ColumnarStoreOptions opt;
+  opt.append = hasFlag(argc, argv, "append");
+  ColumnarStoreWriter writer(out, columns, opt);
+  const uint64_t before = writer.rowCount();
+
+  std::vector<double> scalars(width + 1);
+  spec.runBlocks(
+      0, spec.size(),
+      [&](size_t, const std::vector<PairPipelineResult>& block,
+          const double* rows) {
+        std::vector<std::vector<double>> te(teSteps > 0 ? block.size() : 0);
+        ThreadPool::shared().parallelFor(0, te.size(), [&](size_t i) {
+          if (!block[i].valid)
+            return;
+          for (const TcaPoint& p : UnloadedTca(block[i].pair).path(teSteps))
+            te[i].push_back(p.transmissionError);
+        });
+        for (size_t i = 0; i < block.size(); ++i) {
+          std::copy(rows + i * width, rows + (i + 1) * width, scalars.begin());
+          if (teSteps > 0) {
+            // NaN marks rotations without an engaged tooth
+            double lo = HUGE_VAL, hi = -HUGE_VAL;
+            for (double x : te[i]) {
+              lo = std::fmin(lo, x);
+              hi = std::fmax(hi, x);
+            }
+            scalars[width] = hi >= lo ? hi - lo : NAN;
+            const ArrayValue curve{te[i].data(), te[i].size()};
+            writer.addRow(scalars.data(), &curve);
+          } else {
+            writer.addRow(scalars.data());
+          }
+        }
+      });
+  writer.close();
+  std::cerr << "Wrote " << writer.rowCount() - before << " rows to " << out;
+  if (before > 0)
+    std::cerr << " after " << before << " existing";
+  std::cerr << std::endl;
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int compute(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.compute");
+  BevelGearPair pair = defaultPair();
+  if (!parseArgs(argc, argv, pair, nullptr))
+    return EXIT_FAILURE;
+  PairPipelineResult r = runPairPipeline(pair);
+  if (!r.valid)
+    std::cerr << "Warning: parameters fail validation" << std::endl;
+  printGear("gear", *r.gear);
+  printGear("pinion", *r.pinion);
+  return r.valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int sweep(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.sweep");
+  SweepSpec spec;
+  spec.base = defaultPair();
+  if (!parseArgs(argc, argv, spec.base, &spec.axes))
+    return EXIT_FAILURE;
+  if (spec.axes.empty()) {
+    std::cerr << "Sweep needs at least one key=start:stop:count" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Optional load rating of every design at one operating point
+  const std::string torque = option(argc, argv, "torque");
+  if (!torque.empty()) {
+    const std::string speed = option(argc, argv, "speed");
+    const std::string hours = option(argc, argv, "hours");
+    LoadBin bin{std::strtod(torque.c_str(), nullptr), 1000, 20000};
+    if (!speed.empty())
+      bin.speed = std::strtod(speed.c_str(), nullptr);
+    if (!hours.empty())
+      bin.hours = std::strtod(hours.c_str(), nullptr);
+    spec.spectrum.push_back(bin);
+  }
+
+  const std::string runDir = option(argc, argv, "run");
+  if (!runDir.empty()) {
+    try {
+      return shardedSweep(argc, argv, spec, runDir);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const size_t total = spec.size();
+  const std::vector<std::string> columns = spec.columns();
+  const size_t width = columns.size(), numAxes = spec.axes.size();
+  const std::string out = option(argc, argv, "out");
+  const std::string glrc = ".glrc";
+  if (out.size() > glrc.size() &&
+      out.compare(out.size() - glrc.size(), glrc.size(), glrc) == 0) {
+    try {
+      return columnarSweep(argc, argv, spec, out);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (!out.empty()) {
+    try {
+      ResultStoreWriter writer(out, columns);
+      spec.run(0, total, [&](size_t, const double* rows, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+          writer.addRow(rows + i * width);
+      });
+      writer.finish();
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cerr << "Wrote " << total << " rows to " << out << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  for (size_t c = 0; c < columns.size(); ++c)
+    std::printf("%s%s", c ? "," : "", columns[c].c_str());
+  std::printf("\n");
+  spec.run(0, total, [&](size_t, const double* rows, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      const double* row = rows + i * width;
+      for (size_t c = 0; c < numAxes; ++c)
+        std::printf("%.6g,", row[c]);
+      std::printf("%d", row[numAxes] != 0 ? 1 : 0);
+      for (size_t c = numAxes + 1; c < width; ++c)
+        std::printf(",%.6f", row[c]);
+      std::printf("\n");
+    }
+  });
+  return EXIT_SUCCESS;
+}
+
+// Selected rows of a columnar store; the ranges are pushed down to the
+// chunk statistics, so a selective query reads little of a large store
+int query(int argc, char* argv[]) {
+  GEARLAB_TRACE_SCOPE("cli.query");
+  if (argc < 3 || argv[2][0] == '-') {
+    std::cerr << "Query needs a file.glrc" << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t limit = SIZE_MAX;
+  if (!countOption(argc, argv, "limit", 0, limit))
+    return EXIT_FAILURE;
+  std::unique_ptr<ColumnarResultTable> opened;
+  try {
+    opened = std::make_unique<ColumnarResultTable>(argv[2]);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  const ColumnarResultTable& table = *opened;
+  auto find = [&](const std::string& name) {
+    for (size_t c = 0; c < table.columnCount(); ++c) {
+      if (table.columnName(c) == name)
+        return int(c);
+    }
+    std::cerr << "Unknown column " << name << std::endl;
+    return -1;
+  };
+
+  std::vector<ColumnRange> ranges;
+  for (int i = 3; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--", 0) == 0)
+      continue;
+    const size_t eq = arg.find('='), colon = arg.find(':', eq);
+    if (eq == std::string::npos || colon == std::string::npos) {
+      std::cerr << "Expected column=min:max, got " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+    const int c = find(arg.substr(0, eq));
+    if (c < 0)
+      return EXIT_FAILURE;
+    ColumnRange r{size_t(c)};
+    const std::string lo = arg.substr(eq + 1, colon - eq - 1);
+    const std::string hi = arg.substr(colon + 1);
+    if (!lo.empty())
+      r.min = std::strtod(lo.c_str(), nullptr);
+    if (!hi.empty())
+      r.max = std::strtod(hi.c_str(), nullptr);
+    ranges.push_back(r);
+  }
+
+  std::vector<size_t> shown;
+  const std::string names = option(argc, argv, "columns");
+  for (size_t b = 0; b < names.size();) {
+    size_t e = names.find(',', b);
+    if (e == std::string::npos)
+      e = names.size();
+    const int c = find(names.substr(b, e - b));
+    if (c < 0)
+      return EXIT_FAILURE;
+    shown.push_back(size_t(c));
+    b = e + 1;
+  }
+  if (names.empty()) {
+    for (size_t c = 0; c < table.columnCount(); ++c) {
+      if (table.kind(c) == ColumnKind::Scalar)
+        shown.push_back(c);
+    }
+  }
+
+  const ColumnarSelection s = table.select(ranges, ThreadPool::shared());
+  const size_t n = std::min(s.rows.size(), limit);
+  for (size_t k = 0; k < shown.size(); ++k)
+    std::printf("%s%s", k ? "," : "", table.columnName(shown[k]).c_str());
+  std::printf("\n");
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t k = 0; k < shown.size(); ++k) {
+      if (k)
+        std::printf(",");
+      if (table.kind(shown[k]) == ColumnKind::Scalar) {
+        std::printf("%.10g", table.value(s.rows[i], shown[k]));
+        continue;
+      }
+      // Array values separated by spaces within the field
+      const std::vector<double> a = table.array(s.rows[i], shown[k]);
+      for (size_t j = 0; j < a.size(); ++j)
+        std::printf("%s%.10g", j ? " " : "", a[j]);
+    }
+    std::printf("\n");
+  }
+  std::cerr << s.rows.size() << " of " << table.rowCount() << " rows; "
+            << s.chunksSkipped + s.chunksWhole << " of " << table.chunkCount()
+            << " chunks decided by statistics" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+}  // namespace cli
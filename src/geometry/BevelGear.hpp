@@ -1,3 +1,6 @@
+// BevelGear.hpp
+#pragma once
+
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -0,0 +1,123 @@
+// Dual.hpp
+#pragma once
+
+#include <array>
+#include <cmath>
+
+// Forward-mode automatic differentiation: a value with its gradient with
+// respect to N seeded inputs. Code templated on the scalar type evaluates
+// to exact derivatives in a single pass when run on Dual<N>; math functions
+// are found by argument dependent lookup, so generic code calls them
+// unqualified after `using std::sin;` etc.
+template <int N>
+struct Dual {
+  double v = 0;
+  std::array<double, N> d{};
+
+  Dual() = default;
+  Dual(double value) : v(value) {}  // Constants have no gradient
+
+  // Input i of the differentiation
+  static Dual seed(double value, int i) {
+    Dual x(value);
+    x.d[i] = 1;
+    return x;
+  }
+
+  Dual& operator+=(const Dual& o) { return *this = *this + o; }
+  Dual& operator-=(const Dual& o) { return *this = *this - o; }
+  Dual& operator*=(const Dual& o) { return *this = *this * o; }
+  Dual& operator/=(const Dual& o) { return *this = *this / o; }
+
+  // Value f(v) with derivative df = f'(v) chained onto the gradient
+  Dual chain(double f, double df) const {
+    Dual r(f);
+    for (int i = 0; i < N; ++i)
+      r.d[i] = df * d[i];
+    return r;
+  }
+
+  friend Dual operator+(const Dual& a, const Dual& b) {
+    Dual r(a.v + b.v);
+    for (int i = 0; i < N; ++i)
+      r.d[i] = a.d[i] + b.d[i];
+    return r;
+  }
+  friend Dual operator-(const Dual& a, const Dual& b) {
+    Dual r(a.v - b.v);
+    for (int i = 0; i < N; ++i)
+      r.d[i] = a.d[i] - b.d[i];
+    return r;
+  }
+  friend Dual operator-(const Dual& a) { return a.chain(-a.v, -1); }
+  friend Dual operator*(const Dual& a, const Dual& b) {
+    Dual r(a.v * b.v);
+    for (int i = 0; i < N; ++i)
+      r.d[i] = a.d[i] * b.v + a.v * b.d[i];
+    return r;
+  }
+  friend Dual operator/(const Dual& a, const Dual& b) {
+    const double q = a.v / b.v;
+    Dual r(q);
+    for (int i = 0; i < N; ++i)
+      r.d[i] = (a.d[i] - q * b.d[i]) / b.v;
+    return r;
+  }
+
+  // Comparisons look at the value only, as branches of the primal code do
+  friend bool operator<(const Dual& a, const Dual& b) { return a.v < b.v; }
+  friend bool operator>(const Dual& a, const Dual& b) { return a.v > b.v; }
+  friend bool operator<=(const Dual& a, const Dual& b) { return a.v <= b.v; }
+  friend bool operator>=(const Dual& a, const Dual& b) { return a.v >= b.v; }
+  friend bool operator==(const Dual& a, const Dual& b) { return a.v == b.v; }
+  friend bool operator!=(const Dual& a, const Dual& b) { return a.v != b.v; }
+
+  friend Dual sin(const Dual& a) {
+    return a.chain(std::sin(a.v), std::cos(a.v));
+  }
+  friend Dual cos(const Dual& a) {
+    return a.chain(std::cos(a.v), -std::sin(a.v));
+  }
+  friend Dual tan(const Dual& a) {
+    const double t = std::tan(a.v);
+    return a.chain(t, 1 + t * t);
+  }
+  friend Dual asin(const Dual& a) {
+    return a.chain(std::asin(a.v), 1 / std::sqrt(1 - a.v * a.v));
+  }
+  friend Dual acos(const Dual& a) {
+    return a.chain(std::acos(a.v), -1 / std::sqrt(1 - a.v * a.v));
+  }
+  friend Dual atan(const Dual& a) {
+    return a.chain(std::atan(a.v), 1 / (1 + a.v * a.v));
+  }
+  friend Dual atan2(const Dual& y, const Dual& x) {
+    const double r2 = x.v * x.v + y.v * y.v;
+    Dual r(std::atan2(y.v, x.v));
+    for (int i = 0; i < N; ++i)
+      r.d[i] = (x.v * y.d[i] - y.v * x.d[i]) / r2;
+    return r;
+  }
+  friend Dual sqrt(const Dual& a) {
+    const double s = std::sqrt(a.v);
+    return a.chain(s, 0.5 / s);
+  }
+  friend Dual exp(const Dual& a) {
+    const double e = std::exp(a.v);
+    return a.chain(e, e);
+  }
+  friend Dual log(const Dual& a) { return a.chain(std::log(a.v), 1 / a.v); }
+  friend Dual pow(const Dual& a, double p) {
+    return a.chain(std::pow(a.v, p), p * std::pow(a.v, p - 1));
+  }
+  friend Dual fabs(const Dual& a) {
+    return a.chain(std::fabs(a.v), a.v < 0 ? -1 : 1);
+  }
+};
+
+// Value of a scalar that may be a Dual
+inline double primal(double x) { return x; }
+template <int N>
+double primal(const Dual<N>& x) {
+  return x.v;
+}
@@ -74,6 +74,92 @@ struct BevelGear {
         spiralType(spiralType) {}
 };
 
+// The pair equations on any scalar type, one function per derived value:
+// float for screening, Dual numbers (Dual.hpp) for exact derivatives of the
+// same arithmetic BevelGearPair runs on double. Angles in deg.
+namespace pairmath {
+
+template <typename T>
+T deg2rad(const T& deg) {
+  return deg * T(M_PI) / 180;
+}
+
+template <typename T>
+T rad2deg(const T& rad) {
+  return rad * 180 / T(M_PI);
+}
+
+// Gear pitch cone angle for numPinionTeeth / numGearTeeth = ratio
+template <typename T>
+T pitchConeAngle(const T& shaftAngle, double ratio) {
+  using std::atan;
+  using std::sin;
+  return rad2deg(atan(sin(deg2rad(shaftAngle)) / T(ratio)));
+}
+
+template <typename T>
+T pitchConeDistance(const T& gearPitch, const T& PA) {
+  using std::sin;
+  return gearPitch / (2 * sin(deg2rad(PA)));
+}
+
+template <typename T>
+T addendum(const T& faceConeOffset, const T& FA, const T& PA, const T& R) {
+  using std::cos;
+  using std::sin;
+  using std::tan;
+  T a = faceConeOffset * (sin(deg2rad(FA)) / cos(deg2rad(FA - PA)));
+  a += R * tan(deg2rad(FA - PA));
+  return a;
+}
+
+template <typename T>
+T dedendum(const T& rootConeOffset, const T& RA, const T& PA, const T& R) {
+  using std::cos;
+  using std::sin;
+  using std::tan;
+  T d = -rootConeOffset * (sin(deg2rad(RA)) / cos(deg2rad(PA - RA)));
+  d += R * tan(deg2rad(PA - RA));
+  return d;
+}
+
+// The pinion addendum leaves the cone clearance to the gear root
+template <typename T>
+T pinionAddendum(const T& dedendum, const T& coneClearance,
+                 const T& pinionFA, const T& pinionPA) {
+  using std::cos;
+  return dedendum - (coneClearance / cos(deg2rad(pinionFA - pinionPA)));
+}
+
+template <typename T>
+T pinionDedendum(const T& addendum, const T& coneClearance,
+                 const T& pinionPA, const T& pinionRA) {
+  using std::cos;
+  return addendum + (coneClearance / cos(deg2rad(pinionPA - pinionRA)));
+}
+
+template <typename T>
+T pinionFaceConeOffset(const T& pinionAddendum, const T& R,
+                       const T& pinionFA, const T& pinionPA) {
+  using std::cos;
+  using std::sin;
+  using std::tan;
+  return (pinionAddendum - R * tan(deg2rad(pinionFA - pinionPA))) *
+         (cos(deg2rad(pinionFA - pinionPA)) / sin(deg2rad(pinionFA)));
+}
+
+template <typename T>
+T pinionRootConeOffset(const T& pinionDedendum, const T& R,
+                       const T& pinionRA, const T& pinionPA) {
+  using std::cos;
+  using std::sin;
+  using std::tan;
+  return (-pinionDedendum + R * tan(deg2rad(pinionPA - pinionRA))) *
+         (cos(deg2rad(pinionPA - pinionRA)) / sin(deg2rad(pinionRA)));
+}
+
+}  // namespace pairmath
+
 // Bevel gear pair for initial specifications and splitting into gear & pinion
 struct BevelGearPair {
   // default contructor
@@ -145,46 +231,63 @@ struct BevelGearPair {
 
   void computePA() {
     double ratio = static_cast<double>(numPinionTeeth) / numGearTeeth;
-    pitchConeAngle = rad2deg(atan(sin(deg2rad(shaftAngle)) / ratio));
+    pitchConeAngle = pairmath::pitchConeAngle(shaftAngle, ratio);
     pinionPitchConeAngle = shaftAngle - pitchConeAngle;
   }
 
   void computeDerivedValues() {
+    computePitchDiameters();
+    computePitchConeDistance();
+    computeAddendum();
+    computeDedendum();
+    computePinionConeAngles();
+    computePinionAddendum();
+    computePinionDedendum();
+  }
+
+  // Finer grained steps of computeDerivedValues(), kept separate so that
+  // LazyBevelGearPair can recompute only what an input change affects
+  void computePitchDiameters() {
     gearPitch = module * numGearTeeth;
     pinionPitch = module * numPinionTeeth;
-    pitchConeDistance = gearPitch / (2 * sin(deg2rad(pitchConeAngle)));
-    addendum = faceConeOffset * (sin(deg2rad(faceConeAngle)) /
-                                 cos(deg2rad(faceConeAngle - pitchConeAngle)));
-    addendum +=
-        pitchConeDistance * tan(deg2rad(faceConeAngle - pitchConeAngle));
-    dedendum = -rootConeOffset * (sin(deg2rad(rootConeAngle)) /
-                                  cos(deg2rad(pitchConeAngle - rootConeAngle)));
-    dedendum +=
-        pitchConeDistance * tan(deg2rad(pitchConeAngle - rootConeAngle));
+  }
+
+  void computePitchConeDistance() {
+    pitchConeDistance = pairmath::pitchConeDistance(gearPitch, pitchConeAngle);
+  }
+
+  void computeAddendum() {
+    addendum = pairmath::addendum(faceConeOffset, faceConeAngle,
+                                  pitchConeAngle, pitchConeDistance);
+  }
+
+  void computeDedendum() {
+    dedendum = pairmath::dedendum(rootConeOffset, rootConeAngle,
+                                  pitchConeAngle, pitchConeDistance);
+  }
+
+  void computePinionConeAngles() {
     pinionRootConeAngle = shaftAngle - faceConeAngle;
     pinionFaceConeAngle = shaftAngle - rootConeAngle;
-    pinionAddendum =
-        dedendum - (coneClearance /
-                    cos(deg2rad(pinionFaceConeAngle - pinionPitchConeAngle)));
-    pinionDedendum =
-        addendum + (coneClearance /
-                    cos(deg2rad(pinionPitchConeAngle - pinionRootConeAngle)));
+  }
+
+  void computePinionAddendum() {
+    pinionAddendum = pairmath::pinionAddendum(
+        dedendum, coneClearance, pinionFaceConeAngle, pinionPitchConeAngle);
+  }
+
+  void computePinionDedendum() {
+    pinionDedendum = pairmath::pinionDedendum(
+        addendum, coneClearance, pinionPitchConeAngle, pinionRootConeAngle);
   }
 
   void computePinionParameters() {
-    // TODO:  compute pinion parameters using gear parameters
-    pinionFaceConeOffset =
-        (pinionAddendum -
-         pitchConeDistance *
-             tan(deg2rad(pinionFaceConeAngle - pinionPitchConeAngle))) *
-        (cos(deg2rad(pinionFaceConeAngle - pinionPitchConeAngle)) /
-         sin(deg2rad(pinionFaceConeAngle)));
-    pinionRootConeOffset =
-        (-pinionDedendum +
-         pitchConeDistance *
-             tan(deg2rad(pinionPitchConeAngle - pinionRootConeAngle))) *
-        (cos(deg2rad(pinionPitchConeAngle - pinionRootConeAngle)) /
-         sin(deg2rad(pinionRootConeAngle)));
+    pinionFaceConeOffset = pairmath::pinionFaceConeOffset(
+        pinionAddendum, pitchConeDistance, pinionFaceConeAngle,
+        pinionPitchConeAngle);
+    pinionRootConeOffset = pairmath::pinionRootConeOffset(
+        pinionDedendum, pitchConeDistance, pinionRootConeAngle,
+        pinionPitchConeAngle);
   }
 
   BevelGear makeGear() const {
@@ -223,3 +326,66 @@ struct BevelGearPair {
            module >= 0 && coneClearance > 0 && shaftAngle > 0;
   }
 };
+
+// Derived values of a gear pair on any scalar type, in the order of
+// BevelGearPair::computePA(), computeDerivedValues() and
+// computePinionParameters()
+template <typename T>
+struct PairDerived {
+  T pitchConeAngle, pinionPitchConeAngle, pitchConeDistance;
+  T addendum, dedendum;
+  T pinionFaceConeAngle, pinionRootConeAngle;
+  T pinionAddendum, pinionDedendum;
+  T pinionFaceConeOffset, pinionRootConeOffset;
+};
+
+// Continuous inputs, named as in PairFieldUtils
+template <typename T>
+struct PairInputs {
+  T module, backlash, coneClearance, shaftAngle;
+  T faceConeAngle, rootConeAngle, faceConeOffset, rootConeOffset;
+  T innerConeDistance, outerConeDistance, pressureAngle, spiralAngle;
+};
+
+// All derived values at once on any scalar type. On double this is
+// BevelGearPair's own computation, step for step.
+template <typename T>
+PairDerived<T> derivePair(int numGearTeeth, int numPinionTeeth,
+                          const PairInputs<T>& in) {
+  PairDerived<T> o;
+  o.pitchConeAngle = pairmath::pitchConeAngle(
+      in.shaftAngle, static_cast<double>(numPinionTeeth) / numGearTeeth);
+  o.pinionPitchConeAngle = in.shaftAngle - o.pitchConeAngle;
+  o.pitchConeDistance = pairmath::pitchConeDistance(
+      in.module * T(numGearTeeth), o.pitchConeAngle);
+  o.addendum = pairmath::addendum(in.faceConeOffset, in.faceConeAngle,
+                                  o.pitchConeAngle, o.pitchConeDistance);
+  o.dedendum = pairmath::dedendum(in.rootConeOffset, in.rootConeAngle,
+                                  o.pitchConeAngle, o.pitchConeDistance);
+  o.pinionRootConeAngle = in.shaftAngle - in.faceConeAngle;
+  o.pinionFaceConeAngle = in.shaftAngle - in.rootConeAngle;
+  o.pinionAddendum =
+      pairmath::pinionAddendum(o.dedendum, in.coneClearance,
+                               o.pinionFaceConeAngle, o.pinionPitchConeAngle);
+  o.pinionDedendum =
+      pairmath::pinionDedendum(o.addendum, in.coneClearance,
+                               o.pinionPitchConeAngle, o.pinionRootConeAngle);
+  o.pinionFaceConeOffset = pairmath::pinionFaceConeOffset(
+      o.pinionAddendum, o.pitchConeDistance, o.pinionFaceConeAngle,
+      o.pinionPitchConeAngle);
+  o.pinionRootConeOffset = pairmath::pinionRootConeOffset(
+      o.pinionDedendum, o.pitchConeDistance, o.pinionRootConeAngle,
+      o.pinionPitchConeAngle);
+  return o;
+}
+
+// Inputs of a pair converted to T, e.g. float for screening
+template <typename T>
+PairInputs<T> pairInputs(const BevelGearPair& p) {
+  return {T(p.module),         T(p.backlash),
+          T(p.coneClearance),  T(p.shaftAngle),
+          T(p.faceConeAngle),  T(p.rootConeAngle),
+          T(p.faceConeOffset), T(p.rootConeOffset),
+          T(p.innerConeDistance), T(p.outerConeDistance),
+          T(p.pressureAngle),  T(p.spiralAngle)};
+}
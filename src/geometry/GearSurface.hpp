@@ -0,0 +1,310 @@
+// GearSurface.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+#include "ToothFlank.hpp"
+
+// Triangulated boundary of the analytic gear solid (the same solid that
+// ContourSlicer cuts): teeth from ToothFlank, the spherical heel and toe
+// between the inner and outer cone distances, and an optional bore.
+// Triangles are wound so (b - a) x (c - a) points out of the material.
+//
+// One pitch sector (tooth, root land up to the next tooth, body and bore
+// strip) is tessellated once and rotated into the other sectors in parallel.
+// Vertex coordinates are stored per triangle in structure-of-arrays layout so
+// per-face loops over normals, areas and heights vectorise.
+//
+// Templated on the precision like ToothFlank: GearSurface (double) for
+// results, GearSurfaceF (float) for previews at twice the SIMD width.
+
+enum class SurfaceRegion : uint8_t {
+  Flank,
+  TipLand,
+  RootLand,
+  ToothEnd,  // Heel and toe faces of a tooth
+  Body,      // Heel and toe spheres below the root cone
+  Bore
+};
+constexpr size_t numSurfaceRegions = 6;
+
+inline const char* toString(SurfaceRegion r) {
+  switch (r) {
+    case SurfaceRegion::Flank:
+      return "flank";
+    case SurfaceRegion::TipLand:
+      return "tipLand";
+    case SurfaceRegion::RootLand:
+      return "rootLand";
+    case SurfaceRegion::ToothEnd:
+      return "toothEnd";
+    case SurfaceRegion::Body:
+      return "body";
+    case SurfaceRegion::Bore:
+      return "bore";
+  }
+  return "unknown";
+}
+
+struct GearSurfaceOptions {
+  int faceSteps = 16;    // Along the face width
+  int profileSteps = 8;  // Root to tip
+  int landSteps = 4;     // Across tip and root lands
+  int bodySteps = 8;     // Heel and toe spheres, bore
+  double boreRadius = 0;
+};
+
+namespace gearmath {
+
+template <typename T>
+struct BasicGearSurfaceMesh {
+  using Vec = BasicVec3<T>;
+  std::vector<T> ax, ay, az, bx, by, bz, cx, cy, cz;
+  std::vector<SurfaceRegion> region;
+  std::vector<int> tooth;  // Pitch sector of the triangle
+
+  size_t size() const { return ax.size(); }
+
+  void resize(size_t n) {
+    for (auto* v : {&ax, &ay, &az, &bx, &by, &bz, &cx, &cy, &cz})
+      v->resize(n);
+    region.resize(n);
+    tooth.resize(n);
+  }
+
+  static size_t bytesPerTriangle() {
+    return 9 * sizeof(T) + sizeof(SurfaceRegion) + sizeof(int);
+  }
+
+  Vec a(size_t i) const { return {ax[i], ay[i], az[i]}; }
+  Vec b(size_t i) const { return {bx[i], by[i], bz[i]}; }
+  Vec c(size_t i) const { return {cx[i], cy[i], cz[i]}; }
+
+  void set(size_t i, const Vec& a, const Vec& b, const Vec& c,
+           SurfaceRegion r, int k) {
+    ax[i] = a.x, ay[i] = a.y, az[i] = a.z;
+    bx[i] = b.x, by[i] = b.y, bz[i] = b.z;
+    cx[i] = c.x, cy[i] = c.y, cz[i] = c.z;
+    region[i] = r;
+    tooth[i] = k;
+  }
+};
+
+template <typename T>
+class BasicGearSurface {
+public:
+  using Vec = BasicVec3<T>;
+  using Mesh = BasicGearSurfaceMesh<T>;
+
+  BasicGearSurface(const BevelGear& gear, GearSurfaceOptions options = {})
+      : flank(gear), opt(options) {
+    if (opt.faceSteps < 1 || opt.profileSteps < 1 || opt.landSteps < 1 ||
+        opt.bodySteps < 1 || opt.boreRadius < 0 ||
+        opt.boreRadius >=
+            flank.innerR() * sin(flank.rootAngle(flank.innerR()))) {
+      throw std::invalid_argument("Invalid gear surface options");
+    }
+  }
+
+  const BasicToothFlank<T>& toothFlank() const { return flank; }
+
+  // Under a job budget that cannot hold the mesh the step counts are halved
+  // until it fits; if even one step per patch does not fit, this throws
+  // memory::BudgetExceeded
+  Mesh build(ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("surface.build");
+    const int z = flank.numTeeth();
+    GearSurfaceOptions o = opt;
+    Sector s = sector(o);
+    auto bytes = [&] { return s.tris.size() * z * Mesh::bytesPerTriangle(); };
+    const memory::Budget* budget = memory::currentBudget();
+    while (budget && !budget->fits(bytes()) && coarsen(o))
+      s = sector(o);
+    const size_t per = s.tris.size();
+    memory::Reservation held =
+        memory::Reservation::require(memory::Category::Mesh, bytes());
+    Mesh m;
+    m.resize(per * z);
+    pool.parallelFor(0, size_t(z), [&](size_t k) {
+      const T angle = k * flank.pitchAngle();
+      for (size_t t = 0; t < per; ++t) {
+        const Tri& tri = s.tris[t];
+        m.set(k * per + t, tri.a.rotatedZ(angle), tri.b.rotatedZ(angle),
+              tri.c.rotatedZ(angle), tri.region, int(k));
+      }
+    });
+    return m;
+  }
+
+private:
+  // Twice the area below which a triangle is degenerate
+  static constexpr T degenerate = sizeof(T) < sizeof(double) ? 1e-6 : 1e-12;
+
+  struct Tri {
+    Vec a, b, c;
+    SurfaceRegion region;
+  };
+  struct Sector {
+    std::vector<Tri> tris;
+  };
+
+  // Grid patch P(i, j), i in [0, ni], j in [0, nj], wound to face the
+  // outward hint at its centre. Degenerate triangles are skipped.
+  template <typename P, typename H>
+  static void patch(Sector& s, int ni, int nj, P&& point, H&& hint,
+                    SurfaceRegion region) {
+    std::vector<Vec> g((ni + 1) * (nj + 1));
+    for (int i = 0; i <= ni; ++i) {
+      for (int j = 0; j <= nj; ++j)
+        g[i * (nj + 1) + j] = point(T(i) / ni, T(j) / nj);
+    }
+    auto at = [&](int i, int j) { return g[i * (nj + 1) + j]; };
+    // Winding from the quad nearest the centre
+    const int ci = ni / 2, cj = nj / 2;
+    const int i0 = std::min(ci, ni - 1), j0 = std::min(cj, nj - 1);
+    const Vec n = (at(i0 + 1, j0) - at(i0, j0))
+                      .cross(at(i0, j0 + 1) - at(i0, j0));
+    const bool flip =
+        n.dot(hint((i0 + T(0.5)) / ni, (j0 + T(0.5)) / nj)) < 0;
+    auto add = [&](const Vec& a, const Vec& b, const Vec& c) {
+      if ((b - a).cross(c - a).norm() < degenerate)
+        return;
+      s.tris.push_back(flip ? Tri{a, c, b, region} : Tri{a, b, c, region});
+    };
+    for (int i = 0; i < ni; ++i) {
+      for (int j = 0; j < nj; ++j) {
+        add(at(i, j), at(i + 1, j), at(i + 1, j + 1));
+        add(at(i, j), at(i + 1, j + 1), at(i, j + 1));
+      }
+    }
+  }
+
+  static Vec spherical(T R, T gamma, T phi) {
+    return {R * sin(gamma) * cos(phi), R * sin(gamma) * sin(phi),
+            R * cos(gamma)};
+  }
+  // Direction of increasing polar angle
+  static Vec meridian(T gamma, T phi) {
+    return {cos(gamma) * cos(phi), cos(gamma) * sin(phi), -sin(gamma)};
+  }
+
+  // Halves the step counts; false when they are all 1 already
+  static bool coarsen(GearSurfaceOptions& o) {
+    bool coarser = false;
+    for (int* n : {&o.faceSteps, &o.profileSteps, &o.landSteps, &o.bodySteps}) {
+      coarser |= *n > 1;
+      *n = std::max(1, *n / 2);
+    }
+    return coarser;
+  }
+
+  Sector sector(const GearSurfaceOptions& o) const {
+    Sector s;
+    const BasicToothFlank<T>& f = flank;
+    const T Ri = f.innerR(), Ro = f.outerR(), pitch = f.pitchAngle();
+    auto R = [&](T t) { return Ri + t * (Ro - Ri); };
+    const int nR = o.faceSteps, nU = o.profileSteps;
+    const int nL = o.landSteps, nB = o.bodySteps;
+
+    for (FlankSide side : {FlankSide::Right, FlankSide::Left}) {
+      patch(
+          s, nR, nU, [&](T a, T b) { return f.point(side, R(a), b); },
+          [&](T a, T b) { return f.normal(side, R(a), b); },
+          SurfaceRegion::Flank);
+    }
+
+    // Tip land across the tooth, root land across the space to tooth 1
+    auto across = [&](T Rr, T gamma, T t, bool root) {
+      const T l = f.azimuth(FlankSide::Left, Rr, gamma);
+      const T r = f.azimuth(FlankSide::Right, Rr, gamma);
+      return root ? r + t * (l + pitch - r) : l + t * (r - l);
+    };
+    patch(
+        s, nR, nL,
+        [&](T a, T t) {
+          const T g = f.tipAngle(R(a));
+          return spherical(R(a), g, across(R(a), g, t, false));
+        },
+        [&](T a, T t) {
+          const T g = f.tipAngle(R(a));
+          return meridian(g, across(R(a), g, t, false));
+        },
+        SurfaceRegion::TipLand);
+    patch(
+        s, nR, nL,
+        [&](T a, T t) {
+          const T g = f.rootAngle(R(a));
+          return spherical(R(a), g, across(R(a), g, t, true));
+        },
+        [&](T a, T t) {
+          const T g = f.rootAngle(R(a));
+          return meridian(g, across(R(a), g, t, true));
+        },
+        SurfaceRegion::RootLand);
+
+    // Tooth ends on the heel and toe spheres
+    for (T Rr : {Ro, Ri}) {
+      const T sign = Rr == Ro ? 1 : -1;
+      auto point = [&, Rr](T u, T t) {
+        const T g = f.polarAngle(Rr, u);
+        return spherical(Rr, g, across(Rr, g, t, false));
+      };
+      patch(
+          s, nU, nL, point,
+          [&, sign](T u, T t) { return point(u, t) * sign; },
+          SurfaceRegion::ToothEnd);
+    }
+
+    // Body spheres from the bore (or the axis) up to the root cone, and the
+    // bore strip between them. Each spans one pitch from the root land start.
+    const T phi0 = f.azimuth(FlankSide::Right, Ro, f.rootAngle(Ro));
+    const T phi0i = f.azimuth(FlankSide::Right, Ri, f.rootAngle(Ri));
+    for (T Rr : {Ro, Ri}) {
+      const T sign = Rr == Ro ? 1 : -1;
+      const T g0 = asin(T(opt.boreRadius) / Rr), g1 = f.rootAngle(Rr);
+      const T p0 = Rr == Ro ? phi0 : phi0i;
+      auto point = [&, Rr, g0, g1, p0](T a, T t) {
+        return spherical(Rr, g0 + a * (g1 - g0), p0 + t * pitch);
+      };
+      patch(
+          s, nB, nB, point,
+          [&, sign](T a, T t) { return point(a, t) * sign; },
+          SurfaceRegion::Body);
+    }
+    if (opt.boreRadius > 0) {
+      const T b = T(opt.boreRadius);
+      const T z0 = sqrt(Ri * Ri - b * b), z1 = sqrt(Ro * Ro - b * b);
+      patch(
+          s, nB, nB,
+          [&](T a, T t) {
+            const T phi = phi0 + t * pitch;
+            return Vec(b * cos(phi), b * sin(phi), z0 + a * (z1 - z0));
+          },
+          [&](T, T t) {
+            const T phi = phi0 + t * pitch;
+            return Vec(-cos(phi), -sin(phi), 0);
+          },
+          SurfaceRegion::Bore);
+    }
+    return s;
+  }
+
+  BasicToothFlank<T> flank;
+  GearSurfaceOptions opt;
+};
+
+}  // namespace gearmath
+
+using gearmath::BasicGearSurface;
+using gearmath::BasicGearSurfaceMesh;
+using GearSurface = BasicGearSurface<double>;
+using GearSurfaceMesh = BasicGearSurfaceMesh<double>;
+using GearSurfaceF = BasicGearSurface<float>;
+using GearSurfaceMeshF = BasicGearSurfaceMesh<float>;
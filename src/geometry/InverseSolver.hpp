@@ -0,0 +1,232 @@
+// InverseSolver.hpp
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/Trace.hpp"
+#include "GearParams.hpp"
+
+// Inverse of BevelGearPair::computeDerivedValues(): finds the gear face/root
+// cone angles and offsets that produce target addenda and dedenda for gear
+// and pinion. Pitch cone angle, pitch cone distance and cone clearance come
+// from a base pair and are shared by every target of a batch.
+//
+// With u = FA - PA and v = PA - RA the forward equations are
+//   a  =  fo * sin(FA) / cos(u) + R * tan(u)
+//   pd =  a + c / cos(u)
+//   d  = -ro * sin(RA) / cos(v) + R * tan(v)
+//   pa =  d - c / cos(v)
+// so the system splits into a face block (FA, fo) -> (a, pd) and a root block
+// (RA, ro) -> (d, pa), each solved by Newton with an analytic 2x2 Jacobian.
+// A target is only reachable when pd - a > c and d - pa > c.
+
+// Targets in structure-of-arrays layout, one entry per design
+struct ConeTargets {
+  std::vector<double> addendum;
+  std::vector<double> dedendum;
+  std::vector<double> pinionAddendum;
+  std::vector<double> pinionDedendum;
+
+  size_t size() const { return addendum.size(); }
+
+  void reserve(size_t n) {
+    addendum.reserve(n);
+    dedendum.reserve(n);
+    pinionAddendum.reserve(n);
+    pinionDedendum.reserve(n);
+  }
+
+  void push_back(double a, double d, double pa, double pd) {
+    addendum.push_back(a);
+    dedendum.push_back(d);
+    pinionAddendum.push_back(pa);
+    pinionDedendum.push_back(pd);
+  }
+};
+
+// Solved cone parameters, same layout and indexing as ConeTargets
+struct ConeSolution {
+  std::vector<double> faceConeAngle;  // Gear face cone angle (deg)
+  std::vector<double> rootConeAngle;  // Gear root cone angle (deg)
+  std::vector<double> faceConeOffset;
+  std::vector<double> rootConeOffset;
+  std::vector<double> pinionFaceConeOffset;
+  std::vector<double> pinionRootConeOffset;
+  std::vector<int> iterations;
+  std::vector<unsigned char> converged;
+
+  size_t size() const { return faceConeAngle.size(); }
+
+  void resize(size_t n) {
+    faceConeAngle.resize(n);
+    rootConeAngle.resize(n);
+    faceConeOffset.resize(n);
+    rootConeOffset.resize(n);
+    pinionFaceConeOffset.resize(n);
+    pinionRootConeOffset.resize(n);
+    iterations.assign(n, 0);
+    converged.assign(n, 0);
+  }
+};
+
+struct InverseConeSolver {
+  BevelGearPair base;
+  double tolerance = 1e-10;  // Residual tolerance on addendum/dedendum (mm)
+  int maxIterations = 50;
+  double maxAngleStep = 5.0;  // Newton step clamp for cone angles (deg)
+
+  explicit InverseConeSolver(const BevelGearPair& base) : base(base) {
+    if (!base.validateToothCounts() || base.pitchConeDistance <= 0) {
+      throw std::invalid_argument(
+          "InverseConeSolver needs a fully computed base pair");
+    }
+  }
+
+  // Residuals and Jacobian of the face block at (FA, fo), angles in deg.
+  // J = [[da/dFA, da/dfo], [dpd/dFA, dpd/dfo]], derivatives per degree.
+  static void faceBlock(double FA, double fo, double PA, double R, double c,
+                        double& a, double& pd, double J[4]) {
+    const double k = M_PI / 180;
+    const double u = (FA - PA) * k;
+    const double cu = cos(u), su = sin(u), sf = sin(FA * k);
+    const double sec2 = 1 / (cu * cu);
+    a = fo * sf / cu + R * su / cu;
+    pd = a + c / cu;
+    // d/dFA [sin(FA) / cos(FA - PA)] = cos(PA) / cos^2(u)
+    J[0] = (fo * cos(PA * k) + R) * sec2 * k;
+    J[1] = sf / cu;
+    J[2] = J[0] + c * su * sec2 * k;
+    J[3] = J[1];
+  }
+
+  // Residuals and Jacobian of the root block at (RA, ro), angles in deg.
+  // J = [[dd/dRA, dd/dro], [dpa/dRA, dpa/dro]], derivatives per degree.
+  static void rootBlock(double RA, double ro, double PA, double R, double c,
+                        double& d, double& pa, double J[4]) {
+    const double k = M_PI / 180;
+    const double v = (PA - RA) * k;
+    const double cv = cos(v), sv = sin(v), sr = sin(RA * k);
+    const double sec2 = 1 / (cv * cv);
+    d = -ro * sr / cv + R * sv / cv;
+    pa = d - c / cv;
+    // d/dRA [sin(RA) / cos(PA - RA)] = cos(PA) / cos^2(v)
+    J[0] = -(ro * cos(PA * k) + R) * sec2 * k;
+    J[1] = -sr / cv;
+    J[2] = J[0] + c * sv * sec2 * k;
+    J[3] = J[1];
+  }
+
+  // Solve all targets. The initial guess for every target is the base pair's
+  // cone angles and offsets. Lanes that converge are frozen by selecting the
+  // old value, so the per-iteration loops stay branch free over the batch.
+  ConeSolution solve(const ConeTargets& targets) const {
+    GEARLAB_TRACE_SCOPE("inverseConeSolve");
+    const size_t n = targets.size();
+    const double PA = base.pitchConeAngle;
+    const double R = base.pitchConeDistance;
+    const double c = base.coneClearance;
+
+    // Solution arrays plus lane masks
+    memory::Reservation held(memory::Category::Geometry,
+                             n * (6 * sizeof(double) + sizeof(int) + 4));
+    ConeSolution s;
+    s.resize(n);
+    std::vector<unsigned char> faceDone(n, 0), rootDone(n, 0), feasible(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      // Unreachable lanes are frozen at the initial guess
+      feasible[i] = targets.pinionDedendum[i] - targets.addendum[i] > c &&
+                    targets.dedendum[i] - targets.pinionAddendum[i] > c;
+      faceDone[i] = rootDone[i] = !feasible[i];
+      s.faceConeAngle[i] = base.faceConeAngle;
+      s.faceConeOffset[i] = base.faceConeOffset;
+      s.rootConeAngle[i] = base.rootConeAngle;
+      s.rootConeOffset[i] = base.rootConeOffset;
+    }
+
+    const double* ta = targets.addendum.data();
+    const double* td = targets.dedendum.data();
+    const double* tpa = targets.pinionAddendum.data();
+    const double* tpd = targets.pinionDedendum.data();
+    double* FA = s.faceConeAngle.data();
+    double* fo = s.faceConeOffset.data();
+    double* RA = s.rootConeAngle.data();
+    double* ro = s.rootConeOffset.data();
+    int* it = s.iterations.data();
+
+    for (int iter = 0; iter < maxIterations; ++iter) {
+      size_t active = 0;
+      for (size_t i = 0; i < n; ++i) {
+        double J[4], a, pd, d, pa;
+
+        faceBlock(FA[i], fo[i], PA, R, c, a, pd, J);
+        double r0 = a - ta[i], r1 = pd - tpd[i];
+        double det = J[0] * J[3] - J[1] * J[2];
+        double dFA = (J[3] * r0 - J[1] * r1) / det;
+        double dfo = (J[0] * r1 - J[2] * r0) / det;
+        dFA = std::fmax(-maxAngleStep, std::fmin(maxAngleStep, dFA));
+        faceDone[i] |= std::fabs(r0) < tolerance && std::fabs(r1) < tolerance;
+        FA[i] = faceDone[i] ? FA[i] : FA[i] - dFA;
+        fo[i] = faceDone[i] ? fo[i] : fo[i] - dfo;
+
+        rootBlock(RA[i], ro[i], PA, R, c, d, pa, J);
+        r0 = d - td[i];
+        r1 = pa - tpa[i];
+        det = J[0] * J[3] - J[1] * J[2];
+        double dRA = (J[3] * r0 - J[1] * r1) / det;
+        double dro = (J[0] * r1 - J[2] * r0) / det;
+        dRA = std::fmax(-maxAngleStep, std::fmin(maxAngleStep, dRA));
+        rootDone[i] |= std::fabs(r0) < tolerance && std::fabs(r1) < tolerance;
+        RA[i] = rootDone[i] ? RA[i] : RA[i] - dRA;
+        ro[i] = rootDone[i] ? ro[i] : ro[i] - dro;
+
+        const int laneActive = !(faceDone[i] && rootDone[i]);
+        it[i] += laneActive;
+        active += laneActive;
+      }
+      if (active == 0)
+        break;
+    }
+
+    const double S = base.shaftAngle;
+    const double k = M_PI / 180;
+    for (size_t i = 0; i < n; ++i) {
+      // Same relations as BevelGearPair::computePinionParameters(), with
+      // pinionFaceConeAngle - pinionPitchConeAngle == PA - RA and
+      // pinionPitchConeAngle - pinionRootConeAngle == FA - PA.
+      const double v = (PA - RA[i]) * k, u = (FA[i] - PA) * k;
+      s.pinionFaceConeOffset[i] =
+          (tpa[i] - R * tan(v)) * (cos(v) / sin((S - RA[i]) * k));
+      s.pinionRootConeOffset[i] =
+          (-tpd[i] + R * tan(u)) * (cos(u) / sin((S - FA[i]) * k));
+      s.converged[i] = feasible[i] && faceDone[i] && rootDone[i] &&
+                       std::isfinite(FA[i]) && std::isfinite(RA[i]);
+    }
+    return s;
+  }
+
+  // Single target convenience wrapper, returns the full solved pair
+  BevelGearPair solve(double addendum, double dedendum, double pinionAddendum,
+                      double pinionDedendum) const {
+    ConeTargets t;
+    t.push_back(addendum, dedendum, pinionAddendum, pinionDedendum);
+    ConeSolution s = solve(t);
+    if (!s.converged[0]) {
+      throw std::runtime_error("InverseConeSolver did not converge");
+    }
+    return apply(s, 0);
+  }
+
+  // Rebuild a forward pair from the base pair and solution entry i
+  BevelGearPair apply(const ConeSolution& s, size_t i) const {
+    return BevelGearPair(base.numGearTeeth, base.numPinionTeeth, base.module,
+                         base.backlash, base.coneClearance, base.shaftAngle,
+                         s.faceConeAngle[i], s.rootConeAngle[i],
+                         s.faceConeOffset[i], s.rootConeOffset[i],
+                         base.innerConeDistance, base.outerConeDistance,
+                         base.pressureAngle, base.spiralAngle, base.spiralType);
+  }
+};
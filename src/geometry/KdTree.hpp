@@ -0,0 +1,111 @@
+// KdTree.hpp
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Vec3.hpp"
+
+// Static 3D k-d tree for nearest point queries. The points are reordered so
+// every node is an index range [lo, hi) split at its median (lo + hi) / 2
+// along the axis of largest extent: the tree needs no pointers and a query
+// walks contiguous memory. Leaves of up to leafSize points are scanned.
+class KdTree {
+public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  KdTree() = default;
+  explicit KdTree(const std::vector<Vec3>& points) : items(points.size()) {
+    for (size_t i = 0; i < points.size(); ++i)
+      items[i] = {points[i], uint32_t(i)};
+    axes.resize(items.size());
+    build(0, items.size());
+  }
+
+  size_t size() const { return items.size(); }
+
+  // Index into the constructor's points of the one nearest to q, npos when
+  // empty. The squared distance goes to dist2 if given.
+  size_t nearest(const Vec3& q, double* dist2 = nullptr) const {
+    size_t best = npos;
+    double d2 = std::numeric_limits<double>::infinity();
+    if (!items.empty())
+      search(0, items.size(), q, best, d2);
+    if (dist2)
+      *dist2 = d2;
+    return best;
+  }
+
+private:
+  static constexpr size_t leafSize = 8;
+
+  struct Item {
+    Vec3 p;
+    uint32_t id;
+  };
+
+  static double coord(const Vec3& v, int axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+  }
+
+  void build(size_t lo, size_t hi) {
+    if (hi - lo <= leafSize)
+      return;
+    Vec3 a = items[lo].p, b = a;
+    for (size_t i = lo + 1; i < hi; ++i) {
+      const Vec3& p = items[i].p;
+      a = {std::min(a.x, p.x), std::min(a.y, p.y), std::min(a.z, p.z)};
+      b = {std::max(b.x, p.x), std::max(b.y, p.y), std::max(b.z, p.z)};
+    }
+    const Vec3 extent = b - a;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+                     : extent.y >= extent.z                      ? 1
+                                                                 : 2;
+    const size_t m = (lo + hi) / 2;
+    std::nth_element(items.begin() + lo, items.begin() + m,
+                     items.begin() + hi,
+                     [axis](const Item& l, const Item& r) {
+                       return coord(l.p, axis) < coord(r.p, axis);
+                     });
+    axes[m] = uint8_t(axis);
+    build(lo, m);
+    build(m + 1, hi);
+  }
+
+  void visit(const Item& item, const Vec3& q, size_t& best,
+             double& d2) const {
+    const Vec3 d = item.p - q;
+    const double e = d.dot(d);
+    if (e < d2) {
+      d2 = e;
+      best = item.id;
+    }
+  }
+
+  void search(size_t lo, size_t hi, const Vec3& q, size_t& best,
+              double& d2) const {
+    if (hi - lo <= leafSize) {
+      for (size_t i = lo; i < hi; ++i)
+        visit(items[i], q, best, d2);
+      return;
+    }
+    const size_t m = (lo + hi) / 2;
+    const int axis = axes[m];
+    const double d = coord(q, axis) - coord(items[m].p, axis);
+    visit(items[m], q, best, d2);
+    if (d < 0) {
+      search(lo, m, q, best, d2);
+      if (d * d < d2)
+        search(m + 1, hi, q, best, d2);
+    } else {
+      search(m + 1, hi, q, best, d2);
+      if (d * d < d2)
+        search(lo, m, q, best, d2);
+    }
+  }
+
+  std::vector<Item> items;
+  std::vector<uint8_t> axes;  // Split axis of the node with median i
+};
@@ -0,0 +1,104 @@
+// PairFields.hpp
+#pragma once
+
+#include <cmath>
+#include <string>
+
+#include "GearParams.hpp"
+
+// Name based access to the BevelGearPair inputs, using the same keys as the
+// TOML files and the constructor argument names. Used by the CLI and other
+// front ends that receive parameters as text.
+struct PairFieldUtils {
+  static constexpr const char* names[] = {
+      "numGearTeeth",      "numPinionTeeth",    "module",
+      "backlash",          "coneClearance",     "shaftAngle",
+      "faceConeAngle",     "rootConeAngle",     "faceConeOffset",
+      "rootConeOffset",    "innerConeDistance", "outerConeDistance",
+      "pressureAngle",     "spiralAngle",       "spiralType"};
+
+  static constexpr int maxTeeth = 10000;
+
+  // Whether a value can be set for the input: finite, and for the tooth
+  // counts and the spiral type an integer in range, as set() casts those
+  // to int. Unknown names are left to set().
+  static bool valid(const std::string& name, double value) {
+    if (!std::isfinite(value))
+      return false;
+    if (name == "numGearTeeth" || name == "numPinionTeeth")
+      return value >= 1 && value <= maxTeeth && value == std::floor(value);
+    if (name == "spiralType")
+      return value >= 0 && value <= 2 && value == std::floor(value);
+    return true;
+  }
+
+  // Set an input by name. Returns false for unknown names.
+  static bool set(BevelGearPair& p, const std::string& name, double value) {
+    if (name == "numGearTeeth")
+      p.numGearTeeth = static_cast<int>(value);
+    else if (name == "numPinionTeeth")
+      p.numPinionTeeth = static_cast<int>(value);
+    else if (name == "spiralType")
+      p.spiralType = static_cast<spiralFunction>(static_cast<int>(value));
+    else if (double* f = field(p, name))
+      *f = value;
+    else
+      return false;
+    return true;
+  }
+
+  // Read an input by name. Returns false for unknown names.
+  static bool get(const BevelGearPair& p, const std::string& name,
+                  double& value) {
+    if (name == "numGearTeeth")
+      value = p.numGearTeeth;
+    else if (name == "numPinionTeeth")
+      value = p.numPinionTeeth;
+    else if (name == "spiralType")
+      value = static_cast<int>(p.spiralType);
+    else if (const double* f = field(const_cast<BevelGearPair&>(p), name))
+      value = *f;
+    else
+      return false;
+    return true;
+  }
+
+  // Rerun the derived value computation after inputs were set by name
+  static BevelGearPair recompute(const BevelGearPair& p) {
+    return BevelGearPair(p.numGearTeeth, p.numPinionTeeth, p.module,
+                         p.backlash, p.coneClearance, p.shaftAngle,
+                         p.faceConeAngle, p.rootConeAngle, p.faceConeOffset,
+                         p.rootConeOffset, p.innerConeDistance,
+                         p.outerConeDistance, p.pressureAngle, p.spiralAngle,
+                         p.spiralType);
+  }
+
+private:
+  static double* field(BevelGearPair& p, const std::string& name) {
+    if (name == "module")
+      return &p.module;
+    if (name == "backlash")
+      return &p.backlash;
+    if (name == "coneClearance")
+      return &p.coneClearance;
+    if (name == "shaftAngle")
+      return &p.shaftAngle;
+    if (name == "faceConeAngle")
+      return &p.faceConeAngle;
+    if (name == "rootConeAngle")
+      return &p.rootConeAngle;
+    if (name == "faceConeOffset")
+      return &p.faceConeOffset;
+    if (name == "rootConeOffset")
+      return &p.rootConeOffset;
+    if (name == "innerConeDistance")
+      return &p.innerConeDistance;
+    if (name == "outerConeDistance")
+      return &p.outerConeDistance;
+    if (name == "pressureAngle")
+      return &p.pressureAngle;
+    if (name == "spiralAngle")
+      return &p.spiralAngle;
+    return nullptr;
+  }
+};
@@ -0,0 +1,78 @@
+// PairGradient.hpp
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "Dual.hpp"
+#include "GearParams.hpp"
+
+// Exact derivatives of every derived value of a pair with respect to every
+// continuous input, from one forward pass on Dual numbers. Replaces the
+// numInputs + 1 reconstructions of a finite difference gradient. Angles in
+// deg, so angle derivatives are per degree.
+struct PairGradient {
+  static constexpr int numInputs = 12;
+  static constexpr int numOutputs = 11;
+  static constexpr const char* inputs[numInputs] = {
+      "module",         "backlash",          "coneClearance",
+      "shaftAngle",     "faceConeAngle",     "rootConeAngle",
+      "faceConeOffset", "rootConeOffset",    "innerConeDistance",
+      "outerConeDistance", "pressureAngle",  "spiralAngle"};
+  static constexpr const char* outputs[numOutputs] = {
+      "pitchConeAngle",       "pinionPitchConeAngle", "pitchConeDistance",
+      "addendum",             "dedendum",             "pinionFaceConeAngle",
+      "pinionRootConeAngle",  "pinionAddendum",       "pinionDedendum",
+      "pinionFaceConeOffset", "pinionRootConeOffset"};
+
+  std::array<double, numOutputs> value{};
+  // d[output][input]
+  std::array<std::array<double, numInputs>, numOutputs> d{};
+
+  // Derivative of an output with respect to an input by name. Returns false
+  // for unknown names.
+  bool get(const std::string& output, const std::string& input,
+           double& derivative) const {
+    const int o = indexOf(outputs, numOutputs, output);
+    const int i = indexOf(inputs, numInputs, input);
+    if (o < 0 || i < 0)
+      return false;
+    derivative = d[o][i];
+    return true;
+  }
+
+private:
+  static int indexOf(const char* const* names, int n,
+                     const std::string& name) {
+    for (int i = 0; i < n; ++i) {
+      if (name == names[i])
+        return i;
+    }
+    return -1;
+  }
+};
+
+inline PairGradient pairGradient(const BevelGearPair& p) {
+  using D = Dual<PairGradient::numInputs>;
+  const PairInputs<D> in{
+      D::seed(p.module, 0),           D::seed(p.backlash, 1),
+      D::seed(p.coneClearance, 2),    D::seed(p.shaftAngle, 3),
+      D::seed(p.faceConeAngle, 4),    D::seed(p.rootConeAngle, 5),
+      D::seed(p.faceConeOffset, 6),   D::seed(p.rootConeOffset, 7),
+      D::seed(p.innerConeDistance, 8), D::seed(p.outerConeDistance, 9),
+      D::seed(p.pressureAngle, 10),   D::seed(p.spiralAngle, 11)};
+  const PairDerived<D> o = derivePair(p.numGearTeeth, p.numPinionTeeth, in);
+  const D* out[PairGradient::numOutputs] = {
+      &o.pitchConeAngle,       &o.pinionPitchConeAngle,
+      &o.pitchConeDistance,    &o.addendum,
+      &o.dedendum,             &o.pinionFaceConeAngle,
+      &o.pinionRootConeAngle,  &o.pinionAddendum,
+      &o.pinionDedendum,       &o.pinionFaceConeOffset,
+      &o.pinionRootConeOffset};
+  PairGradient g;
+  for (int k = 0; k < PairGradient::numOutputs; ++k) {
+    g.value[k] = out[k]->v;
+    g.d[k] = out[k]->d;
+  }
+  return g;
+}
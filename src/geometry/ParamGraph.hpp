@@ -0,0 +1,293 @@
+// ParamGraph.hpp
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "GearParams.hpp"
+
+// Dependency graph with dirty flags and lazy recomputation. Nodes are either
+// inputs (no compute function) or computed nodes that depend on previously
+// added nodes, so node ids are always in topological order.
+class DependencyGraph {
+public:
+  using NodeId = size_t;
+
+  NodeId addInput(std::string name) { return addNode(std::move(name), {}, {}); }
+
+  NodeId addNode(std::string name, std::vector<NodeId> deps,
+                 std::function<void()> compute) {
+    const NodeId id = nodes.size();
+    for (NodeId d : deps) {
+      if (d >= id)
+        throw std::invalid_argument("Dependency added after node " + name);
+    }
+    Node n;
+    n.name = std::move(name);
+    n.compute = std::move(compute);
+    n.dirty = static_cast<bool>(n.compute);
+    nodes.push_back(std::move(n));
+    for (NodeId d : deps)
+      nodes[d].dependents.push_back(id);
+    nodes[id].deps = std::move(deps);
+    return id;
+  }
+
+  // Mark everything downstream of a node as stale
+  void invalidate(NodeId id) {
+    for (NodeId d : nodes.at(id).dependents) {
+      if (!nodes[d].dirty) {
+        nodes[d].dirty = true;
+        invalidate(d);
+      }
+    }
+  }
+
+  // Bring a node up to date, recomputing stale dependencies first
+  void evaluate(NodeId id) {
+    Node& n = nodes.at(id);
+    if (!n.dirty)
+      return;
+    for (NodeId d : n.deps)
+      evaluate(d);
+    n.compute();
+    ++n.evaluations;
+    n.dirty = false;
+  }
+
+  void evaluateAll() {
+    for (NodeId id = 0; id < nodes.size(); ++id)
+      evaluate(id);
+  }
+
+  bool isDirty(NodeId id) const { return nodes.at(id).dirty; }
+  size_t evaluations(NodeId id) const { return nodes.at(id).evaluations; }
+  const std::string& name(NodeId id) const { return nodes.at(id).name; }
+  const std::vector<NodeId>& dependencies(NodeId id) const {
+    return nodes.at(id).deps;
+  }
+  size_t size() const { return nodes.size(); }
+
+  NodeId find(const std::string& name) const {
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+      if (nodes[id].name == name)
+        return id;
+    }
+    throw std::out_of_range("No graph node named " + name);
+  }
+
+private:
+  struct Node {
+    std::string name;
+    std::vector<NodeId> deps;
+    std::vector<NodeId> dependents;
+    std::function<void()> compute;
+    bool dirty = false;
+    size_t evaluations = 0;
+  };
+  std::vector<Node> nodes;
+};
+
+// BevelGearPair whose derived values are recomputed lazily and only when an
+// input they depend on changes. Downstream pipeline stages (flanks, mesh,
+// LTCA, ...) register themselves with addStage() against the nodes they read,
+// e.g. a flank stage does not depend on backlash and stays clean when it
+// changes.
+class LazyBevelGearPair {
+public:
+  using NodeId = DependencyGraph::NodeId;
+
+  // Derived quantity nodes, one per BevelGearPair compute step
+  struct Nodes {
+    NodeId pitchConeAngles;    // pitchConeAngle, pinionPitchConeAngle
+    NodeId pitchDiameters;     // gearPitch, pinionPitch
+    NodeId pitchConeDistance;  // pitchConeDistance
+    NodeId addendum;
+    NodeId dedendum;
+    NodeId pinionConeAngles;  // pinionFaceConeAngle, pinionRootConeAngle
+    NodeId pinionAddendum;
+    NodeId pinionDedendum;
+    NodeId pinionOffsets;  // pinionFaceConeOffset, pinionRootConeOffset
+  };
+
+  explicit LazyBevelGearPair(const BevelGearPair& initial = BevelGearPair())
+      : p(initial) {
+    auto in = [&](auto BevelGearPair::*field, const char* name) {
+      NodeId id = graph.addInput(name);
+      bind(field, id);
+      return id;
+    };
+    const NodeId gearTeeth = in(&BevelGearPair::numGearTeeth, "numGearTeeth");
+    const NodeId pinionTeeth =
+        in(&BevelGearPair::numPinionTeeth, "numPinionTeeth");
+    const NodeId mod = in(&BevelGearPair::module, "module");
+    in(&BevelGearPair::backlash, "backlash");
+    const NodeId clearance = in(&BevelGearPair::coneClearance, "coneClearance");
+    const NodeId shaft = in(&BevelGearPair::shaftAngle, "shaftAngle");
+    const NodeId FA = in(&BevelGearPair::faceConeAngle, "faceConeAngle");
+    const NodeId RA = in(&BevelGearPair::rootConeAngle, "rootConeAngle");
+    const NodeId fo = in(&BevelGearPair::faceConeOffset, "faceConeOffset");
+    const NodeId ro = in(&BevelGearPair::rootConeOffset, "rootConeOffset");
+    in(&BevelGearPair::innerConeDistance, "innerConeDistance");
+    in(&BevelGearPair::outerConeDistance, "outerConeDistance");
+    in(&BevelGearPair::pressureAngle, "pressureAngle");
+    in(&BevelGearPair::spiralAngle, "spiralAngle");
+    in(&BevelGearPair::spiralType, "spiralType");
+
+    n.pitchConeAngles = graph.addNode("pitchConeAngles",
+                                      {gearTeeth, pinionTeeth, shaft},
+                                      [this] { p.computePA(); });
+    n.pitchDiameters =
+        graph.addNode("pitchDiameters", {gearTeeth, pinionTeeth, mod},
+                      [this] { p.computePitchDiameters(); });
+    n.pitchConeDistance =
+        graph.addNode("pitchConeDistance",
+                      {n.pitchDiameters, n.pitchConeAngles},
+                      [this] { p.computePitchConeDistance(); });
+    n.addendum =
+        graph.addNode("addendum", {FA, fo, n.pitchConeAngles,
+                                   n.pitchConeDistance},
+                      [this] { p.computeAddendum(); });
+    n.dedendum =
+        graph.addNode("dedendum", {RA, ro, n.pitchConeAngles,
+                                   n.pitchConeDistance},
+                      [this] { p.computeDedendum(); });
+    n.pinionConeAngles =
+        graph.addNode("pinionConeAngles", {shaft, FA, RA},
+                      [this] { p.computePinionConeAngles(); });
+    n.pinionAddendum = graph.addNode(
+        "pinionAddendum",
+        {n.dedendum, clearance, n.pinionConeAngles, n.pitchConeAngles},
+        [this] { p.computePinionAddendum(); });
+    n.pinionDedendum = graph.addNode(
+        "pinionDedendum",
+        {n.addendum, clearance, n.pinionConeAngles, n.pitchConeAngles},
+        [this] { p.computePinionDedendum(); });
+    n.pinionOffsets = graph.addNode(
+        "pinionOffsets",
+        {n.pinionAddendum, n.pinionDedendum, n.pinionConeAngles,
+         n.pitchConeAngles, n.pitchConeDistance},
+        [this] { p.computePinionParameters(); });
+  }
+
+  // The graph captures `this`, so the object must stay in place
+  LazyBevelGearPair(const LazyBevelGearPair&) = delete;
+  LazyBevelGearPair& operator=(const LazyBevelGearPair&) = delete;
+
+  // Set an input field, e.g. set(&BevelGearPair::backlash, 0.2). Only nodes
+  // downstream of that field are invalidated, and only if the value changed.
+  template <typename T>
+  void set(T BevelGearPair::*field, std::common_type_t<T> value) {
+    if (p.*field == value)
+      return;
+    p.*field = value;
+    graph.invalidate(inputNode(field));
+  }
+
+  // Assign all inputs from another pair, invalidating only what changed
+  void assign(const BevelGearPair& other) {
+    for (const auto& b : intInputs)
+      set(b.first, other.*(b.first));
+    for (const auto& b : doubleInputs)
+      set(b.first, other.*(b.first));
+    set(&BevelGearPair::spiralType, other.spiralType);
+  }
+
+  // Read a field, recomputing the node that produces it if it is stale
+  double get(double BevelGearPair::*field) {
+    if (NodeId* id = derivedNode(field))
+      graph.evaluate(*id);
+    return p.*field;
+  }
+
+  // Fully evaluated pair
+  const BevelGearPair& pair() {
+    graph.evaluateAll();
+    return p;
+  }
+
+  BevelGear makeGear() { return pair().makeGear(); }
+  BevelGear makePinion() { return pair().makePinion(); }
+
+  // Register a downstream stage. compute is called with the up to date pair
+  // whenever evaluate(stage) finds one of deps changed.
+  NodeId addStage(std::string name, std::vector<NodeId> deps,
+                  std::function<void(const BevelGearPair&)> compute) {
+    return graph.addNode(std::move(name), std::move(deps),
+                         [this, compute = std::move(compute)] { compute(p); });
+  }
+
+  void evaluate(NodeId id) { graph.evaluate(id); }
+  bool isDirty(NodeId id) const { return graph.isDirty(id); }
+
+  template <typename T>
+  NodeId inputNode(T BevelGearPair::*field) const {
+    for (const auto& b : bindings<T>()) {
+      if (b.first == field)
+        return b.second;
+    }
+    throw std::invalid_argument("Field is not an input of BevelGearPair");
+  }
+
+  const Nodes& nodes() const { return n; }
+  const DependencyGraph& dependencyGraph() const { return graph; }
+
+private:
+  template <typename T>
+  using Binding = std::pair<T BevelGearPair::*, NodeId>;
+
+  void bind(int BevelGearPair::*f, NodeId id) { intInputs.push_back({f, id}); }
+  void bind(double BevelGearPair::*f, NodeId id) {
+    doubleInputs.push_back({f, id});
+  }
+  void bind(spiralFunction BevelGearPair::*f, NodeId id) {
+    spiralInputs.push_back({f, id});
+  }
+
+  template <typename T>
+  const std::vector<Binding<T>>& bindings() const {
+    if constexpr (std::is_same_v<T, int>) {
+      return intInputs;
+    } else if constexpr (std::is_same_v<T, double>) {
+      return doubleInputs;
+    } else {
+      static_assert(std::is_same_v<T, spiralFunction>);
+      return spiralInputs;
+    }
+  }
+
+  NodeId* derivedNode(double BevelGearPair::*f) {
+    using P = BevelGearPair;
+    if (f == &P::pitchConeAngle || f == &P::pinionPitchConeAngle)
+      return &n.pitchConeAngles;
+    if (f == &P::gearPitch || f == &P::pinionPitch)
+      return &n.pitchDiameters;
+    if (f == &P::pitchConeDistance)
+      return &n.pitchConeDistance;
+    if (f == &P::addendum)
+      return &n.addendum;
+    if (f == &P::dedendum)
+      return &n.dedendum;
+    if (f == &P::pinionFaceConeAngle || f == &P::pinionRootConeAngle)
+      return &n.pinionConeAngles;
+    if (f == &P::pinionAddendum)
+      return &n.pinionAddendum;
+    if (f == &P::pinionDedendum)
+      return &n.pinionDedendum;
+    if (f == &P::pinionFaceConeOffset || f == &P::pinionRootConeOffset)
+      return &n.pinionOffsets;
+    return nullptr;
+  }
+
+  BevelGearPair p;
+  DependencyGraph graph;
+  Nodes n;
+  std::vector<Binding<int>> intInputs;
+  std::vector<Binding<double>> doubleInputs;
+  std::vector<Binding<spiralFunction>> spiralInputs;
+};
@@ -0,0 +1,73 @@
+// RigidTransform.hpp
+#pragma once
+
+#include <array>
+#include <cmath>
+
+#include "Vec3.hpp"
+
+// Rotation (row major) followed by a translation, p' = R p + t
+struct RigidTransform {
+  std::array<double, 9> rotation{1, 0, 0, 0, 1, 0, 0, 0, 1};
+  Vec3 translation;
+
+  Vec3 rotate(const Vec3& p) const {
+    const auto& r = rotation;
+    return {r[0] * p.x + r[1] * p.y + r[2] * p.z,
+            r[3] * p.x + r[4] * p.y + r[5] * p.z,
+            r[6] * p.x + r[7] * p.y + r[8] * p.z};
+  }
+  Vec3 apply(const Vec3& p) const { return rotate(p) + translation; }
+
+  // This transform followed by next
+  RigidTransform then(const RigidTransform& next) const {
+    RigidTransform c;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        double v = 0;
+        for (int k = 0; k < 3; ++k)
+          v += next.rotation[3 * i + k] * rotation[3 * k + j];
+        c.rotation[3 * i + j] = v;
+      }
+    }
+    c.translation = next.apply(translation);
+    return c;
+  }
+
+  RigidTransform inverse() const {
+    RigidTransform c;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j)
+        c.rotation[3 * i + j] = rotation[3 * j + i];
+    }
+    c.translation = -c.rotate(translation);
+    return c;
+  }
+
+  // Rotation by |w| rad about w (Rodrigues)
+  static RigidTransform rotationAbout(const Vec3& w) {
+    RigidTransform c;
+    const double a = w.norm();
+    if (a == 0)
+      return c;
+    const Vec3 k = w / a;
+    const double s = sin(a), v = 1 - cos(a);
+    c.rotation = {1 - v * (k.y * k.y + k.z * k.z), v * k.x * k.y - s * k.z,
+                  v * k.x * k.z + s * k.y,           v * k.x * k.y + s * k.z,
+                  1 - v * (k.x * k.x + k.z * k.z), v * k.y * k.z - s * k.x,
+                  v * k.x * k.z - s * k.y,           v * k.y * k.z + s * k.x,
+                  1 - v * (k.x * k.x + k.y * k.y)};
+    return c;
+  }
+
+  // Rotation vector (axis times angle in rad) of the rotation part
+  Vec3 rotationVector() const {
+    const auto& r = rotation;
+    const double c =
+        std::fmax(-1.0, std::fmin(1.0, (r[0] + r[4] + r[8] - 1) / 2));
+    const double a = acos(c);
+    const Vec3 axis(r[7] - r[5], r[2] - r[6], r[3] - r[1]);
+    const double s = axis.norm();
+    return s > 0 ? axis * (a / s) : Vec3();
+  }
+};
@@ -0,0 +1,198 @@
+// ToothFlank.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "GearParams.hpp"
+#include "Vec3.hpp"
+
+enum class FlankSide { Left, Right };
+
+namespace gearmath {
+
+// Analytic tooth surface of a BevelGear. Frame: apex at the origin, gear axis
+// +z, tooth 0 centred on the +x half plane. On every sphere of cone distance R
+// the flank is a spherical involute of the base cone sin(db) = sin(d) cos(a),
+// radial below the base cone. The tooth is bounded by the face and root cones
+// of the gear and by the inner and outer cone distances. The lengthwise
+// curvature comes from the spiral function, developed on the pitch cone.
+//
+// Surface parameters: R in [innerConeDistance, outerConeDistance] and u in
+// [0, 1] from the root to the tip of the flank.
+//
+// Templated on the precision: ToothFlank (double) for results, ToothFlankF
+// (float) for previews and coarse screening. The gear is kept in double and
+// converted once.
+template <typename T>
+class BasicToothFlank {
+public:
+  using Vec = BasicVec3<T>;
+
+  explicit BasicToothFlank(const BevelGear& gear)
+      : g(gear),
+        Rm(T(gear.pitchConeDistance)),
+        beta(T(gear.spiralAngle) * T(M_PI) / 180),
+        Ri(T(gear.innerConeDistance)),
+        Ro(T(gear.outerConeDistance)) {
+    if (gear.numTeeth < 1 || gear.pitchConeDistance <= 0 ||
+        gear.outerConeDistance <= gear.innerConeDistance) {
+      throw std::invalid_argument("ToothFlank needs a computed BevelGear");
+    }
+    const T k = T(M_PI) / 180;
+    delta = T(gear.pitchConeAngle) * k;
+    deltaB = asin(sin(delta) * cos(T(gear.pressureAngle) * k));
+    // Addendum modification implied by the mean addendum thickens the tooth
+    // like a profile shifted rack; backlash (deg of rotation) is shared
+    // between the two members
+    const T x = T((gear.addendum - gear.module) / gear.module);
+    halfThickness = T(M_PI) / (2 * gear.numTeeth) +
+                    2 * x * tan(T(gear.pressureAngle) * k) / gear.numTeeth -
+                    T(gear.backlash) * k / 4;
+    involuteAtPitch = involuteAzimuth(delta);
+    // Addendum and dedendum at cone distance R are c0 + R c1
+    const T fa = T(gear.faceConeAngle) * k, ra = T(gear.rootConeAngle) * k;
+    tip0 = T(gear.faceConeOffset) * sin(fa) / cos(fa - delta);
+    tip1 = tan(fa - delta);
+    root0 = -T(gear.rootConeOffset) * sin(ra) / cos(delta - ra);
+    root1 = tan(delta - ra);
+  }
+
+  const BevelGear& gear() const { return g; }
+  int numTeeth() const { return g.numTeeth; }
+  T pitchAngle() const { return 2 * T(M_PI) / g.numTeeth; }
+  T innerR() const { return Ri; }
+  T outerR() const { return Ro; }
+
+  // Polar angles (rad from the axis) of the tip and root at cone distance R,
+  // from the same addendum/dedendum relations as BevelGearPair
+  T tipAngle(T R) const { return delta + atan((tip0 + R * tip1) / R); }
+  T rootAngle(T R) const {
+    return delta - atan((root0 + R * root1) / R);
+  }
+
+  // Azimuth of the tooth centre line at cone distance R
+  T spiralOffset(T R) const {
+    if (beta == 0)
+      return 0;
+    T developed = 0;
+    switch (g.spiralType) {
+      case spiralFunction::Logarithmic:
+        developed = tan(beta) * log(R / Rm);
+        break;
+      case spiralFunction::CircularCut: {
+        // Cutter of radius Rm, tangent to the trace at the mean point
+        const T rc = Rm;
+        const T cx = Rm - rc * sin(beta), cy = rc * cos(beta);
+        const T rho = sqrt(cx * cx + cy * cy);
+        const T q = (R * R + rho * rho - rc * rc) / (2 * R);
+        developed = atan2(cy, cx) - acos(std::clamp(q / rho, T(-1), T(1)));
+        break;
+      }
+      case spiralFunction::Involute: {
+        // Involute of the circle Rm cos(beta), spiral angle beta at Rm
+        const T rb = Rm * cos(beta);
+        auto inv = [&](T r) {
+          r = std::max(r, rb);
+          return sqrt(r * r / (rb * rb) - 1) - acos(rb / r);
+        };
+        developed = inv(R) - inv(Rm);
+        break;
+      }
+    }
+    return developed / sin(delta);
+  }
+
+  // Polar angle (rad) of the profile point u
+  T polarAngle(T R, T u) const {
+    const T lo = rootAngle(R), hi = tipAngle(R);
+    return lo + u * (hi - lo);
+  }
+
+  // Inverse of polarAngle
+  T profileParam(T R, T gamma) const {
+    const T lo = rootAngle(R), hi = tipAngle(R);
+    return (gamma - lo) / (hi - lo);
+  }
+
+  // Base cone angle (rad) of the spherical involute
+  T baseAngle() const { return deltaB; }
+
+  // Arc (rad) on the great circle of action from the base cone to the
+  // involute point at polar angle gamma, 0 below the base cone. The member
+  // turns by arc / sin(baseAngle()) while contact moves along the arc.
+  T involuteArc(T gamma) const {
+    const T c = std::clamp(cos(gamma) / cos(deltaB), T(-1), T(1));
+    return gamma > deltaB ? acos(c) : T(0);
+  }
+  T polarAngleAtArc(T psi) const { return acos(cos(psi) * cos(deltaB)); }
+
+  // Half the angular tooth width at polar angle gamma. Flanks that would
+  // cross above a pointed tip are clamped to the centre line.
+  T halfWidth(T gamma) const {
+    return std::max(
+        halfThickness - (involuteAzimuth(gamma) - involuteAtPitch), T(0));
+  }
+
+  // Azimuth of the flank at cone distance R and polar angle gamma
+  T azimuth(FlankSide side, T R, T gamma) const {
+    const T a = halfWidth(gamma);
+    return (side == FlankSide::Right ? a : -a) + spiralOffset(R);
+  }
+
+  Vec point(FlankSide side, T R, T u) const {
+    const T gamma = polarAngle(R, u);
+    const T phi = azimuth(side, R, gamma);
+    return {R * sin(gamma) * cos(phi), R * sin(gamma) * sin(phi),
+            R * cos(gamma)};
+  }
+
+  // Unit normal pointing out of the tooth material, into the tooth space.
+  // In float the difference step grows to the square root of the rounding.
+  Vec normal(FlankSide side, T R, T u) const {
+    const T h =
+        std::max(T(1e-4), std::sqrt(std::numeric_limits<T>::epsilon()));
+    const T hR = h * R, hu = h;
+    const T u0 = std::min(u, 1 - hu);
+    const Vec dR = point(side, R + hR, u0) - point(side, R - hR, u0);
+    const Vec du = point(side, R, u0 + hu) - point(side, R, u0);
+    Vec n = dR.cross(du).normalized();
+    // Outward is away from the tooth centre line in azimuth
+    const Vec p = point(side, R, u0);
+    const Vec tangential = Vec(-p.y, p.x, 0).normalized();
+    const T sign = side == FlankSide::Right ? 1 : -1;
+    return n.dot(tangential) * sign < 0 ? -n : n;
+  }
+
+  // Point on tooth k, rotated from tooth 0 about the gear axis
+  Vec onTooth(const Vec& p, int k) const {
+    return p.rotatedZ(k * pitchAngle());
+  }
+
+private:
+  // Azimuth of the spherical involute at polar angle gamma, radial below the
+  // base cone
+  T involuteAzimuth(T gamma) const {
+    const T psi = involuteArc(gamma);
+    const T theta = psi / sin(deltaB);
+    const T sb = sin(deltaB);
+    const T x = sin(psi) * sin(theta) + cos(psi) * cos(theta) * sb;
+    const T y = -sin(psi) * cos(theta) + cos(psi) * sin(theta) * sb;
+    return atan2(y, x);
+  }
+
+  BevelGear g;
+  T Rm, beta, Ri, Ro;
+  T delta = 0, deltaB = 0;
+  T halfThickness = 0;
+  T involuteAtPitch = 0;
+  T tip0 = 0, tip1 = 0, root0 = 0, root1 = 0;
+};
+
+}  // namespace gearmath
+
+using gearmath::BasicToothFlank;
+using ToothFlank = BasicToothFlank<double>;
+using ToothFlankF = BasicToothFlank<float>;
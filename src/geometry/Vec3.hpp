@@ -0,0 +1,72 @@
+// Vec3.hpp
+#pragma once
+
+#include <cmath>
+
+// Small 3D vector for flank, toolpath and mesh geometry (mm). Vec3 is the
+// double precision one used for results; Vec3f serves float previews.
+template <typename T>
+struct BasicVec3 {
+  T x = 0;
+  T y = 0;
+  T z = 0;
+
+  BasicVec3() = default;
+  BasicVec3(T x, T y, T z) : x(x), y(y), z(z) {}
+
+  BasicVec3 operator+(const BasicVec3& o) const {
+    return {x + o.x, y + o.y, z + o.z};
+  }
+  BasicVec3 operator-(const BasicVec3& o) const {
+    return {x - o.x, y - o.y, z - o.z};
+  }
+  BasicVec3 operator-() const { return {-x, -y, -z}; }
+  BasicVec3 operator*(T s) const { return {x * s, y * s, z * s}; }
+  BasicVec3 operator/(T s) const { return {x / s, y / s, z / s}; }
+  BasicVec3& operator+=(const BasicVec3& o) {
+    x += o.x;
+    y += o.y;
+    z += o.z;
+    return *this;
+  }
+  BasicVec3& operator-=(const BasicVec3& o) {
+    x -= o.x;
+    y -= o.y;
+    z -= o.z;
+    return *this;
+  }
+  friend BasicVec3 operator*(T s, const BasicVec3& v) { return v * s; }
+
+  T dot(const BasicVec3& o) const { return x * o.x + y * o.y + z * o.z; }
+  BasicVec3 cross(const BasicVec3& o) const {
+    return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+  }
+  T norm() const { return std::sqrt(dot(*this)); }
+  BasicVec3 normalized() const {
+    const T n = norm();
+    return n > 0 ? *this / n : *this;
+  }
+
+  // Rotation about the z (gear) axis by angle in rad
+  BasicVec3 rotatedZ(T angle) const {
+    const T c = std::cos(angle), s = std::sin(angle);
+    return {c * x - s * y, s * x + c * y, z};
+  }
+};
+
+using Vec3 = BasicVec3<double>;
+using Vec3f = BasicVec3<float>;
+
+// Home of the precision-templated geometry kernels: unqualified math calls
+// in it pick the float overloads for float, not ::sin(double)
+namespace gearmath {
+using std::acos;
+using std::asin;
+using std::atan;
+using std::atan2;
+using std::cos;
+using std::log;
+using std::sin;
+using std::sqrt;
+using std::tan;
+}  // namespace gearmath
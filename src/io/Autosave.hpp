@@ -0,0 +1,266 @@
+// Autosave.hpp
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../pipeline/Trace.hpp"
+
+// Replace path with data so that a crash leaves either the old or the new
+// file, never a mix: write a temporary next to it, fsync, rename over the
+// target, then fsync the directory so the rename itself is durable. The
+// target keeps its permissions. On failure the target is untouched and
+// error (if given) says why.
+inline bool writeFileAtomically(const std::string& path,
+                                const std::string& data,
+                                std::string* error = nullptr) {
+  auto fail = [&](const std::string& what) {
+    if (error)
+      *error = what + " " + path + ": " + std::strerror(errno);
+    return false;
+  };
+  const std::string tmp = path + ".tmp";
+  mode_t mode = 0644;
+  struct stat st;
+  if (::stat(path.c_str(), &st) == 0)
+    mode = st.st_mode & 07777;
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if (fd < 0)
+    return fail("Cannot create temporary for");
+  size_t done = 0;
+  while (done < data.size()) {
+    const ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      const int saved = errno;
+      ::close(fd);
+      std::remove(tmp.c_str());
+      errno = saved;
+      return fail("Cannot write");
+    }
+    done += size_t(n);
+  }
+  if (::fchmod(fd, mode) != 0 || ::fsync(fd) != 0) {
+    const int saved = errno;
+    ::close(fd);
+    std::remove(tmp.c_str());
+    errno = saved;
+    return fail("Cannot sync");
+  }
+  if (::close(fd) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    const int saved = errno;
+    std::remove(tmp.c_str());
+    errno = saved;
+    return fail("Cannot replace");
+  }
+  const size_t slash = path.find_last_of('/');
+  const std::string dir = slash == std::string::npos ? "."
+                          : slash == 0                ? "/"
+                                                      : path.substr(0, slash);
+  const int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dfd >= 0) {
+    ::fsync(dfd);
+    ::close(dfd);
+  }
+  return true;
+}
+
+struct AutosaveOptions {
+  // Write once edits to a path have paused this long...
+  std::chrono::milliseconds quiet{500};
+  // ...or at the latest this long after the first unsaved edit
+  std::chrono::milliseconds maxDelay{5000};
+};
+
+struct AutosaveResult {
+  std::string path;
+  bool ok = false;
+  std::string error;
+  size_t requests = 0;  // Edits this write covered
+  bool now = false;     // One of them came from saveNow()
+};
+
+struct AutosaveStats {
+  uint64_t requests = 0;  // schedule() and saveNow() calls
+  uint64_t writes = 0;    // Files written, successful or not
+  uint64_t failures = 0;
+};
+
+// Writes project files on a background thread. The caller hands over a
+// serializer that owns a snapshot of the state (plain values or shared
+// immutable results), so taking it is cheap on the UI thread and the
+// formatting and I/O happen here. Requests for the same path are coalesced:
+// only the newest serializer runs, once edits pause. Files are replaced
+// with writeFileAtomically.
+class AutosaveService {
+public:
+  using Serializer = std::function<void(std::ostream&)>;
+  // Called on the writer thread after every write
+  using Completion = std::function<void(const AutosaveResult&)>;
+
+  explicit AutosaveService(AutosaveOptions opt = AutosaveOptions(),
+                           Completion done = nullptr)
+      : opt(opt), done(std::move(done)) {
+    worker = std::thread([this] { loop(); });
+  }
+
+  AutosaveService(const AutosaveService&) = delete;
+  AutosaveService& operator=(const AutosaveService&) = delete;
+
+  // Writes whatever is still pending, without waiting for the quiet period
+  ~AutosaveService() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+  }
+
+  // Save path after the quiet period, replacing an earlier pending request
+  void schedule(const std::string& path, Serializer serializer) {
+    enqueue(path, std::move(serializer), false);
+  }
+
+  // Save path as soon as the writer is free, still off the calling thread
+  void saveNow(const std::string& path, Serializer serializer) {
+    enqueue(path, std::move(serializer), true);
+  }
+
+  // Write everything pending now and wait for it. Returns false if a write
+  // failed since the previous flush.
+  bool flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++flushing;
+    wake.notify_all();
+    idle.wait(lock, [&] { return pending.empty() && !writing; });
+    --flushing;
+    const bool ok = counters.failures == failuresReported;
+    failuresReported = counters.failures;
+    return ok;
+  }
+
+  // Whether a request has not been written yet
+  bool busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !pending.empty() || writing;
+  }
+
+  AutosaveStats stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Request {
+    Serializer serializer;
+    Clock::time_point first, last;
+    bool now = false;
+    size_t count = 0;
+  };
+
+  void enqueue(const std::string& path, Serializer serializer, bool now) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      const Clock::time_point t = Clock::now();
+      auto it = pending.find(path);
+      if (it == pending.end())
+        it = pending.emplace(path, Request{nullptr, t, t, false, 0}).first;
+      Request& r = it->second;
+      r.serializer = std::move(serializer);
+      r.last = t;
+      r.now |= now;
+      ++r.count;
+      ++counters.requests;
+    }
+    wake.notify_all();
+  }
+
+  Clock::time_point due(const Request& r) const {
+    if (r.now || flushing > 0 || stopping)
+      return Clock::time_point::min();
+    return std::min(r.last + opt.quiet, r.first + opt.maxDelay);
+  }
+
+  void loop() {
+    trace::setThreadName("autosave");
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      if (pending.empty()) {
+        idle.notify_all();
+        if (stopping)
+          return;
+        wake.wait(lock);
+        continue;
+      }
+      auto next = pending.begin();
+      for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if (due(it->second) < due(next->second))
+          next = it;
+      }
+      const Clock::time_point when = due(next->second);
+      if (Clock::now() < when) {
+        wake.wait_until(lock, when);
+        continue;
+      }
+
+      AutosaveResult result;
+      result.path = next->first;
+      result.requests = next->second.count;
+      result.now = next->second.now;
+      Serializer serializer = std::move(next->second.serializer);
+      pending.erase(next);
+      writing = true;
+      lock.unlock();
+      write(serializer, result);
+      if (done)
+        done(result);
+      lock.lock();
+      writing = false;
+      ++counters.writes;
+      counters.failures += !result.ok;
+    }
+  }
+
+  static void write(const Serializer& serializer, AutosaveResult& result) {
+    GEARLAB_TRACE_SCOPE("autosave.write");
+    try {
+      std::ostringstream out;
+      serializer(out);
+      result.ok = writeFileAtomically(result.path, out.str(), &result.error);
+    } catch (const std::exception& e) {
+      result.ok = false;
+      result.error = e.what();
+    }
+  }
+
+  AutosaveOptions opt;
+  Completion done;
+  mutable std::mutex mutex;
+  std::condition_variable wake, idle;
+  std::map<std::string, Request> pending;
+  bool writing = false;
+  bool stopping = false;
+  int flushing = 0;
+  AutosaveStats counters;
+  uint64_t failuresReported = 0;  // Failures up to the last flush
+  std::thread worker;
+};
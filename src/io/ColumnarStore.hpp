@@ -0,0 +1,908 @@
+// ColumnarStore.hpp
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../pipeline/TaskGraph.hpp"
+#include "../pipeline/Trace.hpp"
+#include "ResultStore.hpp"
+
+// Append-only columnar store (.glrc) for sweeps whose rows carry arrays
+// (transmission error curves, pressure maps, contact paths) as well as
+// scalars. Rows are written in chunks; every chunk holds each column as
+// its own compressed stream with min/max/NaN statistics, so a query decodes
+// only the columns it reads and skips chunks the statistics rule out. The
+// file is memory-mapped, so opening a 100 GB store costs one page per chunk.
+//
+//   FileHeader          magic "GLRCOL01", column count, version
+//   ColumnDef[n]        name + kind (scalar or array)
+//   chunk*              ChunkHeader, ColumnChunk[n], column streams
+//
+// A chunk is committed by an fsync once fully written. A crash can only
+// tear the last chunk, which readers ignore and the next appending writer
+// truncates. Like .glr, values are stored in host byte order.
+namespace columnstore {
+
+constexpr char magic[8] = {'G', 'L', 'R', 'C', 'O', 'L', '0', '1'};
+constexpr uint32_t chunkMagic = 0x4b4e4843;  // "CHNK"
+constexpr uint32_t version = 1;
+constexpr size_t maxNameLength = 47;
+
+// Encoding of a stream of doubles, chosen per column chunk
+enum class Codec : uint8_t {
+  Raw,    // 8 bytes per value
+  Xor,    // XOR with the previous value, zero bytes dropped, repeats as runs
+  Delta,  // Difference of the bit patterns, zigzag varint
+};
+
+struct FileHeader {
+  char magic[8];
+  uint32_t numColumns;
+  uint32_t version;
+};
+
+struct ColumnDef {
+  char name[maxNameLength + 1];
+  uint32_t kind;
+  uint32_t reserved;
+};
+
+struct ChunkHeader {
+  uint32_t magic;
+  uint32_t numRows;
+  uint64_t firstRow;
+  uint64_t bytes;    // Whole chunk including this header
+  uint32_t descCrc;  // Of the ColumnChunk array
+  uint32_t reserved;
+};
+
+struct ColumnChunk {
+  uint8_t codec;
+  uint8_t reserved[3];
+  uint32_t crc;            // Of the value and length streams
+  uint64_t offset, size;   // Value stream, from the chunk start
+  uint64_t lengthsOffset;  // Varint array lengths (array columns)
+  uint64_t lengthsSize;
+  uint64_t values;  // Rows for scalars, summed lengths for arrays
+  uint64_t nanCount;
+  double min, max;  // Over the values that are not NaN
+};
+
+inline uint32_t crc32(const uint8_t* data, size_t n, uint32_t crc = 0) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i)
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+inline uint64_t bitsOf(double v) {
+  uint64_t b;
+  std::memcpy(&b, &v, sizeof(b));
+  return b;
+}
+
+inline double fromBits(uint64_t b) {
+  double v;
+  std::memcpy(&v, &b, sizeof(v));
+  return v;
+}
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(uint8_t(v) | 0x80);
+    v >>= 7;
+  }
+  out.push_back(uint8_t(v));
+}
+
+// Bounds-checked reading of an encoded stream
+struct Reader {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  uint8_t byte() {
+    if (p == end)
+      throw std::runtime_error("Corrupt column chunk");
+    return *p++;
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const uint8_t b = byte();
+      v |= uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    throw std::runtime_error("Corrupt column chunk");
+  }
+};
+
+// Control byte per value: 1rrrrrrr repeats the previous value r + 1 times,
+// 00lllttt is followed by the 8 - l - t bytes of the XOR between its l
+// leading and t trailing zero bytes. Smooth curves share sign, exponent and
+// high mantissa bytes; integers and grid values have zero low bytes.
+inline void encodeXor(const double* v, size_t n, std::vector<uint8_t>& out) {
+  out.resize(n * 9);  // Worst case
+  uint8_t* p = out.data();
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n;) {
+    const uint64_t x = bitsOf(v[i]) ^ prev;
+    if (x == 0) {
+      size_t run = 1;
+      while (run < 128 && i + run < n && bitsOf(v[i + run]) == prev)
+        ++run;
+      *p++ = uint8_t(0x80 | (run - 1));
+      i += run;
+      continue;
+    }
+    const int lead = __builtin_clzll(x) / 8, trail = __builtin_ctzll(x) / 8;
+    *p++ = uint8_t(lead << 3 | trail);
+    for (int b = trail; b < 8 - lead; ++b)
+      *p++ = uint8_t(x >> (8 * b));
+    prev ^= x;
+    ++i;
+  }
+  out.resize(size_t(p - out.data()));
+}
+
+inline void decodeXor(Reader in, size_t n, double* v) {
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n;) {
+    const uint8_t c = in.byte();
+    if (c & 0x80) {
+      const size_t run = size_t(c & 0x7f) + 1;
+      if (i + run > n)
+        throw std::runtime_error("Corrupt column chunk");
+      for (size_t k = 0; k < run; ++k)
+        v[i++] = fromBits(prev);
+      continue;
+    }
+    const int lead = c >> 3, trail = c & 7;
+    if (lead + trail > 7)
+      throw std::runtime_error("Corrupt column chunk");
+    uint64_t x = 0;
+    for (int b = trail; b < 8 - lead; ++b)
+      x |= uint64_t(in.byte()) << (8 * b);
+    prev ^= x;
+    v[i++] = fromBits(prev);
+  }
+}
+
+// Monotonic or slowly varying values of one sign and exponent differ by a
+// small integer in their bit patterns
+inline void encodeDelta(const double* v, size_t n,
+                        std::vector<uint8_t>& out) {
+  out.resize(n * 10);
+  uint8_t* p = out.data();
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t b = bitsOf(v[i]);
+    const int64_t d = int64_t(b - prev);
+    uint64_t z = (uint64_t(d) << 1) ^ uint64_t(d >> 63);
+    while (z >= 0x80) {
+      *p++ = uint8_t(z) | 0x80;
+      z >>= 7;
+    }
+    *p++ = uint8_t(z);
+    prev = b;
+  }
+  out.resize(size_t(p - out.data()));
+}
+
+inline void decodeDelta(Reader in, size_t n, double* v) {
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t z = in.varint();
+    prev += (z >> 1) ^ (~(z & 1) + 1);
+    v[i] = fromBits(prev);
+  }
+}
+
+// Smallest of the encodings, raw when neither helps
+inline Codec encode(const double* v, size_t n, std::vector<uint8_t>& out) {
+  std::vector<uint8_t> x, d;
+  encodeXor(v, n, x);
+  encodeDelta(v, n, d);
+  const size_t raw = n * sizeof(double);
+  if (std::min(x.size(), d.size()) >= raw) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(v);
+    out.assign(p, p + raw);
+    return Codec::Raw;
+  }
+  if (x.size() <= d.size()) {
+    out.swap(x);
+    return Codec::Xor;
+  }
+  out.swap(d);
+  return Codec::Delta;
+}
+
+inline void decode(Codec codec, Reader in, size_t n, double* v) {
+  switch (codec) {
+    case Codec::Raw:
+      if (size_t(in.end - in.p) != n * sizeof(double))
+        throw std::runtime_error("Corrupt column chunk");
+      std::memcpy(v, in.p, n * sizeof(double));
+      return;
+    case Codec::Xor:
+      decodeXor(in, n, v);
+      return;
+    case Codec::Delta:
+      decodeDelta(in, n, v);
+      return;
+  }
+  throw std::runtime_error("Unknown column codec");
+}
+
+}  // namespace columnstore
+
+enum class ColumnKind : uint32_t {
+  Scalar,  // One double per row
+  Array,   // Any number of doubles per row
+};
+
+struct ColumnSpec {
+  std::string name;
+  ColumnKind kind = ColumnKind::Scalar;
+};
+
+// Values of one row of an array column
+struct ArrayValue {
+  const double* data = nullptr;
+  size_t size = 0;
+};
+
+struct ColumnarStoreOptions {
+  size_t chunkRows = 65536;       // Rows per chunk at most
+  size_t chunkValues = 1u << 20;  // Buffered values that close a chunk early
+  bool append = false;            // Add to an existing store of this schema
+};
+
+// Writes rows into a columnar store. Rows are buffered and written as a
+// chunk when chunkRows or chunkValues is reached, or on flush(); a chunk is
+// durable once written. Rows still buffered when the writer is destroyed
+// without close() are lost, the chunks before them are not.
+class ColumnarStoreWriter {
+public:
+  ColumnarStoreWriter(std::string path, std::vector<ColumnSpec> columns,
+                      ColumnarStoreOptions opt = ColumnarStoreOptions())
+      : path(std::move(path)), specs(std::move(columns)), opt(opt) {
+    using namespace columnstore;
+    if (specs.empty())
+      throw std::invalid_argument("Columnar store needs at least one column");
+    for (const ColumnSpec& s : specs) {
+      if (s.name.size() > maxNameLength)
+        throw std::invalid_argument("Column name too long: " + s.name);
+      (s.kind == ColumnKind::Array ? numArrays : numScalars)++;
+    }
+    pending.resize(specs.size());
+    lengths.resize(specs.size());
+    if (this->opt.append && (out = std::fopen(this->path.c_str(), "r+b"))) {
+      try {
+        recover();
+      } catch (...) {
+        std::fclose(out);
+        throw;
+      }
+      return;
+    }
+    out = std::fopen(this->path.c_str(), "wb");
+    if (!out)
+      throw std::runtime_error("Cannot create " + this->path);
+    FileHeader h{};
+    std::memcpy(h.magic, columnstore::magic, sizeof(h.magic));
+    h.numColumns = uint32_t(specs.size());
+    h.version = version;
+    const std::vector<ColumnDef> defs = definitions();
+    if (std::fwrite(&h, sizeof(h), 1, out) != 1 ||
+        std::fwrite(defs.data(), sizeof(ColumnDef), defs.size(), out) !=
+            defs.size() ||
+        std::fflush(out) != 0) {
+      std::fclose(out);
+      throw std::runtime_error("Write failed for " + this->path);
+    }
+    end = sizeof(h) + defs.size() * sizeof(ColumnDef);
+  }
+
+  ColumnarStoreWriter(const ColumnarStoreWriter&) = delete;
+  ColumnarStoreWriter& operator=(const ColumnarStoreWriter&) = delete;
+
+  ~ColumnarStoreWriter() {
+    if (out)
+      std::fclose(out);
+  }
+
+  size_t columnCount() const { return specs.size(); }
+  // Rows in the store, including those appended to and still buffered
+  uint64_t rowCount() const { return committedRows + pendingRows; }
+
+  // Append one row: the scalar columns in schema order, then the array
+  // columns in schema order
+  void addRow(const double* scalars, const ArrayValue* arrays = nullptr) {
+    if (!out)
+      throw std::logic_error("Columnar store is closed");
+    if (numArrays > 0 && !arrays)
+      throw std::invalid_argument("Row is missing its array columns");
+    size_t s = 0, a = 0;
+    for (size_t c = 0; c < specs.size(); ++c) {
+      if (specs[c].kind == ColumnKind::Scalar) {
+        pending[c].push_back(scalars[s++]);
+        ++pendingValues;
+      } else {
+        const ArrayValue& v = arrays[a++];
+        if (v.size > std::numeric_limits<uint32_t>::max())
+          throw std::invalid_argument("Array value too long");
+        pending[c].insert(pending[c].end(), v.data, v.data + v.size);
+        lengths[c].push_back(uint32_t(v.size));
+        pendingValues += v.size;
+      }
+    }
+    if (++pendingRows >= opt.chunkRows || pendingValues >= opt.chunkValues)
+      flush();
+  }
+
+  void addRow(const std::vector<double>& scalars,
+              const std::vector<std::vector<double>>& arrays = {}) {
+    if (scalars.size() != numScalars || arrays.size() != numArrays)
+      throw std::invalid_argument("Row has wrong number of columns");
+    std::vector<ArrayValue> views;
+    for (const auto& v : arrays)
+      views.push_back(ArrayValue{v.data(), v.size()});
+    addRow(scalars.data(), views.data());
+  }
+
+  // Write the buffered rows as a chunk and make it durable
+  void flush() {
+    using namespace columnstore;
+    if (pendingRows == 0)
+      return;
+    GEARLAB_TRACE_SCOPE("export.columnarChunk");
+    std::vector<ColumnChunk> descs(specs.size());
+    std::vector<std::vector<uint8_t>> streams(2 * specs.size());
+    uint64_t offset = sizeof(ChunkHeader) + descs.size() * sizeof(ColumnChunk);
+    for (size_t c = 0; c < specs.size(); ++c) {
+      ColumnChunk& d = descs[c];
+      const std::vector<double>& v = pending[c];
+      d.codec = uint8_t(encode(v.data(), v.size(), streams[2 * c]));
+      for (uint32_t n : lengths[c])
+        putVarint(streams[2 * c + 1], n);
+      d.values = v.size();
+      d.min = std::numeric_limits<double>::infinity();
+      d.max = -d.min;
+      for (double x : v) {
+        if (std::isnan(x)) {
+          ++d.nanCount;
+        } else {
+          d.min = std::min(d.min, x);
+          d.max = std::max(d.max, x);
+        }
+      }
+      const std::vector<uint8_t>& data = streams[2 * c];
+      const std::vector<uint8_t>& lens = streams[2 * c + 1];
+      d.offset = offset;
+      d.size = data.size();
+      d.lengthsOffset = offset + data.size();
+      d.lengthsSize = lens.size();
+      d.crc = crc32(lens.data(), lens.size(), crc32(data.data(), data.size()));
+      offset += data.size() + lens.size();
+    }
+    ChunkHeader h{};
+    h.magic = chunkMagic;
+    h.numRows = uint32_t(pendingRows);
+    h.firstRow = committedRows;
+    h.bytes = offset;
+    h.descCrc = crc32(reinterpret_cast<const uint8_t*>(descs.data()),
+                      descs.size() * sizeof(ColumnChunk));
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, out) == 1 &&
+              std::fwrite(descs.data(), sizeof(ColumnChunk), descs.size(),
+                          out) == descs.size();
+    for (const auto& s : streams)
+      ok = ok && std::fwrite(s.data(), 1, s.size(), out) == s.size();
+    ok = ok && std::fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if (!ok) {
+      // Leave the store as it was before this chunk
+      ok = ftruncate(fileno(out), off_t(end)) == 0 &&
+           std::fseek(out, long(end), SEEK_SET) == 0;
+      if (!ok) {
+        std::fclose(out);
+        out = nullptr;
+      }
+      throw std::runtime_error("Write failed for " + path);
+    }
+    end += offset;
+    committedRows += pendingRows;
+    pendingRows = pendingValues = 0;
+    for (auto& v : pending)
+      v.clear();
+    for (auto& l : lengths)
+      l.clear();
+  }
+
+  void close() {
+    if (!out)
+      return;
+    flush();
+    const bool ok = std::fclose(out) == 0;
+    out = nullptr;
+    if (!ok)
+      throw std::runtime_error("Failed to close " + path);
+  }
+
+private:
+  std::vector<columnstore::ColumnDef> definitions() const {
+    std::vector<columnstore::ColumnDef> defs(specs.size());
+    for (size_t c = 0; c < specs.size(); ++c) {
+      std::memset(&defs[c], 0, sizeof(defs[c]));
+      std::memcpy(defs[c].name, specs[c].name.data(), specs[c].name.size());
+      defs[c].kind = uint32_t(specs[c].kind);
+    }
+    return defs;
+  }
+
+  // Check the schema of the existing file, find its end and cut off a chunk
+  // torn by a crash
+  void recover() {
+    using namespace columnstore;
+    FileHeader h;
+    std::vector<ColumnDef> defs(specs.size());
+    if (std::fread(&h, sizeof(h), 1, out) != 1 ||
+        std::memcmp(h.magic, columnstore::magic, sizeof(h.magic)) != 0)
+      throw std::runtime_error("Not a columnar store: " + path);
+    const std::vector<ColumnDef> expected = definitions();
+    if (h.numColumns != specs.size() ||
+        std::fread(defs.data(), sizeof(ColumnDef), defs.size(), out) !=
+            defs.size() ||
+        std::memcmp(defs.data(), expected.data(),
+                    defs.size() * sizeof(ColumnDef)) != 0)
+      throw std::invalid_argument(path + " has a different schema");
+
+    struct stat st;
+    if (fstat(fileno(out), &st) != 0)
+      throw std::runtime_error("Cannot read " + path);
+    end = sizeof(h) + defs.size() * sizeof(ColumnDef);
+    std::vector<uint8_t> chunk;
+    while (end + sizeof(ChunkHeader) <= uint64_t(st.st_size)) {
+      ChunkHeader ch;
+      if (std::fseek(out, long(end), SEEK_SET) != 0 ||
+          std::fread(&ch, sizeof(ch), 1, out) != 1 ||
+          ch.magic != chunkMagic || ch.firstRow != committedRows ||
+          ch.bytes > uint64_t(st.st_size) - end ||
+          ch.bytes < sizeof(ChunkHeader) + specs.size() * sizeof(ColumnChunk))
+        break;
+      // Chunks before the last were committed by an fsync before the next
+      // one was started, so only the last needs its data checked
+      if (end + ch.bytes == uint64_t(st.st_size)) {
+        chunk.resize(ch.bytes);
+        if (std::fseek(out, long(end), SEEK_SET) != 0 ||
+            std::fread(chunk.data(), 1, chunk.size(), out) != chunk.size() ||
+            !intact(chunk))
+          break;
+      }
+      end += ch.bytes;
+      committedRows += ch.numRows;
+    }
+    if ((uint64_t(st.st_size) != end &&
+         ftruncate(fileno(out), off_t(end)) != 0) ||
+        std::fseek(out, long(end), SEEK_SET) != 0)
+      throw std::runtime_error("Cannot append to " + path);
+  }
+
+  bool intact(const std::vector<uint8_t>& chunk) const {
+    using namespace columnstore;
+    const size_t descEnd =
+        sizeof(ChunkHeader) + specs.size() * sizeof(ColumnChunk);
+    if (chunk.size() < descEnd)
+      return false;
+    ChunkHeader h;
+    std::memcpy(&h, chunk.data(), sizeof(h));
+    if (crc32(chunk.data() + sizeof(h), descEnd - sizeof(h)) != h.descCrc)
+      return false;
+    for (size_t c = 0; c < specs.size(); ++c) {
+      ColumnChunk d;
+      std::memcpy(&d, chunk.data() + sizeof(h) + c * sizeof(d), sizeof(d));
+      if (d.offset + d.size > chunk.size() ||
+          d.lengthsOffset + d.lengthsSize > chunk.size())
+        return false;
+      const uint32_t crc =
+          crc32(chunk.data() + d.lengthsOffset, d.lengthsSize,
+                crc32(chunk.data() + d.offset, d.size));
+      if (crc != d.crc)
+        return false;
+    }
+    return true;
+  }
+
+  std::string path;
+  std::vector<ColumnSpec> specs;
+  ColumnarStoreOptions opt;
+  size_t numScalars = 0, numArrays = 0;
+  FILE* out = nullptr;
+  uint64_t end = 0;  // File offset after the last committed chunk
+  uint64_t committedRows = 0;
+  size_t pendingRows = 0, pendingValues = 0;
+  std::vector<std::vector<double>> pending;
+  std::vector<std::vector<uint32_t>> lengths;
+};
+
+// Statistics of one column in one chunk
+struct ColumnChunkStats {
+  columnstore::Codec codec;
+  uint64_t values;    // Rows, or array elements
+  uint64_t nanCount;
+  double min, max;    // +inf / -inf when every value is NaN
+  uint64_t bytes;     // Encoded size
+};
+
+// Range predicate on a scalar column, both ends included. NaN never passes.
+struct ColumnRange {
+  size_t column;
+  double min = -std::numeric_limits<double>::infinity();
+  double max = std::numeric_limits<double>::infinity();
+};
+
+struct ColumnarSelection {
+  std::vector<uint64_t> rows;  // Ascending
+  size_t chunksRead = 0;       // Decoded to test the predicates
+  size_t chunksSkipped = 0;    // Ruled out by their statistics
+  size_t chunksWhole = 0;      // Matched entirely by their statistics
+};
+
+// Memory-mapped reader of a .glrc store. Opening maps the file and reads
+// the chunk headers; column chunks are decoded on first access and kept in
+// a cache bounded by cacheBytes. Safe for concurrent reads, so it can back
+// runResultQuery and the result browser like a .glr table. value() of an
+// array column is the length of the row's array.
+class ColumnarResultTable : public ResultTable {
+public:
+  explicit ColumnarResultTable(const std::string& path,
+                               size_t cacheBytes = size_t(256) << 20)
+      : path(path), cacheLimit(cacheBytes), id(nextId()) {
+    using namespace columnstore;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+      ::close(fd);
+      throw std::runtime_error("Not a columnar store: " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      throw std::runtime_error("Cannot map " + path);
+    base = static_cast<const uint8_t*>(p);
+    try {
+      readLayout();
+    } catch (...) {
+      munmap(const_cast<uint8_t*>(base), size);
+      throw;
+    }
+    slots.resize(chunkOffsets.size() * specs.size());
+    // Chunks are read whole but columns are scattered across them
+    madvise(const_cast<uint8_t*>(base), size, MADV_RANDOM);
+  }
+
+  ColumnarResultTable(const ColumnarResultTable&) = delete;
+  ColumnarResultTable& operator=(const ColumnarResultTable&) = delete;
+
+  ~ColumnarResultTable() override {
+    munmap(const_cast<uint8_t*>(base), size);
+  }
+
+  size_t rowCount() const override { return rows; }
+  size_t columnCount() const override { return specs.size(); }
+  std::string columnName(size_t column) const override {
+    return specs.at(column).name;
+  }
+  double value(size_t row, size_t column) const override {
+    const size_t k = chunkOf(row);
+    const Decoded& d = cached(k, column);
+    const size_t i = row - chunkFirst[k];
+    if (d.starts.empty())
+      return d.values[i];
+    return double(d.starts[i + 1] - d.starts[i]);
+  }
+
+  ColumnKind kind(size_t column) const { return specs.at(column).kind; }
+
+  std::vector<double> array(size_t row, size_t column) const {
+    if (kind(column) != ColumnKind::Array)
+      throw std::invalid_argument(specs[column].name + " is not an array");
+    const size_t k = chunkOf(row);
+    const Decoded& d = cached(k, column);
+    const size_t i = row - chunkFirst[k];
+    return std::vector<double>(d.values.begin() + d.starts[i],
+                               d.values.begin() + d.starts[i + 1]);
+  }
+
+  size_t chunkCount() const { return chunkOffsets.size(); }
+  uint64_t chunkFirstRow(size_t k) const { return chunkFirst.at(k); }
+  uint64_t chunkRows(size_t k) const {
+    return chunkFirst.at(k + 1) - chunkFirst[k];
+  }
+
+  ColumnChunkStats stats(size_t chunk, size_t column) const {
+    const columnstore::ColumnChunk d = descriptor(chunk, column);
+    return ColumnChunkStats{columnstore::Codec(d.codec), d.values,
+                            d.nanCount, d.min, d.max,
+                            d.size + d.lengthsSize};
+  }
+
+  // Encoded bytes of a column over all chunks
+  uint64_t storedBytes(size_t column) const {
+    uint64_t total = 0;
+    for (size_t k = 0; k < chunkCount(); ++k)
+      total += stats(k, column).bytes;
+    return total;
+  }
+
+  // Rows passing every range, chunks in parallel on the pool. A chunk whose
+  // statistics exclude a range is skipped, one they place inside every
+  // range is taken whole; only the rest decode the predicate columns, which
+  // bypass the cache so a scan does not evict the working set.
+  ColumnarSelection select(const std::vector<ColumnRange>& ranges,
+                           ThreadPool& pool,
+                           const CancellationToken& token =
+                               CancellationToken()) const {
+    GEARLAB_TRACE_SCOPE("columnarSelect");
+    for (const ColumnRange& r : ranges) {
+      if (r.column >= specs.size())
+        throw std::out_of_range("Predicate column out of range");
+      if (specs[r.column].kind != ColumnKind::Scalar)
+        throw std::invalid_argument("Predicate on array column " +
+                                    specs[r.column].name);
+    }
+    const size_t n = chunkCount();
+    std::vector<std::vector<uint64_t>> parts(n);
+    std::vector<char> outcome(n);  // 's'kipped, 'w'hole, 'r'ead
+    pool.parallelFor(
+        0, n,
+        [&](size_t k) {
+          if (token.isCancelled())
+            return;
+          bool whole = true;
+          for (const ColumnRange& r : ranges) {
+            const columnstore::ColumnChunk d = descriptor(k, r.column);
+            if (d.nanCount == d.values || d.max < r.min || d.min > r.max) {
+              outcome[k] = 's';
+              return;
+            }
+            whole &= d.nanCount == 0 && d.min >= r.min && d.max <= r.max;
+          }
+          auto& out = parts[k];
+          const uint64_t first = chunkFirst[k], count = chunkRows(k);
+          if (whole) {
+            outcome[k] = 'w';
+            out.resize(count);
+            for (uint64_t i = 0; i < count; ++i)
+              out[i] = first + i;
+            return;
+          }
+          outcome[k] = 'r';
+          std::vector<char> pass(count, 1);
+          for (const ColumnRange& r : ranges) {
+            const Decoded d = decode(k, r.column);
+            for (uint64_t i = 0; i < count; ++i) {
+              const double v = d.values[i];
+              pass[i] &= v >= r.min && v <= r.max;
+            }
+          }
+          for (uint64_t i = 0; i < count; ++i) {
+            if (pass[i])
+              out.push_back(first + i);
+          }
+        },
+        1);
+    if (token.isCancelled())
+      throw JobCancelled();
+
+    ColumnarSelection s;
+    size_t total = 0;
+    for (const auto& p : parts)
+      total += p.size();
+    s.rows.reserve(total);
+    for (size_t k = 0; k < n; ++k) {
+      s.rows.insert(s.rows.end(), parts[k].begin(), parts[k].end());
+      s.chunksSkipped += outcome[k] == 's';
+      s.chunksWhole += outcome[k] == 'w';
+      s.chunksRead += outcome[k] == 'r';
+    }
+    return s;
+  }
+
+private:
+  // One column of one chunk; starts has rows + 1 entries for arrays
+  struct Decoded {
+    std::vector<double> values;
+    std::vector<uint64_t> starts;
+    size_t bytes() const {
+      return values.size() * sizeof(double) + starts.size() * sizeof(uint64_t);
+    }
+  };
+
+  static uint64_t nextId() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+  }
+
+  void readLayout() {
+    using namespace columnstore;
+    FileHeader h;
+    std::memcpy(&h, base, sizeof(h));
+    uint64_t at = sizeof(h) + uint64_t(h.numColumns) * sizeof(ColumnDef);
+    if (std::memcmp(h.magic, columnstore::magic, sizeof(h.magic)) != 0 ||
+        h.numColumns == 0 || at > size)
+      throw std::runtime_error("Not a columnar store: " + path);
+    if (h.version != version)
+      throw std::runtime_error("Unsupported columnar store version: " + path);
+    for (uint32_t c = 0; c < h.numColumns; ++c) {
+      ColumnDef d;
+      std::memcpy(&d, base + sizeof(h) + c * sizeof(d), sizeof(d));
+      specs.push_back(ColumnSpec{
+          std::string(d.name, strnlen(d.name, sizeof(d.name))),
+          d.kind == uint32_t(ColumnKind::Array) ? ColumnKind::Array
+                                                : ColumnKind::Scalar});
+    }
+    const size_t descBytes = specs.size() * sizeof(ColumnChunk);
+    chunkFirst.push_back(0);
+    // Stop at the first chunk that is incomplete: the tail a crash tore
+    while (at + sizeof(ChunkHeader) + descBytes <= size) {
+      ChunkHeader ch;
+      std::memcpy(&ch, base + at, sizeof(ch));
+      if (ch.magic != chunkMagic || ch.firstRow != rows ||
+          ch.bytes > size - at ||
+          ch.bytes < sizeof(ChunkHeader) + descBytes ||
+          crc32(base + at + sizeof(ch), descBytes) != ch.descCrc)
+        break;
+      bool inside = true;
+      for (size_t c = 0; c < specs.size(); ++c) {
+        ColumnChunk d;
+        std::memcpy(&d, base + at + sizeof(ch) + c * sizeof(d), sizeof(d));
+        inside &= d.offset + d.size <= ch.bytes &&
+                  d.lengthsOffset + d.lengthsSize <= ch.bytes;
+      }
+      if (!inside)
+        break;
+      chunkOffsets.push_back(at);
+      rows += ch.numRows;
+      chunkFirst.push_back(rows);
+      at += ch.bytes;
+    }
+  }
+
+  size_t chunkOf(size_t row) const {
+    if (row >= rows)
+      throw std::out_of_range("Row out of range");
+    return size_t(std::upper_bound(chunkFirst.begin(), chunkFirst.end(),
+                                   uint64_t(row)) -
+                  chunkFirst.begin()) -
+           1;
+  }
+
+  columnstore::ColumnChunk descriptor(size_t chunk, size_t column) const {
+    using namespace columnstore;
+    if (column >= specs.size())
+      throw std::out_of_range("Column out of range");
+    ColumnChunk d;
+    std::memcpy(&d,
+                base + chunkOffsets.at(chunk) + sizeof(ChunkHeader) +
+                    column * sizeof(ColumnChunk),
+                sizeof(d));
+    return d;
+  }
+
+  Decoded decode(size_t chunk, size_t column) const {
+    using namespace columnstore;
+    const ColumnChunk d = descriptor(chunk, column);
+    const uint8_t* at = base + chunkOffsets[chunk];
+    if (crc32(at + d.lengthsOffset, d.lengthsSize,
+              crc32(at + d.offset, d.size)) != d.crc)
+      throw std::runtime_error("Corrupt column chunk in " + path);
+    Decoded out;
+    const uint64_t n = chunkRows(chunk);
+    if (specs[column].kind == ColumnKind::Array) {
+      Reader lens{at + d.lengthsOffset, at + d.lengthsOffset + d.lengthsSize};
+      out.starts.resize(n + 1);
+      for (uint64_t i = 0; i < n; ++i)
+        out.starts[i + 1] = out.starts[i] + lens.varint();
+      if (out.starts[n] != d.values)
+        throw std::runtime_error("Corrupt column chunk in " + path);
+    } else if (d.values != n) {
+      throw std::runtime_error("Corrupt column chunk in " + path);
+    }
+    out.values.resize(d.values);
+    columnstore::decode(Codec(d.codec), Reader{at + d.offset,
+                                               at + d.offset + d.size},
+                        d.values, out.values.data());
+    return out;
+  }
+
+  // Decoded column chunk from the cache. Each thread remembers the last
+  // one it used, so scans over a chunk do not touch the shared slots.
+  const Decoded& cached(size_t chunk, size_t column) const {
+    struct Recent {
+      uint64_t table = 0;
+      size_t slot = 0;
+      std::shared_ptr<const Decoded> data;
+    };
+    thread_local Recent recent;
+    const size_t slot = chunk * specs.size() + column;
+    if (recent.table == id && recent.slot == slot)
+      return *recent.data;
+
+    std::shared_ptr<const Decoded> d = std::atomic_load(&slots[slot]);
+    if (!d) {
+      auto fresh = std::make_shared<const Decoded>(decode(chunk, column));
+      std::shared_ptr<const Decoded> empty;
+      if (std::atomic_compare_exchange_strong(&slots[slot], &empty, fresh)) {
+        d = fresh;
+        admit(slot, d->bytes());
+      } else {
+        d = empty;  // Another thread decoded it first
+      }
+    }
+    recent = Recent{id, slot, d};
+    return *recent.data;
+  }
+
+  // Account a new cache entry and evict the oldest while over the limit
+  void admit(size_t slot, size_t bytes) const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheOrder.push_back(slot);
+    cachedBytes += bytes;
+    while (cachedBytes > cacheLimit && cacheOrder.size() > 1) {
+      const size_t victim = cacheOrder.front();
+      cacheOrder.pop_front();
+      std::shared_ptr<const Decoded> old =
+          std::atomic_exchange(&slots[victim],
+                               std::shared_ptr<const Decoded>());
+      if (old)
+        cachedBytes -= old->bytes();
+    }
+  }
+
+  std::string path;
+  const uint8_t* base = nullptr;
+  size_t size = 0;
+  size_t rows = 0;
+  std::vector<ColumnSpec> specs;
+  std::vector<uint64_t> chunkOffsets;
+  std::vector<uint64_t> chunkFirst;  // chunkCount() + 1 entries
+
+  size_t cacheLimit;
+  uint64_t id;  // Tells tables apart in the per-thread cache entry
+  mutable std::vector<std::shared_ptr<const Decoded>> slots;
+  mutable std::mutex cacheMutex;
+  mutable std::deque<size_t> cacheOrder;
+  mutable size_t cachedBytes = 0;
+};
@@ -0,0 +1,98 @@
+// Heatmap.hpp
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Image and raw grid files of row major scalar grids such as contact
+// patterns. Images are binary PPM (P6), which every viewer and image tool
+// reads, with row 0 at the bottom so a flank grid shows root down and tip
+// up. Zero cells are white like an unmarked flank; the rest run from pale
+// yellow through orange to dark red at maxValue. Raw grids are CSV with the
+// row and column coordinates, written at full precision.
+namespace heatmap {
+
+struct Rgb {
+  unsigned char r, g, b;
+};
+
+inline Rgb colour(double v, double maxValue) {
+  if (!(v > 0) || !(maxValue > 0))
+    return {255, 255, 255};
+  static const Rgb stops[] = {
+      {255, 240, 160}, {253, 174, 97}, {244, 109, 67}, {165, 0, 38}};
+  const double f = std::clamp(v / maxValue, 0.0, 1.0) * 3;
+  const int i = std::min(int(f), 2);
+  const double t = f - i;
+  auto mix = [&](unsigned char a, unsigned char b) {
+    return static_cast<unsigned char>(a + (b - a) * t + 0.5);
+  };
+  return {mix(stops[i].r, stops[i + 1].r), mix(stops[i].g, stops[i + 1].g),
+          mix(stops[i].b, stops[i + 1].b)};
+}
+
+// Write a columns x rows grid as a PPM image, every cell scale x scale
+// pixels. maxValue 0 scales to the largest value. Returns the bytes written.
+inline size_t writePpm(const std::string& path,
+                       const std::vector<float>& values, int columns,
+                       int rows, double maxValue = 0, int scale = 4) {
+  if (columns < 1 || rows < 1 || scale < 1 ||
+      values.size() != size_t(columns) * rows)
+    throw std::invalid_argument("Invalid heatmap grid for " + path);
+  if (maxValue <= 0 && !values.empty())
+    maxValue = *std::max_element(values.begin(), values.end());
+  const int width = columns * scale, height = rows * scale;
+  std::vector<unsigned char> pixels(size_t(width) * height * 3);
+  for (int y = 0; y < height; ++y) {
+    const int row = rows - 1 - y / scale;
+    for (int x = 0; x < width; ++x) {
+      const Rgb c = colour(values[size_t(row) * columns + x / scale],
+                           maxValue);
+      unsigned char* p = &pixels[(size_t(y) * width + x) * 3];
+      p[0] = c.r;
+      p[1] = c.g;
+      p[2] = c.b;
+    }
+  }
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    throw std::runtime_error("Cannot write " + path);
+  const int header = std::fprintf(f, "P6\n%d %d\n255\n", width, height);
+  const size_t n = std::fwrite(pixels.data(), 1, pixels.size(), f);
+  if (std::fclose(f) != 0 || header < 0 || n != pixels.size())
+    throw std::runtime_error("Cannot write " + path);
+  return size_t(header) + n;
+}
+
+// Write the grid as CSV: a header row with the column coordinates, then
+// one line per row starting with its coordinate. Returns the bytes written.
+inline size_t writeCsv(const std::string& path,
+                       const std::vector<float>& values, int columns,
+                       int rows, const std::vector<double>& columnAt,
+                       const std::vector<double>& rowAt,
+                       const std::string& corner = "") {
+  if (values.size() != size_t(columns) * rows ||
+      columnAt.size() != size_t(columns) || rowAt.size() != size_t(rows))
+    throw std::invalid_argument("Invalid heatmap grid for " + path);
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f)
+    throw std::runtime_error("Cannot write " + path);
+  long bytes = std::fprintf(f, "%s", corner.c_str());
+  for (double c : columnAt)
+    bytes += std::fprintf(f, ",%.6g", c);
+  bytes += std::fprintf(f, "\n");
+  for (int r = 0; r < rows; ++r) {
+    bytes += std::fprintf(f, "%.6g", rowAt[r]);
+    for (int c = 0; c < columns; ++c)
+      bytes += std::fprintf(f, ",%.9g", values[size_t(r) * columns + c]);
+    bytes += std::fprintf(f, "\n");
+  }
+  if (std::fclose(f) != 0)
+    throw std::runtime_error("Cannot write " + path);
+  return size_t(bytes);
+}
+
+}  // namespace heatmap
@@ -0,0 +1,430 @@
+// Json.hpp
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document model for the compute server protocol: a value
+// tree, a strict parser (RFC 8259, no extensions) and a compact writer.
+// Numbers are doubles and are written so they read back bit identical.
+// Object members keep their insertion order.
+namespace json {
+
+class ParseError : public std::runtime_error {
+public:
+  ParseError(const std::string& what, size_t offset)
+      : std::runtime_error(what + " at offset " + std::to_string(offset)),
+        offset(offset) {}
+  size_t offset;
+};
+
+class Value {
+public:
+  enum class Type { Null, Bool, Number, String, Array, Object };
+  using Member = std::pair<std::string, Value>;
+
+  Value() = default;
+  Value(std::nullptr_t) {}
+  Value(bool b) : t(Type::Bool), b(b) {}
+  Value(double x) : t(Type::Number), x(x) {}
+  Value(int x) : t(Type::Number), x(x) {}
+  Value(size_t x) : t(Type::Number), x(double(x)) {}
+  Value(const char* s) : t(Type::String), s(s) {}
+  Value(std::string s) : t(Type::String), s(std::move(s)) {}
+
+  static Value array() {
+    Value v;
+    v.t = Type::Array;
+    return v;
+  }
+  static Value object() {
+    Value v;
+    v.t = Type::Object;
+    return v;
+  }
+
+  Type type() const { return t; }
+  bool isNull() const { return t == Type::Null; }
+  bool isBool() const { return t == Type::Bool; }
+  bool isNumber() const { return t == Type::Number; }
+  bool isString() const { return t == Type::String; }
+  bool isArray() const { return t == Type::Array; }
+  bool isObject() const { return t == Type::Object; }
+
+  bool asBool() const { return b; }
+  double asNumber() const { return x; }
+  const std::string& asString() const { return s; }
+  const std::vector<Value>& items() const { return a; }
+  const std::vector<Member>& members() const { return o; }
+  size_t size() const { return t == Type::Object ? o.size() : a.size(); }
+
+  // Member by key, nullptr if absent or not an object
+  const Value* find(const std::string& key) const {
+    for (const Member& m : o) {
+      if (m.first == key)
+        return &m.second;
+    }
+    return nullptr;
+  }
+
+  // Member by key, appended as null if absent. Turns null into an object.
+  Value& operator[](const std::string& key) {
+    if (t == Type::Null)
+      t = Type::Object;
+    for (Member& m : o) {
+      if (m.first == key)
+        return m.second;
+    }
+    o.emplace_back(key, Value());
+    return o.back().second;
+  }
+
+  // Append to an array. Turns null into an array.
+  Value& push(Value v) {
+    if (t == Type::Null)
+      t = Type::Array;
+    a.push_back(std::move(v));
+    return a.back();
+  }
+
+  std::string dump() const {
+    std::string out;
+    dump(out);
+    return out;
+  }
+
+  void dump(std::string& out) const {
+    switch (t) {
+      case Type::Null:
+        out += "null";
+        break;
+      case Type::Bool:
+        out += b ? "true" : "false";
+        break;
+      case Type::Number:
+        writeNumber(out, x);
+        break;
+      case Type::String:
+        writeString(out, s);
+        break;
+      case Type::Array:
+        out += '[';
+        for (size_t i = 0; i < a.size(); ++i) {
+          if (i)
+            out += ',';
+          a[i].dump(out);
+        }
+        out += ']';
+        break;
+      case Type::Object:
+        out += '{';
+        for (size_t i = 0; i < o.size(); ++i) {
+          if (i)
+            out += ',';
+          writeString(out, o[i].first);
+          out += ':';
+          o[i].second.dump(out);
+        }
+        out += '}';
+        break;
+    }
+  }
+
+  // Shortest of %.15g and %.17g that reads back exactly. JSON has no
+  // infinities or NaN, they are written as null.
+  static void writeNumber(std::string& out, double v) {
+    if (!std::isfinite(v)) {
+      out += "null";
+      return;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", v);
+    if (std::strtod(buf, nullptr) != v)
+      std::snprintf(buf, sizeof(buf), "%.17g", v);
+    out += buf;
+  }
+
+  static void writeString(std::string& out, const std::string& str) {
+    out += '"';
+    for (const char ch : str) {
+      const unsigned char c = static_cast<unsigned char>(ch);
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += ch;
+      } else if (c == '\n') {
+        out += "\\n";
+      } else if (c < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        out += buf;
+      } else {
+        out += ch;
+      }
+    }
+    out += '"';
+  }
+
+private:
+  Type t = Type::Null;
+  bool b = false;
+  double x = 0;
+  std::string s;
+  std::vector<Value> a;
+  std::vector<Member> o;
+};
+
+namespace detail {
+
+class Parser {
+public:
+  explicit Parser(const std::string& text) : p(text.data()), text(text) {}
+
+  Value document() {
+    Value v = value(0);
+    skipSpace();
+    if (pos() != text.size())
+      fail("Trailing characters");
+    return v;
+  }
+
+private:
+  static constexpr int maxDepth = 64;
+
+  size_t pos() const { return size_t(p - text.data()); }
+  bool atEnd() const { return pos() >= text.size(); }
+  [[noreturn]] void fail(const char* what) const {
+    throw ParseError(what, pos());
+  }
+
+  void skipSpace() {
+    while (!atEnd() && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+      ++p;
+  }
+
+  void expect(const char* word) {
+    for (; *word; ++word, ++p) {
+      if (atEnd() || *p != *word)
+        fail("Invalid literal");
+    }
+  }
+
+  Value value(int depth) {
+    if (depth > maxDepth)
+      fail("Nesting too deep");
+    skipSpace();
+    if (atEnd())
+      fail("Unexpected end of input");
+    switch (*p) {
+      case '{':
+        return objectValue(depth);
+      case '[':
+        return arrayValue(depth);
+      case '"':
+        return Value(string());
+      case 't':
+        expect("true");
+        return Value(true);
+      case 'f':
+        expect("false");
+        return Value(false);
+      case 'n':
+        expect("null");
+        return Value();
+      default:
+        return Value(number());
+    }
+  }
+
+  Value objectValue(int depth) {
+    Value v = Value::object();
+    ++p;
+    skipSpace();
+    if (!atEnd() && *p == '}') {
+      ++p;
+      return v;
+    }
+    for (;;) {
+      skipSpace();
+      if (atEnd() || *p != '"')
+        fail("Expected a member name");
+      std::string key = string();
+      skipSpace();
+      if (atEnd() || *p != ':')
+        fail("Expected ':'");
+      ++p;
+      v[key] = value(depth + 1);
+      skipSpace();
+      if (atEnd())
+        fail("Unterminated object");
+      if (*p++ == '}')
+        return v;
+      if (p[-1] != ',')
+        fail("Expected ',' or '}'");
+    }
+  }
+
+  Value arrayValue(int depth) {
+    Value v = Value::array();
+    ++p;
+    skipSpace();
+    if (!atEnd() && *p == ']') {
+      ++p;
+      return v;
+    }
+    for (;;) {
+      v.push(value(depth + 1));
+      skipSpace();
+      if (atEnd())
+        fail("Unterminated array");
+      if (*p++ == ']')
+        return v;
+      if (p[-1] != ',')
+        fail("Expected ',' or ']'");
+    }
+  }
+
+  double number() {
+    const char* start = p;
+    if (!atEnd() && *p == '-')
+      ++p;
+    auto digits = [&] {
+      const char* d = p;
+      while (!atEnd() && *p >= '0' && *p <= '9')
+        ++p;
+      return p - d;
+    };
+    if (!atEnd() && *p == '0')
+      ++p;
+    else if (digits() == 0)
+      fail("Invalid value");
+    if (!atEnd() && *p == '.') {
+      ++p;
+      if (digits() == 0)
+        fail("Invalid number");
+    }
+    if (!atEnd() && (*p == 'e' || *p == 'E')) {
+      ++p;
+      if (!atEnd() && (*p == '+' || *p == '-'))
+        ++p;
+      if (digits() == 0)
+        fail("Invalid number");
+    }
+    return std::strtod(std::string(start, p).c_str(), nullptr);
+  }
+
+  unsigned hex4() {
+    unsigned u = 0;
+    for (int i = 0; i < 4; ++i, ++p) {
+      if (atEnd())
+        fail("Unterminated string");
+      const char c = *p;
+      u <<= 4;
+      if (c >= '0' && c <= '9')
+        u |= unsigned(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        u |= unsigned(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        u |= unsigned(c - 'A' + 10);
+      else
+        fail("Invalid \\u escape");
+    }
+    return u;
+  }
+
+  static void utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+      out += char(cp);
+    } else if (cp < 0x800) {
+      out += char(0xc0 | cp >> 6);
+      out += char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      out += char(0xe0 | cp >> 12);
+      out += char(0x80 | (cp >> 6 & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    } else {
+      out += char(0xf0 | cp >> 18);
+      out += char(0x80 | (cp >> 12 & 0x3f));
+      out += char(0x80 | (cp >> 6 & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    }
+  }
+
+  std::string string() {
+    std::string out;
+    ++p;
+    for (;;) {
+      if (atEnd())
+        fail("Unterminated string");
+      const unsigned char c = static_cast<unsigned char>(*p++);
+      if (c == '"')
+        return out;
+      if (c < 0x20)
+        fail("Control character in string");
+      if (c != '\\') {
+        out += char(c);
+        continue;
+      }
+      if (atEnd())
+        fail("Unterminated string");
+      switch (*p++) {
+        case '"':
+          out += '"';
+          break;
+        case '\\':
+          out += '\\';
+          break;
+        case '/':
+          out += '/';
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          unsigned cp = hex4();
+          // Surrogate pair
+          if (cp >= 0xd800 && cp < 0xdc00 && pos() + 1 < text.size() &&
+              p[0] == '\\' && p[1] == 'u') {
+            p += 2;
+            const unsigned lo = hex4();
+            if (lo < 0xdc00 || lo >= 0xe000)
+              fail("Invalid surrogate pair");
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+          }
+          utf8(out, cp);
+          break;
+        }
+        default:
+          fail("Invalid escape");
+      }
+    }
+  }
+
+  const char* p;
+  const std::string& text;
+};
+
+}  // namespace detail
+
+// Parse a complete JSON text. Throws ParseError.
+inline Value parse(const std::string& text) {
+  return detail::Parser(text).document();
+}
+
+}  // namespace json
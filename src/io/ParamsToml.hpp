@@ -0,0 +1,129 @@
+// ParamsToml.hpp
+#pragma once
+
+#include <cstdlib>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "../geometry/GearParams.hpp"
+
+// Project parameter files (BevelGearParameters_<project>.toml) without Qt,
+// so the CLI, benchmarks and background writers share one implementation.
+// The format is the flat subset written by BevelGearForm: [project], [gear]
+// and [pinion] sections of `key = value` lines.
+
+struct ParamsDocument {
+  std::string projectName;
+  std::string rootDir;
+  std::map<std::string, std::string> gear;
+  std::map<std::string, std::string> pinion;
+};
+
+inline void writeGearSection(std::ostream& out, const BevelGear& g) {
+  out << "numTeeth = " << g.numTeeth << "\n";
+  out << "module = " << g.module << "\n";
+  out << "backlash = " << g.backlash << "\n";
+  out << "shaftAngle = " << g.shaftAngle << "\n";
+  out << "faceConeAngle = " << g.faceConeAngle << "\n";
+  out << "rootConeAngle = " << g.rootConeAngle << "\n";
+  out << "faceConeOffset = " << g.faceConeOffset << "\n";
+  out << "rootConeOffset = " << g.rootConeOffset << "\n";
+  out << "innerConeDistance = " << g.innerConeDistance << "\n";
+  out << "outerConeDistance = " << g.outerConeDistance << "\n";
+  out << "pressureAngle = " << g.pressureAngle << "\n";
+  out << "spiralAngle = " << g.spiralAngle << "\n";
+  out << "spiralType = " << (int)g.spiralType << "\n";
+}
+
+inline void writeParamsToml(std::ostream& out, const std::string& projectName,
+                            const std::string& rootDir, const BevelGear& gear,
+                            const BevelGear& pinion) {
+  // Project section
+  out << "[project]\n";
+  out << "projectName = \"" << projectName << "\"\n";
+  out << "rootDir = \"" << rootDir << "\"\n\n";
+
+  // Gear section
+  out << "[gear]\n";
+  writeGearSection(out, gear);
+  out << "\n";
+
+  // Pinion section
+  out << "[pinion]\n";
+  writeGearSection(out, pinion);
+}
+
+inline std::string trimmed(const std::string& s) {
+  const size_t b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos)
+    return "";
+  const size_t e = s.find_last_not_of(" \t\r\n");
+  return s.substr(b, e - b + 1);
+}
+
+inline ParamsDocument readParamsToml(std::istream& in) {
+  ParamsDocument doc;
+  std::string section, line;
+  while (std::getline(in, line)) {
+    line = trimmed(line);
+    if (line.rfind("[", 0) == 0) {
+      if (line.find("project") != std::string::npos)
+        section = "project";
+      else if (line.find("gear") != std::string::npos)
+        section = "gear";
+      else if (line.find("pinion") != std::string::npos)
+        section = "pinion";
+      continue;
+    }
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos || line.find('=', eq + 1) != std::string::npos)
+      continue;
+    const std::string key = trimmed(line.substr(0, eq));
+    std::string value = trimmed(line.substr(eq + 1));
+    std::string unquoted;
+    for (char c : value) {
+      if (c != '"')
+        unquoted += c;
+    }
+    if (section == "project") {
+      if (key == "projectName")
+        doc.projectName = unquoted;
+      if (key == "rootDir")
+        doc.rootDir = unquoted;
+    } else if (section == "gear") {
+      doc.gear[key] = unquoted;
+    } else if (section == "pinion") {
+      doc.pinion[key] = unquoted;
+    }
+  }
+  return doc;
+}
+
+// Missing or malformed values read as 0, like QString::toDouble()
+inline double paramValue(const std::map<std::string, std::string>& section,
+                         const std::string& key) {
+  auto it = section.find(key);
+  if (it == section.end())
+    return 0;
+  char* end = nullptr;
+  const double v = std::strtod(it->second.c_str(), &end);
+  return end == it->second.c_str() ? 0 : v;
+}
+
+// Rebuild the pair from a document. Gear values define the pair, the pinion
+// section only contributes its tooth count.
+inline BevelGearPair pairFromParams(const ParamsDocument& doc) {
+  const auto& g = doc.gear;
+  return BevelGearPair(
+      static_cast<int>(paramValue(g, "numTeeth")),
+      static_cast<int>(paramValue(doc.pinion, "numTeeth")),
+      paramValue(g, "module"), paramValue(g, "backlash"),
+      paramValue(g, "coneClearance"), paramValue(g, "shaftAngle"),
+      paramValue(g, "faceConeAngle"), paramValue(g, "rootConeAngle"),
+      paramValue(g, "faceConeOffset"), paramValue(g, "rootConeOffset"),
+      paramValue(g, "innerConeDistance"), paramValue(g, "outerConeDistance"),
+      paramValue(g, "pressureAngle"), paramValue(g, "spiralAngle"),
+      static_cast<spiralFunction>(static_cast<int>(paramValue(g, "spiralType"))));
+}
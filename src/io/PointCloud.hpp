@@ -0,0 +1,331 @@
+// PointCloud.hpp
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../geometry/Vec3.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Measured points of a CMM or scanner run (mm), structure of arrays
+struct PointCloud {
+  std::vector<double> x, y, z;
+
+  size_t size() const { return x.size(); }
+  Vec3 point(size_t i) const { return {x[i], y[i], z[i]}; }
+  void push_back(const Vec3& p) {
+    x.push_back(p.x);
+    y.push_back(p.y);
+    z.push_back(p.z);
+  }
+};
+
+// Readers for the formats our measuring machines export:
+//   .ply   binary little endian or ascii, vertex x y z as float or double,
+//          other vertex properties are skipped, as are fixed size elements
+//          declared before the vertices
+//   other  text, one point per line as "x y z" separated by blanks, commas
+//          or semicolons; lines that do not start with three numbers
+//          (headers, comments) are skipped
+// The file is mapped and parsed in parallel blocks, so a scan of millions of
+// points never exists twice in memory as text and as numbers.
+namespace pointcloud {
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot open " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+      void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map " + path);
+      }
+      base = static_cast<const char*>(p);
+      madvise(const_cast<char*>(base), length, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (base)
+      munmap(const_cast<char*>(base), length);
+  }
+
+  const char* data() const { return base; }
+  size_t size() const { return length; }
+
+private:
+  const char* base = nullptr;
+  size_t length = 0;
+};
+
+constexpr size_t blockBytes = size_t(1) << 22;
+
+inline bool isSeparator(char c) {
+  return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+// Parse up to n numbers of one line into v; returns how many were read
+inline int parseLine(const char* p, const char* end, double* v, int n) {
+  int read = 0;
+  while (read < n) {
+    while (p < end && isSeparator(*p))
+      ++p;
+    if (p == end)
+      break;
+    const auto r = std::from_chars(p, end, v[read]);
+    if (r.ec != std::errc())
+      break;
+    p = r.ptr;
+    ++read;
+  }
+  return read;
+}
+
+// Text points of [begin, end); columns picks x, y, z out of each line
+inline void parseText(const char* begin, const char* end, const int* columns,
+                      PointCloud& out) {
+  const int used = 1 + std::max({columns[0], columns[1], columns[2]});
+  double v[16];
+  for (const char* p = begin; p < end;) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+    if (parseLine(p, eol, v, used) == used)
+      out.push_back({v[columns[0]], v[columns[1]], v[columns[2]]});
+    p = eol + 1;
+  }
+}
+
+// Blocks of text split after a newline, parsed in parallel and appended in
+// order
+inline PointCloud readText(const char* data, size_t size, const int* columns,
+                           ThreadPool& pool) {
+  std::vector<size_t> cuts{0};
+  while (cuts.back() < size) {
+    size_t c = std::min(size, cuts.back() + blockBytes);
+    while (c < size && data[c - 1] != '\n')
+      ++c;
+    cuts.push_back(c);
+  }
+  std::vector<PointCloud> blocks(cuts.size() - 1);
+  pool.parallelFor(0, blocks.size(), [&](size_t b) {
+    parseText(data + cuts[b], data + cuts[b + 1], columns, blocks[b]);
+  });
+  PointCloud cloud;
+  size_t n = 0;
+  for (const PointCloud& b : blocks)
+    n += b.size();
+  memory::Reservation held(memory::Category::Geometry,
+                           n * 3 * sizeof(double));
+  cloud.x.reserve(n);
+  cloud.y.reserve(n);
+  cloud.z.reserve(n);
+  for (PointCloud& b : blocks) {
+    cloud.x.insert(cloud.x.end(), b.x.begin(), b.x.end());
+    cloud.y.insert(cloud.y.end(), b.y.begin(), b.y.end());
+    cloud.z.insert(cloud.z.end(), b.z.begin(), b.z.end());
+    b = PointCloud();
+  }
+  return cloud;
+}
+
+inline size_t plyTypeSize(const std::string& type) {
+  if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+    return 1;
+  if (type == "short" || type == "ushort" || type == "int16" ||
+      type == "uint16")
+    return 2;
+  if (type == "int" || type == "uint" || type == "float" || type == "int32" ||
+      type == "uint32" || type == "float32")
+    return 4;
+  if (type == "double" || type == "float64")
+    return 8;
+  return 0;
+}
+
+inline PointCloud readPly(const char* data, size_t size,
+                          const std::string& path, ThreadPool& pool) {
+  const size_t e = std::string_view(data, std::min(size, size_t(1) << 16))
+                      .find("end_header");
+  if (std::strncmp(data, "ply", std::min<size_t>(size, 3)) != 0 ||
+      e == std::string_view::npos) {
+    throw std::runtime_error("Not a PLY file: " + path);
+  }
+  const char* h = data + e;
+  const char* body = static_cast<const char*>(
+      std::memchr(h, '\n', data + size - h));
+  body = body ? body + 1 : data + size;
+
+  std::istringstream header(std::string(data, h - data));
+  std::string line, format;
+  size_t vertices = 0, stride = 0;
+  bool inVertex = false, seenVertex = false;
+  // Elements declared before the vertices, their data comes first
+  struct Element {
+    size_t count = 0, stride = 0;
+    bool list = false;
+  };
+  std::vector<Element> leading;
+  int columns[3] = {-1, -1, -1};
+  size_t offsets[3] = {0, 0, 0};
+  bool doubles[3] = {false, false, false};
+  int property = 0;
+  while (std::getline(header, line)) {
+    std::istringstream words(line);
+    std::string key;
+    words >> key;
+    if (key == "format") {
+      words >> format;
+    } else if (key == "element") {
+      std::string name;
+      words >> name;
+      inVertex = name == "vertex";
+      if (inVertex) {
+        words >> vertices;
+        seenVertex = true;
+      } else if (!seenVertex) {
+        leading.emplace_back();
+        words >> leading.back().count;
+      }
+    } else if (key == "property" && !inVertex && !seenVertex &&
+               !leading.empty()) {
+      std::string type;
+      words >> type;
+      const size_t bytes = plyTypeSize(type);
+      leading.back().list |= bytes == 0;
+      leading.back().stride += bytes;
+    } else if (key == "property" && inVertex) {
+      std::string type, name;
+      words >> type >> name;
+      const size_t bytes = plyTypeSize(type);
+      if (type == "list" || bytes == 0)
+        throw std::runtime_error("Unsupported PLY vertex property: " + path);
+      const int axis = name == "x"   ? 0
+                       : name == "y" ? 1
+                       : name == "z" ? 2
+                                     : -1;
+      if (axis >= 0) {
+        if (type.compare(0, 5, "float") != 0 && type != "double")
+          throw std::runtime_error("PLY coordinates must be float: " + path);
+        columns[axis] = property;
+        offsets[axis] = stride;
+        doubles[axis] = bytes == 8;
+      }
+      stride += bytes;
+      ++property;
+    }
+  }
+  if (columns[0] < 0 || columns[1] < 0 || columns[2] < 0)
+    throw std::runtime_error("PLY file has no vertex x y z: " + path);
+
+  if (format == "ascii") {
+    if (property > 16)
+      throw std::runtime_error("Too many PLY vertex properties: " + path);
+    for (const Element& el : leading) {
+      for (size_t i = 0; i < el.count && body < data + size; ++i) {
+        const char* eol = static_cast<const char*>(
+            std::memchr(body, '\n', data + size - body));
+        body = eol ? eol + 1 : data + size;
+      }
+    }
+    PointCloud cloud = readText(body, data + size - body, columns, pool);
+    cloud.x.resize(std::min(cloud.size(), vertices));
+    cloud.y.resize(cloud.x.size());
+    cloud.z.resize(cloud.x.size());
+    return cloud;
+  }
+  if (format != "binary_little_endian")
+    throw std::runtime_error("Unsupported PLY format " + format + ": " + path);
+  for (const Element& el : leading) {
+    if (el.count == 0)
+      continue;
+    if (el.list) {
+      throw std::runtime_error(
+          "PLY elements before the vertices must have fixed size: " + path);
+    }
+    if (el.stride && el.count > size_t(data + size - body) / el.stride)
+      throw std::runtime_error("Truncated PLY file: " + path);
+    body += el.count * el.stride;
+  }
+  // Divide rather than multiply, a bogus vertex count must not overflow
+  if (vertices > size_t(data + size - body) / stride)
+    throw std::runtime_error("Truncated PLY file: " + path);
+
+  memory::Reservation held(memory::Category::Geometry,
+                           vertices * 3 * sizeof(double));
+  PointCloud cloud;
+  cloud.x.resize(vertices);
+  cloud.y.resize(vertices);
+  cloud.z.resize(vertices);
+  double* out[3] = {cloud.x.data(), cloud.y.data(), cloud.z.data()};
+  const size_t perBlock = std::max<size_t>(1, blockBytes / stride);
+  pool.parallelFor(0, (vertices + perBlock - 1) / perBlock, [&](size_t b) {
+    const size_t lo = b * perBlock, hi = std::min(vertices, lo + perBlock);
+    for (size_t i = lo; i < hi; ++i) {
+      const char* v = body + i * stride;
+      for (int a = 0; a < 3; ++a) {
+        if (doubles[a]) {
+          std::memcpy(&out[a][i], v + offsets[a], 8);
+        } else {
+          float f;
+          std::memcpy(&f, v + offsets[a], 4);
+          out[a][i] = f;
+        }
+      }
+    }
+  });
+  return cloud;
+}
+
+inline bool hasExtension(const std::string& path, const char* ext) {
+  const size_t n = std::strlen(ext);
+  if (path.size() < n)
+    return false;
+  for (size_t i = 0; i < n; ++i) {
+    if (std::tolower(path[path.size() - n + i]) != ext[i])
+      return false;
+  }
+  return true;
+}
+
+inline PointCloud read(const std::string& path,
+                       ThreadPool& pool = ThreadPool::shared()) {
+  GEARLAB_TRACE_SCOPE("pointcloud.read");
+  const MappedFile file(path);
+  if (hasExtension(path, ".ply"))
+    return readPly(file.data(), file.size(), path, pool);
+  static const int xyz[3] = {0, 1, 2};
+  return readText(file.data(), file.size(), xyz, pool);
+}
+
+}  // namespace pointcloud
@@ -0,0 +1,204 @@
+// ResultQuery.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/TaskGraph.hpp"
+#include "ResultStore.hpp"
+
+// Filter and sort specification for a result table view
+struct ResultQuery {
+  int filterColumn = -1;  // -1 disables the range filter
+  double filterMin = -std::numeric_limits<double>::infinity();
+  double filterMax = std::numeric_limits<double>::infinity();
+  int sortColumn = -1;  // -1 keeps file order
+  bool descending = false;
+};
+
+// Row indices of the table that pass the filter, in sorted order. Runs on the
+// pool: the filter is evaluated per chunk, chunks are sorted in parallel and
+// then merged pairwise. Throws JobCancelled when the token fires and
+// memory::BudgetExceeded when the row view does not fit the current budget.
+inline std::vector<uint32_t> runResultQuery(
+    const ResultTable& table, const ResultQuery& q, ThreadPool& pool,
+    const CancellationToken& token = CancellationToken()) {
+  GEARLAB_TRACE_SCOPE("resultQuery");
+  const size_t n = table.rowCount();
+  if (n > std::numeric_limits<uint32_t>::max())
+    throw std::length_error("Result table too large for a 32 bit row view");
+  // Filtered parts and the final view can both be alive during the copy
+  memory::Reservation held = memory::Reservation::require(
+      memory::Category::ResultBuffer, 2 * n * sizeof(uint32_t));
+  const size_t numChunks = std::max<size_t>(1, pool.size() * 4);
+  const size_t chunk = (n + numChunks - 1) / numChunks;
+
+  // Filter, keeping per-chunk results so order is preserved
+  std::vector<std::vector<uint32_t>> parts(numChunks);
+  pool.parallelFor(0, numChunks, [&](size_t c) {
+    const size_t b = c * chunk, e = std::min(n, b + chunk);
+    auto& out = parts[c];
+    out.reserve(e > b ? e - b : 0);
+    for (size_t r = b; r < e; ++r) {
+      if ((r & 0xffff) == 0 && token.isCancelled())
+        return;
+      if (q.filterColumn >= 0) {
+        const double v = table.value(r, q.filterColumn);
+        if (!(v >= q.filterMin && v <= q.filterMax))
+          continue;
+      }
+      out.push_back(static_cast<uint32_t>(r));
+    }
+  });
+  if (token.isCancelled())
+    throw JobCancelled();
+
+  std::vector<size_t> bounds{0};
+  for (const auto& p : parts)
+    bounds.push_back(bounds.back() + p.size());
+  std::vector<uint32_t> rows(bounds.back());
+  pool.parallelFor(0, numChunks, [&](size_t c) {
+    std::copy(parts[c].begin(), parts[c].end(), rows.begin() + bounds[c]);
+    std::vector<uint32_t>().swap(parts[c]);
+  });
+  if (q.sortColumn < 0)
+    return rows;
+
+  const size_t col = static_cast<size_t>(q.sortColumn);
+  auto less = [&](uint32_t a, uint32_t b) {
+    const double va = table.value(a, col), vb = table.value(b, col);
+    return q.descending ? vb < va : va < vb;
+  };
+  // Sort each run in parallel, then merge neighbouring runs until one is left
+  pool.parallelFor(0, numChunks, [&](size_t c) {
+    std::stable_sort(rows.begin() + bounds[c], rows.begin() + bounds[c + 1],
+                     less);
+  });
+  for (size_t width = 1; width < numChunks; width *= 2) {
+    if (token.isCancelled())
+      throw JobCancelled();
+    const size_t merges = (numChunks + 2 * width - 1) / (2 * width);
+    pool.parallelFor(0, merges, [&](size_t m) {
+      const size_t lo = m * 2 * width;
+      const size_t mid = std::min(lo + width, numChunks);
+      const size_t hi = std::min(lo + 2 * width, numChunks);
+      std::inplace_merge(rows.begin() + bounds[lo], rows.begin() + bounds[mid],
+                         rows.begin() + bounds[hi], less);
+    });
+  }
+  return rows;
+}
+
+// One objective of a Pareto query
+struct ParetoObjective {
+  size_t column;
+  bool maximize = false;
+};
+
+// Rows no other row dominates (at least as good in every objective and
+// better in one), from `rows` if given (e.g. the valid designs selected by
+// runResultQuery) or the whole table. Rows with a NaN objective are
+// skipped; equal rows on the front are all kept. Returned best first in the
+// first objective.
+//
+// Candidates are sorted lexicographically, so a dominating row always comes
+// first and only the front found so far needs checking. Two objectives
+// reduce to a running minimum of the second, O(n log n).
+inline std::vector<uint32_t> runParetoQuery(
+    const ResultTable& table, const std::vector<ParetoObjective>& objectives,
+    const std::vector<uint32_t>* rows, ThreadPool& pool,
+    const CancellationToken& token = CancellationToken()) {
+  GEARLAB_TRACE_SCOPE("paretoQuery");
+  const size_t k = objectives.size();
+  if (k == 0)
+    throw std::invalid_argument("Pareto query needs an objective");
+  for (const ParetoObjective& o : objectives) {
+    if (o.column >= table.columnCount())
+      throw std::out_of_range("Pareto objective column out of range");
+  }
+  const size_t n = rows ? rows->size() : table.rowCount();
+  if (n > std::numeric_limits<uint32_t>::max())
+    throw std::length_error("Result table too large for a 32 bit row view");
+  memory::Reservation held = memory::Reservation::require(
+      memory::Category::ResultBuffer,
+      n * (k * sizeof(double) + 2 * sizeof(uint32_t)));
+
+  // Objective values, negated where larger is better
+  std::vector<double> key(n * k);
+  std::vector<char> usable(n);
+  pool.parallelFor(
+      0, n,
+      [&](size_t i) {
+        const uint32_t r = rows ? (*rows)[i] : uint32_t(i);
+        bool ok = true;
+        for (size_t j = 0; j < k; ++j) {
+          const double v = table.value(r, objectives[j].column);
+          key[i * k + j] = objectives[j].maximize ? -v : v;
+          ok &= !std::isnan(v);
+        }
+        usable[i] = ok;
+      },
+      4096);
+  if (token.isCancelled())
+    throw JobCancelled();
+
+  std::vector<uint32_t> order;
+  order.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (usable[i])
+      order.push_back(uint32_t(i));
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return std::lexicographical_compare(&key[a * k], &key[a * k + k],
+                                        &key[b * k], &key[b * k + k]);
+  });
+
+  std::vector<uint32_t> front;
+  if (k <= 2) {
+    const size_t j = k - 1;
+    // The first row is always on the front, even with an infinite value,
+    // so it seeds the best values rather than an infinite sentinel
+    bool first = true;
+    double best = 0, bestFirst = 0;
+    for (uint32_t i : order) {
+      const double* c = &key[i * k];
+      // Earlier rows are no worse in the first objective
+      if (first || c[j] < best || (c[j] == best && c[0] == bestFirst)) {
+        if (first || c[j] < best) {
+          best = c[j];
+          bestFirst = c[0];
+          first = false;
+        }
+        front.push_back(i);
+      }
+    }
+  } else {
+    for (size_t s = 0; s < order.size(); ++s) {
+      if ((s & 0xffff) == 0 && token.isCancelled())
+        throw JobCancelled();
+      const double* c = &key[order[s] * k];
+      bool dominated = false;
+      for (size_t f = 0; f < front.size() && !dominated; ++f) {
+        const double* d = &key[front[f] * k];
+        bool noWorse = true, better = false;
+        for (size_t j = 0; j < k && noWorse; ++j) {
+          noWorse = d[j] <= c[j];
+          better |= d[j] < c[j];
+        }
+        dominated = noWorse && better;
+      }
+      if (!dominated)
+        front.push_back(order[s]);
+    }
+  }
+  if (rows) {
+    for (uint32_t& i : front)
+      i = (*rows)[i];
+  }
+  return front;
+}
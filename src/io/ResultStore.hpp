@@ -0,0 +1,261 @@
+// ResultStore.hpp
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../pipeline/Trace.hpp"
+
+// Read-only tabular view of numeric results (one row per design or sample).
+// Implemented by the on-disk stores so viewers and exporters do not depend on
+// a particular format.
+class ResultTable {
+public:
+  virtual ~ResultTable() = default;
+  virtual size_t rowCount() const = 0;
+  virtual size_t columnCount() const = 0;
+  virtual std::string columnName(size_t column) const = 0;
+  virtual double value(size_t row, size_t column) const = 0;
+};
+
+// Columnar result file (.glr). All columns are float64 and stored
+// contiguously, so a reader can mmap the file and index any cell without
+// loading it.
+//
+//   Header            magic "GLRSTOR1", row count, column count
+//   ColumnDesc[n]     name + byte offset of the column data
+//   column data       rowCount doubles per column, 64 byte aligned
+namespace resultstore {
+
+constexpr char magic[8] = {'G', 'L', 'R', 'S', 'T', 'O', 'R', '1'};
+constexpr size_t alignment = 64;
+constexpr size_t maxNameLength = 47;
+
+struct Header {
+  char magic[8];
+  uint64_t numRows;
+  uint32_t numColumns;
+  uint32_t reserved;
+};
+
+struct ColumnDesc {
+  char name[maxNameLength + 1];
+  uint64_t offset;
+};
+
+inline uint64_t alignUp(uint64_t v) {
+  return (v + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace resultstore
+
+// Streams rows into per-column spill files so memory stays constant however
+// many rows are written, then assembles the final file on finish() and moves
+// it into place with an atomic rename.
+class ResultStoreWriter {
+public:
+  ResultStoreWriter(std::string path, std::vector<std::string> columns)
+      : path(std::move(path)), names(std::move(columns)) {
+    if (names.empty())
+      throw std::invalid_argument("Result store needs at least one column");
+    for (const std::string& name : names) {
+      if (name.size() > resultstore::maxNameLength)
+        throw std::invalid_argument("Column name too long: " + name);
+    }
+    spills.reserve(names.size());
+    for (size_t c = 0; c < names.size(); ++c) {
+      FILE* f = std::fopen(spillPath(c).c_str(), "wb");
+      if (!f) {
+        // The destructor does not run, remove what was created so far
+        const size_t created = spills.size();
+        closeSpills();
+        for (size_t k = 0; k < created; ++k)
+          std::remove(spillPath(k).c_str());
+        throw std::runtime_error("Cannot create " + spillPath(c));
+      }
+      spills.push_back(f);
+    }
+  }
+
+  ResultStoreWriter(const ResultStoreWriter&) = delete;
+  ResultStoreWriter& operator=(const ResultStoreWriter&) = delete;
+
+  ~ResultStoreWriter() {
+    if (!finished) {
+      closeSpills();
+      removeSpills();
+    }
+  }
+
+  size_t columnCount() const { return names.size(); }
+  uint64_t rowCount() const { return rows; }
+
+  // Append one row, values in column order
+  void addRow(const double* values) {
+    for (size_t c = 0; c < spills.size(); ++c) {
+      if (std::fwrite(&values[c], sizeof(double), 1, spills[c]) != 1)
+        throw std::runtime_error("Write failed for " + path);
+    }
+    ++rows;
+  }
+
+  void addRow(const std::vector<double>& values) {
+    if (values.size() != names.size())
+      throw std::invalid_argument("Row has wrong number of columns");
+    addRow(values.data());
+  }
+
+  // Write header and columns, then atomically replace the target file
+  void finish() {
+    GEARLAB_TRACE_SCOPE("export.resultStore");
+    using namespace resultstore;
+    closeSpills();
+    const std::string tmp = path + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out)
+      throw std::runtime_error("Cannot create " + tmp);
+
+    Header h{};
+    std::memcpy(h.magic, resultstore::magic, sizeof(h.magic));
+    h.numRows = rows;
+    h.numColumns = static_cast<uint32_t>(names.size());
+    std::vector<ColumnDesc> descs(names.size());
+    uint64_t offset = alignUp(sizeof(Header) + descs.size() * sizeof(ColumnDesc));
+    for (size_t c = 0; c < names.size(); ++c) {
+      std::memset(descs[c].name, 0, sizeof(descs[c].name));
+      std::memcpy(descs[c].name, names[c].data(), names[c].size());
+      descs[c].offset = offset;
+      offset = alignUp(offset + rows * sizeof(double));
+    }
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, out) == 1 &&
+              std::fwrite(descs.data(), sizeof(ColumnDesc), descs.size(),
+                          out) == descs.size();
+    std::vector<char> buffer(1 << 20);
+    for (size_t c = 0; c < names.size() && ok; ++c) {
+      ok = std::fseek(out, static_cast<long>(descs[c].offset), SEEK_SET) == 0;
+      FILE* in = std::fopen(spillPath(c).c_str(), "rb");
+      ok = ok && in;
+      size_t n;
+      while (ok && (n = std::fread(buffer.data(), 1, buffer.size(), in)) > 0)
+        ok = std::fwrite(buffer.data(), 1, n, out) == n;
+      if (in)
+        std::fclose(in);
+    }
+    // Pad the last column so the file size covers the aligned layout,
+    // unless its data already ends on the boundary
+    if (ok && std::ftell(out) < static_cast<long>(offset)) {
+      ok = std::fseek(out, static_cast<long>(offset - 1), SEEK_SET) == 0 &&
+           std::fputc(0, out) != EOF;
+    }
+    ok = std::fflush(out) == 0 && fsync(fileno(out)) == 0 && ok;
+    ok = std::fclose(out) == 0 && ok;
+    removeSpills();
+    finished = true;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+      std::remove(tmp.c_str());
+      throw std::runtime_error("Failed to write " + path);
+    }
+  }
+
+private:
+  std::string spillPath(size_t c) const {
+    return path + ".col" + std::to_string(c) + ".tmp";
+  }
+
+  void closeSpills() {
+    for (FILE* f : spills)
+      std::fclose(f);
+    spills.clear();
+  }
+
+  void removeSpills() {
+    for (size_t c = 0; c < names.size(); ++c)
+      std::remove(spillPath(c).c_str());
+  }
+
+  std::string path;
+  std::vector<std::string> names;
+  std::vector<FILE*> spills;
+  uint64_t rows = 0;
+  bool finished = false;
+};
+
+// Memory-mapped reader of a .glr file. Opening only maps the file; pages
+// are brought in by the OS as cells are read.
+class MappedResultTable : public ResultTable {
+public:
+  explicit MappedResultTable(const std::string& path) {
+    using namespace resultstore;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+      ::close(fd);
+      throw std::runtime_error("Not a result store: " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      throw std::runtime_error("Cannot map " + path);
+    base = static_cast<const char*>(p);
+
+    const Header* h = reinterpret_cast<const Header*>(base);
+    const uint64_t descEnd =
+        sizeof(Header) + uint64_t(h->numColumns) * sizeof(ColumnDesc);
+    if (std::memcmp(h->magic, resultstore::magic, sizeof(h->magic)) != 0 ||
+        descEnd > size) {
+      munmap(const_cast<char*>(base), size);
+      throw std::runtime_error("Not a result store: " + path);
+    }
+    rows = h->numRows;
+    const ColumnDesc* d =
+        reinterpret_cast<const ColumnDesc*>(base + sizeof(Header));
+    for (uint32_t c = 0; c < h->numColumns; ++c) {
+      if (d[c].offset + rows * sizeof(double) > size) {
+        munmap(const_cast<char*>(base), size);
+        throw std::runtime_error("Truncated result store: " + path);
+      }
+      names.emplace_back(d[c].name, strnlen(d[c].name, sizeof(d[c].name)));
+      columns.push_back(reinterpret_cast<const double*>(base + d[c].offset));
+    }
+    // Rows are mostly read in order by viewers and exporters
+    madvise(const_cast<char*>(base), size, MADV_SEQUENTIAL);
+  }
+
+  MappedResultTable(const MappedResultTable&) = delete;
+  MappedResultTable& operator=(const MappedResultTable&) = delete;
+
+  ~MappedResultTable() override { munmap(const_cast<char*>(base), size); }
+
+  size_t rowCount() const override { return rows; }
+  size_t columnCount() const override { return columns.size(); }
+  std::string columnName(size_t column) const override {
+    return names.at(column);
+  }
+  double value(size_t row, size_t column) const override {
+    return columns[column][row];
+  }
+
+  // Direct access to a whole column for vectorized scans
+  const double* column(size_t c) const { return columns.at(c); }
+
+private:
+  const char* base = nullptr;
+  size_t size = 0;
+  size_t rows = 0;
+  std::vector<std::string> names;
+  std::vector<const double*> columns;
+};
@@ -0,0 +1,223 @@
+// UnixSocketServer.hpp
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "../pipeline/Trace.hpp"
+
+// Newline delimited request/response server on a Unix domain socket. Every
+// connection gets a thread that reads lines, hands each to the handler and
+// writes the returned text back followed by a newline (nothing for an empty
+// return). Connections are independent, so requests from different clients
+// reach the handler concurrently; the handler must be thread safe.
+//
+// serve() blocks until stop() is called. stop() only writes to a pipe and
+// is safe to call from a signal handler.
+class UnixSocketServer {
+public:
+  using Handler = std::function<std::string(const std::string& line)>;
+
+  // Largest request line; longer ones close the connection
+  static constexpr size_t maxLine = 64 << 20;
+
+  // Binds and listens. A stale socket file left by a dead server is
+  // replaced; a live one is an error. Throws std::system_error.
+  UnixSocketServer(const std::string& path, Handler handler)
+      : socketPath(path), handler(std::move(handler)) {
+    sockaddr_un addr = address(path);
+    if (isLive(addr))
+      throw std::runtime_error("Socket already in use: " + path);
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+      ::unlink(path.c_str());
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+      throw std::system_error(errno, std::generic_category(), "socket");
+    const sockaddr* sa = reinterpret_cast<const sockaddr*>(&addr);
+    if (::bind(listenFd, sa, sizeof(addr)) < 0 ||
+        ::listen(listenFd, 64) < 0) {
+      const int err = errno;
+      ::close(listenFd);
+      throw std::system_error(err, std::generic_category(), "bind " + path);
+    }
+    if (::pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK) < 0) {
+      const int err = errno;
+      ::close(listenFd);
+      ::unlink(path.c_str());
+      throw std::system_error(err, std::generic_category(), "pipe");
+    }
+  }
+
+  ~UnixSocketServer() {
+    closeConnections();
+    ::close(listenFd);
+    ::close(wakeFds[0]);
+    ::close(wakeFds[1]);
+    ::unlink(socketPath.c_str());
+  }
+
+  UnixSocketServer(const UnixSocketServer&) = delete;
+  UnixSocketServer& operator=(const UnixSocketServer&) = delete;
+
+  const std::string& path() const { return socketPath; }
+
+  // Accept connections until stop(). Open connections are shut down and
+  // their threads joined before returning.
+  void serve() {
+    for (;;) {
+      pollfd fds[2] = {{listenFd, POLLIN, 0}, {wakeFds[0], POLLIN, 0}};
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        throw std::system_error(errno, std::generic_category(), "poll");
+      }
+      if (fds[1].revents)
+        break;
+      if (!(fds[0].revents & POLLIN))
+        continue;
+      const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0)
+        continue;
+      reapFinished();
+      std::lock_guard<std::mutex> lock(mutex);
+      connections.emplace_back(std::make_unique<Connection>());
+      Connection* c = connections.back().get();
+      c->fd = fd;
+      c->thread = std::thread([this, c] { session(*c); });
+    }
+    closeConnections();
+  }
+
+  void stop() {
+    const char c = 0;
+    [[maybe_unused]] const ssize_t n = ::write(wakeFds[1], &c, 1);
+  }
+
+  size_t connectionCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return connections.size();
+  }
+
+private:
+  struct Connection {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> finished{false};
+  };
+
+  static sockaddr_un address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+      throw std::invalid_argument("Invalid socket path: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+  }
+
+  static bool isLive(const sockaddr_un& addr) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return false;
+    const bool live = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr),
+                                sizeof(addr)) == 0;
+    ::close(fd);
+    return live;
+  }
+
+  static bool sendAll(int fd, const char* data, size_t n) {
+    while (n > 0) {
+      const ssize_t w = ::send(fd, data, n, MSG_NOSIGNAL);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w <= 0)
+        return false;
+      data += w;
+      n -= size_t(w);
+    }
+    return true;
+  }
+
+  void session(Connection& c) {
+    trace::setThreadName("connection");
+    std::string buffer, reply;
+    char chunk[64 * 1024];
+    for (;;) {
+      const ssize_t n = ::recv(c.fd, chunk, sizeof(chunk), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      buffer.append(chunk, size_t(n));
+      size_t start = 0, end;
+      bool ok = true;
+      while (ok && (end = buffer.find('\n', start)) != std::string::npos) {
+        const std::string line = buffer.substr(start, end - start);
+        start = end + 1;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+          continue;
+        reply = handler(line);
+        if (!reply.empty()) {
+          reply += '\n';
+          ok = sendAll(c.fd, reply.data(), reply.size());
+        }
+      }
+      buffer.erase(0, start);
+      if (!ok || buffer.size() > maxLine)
+        break;
+    }
+    ::shutdown(c.fd, SHUT_RDWR);
+    c.finished = true;
+  }
+
+  void reapFinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = connections.begin(); it != connections.end();) {
+      if ((*it)->finished) {
+        (*it)->thread.join();
+        ::close((*it)->fd);
+        it = connections.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void closeConnections() {
+    std::list<std::unique_ptr<Connection>> open;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      open.swap(connections);
+    }
+    for (auto& c : open) {
+      // Wakes a session blocked in recv; one inside the handler finishes
+      // its request first
+      ::shutdown(c->fd, SHUT_RDWR);
+      c->thread.join();
+      ::close(c->fd);
+    }
+  }
+
+  std::string socketPath;
+  Handler handler;
+  int listenFd = -1;
+  int wakeFds[2] = {-1, -1};
+  std::mutex mutex;
+  std::list<std::unique_ptr<Connection>> connections;
+};
@@ -0,0 +1,62 @@
+#include <QApplication>
+#include <QMainWindow>
+#include <QVBoxLayout>
+#include <QWidget>
+#include <string>
+
+#include "cli/Cli.hpp"
+#include "pipeline/Trace.hpp"
+#include "ui/BevelGearForm.hpp"
+#include "ui/OutputDirSelect.hpp"
+
+int main(int argc, char* argv[]) {
+  // Command line jobs run without a QApplication
+  if (argc > 1 && cli::isCommand(argv[1]))
+    return cli::run(argc, argv);
+
+  QApplication app(argc, argv);
+
+  // --trace=file.json or GEARLAB_TRACE=file.json records a Chrome trace
+  // until the app exits
+  std::string tracePath = trace::enableFromEnvironment();
+  for (const QString& arg : app.arguments()) {
+    if (arg.startsWith("--trace="))
+      tracePath = arg.mid(8).toStdString();
+  }
+  trace::setEnabled(!tracePath.empty());
+  trace::setThreadName("ui");
+
+  QMainWindow mainWindow;
+  mainWindow.setWindowTitle("GearLab");
+
+  QWidget* centralWidget = new QWidget(&mainWindow);
+  QVBoxLayout* layout = new QVBoxLayout(centralWidget);
+
+  OutputDirSelect* dirSelector = new OutputDirSelect(centralWidget);
+  layout->addWidget(dirSelector);
+
+  QObject::connect(dirSelector, &OutputDirSelect::directoryConfirmed,
+                   [&](const QString& dir, const QString& projectName,
+                       const bool& import, const QString& filePath) {
+                     dirSelector->hide();
+
+                     BevelGearForm* gearForm = new BevelGearForm(centralWidget);
+                     if (import)
+                       gearForm->importParametersFromDirSelect(filePath);
+
+                     gearForm->setRootDir(dir);
+                     gearForm->setProjectName(projectName);
+
+                     layout->addWidget(gearForm);
+                   });
+
+  centralWidget->setLayout(layout);
+  mainWindow.setCentralWidget(centralWidget);
+  mainWindow.resize(1200, 800);
+  mainWindow.show();
+
+  const int status = app.exec();
+  if (!tracePath.empty())
+    trace::dumpChromeTrace(tracePath);
+  return status;
+}
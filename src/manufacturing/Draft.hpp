@@ -0,0 +1,402 @@
+// Draft.hpp
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "../geometry/BevelGear.hpp"
+#include "../geometry/GearSurface.hpp"
+#include "../pipeline/MemoryAccounting.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Demouldability of injection moulded and forged gears. Every face of the
+// gear surface mesh releases with the mould (or die) half on its side of a
+// planar parting surface normal to the gear axis: faces above the plane are
+// pulled along +z, faces below along -z. The draft of a face is the angle
+// between its outward normal and the pull plane, asin(n . pull); negative
+// draft is an undercut, draft below BevelMacroGeometry::draftAngle is flagged.
+//
+// A face that faces its pull but has part material in front of it along the
+// pull is trapped as well; height maps of the top and bottom surface, rastered
+// once per run, decide that.
+//
+// The pull direction is the gear axis: teeth all around the axis rule out any
+// tilted pull. The parting plane is chosen from a height histogram of the
+// faces, minimising undercut area and then below draft area, both computed
+// per height with prefix sums. Face loops run over the structure-of-arrays
+// mesh in chunks on the pool, rastering in bands of pixel rows.
+
+enum class DraftStatus : uint8_t { Ok, BelowDraft, Undercut };
+
+struct DraftOptions {
+  double draftAngle = 1.0;  // Required draft (deg)
+  double undercutTolerance = 1e-3;  // Draft (deg) still counted as vertical
+  int partingCandidates = 512;
+  double pixelSize = 0.2;  // Height map resolution (mm)
+  GearSurfaceOptions surface;
+};
+
+struct DraftResult {
+  Vec3 pull{0, 0, 1};  // Pull of the upper half, the lower one is -pull
+  double partingZ = 0;
+  double requiredDraft = 0;  // deg
+  std::vector<float> draft;  // Per face (deg), same indexing as the mesh
+  std::vector<DraftStatus> status;
+  double totalArea = 0;
+  double undercutArea = 0;
+  double belowDraftArea = 0;
+  double minDraft = 0;  // deg
+  double pixelSize = 0;  // Height map pixel used (mm), coarser than asked
+                         // when the job budget is tight
+  std::array<double, numSurfaceRegions> regionUndercutArea{};
+  std::array<double, numSurfaceRegions> regionBelowDraftArea{};
+
+  size_t undercutFaces() const {
+    return std::count(status.begin(), status.end(), DraftStatus::Undercut);
+  }
+  size_t belowDraftFaces() const {
+    return std::count(status.begin(), status.end(), DraftStatus::BelowDraft);
+  }
+};
+
+class DraftAnalysis {
+public:
+  DraftAnalysis(const BevelGear& gear, DraftOptions options = {})
+      : opt(options), surface(gear, opt.surface) {
+    if (opt.draftAngle < 0 || opt.draftAngle >= 90 ||
+        opt.partingCandidates < 2 || opt.pixelSize <= 0) {
+      throw std::invalid_argument("Invalid draft options");
+    }
+  }
+
+  // Required draft and bore from the macro geometry
+  DraftAnalysis(const BevelGear& gear, const BevelMacroGeometry& macro,
+                DraftOptions options = {})
+      : DraftAnalysis(gear, fromMacro(macro, options)) {}
+
+  static bool applies(ManufacturingMethod m) {
+    return m == ManufacturingMethod::InjectionMoulding ||
+           m == ManufacturingMethod::Forging;
+  }
+
+  const GearSurface& gearSurface() const { return surface; }
+
+  DraftResult run(ThreadPool& pool = ThreadPool::shared()) const {
+    return run(surface.build(pool), pool);
+  }
+
+  DraftResult run(const GearSurfaceMesh& m,
+                  ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("draft.run");
+    const size_t n = m.size();
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             n * (4 * sizeof(double) + sizeof(float) +
+                                  sizeof(DraftStatus)));
+    std::vector<double> area(n), sinDraft(n), height(n);
+    const size_t chunks = (n + chunk - 1) / chunk;
+
+    // Unit normal z component, area and centroid height per face. The
+    // length is clamped rather than tested so the loop has no branch; a
+    // degenerate face has nz = 0 and no draft. Results go through local
+    // arrays so the loop needs no alias checks against the vertex arrays,
+    // and the height range is taken from them afterwards.
+    double zLo = HUGE_VAL, zHi = -HUGE_VAL;
+    std::vector<double> chunkLo(chunks), chunkHi(chunks);
+    pool.parallelFor(0, chunks, [&](size_t c) {
+      double a[block], s[block], z[block];
+      double lo = HUGE_VAL, hi = -HUGE_VAL;
+      const size_t e = std::min(n, (c + 1) * chunk);
+      for (size_t b = c * chunk; b < e; b += block) {
+        const size_t count = std::min(block, e - b);
+        for (size_t j = 0; j < count; ++j) {
+          const size_t i = b + j;
+          const double ux = m.bx[i] - m.ax[i], uy = m.by[i] - m.ay[i],
+                       uz = m.bz[i] - m.az[i];
+          const double vx = m.cx[i] - m.ax[i], vy = m.cy[i] - m.ay[i],
+                       vz = m.cz[i] - m.az[i];
+          const double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz,
+                       nz = ux * vy - uy * vx;
+          const double len = std::sqrt(nx * nx + ny * ny + nz * nz);
+          a[j] = 0.5 * len;
+          s[j] = nz / std::max(len, std::numeric_limits<double>::min());
+          z[j] = (m.az[i] + m.bz[i] + m.cz[i]) / 3;
+        }
+        for (size_t j = 0; j < count; ++j) {
+          lo = std::min(lo, z[j]);
+          hi = std::max(hi, z[j]);
+        }
+        std::copy(a, a + count, area.begin() + b);
+        std::copy(s, s + count, sinDraft.begin() + b);
+        std::copy(z, z + count, height.begin() + b);
+      }
+      chunkLo[c] = lo;
+      chunkHi[c] = hi;
+    });
+    for (size_t c = 0; c < chunks; ++c) {
+      zLo = std::min(zLo, chunkLo[c]);
+      zHi = std::max(zHi, chunkHi[c]);
+    }
+
+    DraftResult r;
+    r.requiredDraft = opt.draftAngle;
+    r.partingZ = partingPlane(area, sinDraft, height, zLo, zHi, pool);
+    const HeightMaps maps = raster(m, pool);
+    r.pixelSize = maps.pixel;
+    classify(m, area, sinDraft, height, maps, r, pool);
+    return r;
+  }
+
+private:
+  static constexpr size_t chunk = 4096;
+  static constexpr size_t block = 256;  // Faces per vectorised pass
+  static constexpr int band = 16;  // Pixel rows per raster task
+
+  // Highest and lowest surface point per pixel centre
+  struct HeightMaps {
+    int size = 0;
+    double origin = 0, pixel = 1;
+    std::vector<float> top, bottom;
+    memory::Reservation held;  // Charge of top and bottom
+
+    int index(double v) const {
+      return std::clamp(int(std::floor((v - origin) / pixel)), 0, size - 1);
+    }
+    double centre(int i) const { return origin + (i + 0.5) * pixel; }
+  };
+
+  HeightMaps raster(const GearSurfaceMesh& m, ThreadPool& pool) const {
+    GEARLAB_TRACE_SCOPE("draft.raster");
+    const size_t n = m.size();
+    double extent = 0;
+    for (size_t i = 0; i < n; ++i) {
+      extent = std::max({extent, std::fabs(m.ax[i]), std::fabs(m.ay[i]),
+                         std::fabs(m.bx[i]), std::fabs(m.by[i]),
+                         std::fabs(m.cx[i]), std::fabs(m.cy[i])});
+    }
+    // Under a job budget that cannot hold both maps the pixel is doubled
+    // until they fit
+    auto side = [&](double pixel) {
+      return std::max(1, int(std::ceil(2 * extent / pixel)) + 1);
+    };
+    auto bytes = [&](int size) {
+      return 2 * sizeof(float) * size_t(size) * size;
+    };
+    HeightMaps h;
+    h.pixel = opt.pixelSize;
+    const memory::Budget* budget = memory::currentBudget();
+    while (budget && !budget->fits(bytes(side(h.pixel))) && side(h.pixel) > 1)
+      h.pixel *= 2;
+    h.size = side(h.pixel);
+    h.origin = -0.5 * h.size * h.pixel;
+    h.held = memory::Reservation::require(memory::Category::Mesh,
+                                          bytes(h.size));
+    h.top.assign(size_t(h.size) * h.size, -HUGE_VALF);
+    h.bottom.assign(size_t(h.size) * h.size, HUGE_VALF);
+
+    // Triangles by the bands of rows they touch
+    const int bands = (h.size + band - 1) / band;
+    std::vector<std::vector<uint32_t>> binned(bands);
+    for (size_t i = 0; i < n; ++i) {
+      const double lo = std::min({m.ay[i], m.by[i], m.cy[i]});
+      const double hi = std::max({m.ay[i], m.by[i], m.cy[i]});
+      for (int b = h.index(lo) / band; b <= h.index(hi) / band; ++b)
+        binned[b].push_back(uint32_t(i));
+    }
+
+    pool.parallelFor(0, size_t(bands), [&](size_t b) {
+      const int row0 = int(b) * band, row1 = std::min(h.size, row0 + band);
+      for (uint32_t i : binned[b]) {
+        const double x0 = m.ax[i], y0 = m.ay[i], x1 = m.bx[i], y1 = m.by[i],
+                     x2 = m.cx[i], y2 = m.cy[i];
+        const double det = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        if (std::fabs(det) < 1e-12)
+          continue;  // Parallel to the pull, covers no pixel
+        const int c0 = h.index(std::min({x0, x1, x2}));
+        const int c1 = h.index(std::max({x0, x1, x2}));
+        const int r0 = std::max(row0, h.index(std::min({y0, y1, y2})));
+        const int r1 = std::min(row1 - 1, h.index(std::max({y0, y1, y2})));
+        for (int r = r0; r <= r1; ++r) {
+          const double y = h.centre(r);
+          for (int c = c0; c <= c1; ++c) {
+            const double x = h.centre(c);
+            const double u =
+                ((x - x0) * (y2 - y0) - (x2 - x0) * (y - y0)) / det;
+            const double v =
+                ((x1 - x0) * (y - y0) - (x - x0) * (y1 - y0)) / det;
+            if (u < 0 || v < 0 || u + v > 1)
+              continue;
+            const float z = float(m.az[i] + u * (m.bz[i] - m.az[i]) +
+                                  v * (m.cz[i] - m.az[i]));
+            const size_t p = size_t(r) * h.size + c;
+            h.top[p] = std::max(h.top[p], z);
+            h.bottom[p] = std::min(h.bottom[p], z);
+          }
+        }
+      }
+    });
+    return h;
+  }
+
+  // True if part material lies in front of face i along its pull. The face
+  // plane is compared with the height map at the pixel of its centroid.
+  static bool blocked(const GearSurfaceMesh& m, size_t i, bool up,
+                      const HeightMaps& h) {
+    const double x0 = m.ax[i], y0 = m.ay[i], x1 = m.bx[i], y1 = m.by[i],
+                 x2 = m.cx[i], y2 = m.cy[i];
+    const double det = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (std::fabs(det) < 1e-12)
+      return false;
+    const int c = h.index((x0 + x1 + x2) / 3);
+    const int r = h.index((y0 + y1 + y2) / 3);
+    const double x = h.centre(c), y = h.centre(r);
+    const double u = ((x - x0) * (y2 - y0) - (x2 - x0) * (y - y0)) / det;
+    const double v = ((x1 - x0) * (y - y0) - (x - x0) * (y1 - y0)) / det;
+    const double z =
+        m.az[i] + u * (m.bz[i] - m.az[i]) + v * (m.cz[i] - m.az[i]);
+    const double tol = 2 * h.pixel;
+    const size_t p = size_t(r) * h.size + c;
+    return up ? h.top[p] > z + tol : h.bottom[p] < z - tol;
+  }
+
+  static DraftOptions fromMacro(const BevelMacroGeometry& macro,
+                                DraftOptions o) {
+    if (!applies(macro.process)) {
+      throw std::invalid_argument(
+          "Draft analysis applies to moulded and forged gears, not " +
+          ManufacturingHelper::toString(macro.process));
+    }
+    o.draftAngle = macro.draftAngle;
+    o.surface.boreRadius = macro.innerDia / 2;
+    return o;
+  }
+
+  // Face penalties when released upwards / downwards: undercut area first,
+  // below draft area as a tie breaker
+  void penalties(double a, double s, double& up, double& down) const {
+    const double k = M_PI / 180;
+    const double tol = sin(opt.undercutTolerance * k);
+    const double req = sin(opt.draftAngle * k);
+    const double heavy = 1e6;
+    up = a * ((s < -tol) * heavy + (s < req));
+    down = a * ((-s < -tol) * heavy + (-s < req));
+  }
+
+  double partingPlane(const std::vector<double>& area,
+                      const std::vector<double>& sinDraft,
+                      const std::vector<double>& height, double zLo,
+                      double zHi, ThreadPool& pool) const {
+    const int bins = opt.partingCandidates;
+    const double span = std::max(zHi - zLo, 1e-9);
+    const size_t n = area.size(), chunks = (n + chunk - 1) / chunk;
+    // Per chunk histograms of upward and downward penalties over height
+    std::vector<double> up(chunks * bins, 0.0), down(chunks * bins, 0.0);
+    pool.parallelFor(0, chunks, [&](size_t c) {
+      double* u = &up[c * bins];
+      double* d = &down[c * bins];
+      for (size_t i = c * chunk, e = std::min(n, i + chunk); i < e; ++i) {
+        const int bin =
+            std::min(bins - 1, int((height[i] - zLo) / span * bins));
+        double pu, pd;
+        penalties(area[i], sinDraft[i], pu, pd);
+        u[bin] += pu;
+        d[bin] += pd;
+      }
+    });
+    for (size_t c = 1; c < chunks; ++c) {
+      for (int b = 0; b < bins; ++b) {
+        up[b] += up[c * bins + b];
+        down[b] += down[c * bins + b];
+      }
+    }
+    // Plane at the lower edge of bin k: bins >= k go up, the rest down
+    double above = 0;
+    for (int b = 0; b < bins; ++b)
+      above += up[b];
+    double below = 0, best = HUGE_VAL;
+    int bestBin = 0;
+    for (int k = 0; k <= bins; ++k) {
+      if (above + below < best) {
+        best = above + below;
+        bestBin = k;
+      }
+      if (k < bins) {
+        above -= up[k];
+        below += down[k];
+      }
+    }
+    return zLo + span * bestBin / bins;
+  }
+
+  void classify(const GearSurfaceMesh& m, const std::vector<double>& area,
+                const std::vector<double>& sinDraft,
+                const std::vector<double>& height, const HeightMaps& maps,
+                DraftResult& r, ThreadPool& pool) const {
+    const size_t n = area.size(), chunks = (n + chunk - 1) / chunk;
+    const double k = M_PI / 180;
+    const double tol = sin(opt.undercutTolerance * k);
+    const double req = sin(opt.draftAngle * k);
+    r.draft.resize(n);
+    r.status.resize(n);
+    struct Sums {
+      double total = 0, undercut = 0, below = 0, minDraft = HUGE_VAL;
+      std::array<double, numSurfaceRegions> regionUndercut{}, regionBelow{};
+    };
+    std::vector<Sums> sums(chunks);
+    pool.parallelFor(0, chunks, [&](size_t c) {
+      Sums& s = sums[c];
+      double sd[block], undercut[block], below[block];
+      const size_t e = std::min(n, (c + 1) * chunk);
+      for (size_t b = c * chunk; b < e; b += block) {
+        const size_t count = std::min(block, e - b);
+        // Draft towards the pull of the half holding the face, undercut and
+        // below draft as 0/1 area weights without branches
+        for (size_t j = 0; j < count; ++j) {
+          const double t = sinDraft[b + j];
+          sd[j] = height[b + j] >= r.partingZ ? t : -t;
+          undercut[j] = sd[j] < -tol ? 1.0 : 0.0;
+          below[j] = (sd[j] < req ? 1.0 : 0.0) - undercut[j];
+        }
+        // Only faces that release cleanly can still be trapped
+        for (size_t j = 0; j < count; ++j) {
+          const size_t i = b + j;
+          if (sd[j] > tol && blocked(m, i, height[i] >= r.partingZ, maps)) {
+            undercut[j] = 1;
+            below[j] = 0;
+          }
+        }
+        for (size_t j = 0; j < count; ++j) {
+          const size_t i = b + j;
+          r.status[i] = undercut[j] > 0 ? DraftStatus::Undercut
+                        : below[j] > 0  ? DraftStatus::BelowDraft
+                                        : DraftStatus::Ok;
+          r.draft[i] = float(asin(std::clamp(sd[j], -1.0, 1.0)) / k);
+          s.total += area[i];
+          s.undercut += undercut[j] * area[i];
+          s.below += below[j] * area[i];
+          s.minDraft = std::min(s.minDraft, double(r.draft[i]));
+          s.regionUndercut[size_t(m.region[i])] += undercut[j] * area[i];
+          s.regionBelow[size_t(m.region[i])] += below[j] * area[i];
+        }
+      }
+    });
+    r.minDraft = HUGE_VAL;
+    for (const Sums& s : sums) {
+      r.totalArea += s.total;
+      r.undercutArea += s.undercut;
+      r.belowDraftArea += s.below;
+      r.minDraft = std::min(r.minDraft, s.minDraft);
+      for (size_t g = 0; g < numSurfaceRegions; ++g) {
+        r.regionUndercutArea[g] += s.regionUndercut[g];
+        r.regionBelowDraftArea[g] += s.regionBelow[g];
+      }
+    }
+  }
+
+  DraftOptions opt;
+  GearSurface surface;
+};
@@ -0,0 +1,367 @@
+// Milling.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../geometry/ToothFlank.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// 5-axis finishing toolpaths for ManufacturingMethod::Milling, generated from
+// the analytic tooth flanks. One tooth space (right flank of tooth 0, left
+// flank of tooth 1) is planned once; every other tooth space is the same path
+// rotated about the gear axis. G-code uses the workpiece frame of ToothFlank
+// with tool orientation vectors (TRAORI style A3/B3/C3), so machine
+// kinematics are left to the controller or post processor.
+
+enum class MillingTool {
+  Ball,  // Ball end mill, passes along the face width
+  Flank  // Cylindrical end mill cutting with its side along the profile
+};
+
+struct MillingOptions {
+  MillingTool tool = MillingTool::Ball;
+  double toolRadius = 1.0;
+  double toolLength = 30;  // Flute + shank length checked for gouges
+  double scallopHeight = 0.005;
+  double maxSegment = 0.5;  // Longest contact point step along a pass
+  double tiltAngle = 10;    // Axis tilt away from the cut flank (deg)
+  double leadAngle = 3;     // Axis lead in the feed direction (deg)
+  double clearance = 5;     // Retract distance along the tool axis
+  double feedRate = 800;    // mm/min
+  double gougeTolerance = 1e-3;
+};
+
+// Cutter location: tool tip and unit axis pointing from tip to spindle
+struct CutterLocation {
+  Vec3 tip;
+  Vec3 axis;
+  bool gouge = false;  // No collision free orientation was found
+};
+
+struct Toolpath {
+  std::vector<CutterLocation> points;
+  std::vector<size_t> passStart;  // Index of the first point of each pass
+
+  size_t passes() const { return passStart.size(); }
+  size_t passEnd(size_t p) const {
+    return p + 1 < passStart.size() ? passStart[p + 1] : points.size();
+  }
+};
+
+struct MillingStats {
+  size_t teeth = 0;
+  size_t passesPerTooth = 0;
+  size_t pointsPerTooth = 0;
+  size_t gouges = 0;  // Per tooth space
+  size_t bytes = 0;
+};
+
+class MillingPlanner {
+public:
+  MillingPlanner(const BevelGear& gear, MillingOptions options = {})
+      : flank(gear), opt(options) {
+    if (opt.toolRadius <= 0 || opt.scallopHeight <= 0 ||
+        opt.scallopHeight >= opt.toolRadius || opt.maxSegment <= 0) {
+      throw std::invalid_argument("Invalid milling options");
+    }
+    buildObstacles();
+  }
+
+  // Finishing path of tooth space 0, both flanks
+  Toolpath planToothSpace(ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("milling.plan");
+    Toolpath sides[2];
+    pool.parallelFor(0, 2, [&](size_t s) {
+      sides[s] = planFlank(s == 0 ? FlankSide::Right : FlankSide::Left);
+    });
+    Toolpath out = std::move(sides[0]);
+    for (size_t p = 0; p < sides[1].passes(); ++p)
+      out.passStart.push_back(sides[1].passStart[p] + out.points.size());
+    out.points.insert(out.points.end(), sides[1].points.begin(),
+                      sides[1].points.end());
+    return out;
+  }
+
+  // Step-over between passes that leaves the requested scallop height
+  double stepOver() const {
+    const double r = opt.toolRadius, h = opt.scallopHeight;
+    return 2 * sqrt(h * (2 * r - h));
+  }
+
+  const ToothFlank& toothFlank() const { return flank; }
+  const MillingOptions& options() const { return opt; }
+
+  // Tool tip of path point p on tooth k
+  CutterLocation onTooth(const CutterLocation& c, int k) const {
+    const double a = k * flank.pitchAngle();
+    return {c.tip.rotatedZ(a), c.axis.rotatedZ(a), c.gouge};
+  }
+
+  // Write the program for all teeth to path. Tooth blocks are formatted in
+  // parallel batches and appended in order, so memory stays bounded by one
+  // batch. The file is written to path.tmp and renamed when complete.
+  MillingStats writeGcode(const std::string& path,
+                          ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("milling.gcode");
+    const Toolpath tp = planToothSpace(pool);
+    MillingStats stats;
+    stats.teeth = flank.numTeeth();
+    stats.passesPerTooth = tp.passes();
+    stats.pointsPerTooth = tp.points.size();
+    for (const auto& c : tp.points)
+      stats.gouges += c.gouge;
+
+    const std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out)
+      throw std::runtime_error("Cannot write " + tmp);
+    try {
+      const std::string head = header(tp);
+      out << head;
+      stats.bytes += head.size();
+
+      const size_t batch = std::max<size_t>(1, pool.size() * 2);
+      std::vector<std::string> blocks(batch);
+      for (size_t first = 0; first < stats.teeth; first += batch) {
+        const size_t n = std::min(batch, stats.teeth - first);
+        pool.parallelFor(0, n, [&](size_t i) {
+          blocks[i] = toothBlock(tp, static_cast<int>(first + i));
+        });
+        for (size_t i = 0; i < n; ++i) {
+          out << blocks[i];
+          stats.bytes += blocks[i].size();
+        }
+      }
+      out << "M30\n";
+      stats.bytes += 4;
+      out.close();
+      if (!out || std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Failed to write " + path);
+    } catch (...) {
+      // Never leave a partial program behind
+      out.close();
+      std::remove(tmp.c_str());
+      throw;
+    }
+    return stats;
+  }
+
+  // True if a tool with tip t and axis a cuts into the part beyond the
+  // gouge tolerance
+  bool gouges(const Vec3& tip, const Vec3& axis) const {
+    const double r = opt.toolRadius, tol = opt.gougeTolerance;
+    const bool ball = opt.tool == MillingTool::Ball;
+    const Vec3 centre = ballCentre(tip, axis);
+    for (const Vec3& q : obstacles) {
+      const Vec3 d = q - centre;
+      const double along = d.dot(axis);
+      if (along < 0) {
+        if (ball && d.norm() < r - tol)
+          return true;
+      } else if (along < opt.toolLength &&
+                 (d - axis * along).norm() < r - tol) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  Vec3 ballCentre(const Vec3& tip, const Vec3& axis) const {
+    return opt.tool == MillingTool::Ball ? tip + axis * opt.toolRadius : tip;
+  }
+
+  // Flank and root samples of the tooth space the tool works in
+  void buildObstacles() {
+    constexpr int nR = 24, nU = 16;
+    for (int i = 0; i <= nR; ++i) {
+      const double R =
+          flank.innerR() + (flank.outerR() - flank.innerR()) * i / nR;
+      for (int j = 0; j <= nU; ++j) {
+        const double u = double(j) / nU;
+        obstacles.push_back(flank.point(FlankSide::Right, R, u));
+        obstacles.push_back(
+            flank.onTooth(flank.point(FlankSide::Left, R, u), 1));
+      }
+      // Root cone between the two flanks
+      const double gamma = flank.rootAngle(R);
+      const double a0 = flank.azimuth(FlankSide::Right, R, gamma);
+      const double a1 =
+          flank.azimuth(FlankSide::Left, R, gamma) + flank.pitchAngle();
+      for (int j = 1; j < nU; ++j) {
+        const double phi = a0 + (a1 - a0) * j / nU;
+        obstacles.push_back({R * sin(gamma) * cos(phi),
+                             R * sin(gamma) * sin(phi), R * cos(gamma)});
+      }
+    }
+  }
+
+  // Surface point and outward normal of the flank that is cut, in the frame
+  // of tooth space 0
+  Vec3 surface(FlankSide side, double R, double u) const {
+    const Vec3 p = flank.point(side, R, u);
+    return side == FlankSide::Right ? p : flank.onTooth(p, 1);
+  }
+  Vec3 surfaceNormal(FlankSide side, double R, double u) const {
+    const Vec3 n = flank.normal(side, R, u);
+    return side == FlankSide::Right ? n : flank.onTooth(n, 1);
+  }
+
+  // Tool orientation: along the tooth depth, tilted away from the flank and
+  // leaning into the feed. Tries smaller tilts when the preferred one gouges.
+  CutterLocation locate(const Vec3& p, const Vec3& n, const Vec3& depth,
+                        const Vec3& feed) const {
+    const double k = M_PI / 180;
+    const double lead = opt.leadAngle * k;
+    CutterLocation best;
+    for (double f : {1.0, 0.5, 0.0, 1.5, 2.0}) {
+      const double tilt = opt.tiltAngle * k * f;
+      Vec3 axis = (depth * cos(tilt) + n * sin(tilt)).normalized();
+      axis = (axis * cos(lead) - feed * sin(lead)).normalized();
+      Vec3 tip;
+      if (opt.tool == MillingTool::Ball) {
+        tip = p + n * opt.toolRadius - axis * opt.toolRadius;
+      } else {
+        tip = p + n * opt.toolRadius;
+      }
+      CutterLocation c{tip, axis, gouges(tip, axis)};
+      if (!c.gouge)
+        return c;
+      if (f == 1.0)
+        best = c;
+    }
+    return best;
+  }
+
+  Toolpath planFlank(FlankSide side) const {
+    Toolpath tp;
+    const double R0 = flank.innerR(), R1 = flank.outerR();
+    const double Rm = 0.5 * (R0 + R1);
+    // Steps along the face width, from the flank length at profile u
+    auto steps = [&](double u) {
+      constexpr int n = 32;
+      double length = 0;
+      for (int i = 0; i < n; ++i) {
+        length += (surface(side, R0 + (R1 - R0) * (i + 1) / n, u) -
+                   surface(side, R0 + (R1 - R0) * i / n, u))
+                      .norm();
+      }
+      return std::max(8, int(std::ceil(length / opt.maxSegment)));
+    };
+
+    if (opt.tool == MillingTool::Flank) {
+      // One pass along the face width. The flute touches the profile at mid
+      // depth along its tangent; the convex involute then falls away from
+      // the cylinder towards root and tip, which leaves form error but never
+      // cuts into the flank.
+      tp.passStart.push_back(0);
+      const int nR = steps(0.5);
+      for (int i = 0; i <= nR; ++i) {
+        const double R = R0 + (R1 - R0) * i / nR;
+        const Vec3 p = surface(side, R, 0.5);
+        const Vec3 n = surfaceNormal(side, R, 0.5);
+        Vec3 depth = surface(side, R, 0.501) - surface(side, R, 0.499);
+        depth = (depth - n * depth.dot(n)).normalized();
+        CutterLocation c;
+        c.axis = depth;
+        c.tip = p + n * opt.toolRadius -
+                depth * (p - surface(side, R, 0)).dot(depth);
+        c.gouge = gouges(c.tip, c.axis);
+        tp.points.push_back(c);
+      }
+      return tp;
+    }
+
+    // Ball: passes at constant profile parameter, spaced by the step-over
+    // measured along the profile at the mean cone distance
+    double profileLength = 0;
+    constexpr int nProfile = 64;
+    for (int j = 0; j < nProfile; ++j) {
+      profileLength += (surface(side, Rm, double(j + 1) / nProfile) -
+                        surface(side, Rm, double(j) / nProfile))
+                           .norm();
+    }
+    const int passes =
+        std::max(2, int(std::ceil(profileLength / stepOver())) + 1);
+    for (int pass = 0; pass < passes; ++pass) {
+      const double u = double(pass) / (passes - 1);
+      tp.passStart.push_back(tp.points.size());
+      const bool forward = pass % 2 == 0;  // Zig-zag
+      const int nR = steps(u);
+      for (int i = 0; i <= nR; ++i) {
+        const double t = double(forward ? i : nR - i) / nR;
+        const double R = R0 + (R1 - R0) * t;
+        const Vec3 p = surface(side, R, u);
+        Vec3 n = surfaceNormal(side, R, u);
+        const double du = u < 0.5 ? 1e-3 : -1e-3;
+        Vec3 depth = (surface(side, R, u + du) - p) * (du > 0 ? 1 : -1);
+        Vec3 feed = (surface(side, R + (forward ? 1e-3 : -1e-3), u) - p);
+        depth = (depth - n * depth.dot(n)).normalized();
+        feed = (feed - n * feed.dot(n)).normalized();
+        tp.points.push_back(locate(p, n, depth, feed));
+      }
+    }
+    return tp;
+  }
+
+  std::string header(const Toolpath& tp) const {
+    const BevelGear& g = flank.gear();
+    char buf[512];
+    std::snprintf(
+        buf, sizeof(buf),
+        "%%\n(GearLab bevel gear finishing, %d teeth, module %.4f)\n"
+        "(Tool: %s R%.3f, step-over %.4f, %zu passes per tooth space)\n"
+        "(Frame: apex at origin, gear axis +Z; orientation vectors A3 B3 "
+        "C3)\n"
+        "G90 G21 G17\nTRAORI\n",
+        g.numTeeth, g.module,
+        opt.tool == MillingTool::Ball ? "ball end mill" : "flank end mill",
+        opt.toolRadius, stepOver(), tp.passes());
+    return buf;
+  }
+
+  std::string toothBlock(const Toolpath& tp, int tooth) const {
+    std::string s;
+    s.reserve(tp.points.size() * 72 + 64);
+    char line[160];
+    std::snprintf(line, sizeof(line), "(Tooth space %d)\n", tooth);
+    s += line;
+    // The feed goes on the plunge, the first cutting move after each rapid
+    char feed[32];
+    std::snprintf(feed, sizeof(feed), " F%.0f", opt.feedRate);
+    auto move = [&](const char* g, const CutterLocation& c,
+                    const char* words = "") {
+      const int n = std::snprintf(
+          line, sizeof(line),
+          "%s X%.4f Y%.4f Z%.4f A3=%.6f B3=%.6f C3=%.6f%s\n", g, c.tip.x,
+          c.tip.y, c.tip.z, c.axis.x, c.axis.y, c.axis.z, words);
+      // A non-finite or huge coordinate must not read past the buffer
+      s.append(line, std::clamp(n, 0, int(sizeof(line)) - 1));
+    };
+    for (size_t p = 0; p < tp.passes(); ++p) {
+      const size_t b = tp.passStart[p], e = tp.passEnd(p);
+      CutterLocation first = onTooth(tp.points[b], tooth);
+      CutterLocation above = first;
+      above.tip += first.axis * opt.clearance;
+      move("G0", above);
+      move("G1", first, feed);
+      for (size_t i = b + 1; i < e; ++i)
+        move("G1", onTooth(tp.points[i], tooth));
+      CutterLocation last = onTooth(tp.points[e - 1], tooth);
+      last.tip += last.axis * opt.clearance;
+      move("G0", last);
+    }
+    return s;
+  }
+
+  ToothFlank flank;
+  MillingOptions opt;
+  std::vector<Vec3> obstacles;
+};
@@ -0,0 +1,491 @@
+// Slicing.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../geometry/ToothFlank.hpp"
+#include "../pipeline/ThreadPool.hpp"
+#include "../pipeline/Trace.hpp"
+
+// Layer contours for ManufacturingMethod::ThreeD, cut straight from the
+// analytic solid instead of a triangle mesh. The solid is the spherical shell
+// between the inner and outer cone distances, filled up to the root cone and
+// carrying the teeth between root and face cone, minus an optional bore.
+// Layers are planes normal to the gear axis in the ToothFlank frame.
+//
+// In a layer at height z every circle r = const has one cone distance and one
+// polar angle, so the radial bounds, root and tip are decided once per circle
+// and only the tooth test depends on the azimuth. Each layer is contoured by
+// marching squares on a polar (r, azimuth) grid and every contour vertex is
+// bisected onto the exact boundary. Contours are closed, counter-clockwise
+// around material and clockwise around holes.
+
+struct SliceOptions {
+  double layerHeight = 0.1;
+  double cellSize = 0.1;    // Grid spacing in the layer (mm)
+  double boreRadius = 0;    // 0 leaves the blank solid to the axis
+  double tolerance = 1e-4;  // Vertex bisection tolerance (mm)
+  double simplify = 5e-4;   // Drop vertices closer than this to the chord
+};
+
+struct ContourPoint {
+  double x, y;
+};
+
+using Contour = std::vector<ContourPoint>;
+
+struct SliceLayer {
+  double z = 0;
+  std::vector<Contour> contours;
+};
+
+// Signed area, positive for counter-clockwise contours
+inline double contourArea(const Contour& c) {
+  double a = 0;
+  for (size_t i = 0, j = c.size() - 1; i < c.size(); j = i++)
+    a += c[j].x * c[i].y - c[i].x * c[j].y;
+  return a / 2;
+}
+
+// Contour file (.glc), read by the slicer front end. Coordinates are
+// quantized and stored as zigzag varint deltas between consecutive vertices.
+//
+//   Header          magic "GLCONTR1", layer count, quantum, layer height
+//   per layer       z, contour count
+//   per contour     point count, byte count, varint (dx, dy) pairs
+namespace contourfile {
+
+constexpr char magic[8] = {'G', 'L', 'C', 'O', 'N', 'T', 'R', '1'};
+constexpr double quantum = 1e-4;  // mm
+
+struct Header {
+  char magic[8];
+  uint32_t numLayers;
+  uint32_t reserved;
+  double quantum;
+  double layerHeight;
+};
+
+inline void putVarint(std::string& out, int64_t v) {
+  uint64_t u = (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+  while (u >= 0x80) {
+    out.push_back(char(u | 0x80));
+    u >>= 7;
+  }
+  out.push_back(char(u));
+}
+
+inline int64_t getVarint(const unsigned char*& p, const unsigned char* end) {
+  uint64_t u = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    const unsigned char b = *p++;
+    u |= uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return int64_t(u >> 1) ^ -int64_t(u & 1);
+  }
+  throw std::runtime_error("Truncated contour file");
+}
+
+// Serialised layer record
+inline std::string encodeLayer(const SliceLayer& layer) {
+  std::string out;
+  auto put = [&](const void* p, size_t n) {
+    out.append(static_cast<const char*>(p), n);
+  };
+  const uint32_t count = uint32_t(layer.contours.size());
+  put(&layer.z, sizeof(double));
+  put(&count, sizeof(count));
+  std::string data;
+  for (const Contour& c : layer.contours) {
+    data.clear();
+    int64_t px = 0, py = 0;
+    for (const ContourPoint& p : c) {
+      const int64_t x = std::llround(p.x / quantum);
+      const int64_t y = std::llround(p.y / quantum);
+      putVarint(data, x - px);
+      putVarint(data, y - py);
+      px = x;
+      py = y;
+    }
+    const uint32_t n = uint32_t(c.size()), bytes = uint32_t(data.size());
+    put(&n, sizeof(n));
+    put(&bytes, sizeof(bytes));
+    out += data;
+  }
+  return out;
+}
+
+inline std::vector<SliceLayer> read(const std::string& path) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("Cannot open " + path);
+  std::string buf;
+  char chunk[1 << 16];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0)
+    buf.append(chunk, n);
+  std::fclose(f);
+
+  const auto* p = reinterpret_cast<const unsigned char*>(buf.data());
+  const auto* end = p + buf.size();
+  auto get = [&](void* dst, size_t size) {
+    if (size_t(end - p) < size)
+      throw std::runtime_error("Truncated contour file " + path);
+    std::memcpy(dst, p, size);
+    p += size;
+  };
+  // Counts are checked against the bytes left before anything is sized by
+  // them, so a corrupt header cannot request a huge allocation
+  auto fits = [&](uint64_t count, size_t minBytes) {
+    if (count > size_t(end - p) / minBytes)
+      throw std::runtime_error("Truncated contour file " + path);
+  };
+  Header h;
+  get(&h, sizeof(h));
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error("Not a contour file: " + path);
+
+  // A layer is at least its z and contour count, a contour its two counts
+  // and a point two one-byte varints
+  fits(h.numLayers, sizeof(double) + sizeof(uint32_t));
+  std::vector<SliceLayer> layers(h.numLayers);
+  for (SliceLayer& layer : layers) {
+    uint32_t count;
+    get(&layer.z, sizeof(double));
+    get(&count, sizeof(count));
+    fits(count, 2 * sizeof(uint32_t));
+    layer.contours.resize(count);
+    for (Contour& c : layer.contours) {
+      uint32_t points, bytes;
+      get(&points, sizeof(points));
+      get(&bytes, sizeof(bytes));
+      if (size_t(end - p) < bytes || points > bytes / 2)
+        throw std::runtime_error("Truncated contour file " + path);
+      const unsigned char* q = p;
+      int64_t x = 0, y = 0;
+      c.resize(points);
+      for (ContourPoint& pt : c) {
+        x += getVarint(q, p + bytes);
+        y += getVarint(q, p + bytes);
+        pt = {x * h.quantum, y * h.quantum};
+      }
+      p += bytes;
+    }
+  }
+  return layers;
+}
+
+}  // namespace contourfile
+
+struct SliceStats {
+  size_t layers = 0;
+  size_t contours = 0;
+  size_t points = 0;
+  size_t bytes = 0;
+};
+
+class ContourSlicer {
+public:
+  ContourSlicer(const BevelGear& gear, SliceOptions options = {})
+      : flank(gear), opt(options) {
+    if (opt.layerHeight <= 0 || opt.cellSize <= 0 || opt.tolerance <= 0 ||
+        opt.boreRadius < 0 || opt.boreRadius >= flank.outerR()) {
+      throw std::invalid_argument("Invalid slice options");
+    }
+    // The part spans from the lowest tip corner up to the heel on the axis,
+    // or the heel at the bore
+    zMin = std::min(flank.innerR() * cos(flank.tipAngle(flank.innerR())),
+                    flank.outerR() * cos(flank.tipAngle(flank.outerR())));
+    zMax = sqrt(flank.outerR() * flank.outerR() -
+                opt.boreRadius * opt.boreRadius);
+  }
+
+  size_t layerCount() const {
+    return size_t(std::max(0.0, std::floor((zMax - zMin) / opt.layerHeight)));
+  }
+
+  // Layers are centred in their slab
+  double layerZ(size_t i) const { return zMin + (i + 0.5) * opt.layerHeight; }
+
+  // Point membership of the solid, gear frame
+  bool inside(double x, double y, double z) const {
+    return insidePolar(std::hypot(x, y), std::atan2(y, x), z);
+  }
+
+  SliceLayer slice(double z) const {
+    GEARLAB_TRACE_SCOPE("slicing.layer");
+    SliceLayer layer;
+    layer.z = z;
+    const double Ri = flank.innerR(), Ro = flank.outerR();
+    if (z <= 0 || z >= Ro)
+      return layer;
+
+    // Circles that can hold material, padded by one outside row
+    const double rLo = std::max(
+        opt.boreRadius, Ri > z ? sqrt(Ri * Ri - z * z) : 0.0);
+    const double rHi = sqrt(Ro * Ro - z * z);
+    if (rHi <= rLo)
+      return layer;
+    const double r0 = std::max(0.0, rLo - opt.cellSize);
+    const int nr = int(std::ceil((rHi + opt.cellSize - r0) / opt.cellSize));
+    const double dr = (rHi + opt.cellSize - r0) / nr;
+    // Azimuth steps per pitch so every tooth sees the same grid
+    const int z1 = flank.numTeeth();
+    const int perPitch = std::max(
+        4, int(std::ceil(rHi * flank.pitchAngle() / opt.cellSize)));
+    const int nt = perPitch * z1;
+    const double dt = 2 * M_PI / nt;
+
+    std::vector<Circle> circles(nr + 1);
+    for (int i = 0; i <= nr; ++i)
+      circles[i] = classify(r0 + i * dr, z);
+
+    // Inside flags of one pitch; the other pitches repeat them
+    std::vector<unsigned char> in((nr + 1) * size_t(perPitch));
+    for (int i = 0; i <= nr; ++i) {
+      for (int j = 0; j < perPitch; ++j)
+        in[i * size_t(perPitch) + j] =
+            circles[i].contains(j * dt, flank.pitchAngle());
+    }
+
+    // Edge ids: 2 (i nt + j) runs along r from (i, j), +1 along the azimuth.
+    // Every crossed edge starts exactly one segment, which holds its point.
+    struct Link {
+      int64_t to;
+      ContourPoint p;
+    };
+    std::unordered_map<int64_t, Link> next;
+    next.reserve(4096);
+    // Radius of the crossing between rows without teeth, the same at every
+    // azimuth
+    std::vector<double> ringRadius(nr, -1.0);
+    auto edgePoint = [&](int64_t id) {
+      const int64_t v = id / 2;
+      const int i = int(v / nt), j = int(v % nt);
+      const double ra = r0 + i * dr, ta = j * dt;
+      // Along the azimuth the circle is known, so only the tooth test runs
+      if (id % 2)
+        return boundary(circles[i], ra, ta, ta + dt);
+      if (circles[i].mode != Circle::Teeth &&
+          circles[i + 1].mode != Circle::Teeth) {
+        if (ringRadius[i] < 0)
+          ringRadius[i] = boundary(ra, ra + dr, 0, z).x;
+        return ContourPoint{ringRadius[i] * cos(ta), ringRadius[i] * sin(ta)};
+      }
+      return boundary(ra, ra + dr, ta, z);
+    };
+
+    for (int i = 0; i < nr; ++i) {
+      // Rows without a tooth band on either circle have no crossings
+      if (circles[i].mode != Circle::Teeth &&
+          circles[i + 1].mode != Circle::Teeth &&
+          circles[i].mode == circles[i + 1].mode) {
+        continue;
+      }
+      const unsigned char* lo = &in[i * size_t(perPitch)];
+      const unsigned char* hi = lo + perPitch;
+      for (int j = 0, m = 0; j < nt; ++j) {
+        const int j1 = j + 1 < nt ? j + 1 : 0;
+        const int m1 = m + 1 < perPitch ? m + 1 : 0;
+        // Corners counter-clockwise in (r, azimuth): a b c d
+        const bool c[4] = {lo[m] != 0, hi[m] != 0, hi[m1] != 0, lo[m1] != 0};
+        m = m1;
+        if (c[0] == c[1] && c[1] == c[2] && c[2] == c[3])
+          continue;
+        const int64_t e[4] = {2 * (int64_t(i) * nt + j),
+                              2 * (int64_t(i + 1) * nt + j) + 1,
+                              2 * (int64_t(i) * nt + j1),
+                              2 * (int64_t(i) * nt + j) + 1};
+        // Crossings in counter-clockwise order, true when leaving material
+        int idx[4], n = 0;
+        bool leaving[4];
+        for (int k = 0; k < 4; ++k) {
+          if (c[k] != c[(k + 1) % 4]) {
+            idx[n] = k;
+            leaving[n++] = c[k];
+          }
+        }
+        // Material stays on the left: each leaving crossing links to the
+        // entering one before it, or after it when a saddle is joined
+        bool joined = false;
+        if (n == 4) {
+          joined = insidePolar(r0 + (i + 0.5) * dr, (j + 0.5) * dt, z);
+        }
+        for (int k = 0; k < n; ++k) {
+          if (!leaving[k])
+            continue;
+          const int partner = joined ? (k + 1) % n : (k + n - 1) % n;
+          const int64_t from = e[idx[k]];
+          next.emplace(from, Link{e[idx[partner]], edgePoint(from)});
+        }
+      }
+    }
+
+    // Chain segments into closed loops
+    while (!next.empty()) {
+      Contour c;
+      int64_t id = next.begin()->first;
+      for (auto it = next.find(id); it != next.end(); it = next.find(id)) {
+        c.push_back(it->second.p);
+        id = it->second.to;
+        next.erase(it);
+      }
+      simplify(c);
+      if (c.size() >= 3)
+        layer.contours.push_back(std::move(c));
+    }
+    return layer;
+  }
+
+  // Slice every layer and write the contour file. Layers are computed in
+  // parallel batches and appended in order through a temporary file.
+  SliceStats write(const std::string& path,
+                   ThreadPool& pool = ThreadPool::shared()) const {
+    GEARLAB_TRACE_SCOPE("slicing.write");
+    SliceStats stats;
+    stats.layers = layerCount();
+    const std::string tmp = path + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out)
+      throw std::runtime_error("Cannot write " + tmp);
+
+    contourfile::Header h{};
+    std::memcpy(h.magic, contourfile::magic, sizeof(h.magic));
+    h.numLayers = uint32_t(stats.layers);
+    h.quantum = contourfile::quantum;
+    h.layerHeight = opt.layerHeight;
+    bool ok = std::fwrite(&h, sizeof(h), 1, out) == 1;
+    stats.bytes += sizeof(h);
+
+    const size_t batch = std::max<size_t>(1, pool.size() * 4);
+    std::vector<std::string> records(batch);
+    for (size_t first = 0; ok && first < stats.layers; first += batch) {
+      const size_t n = std::min(batch, stats.layers - first);
+      std::vector<size_t> contours(n), points(n);
+      try {
+        pool.parallelFor(0, n, [&](size_t i) {
+          const SliceLayer layer = slice(layerZ(first + i));
+          contours[i] = layer.contours.size();
+          for (const Contour& c : layer.contours)
+            points[i] += c.size();
+          records[i] = contourfile::encodeLayer(layer);
+        });
+      } catch (...) {
+        std::fclose(out);
+        std::remove(tmp.c_str());
+        throw;
+      }
+      for (size_t i = 0; ok && i < n; ++i) {
+        ok = std::fwrite(records[i].data(), 1, records[i].size(), out) ==
+             records[i].size();
+        stats.bytes += records[i].size();
+        stats.contours += contours[i];
+        stats.points += points[i];
+      }
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+      std::remove(tmp.c_str());
+      throw std::runtime_error("Failed to write " + path);
+    }
+    return stats;
+  }
+
+  const ToothFlank& toothFlank() const { return flank; }
+  const SliceOptions& options() const { return opt; }
+
+private:
+  // Material on one circle of a layer
+  struct Circle {
+    enum Mode { Empty, Full, Teeth } mode = Empty;
+    double centre = 0;     // Azimuth of the centre line of tooth 0
+    double halfWidth = 0;  // Angular half width of a tooth
+
+    bool contains(double azimuth, double pitch) const {
+      if (mode != Teeth)
+        return mode == Full;
+      return std::fabs(std::remainder(azimuth - centre, pitch)) <= halfWidth;
+    }
+  };
+
+  Circle classify(double r, double z) const {
+    Circle c;
+    const double R = std::hypot(r, z);
+    if (z <= 0 || R < flank.innerR() || R > flank.outerR() ||
+        r < opt.boreRadius) {
+      return c;
+    }
+    const double gamma = std::atan2(r, z);
+    if (gamma <= flank.rootAngle(R)) {
+      c.mode = Circle::Full;
+    } else if (gamma <= flank.tipAngle(R)) {
+      c.mode = Circle::Teeth;
+      c.centre = flank.spiralOffset(R);
+      c.halfWidth = flank.halfWidth(gamma);
+    }
+    return c;
+  }
+
+  bool insidePolar(double r, double t, double z) const {
+    return classify(r, z).contains(t, flank.pitchAngle());
+  }
+
+  // Boundary point on the radial edge from ra to rb at azimuth t
+  ContourPoint boundary(double ra, double rb, double t, double z) const {
+    const bool ia = insidePolar(ra, t, z);
+    double lo = ra, hi = rb;
+    while (hi - lo > opt.tolerance) {
+      const double m = 0.5 * (lo + hi);
+      (insidePolar(m, t, z) == ia ? lo : hi) = m;
+    }
+    const double r = 0.5 * (lo + hi);
+    return {r * cos(t), r * sin(t)};
+  }
+
+  // Boundary point on the circle r between azimuths ta and tb
+  ContourPoint boundary(const Circle& c, double r, double ta,
+                        double tb) const {
+    const bool ia = c.contains(ta, flank.pitchAngle());
+    double lo = ta, hi = tb;
+    while ((hi - lo) * r > opt.tolerance) {
+      const double m = 0.5 * (lo + hi);
+      (c.contains(m, flank.pitchAngle()) == ia ? lo : hi) = m;
+    }
+    const double t = 0.5 * (lo + hi);
+    return {r * cos(t), r * sin(t)};
+  }
+
+  // Drop vertices within opt.simplify of the chord of their neighbours
+  void simplify(Contour& c) const {
+    if (opt.simplify <= 0 || c.size() < 4)
+      return;
+    Contour out;
+    out.reserve(c.size());
+    out.push_back(c[0]);
+    for (size_t i = 1; i < c.size(); ++i) {
+      const ContourPoint& a = out.back();
+      const ContourPoint& p = c[i];
+      const ContourPoint& b = c[(i + 1) % c.size()];
+      const double dx = b.x - a.x, dy = b.y - a.y;
+      const double len = std::hypot(dx, dy);
+      const double d =
+          len > 0 ? std::fabs((p.x - a.x) * dy - (p.y - a.y) * dx) / len
+                  : std::hypot(p.x - a.x, p.y - a.y);
+      if (d > opt.simplify)
+        out.push_back(p);
+    }
+    c.swap(out);
+  }
+
+  ToothFlank flank;
+  SliceOptions opt;
+  double zMin = 0, zMax = 0;
+};
@@ -0,0 +1,672 @@
+// ComputeService.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../analysis/UnloadedTca.hpp"
+#include "../geometry/GearSurface.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../io/Json.hpp"
+#include "MemoryAccounting.hpp"
+#include "Pipeline.hpp"
+#include "Trace.hpp"
+
+// JSON-RPC 2.0 front end of the pipeline for the `gearlab serve` mode.
+//
+// Methods, params are an object of pair inputs by PairFieldUtils name (unset
+// ones come from the base design) plus the method options:
+//  - compute:  gear and pinion values and the validation result
+//  - validate: the individual validation checks
+//  - mesh:     GearSurface of the gear or pinion. Options member
+//              ("gear" | "pinion"), vertices (bool, flat a b c per
+//              triangle), faceSteps, profileSteps, landSteps, bodySteps,
+//              boreRadius
+//  - tca:      UnloadedTca path over one mesh cycle. Options member, side
+//              ("right" | "left"), steps, lengthwiseCrowning,
+//              profileCrowning, markingCompound, faceSamples
+//  - stats:    request, batch and cache counters
+//
+// handle() is called concurrently, one thread per client. Results are
+// cached by their exact inputs (LRU over the serialised result bytes), so
+// warm queries never reach the kernels. Misses queue on one of two lanes,
+// parameter queries and geometry, so a mesh build never delays a parameter
+// query. The first waiting caller of a lane becomes its leader and drains
+// everything queued into one batch: one pair sweep over the distinct
+// designs, then one parallelFor over the distinct geometry jobs. Requests
+// that arrive while a batch runs form the next batch, so batches grow with
+// load without a fixed delay. Identical requests in a batch compute once.
+
+struct ComputeServiceOptions {
+  size_t cacheBytes = size_t(64) << 20;  // 0 disables the cache
+  size_t maxBatch = 1024;
+};
+
+struct ComputeServiceStats {
+  size_t requests = 0;
+  size_t cacheHits = 0;
+  size_t computed = 0;  // Distinct jobs run on the kernels
+  size_t batches = 0;
+  size_t largestBatch = 0;
+  size_t cacheEntries = 0;
+  size_t cacheBytes = 0;
+};
+
+class ComputeService {
+public:
+  // JSON-RPC error codes
+  static constexpr int parseError = -32700;
+  static constexpr int invalidRequest = -32600;
+  static constexpr int methodNotFound = -32601;
+  static constexpr int invalidParams = -32602;
+  static constexpr int invalidDesign = -32000;  // Fails validateParam
+  static constexpr int computeError = -32001;
+
+  explicit ComputeService(const BevelGearPair& base,
+                          ComputeServiceOptions options = {},
+                          ThreadPool& pool = ThreadPool::shared())
+      : base(base), opt(options), pool(pool) {}
+
+  // Answer one JSON-RPC message, a request or a batch array. Returns the
+  // response text without a newline, empty if the message held only
+  // notifications. Thread safe.
+  std::string handle(const std::string& message) {
+    GEARLAB_TRACE_SCOPE("service.handle");
+    json::Value doc;
+    try {
+      doc = json::parse(message);
+    } catch (const json::ParseError& e) {
+      return errorText("null", parseError, e.what());
+    }
+    if (!doc.isArray()) {
+      Pending p;
+      p.request = &doc;
+      run(&p, 1);
+      return p.response;
+    }
+    if (doc.size() == 0)
+      return errorText("null", invalidRequest, "Empty batch");
+    std::vector<Pending> items(doc.size());
+    for (size_t i = 0; i < items.size(); ++i)
+      items[i].request = &doc.items()[i];
+    run(items.data(), items.size());
+    std::string out;
+    for (const Pending& p : items) {
+      if (p.response.empty())
+        continue;
+      out += out.empty() ? '[' : ',';
+      out += p.response;
+    }
+    return out.empty() ? out : out + ']';
+  }
+
+  ComputeServiceStats stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ComputeServiceStats s = counters;
+    std::lock_guard<std::mutex> cacheLock(cacheMutex);
+    s.cacheEntries = lru.size();
+    s.cacheBytes = cachedBytes;
+    return s;
+  }
+
+  void clearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    lru.clear();
+    index.clear();
+    cachedBytes = 0;
+  }
+
+private:
+  enum class Method { Compute, Validate, Mesh, Tca, Stats };
+
+  struct Job {
+    Method method = Method::Compute;
+    BevelGearPair pair;
+    bool pinion = false;
+    bool vertices = false;
+    GearSurfaceOptions surface;
+    TcaOptions tca;
+    int steps = 32;
+    std::string key;
+  };
+
+  using Text = std::shared_ptr<const std::string>;
+
+  struct Pending {
+    const json::Value* request = nullptr;
+    std::string id;  // Serialised, empty for notifications
+    Job job;
+    Text result;
+    int code = 0;
+    std::string message;
+    bool done = false;
+    std::string response;
+  };
+
+  // Leader/follower queue of cache misses of one kind
+  struct Lane {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Pending*> queue;
+    bool busy = false;
+  };
+
+  struct Entry {
+    std::string key;
+    Text text;
+    memory::Reservation held;
+  };
+
+  static std::string errorText(const std::string& id, int code,
+                               const std::string& message) {
+    std::string out = "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":";
+    out += std::to_string(code);
+    out += ",\"message\":";
+    json::Value::writeString(out, message);
+    out += "},\"id\":" + id + "}";
+    return out;
+  }
+
+  void run(Pending* items, size_t n) {
+    size_t hits = 0;
+    std::vector<Pending*> misses[2];
+    for (size_t i = 0; i < n; ++i) {
+      Pending& p = items[i];
+      if (parse(p)) {
+        if (p.job.method == Method::Stats) {
+          p.result = std::make_shared<std::string>(statsText());
+        } else if ((p.result = lookup(p.job.key))) {
+          ++hits;
+        } else {
+          const bool geometry = p.job.method == Method::Mesh ||
+                                p.job.method == Method::Tca;
+          misses[geometry].push_back(&p);
+        }
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      counters.requests += n;
+      counters.cacheHits += hits;
+    }
+    for (int l = 0; l < 2; ++l) {
+      if (!misses[l].empty())
+        wait(lanes[l], misses[l]);
+    }
+    for (size_t i = 0; i < n; ++i)
+      respond(items[i]);
+  }
+
+  void respond(Pending& p) {
+    if (p.id.empty())
+      return;  // Notification
+    if (p.code) {
+      p.response = errorText(p.id, p.code, p.message);
+      return;
+    }
+    p.response = "{\"jsonrpc\":\"2.0\",\"result\":";
+    p.response += *p.result;
+    p.response += ",\"id\":" + p.id + "}";
+  }
+
+  static void fail(Pending& p, int code, const std::string& message) {
+    p.code = code;
+    p.message = message;
+  }
+
+  // Queue the misses and take part in draining the lane until they are done
+  void wait(Lane& lane, const std::vector<Pending*>& mine) {
+    std::unique_lock<std::mutex> lock(lane.mutex);
+    lane.queue.insert(lane.queue.end(), mine.begin(), mine.end());
+    auto allDone = [&] {
+      for (const Pending* p : mine) {
+        if (!p->done)
+          return false;
+      }
+      return true;
+    };
+    while (!allDone()) {
+      if (lane.busy) {
+        lane.changed.wait(lock);
+        continue;
+      }
+      lane.busy = true;
+      const size_t n = std::min(lane.queue.size(), opt.maxBatch);
+      std::vector<Pending*> batch(lane.queue.begin(), lane.queue.begin() + n);
+      lane.queue.erase(lane.queue.begin(), lane.queue.begin() + n);
+      lock.unlock();
+      try {
+        process(batch);
+      } catch (const std::exception& e) {
+        for (Pending* p : batch) {
+          if (!p->result)
+            fail(*p, computeError, e.what());
+        }
+      }
+      lock.lock();
+      for (Pending* p : batch)
+        p->done = true;
+      lane.busy = false;
+      lane.changed.notify_all();
+    }
+  }
+
+  // One batched kernel pass over the distinct jobs of a batch
+  void process(std::vector<Pending*>& batch) {
+    GEARLAB_TRACE_SCOPE("service.batch");
+    // Distinct jobs; a previous batch may already have cached some
+    std::unordered_map<std::string, size_t> distinct;
+    std::vector<Pending*> jobs;
+    std::vector<size_t> jobOf(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      Pending* p = batch[i];
+      if ((p->result = lookup(p->job.key))) {
+        jobOf[i] = size_t(-1);
+        continue;
+      }
+      auto it = distinct.emplace(p->job.key, jobs.size()).first;
+      if (it->second == jobs.size())
+        jobs.push_back(p);
+      jobOf[i] = it->second;
+    }
+    {
+      std::lock_guard<std::mutex> lock(statsMutex);
+      ++counters.batches;
+      counters.largestBatch = std::max(counters.largestBatch, batch.size());
+      counters.computed += jobs.size();
+    }
+    if (jobs.empty())
+      return;
+
+    // All designs of the batch in one sweep
+    std::vector<BevelGearPair> designs(jobs.size());
+    for (size_t j = 0; j < jobs.size(); ++j)
+      designs[j] = jobs[j]->job.pair;
+    const std::vector<PairPipelineResult> pairs = runPairSweep(designs);
+
+    // Then the per job work, geometry in parallel
+    std::vector<Text> results(jobs.size());
+    std::vector<int> codes(jobs.size(), 0);
+    std::vector<std::string> messages(jobs.size());
+    pool.parallelFor(0, jobs.size(), [&](size_t j) {
+      try {
+        std::string text = evaluate(jobs[j]->job, pairs[j]);
+        if (!text.empty())
+          results[j] = std::make_shared<std::string>(std::move(text));
+      } catch (const std::invalid_argument& e) {
+        codes[j] = invalidParams;
+        messages[j] = e.what();
+      } catch (const std::exception& e) {
+        codes[j] = computeError;
+        messages[j] = e.what();
+      }
+    });
+    for (size_t j = 0; j < jobs.size(); ++j) {
+      if (results[j])
+        store(jobs[j]->job.key, results[j]);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (jobOf[i] == size_t(-1))
+        continue;
+      const size_t j = jobOf[i];
+      if (results[j])
+        batch[i]->result = results[j];
+      else if (codes[j] == 0 && !pairs[j].valid)
+        fail(*batch[i], invalidDesign, "Parameters fail validation");
+      else
+        fail(*batch[i], codes[j] ? codes[j] : computeError, messages[j]);
+    }
+  }
+
+  // Result text of one job, empty for a design that geometry cannot use
+  static std::string evaluate(const Job& job, const PairPipelineResult& r) {
+    json::Value v = json::Value::object();
+    switch (job.method) {
+      case Method::Compute:
+        v["valid"] = r.valid;
+        v["gear"] = gearValue(*r.gear);
+        v["pinion"] = gearValue(*r.pinion);
+        break;
+      case Method::Validate:
+        v["valid"] = r.valid;
+        v["toothCounts"] = r.pair.validateToothCounts();
+        v["angles"] = r.pair.validateAngles();
+        v["distances"] = r.pair.validateDistances();
+        break;
+      case Method::Mesh:
+        if (!r.valid)
+          return "";
+        v = meshValue(job, job.pinion ? *r.pinion : *r.gear);
+        break;
+      case Method::Tca:
+        if (!r.valid)
+          return "";
+        v = tcaValue(job, r.pair);
+        break;
+      case Method::Stats:
+        break;
+    }
+    return v.dump();
+  }
+
+  static json::Value gearValue(const BevelGear& g) {
+    json::Value v = json::Value::object();
+    v["numTeeth"] = g.numTeeth;
+    v["pitchConeAngle"] = g.pitchConeAngle;
+    v["faceConeAngle"] = g.faceConeAngle;
+    v["rootConeAngle"] = g.rootConeAngle;
+    v["faceConeOffset"] = g.faceConeOffset;
+    v["rootConeOffset"] = g.rootConeOffset;
+    v["pitchConeDistance"] = g.pitchConeDistance;
+    v["addendum"] = g.addendum;
+    v["dedendum"] = g.dedendum;
+    return v;
+  }
+
+  static json::Value meshValue(const Job& job, const BevelGear& gear) {
+    const GearSurfaceMesh m = GearSurface(gear, job.surface).build();
+    double area = 0;
+    Vec3 lo(HUGE_VAL, HUGE_VAL, HUGE_VAL), hi = -lo;
+    for (size_t i = 0; i < m.size(); ++i) {
+      area += (m.b(i) - m.a(i)).cross(m.c(i) - m.a(i)).norm() / 2;
+      for (const Vec3& p : {m.a(i), m.b(i), m.c(i)}) {
+        lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+        hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+      }
+    }
+    json::Value v = json::Value::object();
+    v["member"] = job.pinion ? "pinion" : "gear";
+    v["triangles"] = m.size();
+    v["area"] = area;
+    v["min"] = point(lo);
+    v["max"] = point(hi);
+    if (job.vertices) {
+      json::Value& xyz = v["vertices"] = json::Value::array();
+      for (size_t i = 0; i < m.size(); ++i) {
+        for (const Vec3& p : {m.a(i), m.b(i), m.c(i)}) {
+          xyz.push(p.x);
+          xyz.push(p.y);
+          xyz.push(p.z);
+        }
+      }
+    }
+    return v;
+  }
+
+  static json::Value point(const Vec3& p) {
+    json::Value v = json::Value::array();
+    v.push(p.x);
+    v.push(p.y);
+    v.push(p.z);
+    return v;
+  }
+
+  static json::Value tcaValue(const Job& job, const BevelGearPair& pair) {
+    const UnloadedTca tca(pair, job.pinion, job.tca);
+    const std::vector<TcaPoint> path = tca.path(job.steps);
+    json::Value v = json::Value::object();
+    v["member"] = job.pinion ? "pinion" : "gear";
+    v["meshCycle"] = tca.meshCycle();
+    json::Value rotation = json::Value::array(), te = json::Value::array();
+    json::Value tooth = json::Value::array(), area = json::Value::array();
+    json::Value centreR = json::Value::array(), centreU = json::Value::array();
+    double teMin = HUGE_VAL, teMax = -HUGE_VAL;
+    for (const TcaPoint& p : path) {
+      rotation.push(p.rotation);
+      te.push(p.transmissionError);
+      tooth.push(p.contact.tooth);
+      area.push(p.contact.area);
+      centreR.push(p.contact.centreR);
+      centreU.push(p.contact.centreU);
+      teMin = std::min(teMin, p.transmissionError);
+      teMax = std::max(teMax, p.transmissionError);
+    }
+    v["transmissionErrorPeakToPeak"] = teMax - teMin;
+    v["rotation"] = std::move(rotation);
+    v["transmissionError"] = std::move(te);
+    v["tooth"] = std::move(tooth);
+    v["contactArea"] = std::move(area);
+    v["centreR"] = std::move(centreR);
+    v["centreU"] = std::move(centreU);
+    return v;
+  }
+
+  std::string statsText() const {
+    const ComputeServiceStats s = stats();
+    json::Value v = json::Value::object();
+    v["requests"] = s.requests;
+    v["cacheHits"] = s.cacheHits;
+    v["computed"] = s.computed;
+    v["batches"] = s.batches;
+    v["largestBatch"] = s.largestBatch;
+    v["cacheEntries"] = s.cacheEntries;
+    v["cacheBytes"] = s.cacheBytes;
+    return v.dump();
+  }
+
+  // Check the request envelope and read the job. Sets the error of p on
+  // failure.
+  bool parse(Pending& p) {
+    const json::Value& r = *p.request;
+    if (!r.isObject()) {
+      p.id = "null";
+      fail(p, invalidRequest, "Request must be an object");
+      return false;
+    }
+    if (const json::Value* id = r.find("id")) {
+      if (!id->isString() && !id->isNumber() && !id->isNull()) {
+        p.id = "null";
+        fail(p, invalidRequest, "Invalid id");
+        return false;
+      }
+      p.id = id->dump();
+    }
+    const json::Value* version = r.find("jsonrpc");
+    const json::Value* method = r.find("method");
+    if (!version || !version->isString() || version->asString() != "2.0" ||
+        !method || !method->isString()) {
+      if (p.id.empty())
+        p.id = "null";
+      fail(p, invalidRequest, "Expected jsonrpc 2.0 with a method");
+      return false;
+    }
+    const std::string& name = method->asString();
+    Job& job = p.job;
+    if (name == "compute")
+      job.method = Method::Compute;
+    else if (name == "validate")
+      job.method = Method::Validate;
+    else if (name == "mesh")
+      job.method = Method::Mesh;
+    else if (name == "tca")
+      job.method = Method::Tca;
+    else if (name == "stats")
+      job.method = Method::Stats;
+    else {
+      fail(p, methodNotFound, "Unknown method " + name);
+      return false;
+    }
+    job.pair = base;
+    const json::Value* params = r.find("params");
+    if (params && !params->isObject()) {
+      fail(p, invalidParams, "params must be an object");
+      return false;
+    }
+    if (params) {
+      for (const auto& [key, value] : params->members()) {
+        const std::string error = option(job, key, value);
+        if (!error.empty()) {
+          fail(p, invalidParams, error);
+          return false;
+        }
+      }
+    }
+    job.key = cacheKey(name, job);
+    return true;
+  }
+
+  // Apply one param. Returns an error message, empty on success.
+  static std::string option(Job& job, const std::string& key,
+                            const json::Value& value) {
+    const bool geometry =
+        job.method == Method::Mesh || job.method == Method::Tca;
+    if (geometry && key == "member") {
+      if (!value.isString() ||
+          (value.asString() != "gear" && value.asString() != "pinion"))
+        return "member must be \"gear\" or \"pinion\"";
+      job.pinion = value.asString() == "pinion";
+      return "";
+    }
+    if (job.method == Method::Mesh && key == "vertices") {
+      if (!value.isBool())
+        return "vertices must be a boolean";
+      job.vertices = value.asBool();
+      return "";
+    }
+    if (job.method == Method::Tca && key == "side") {
+      if (!value.isString() ||
+          (value.asString() != "right" && value.asString() != "left"))
+        return "side must be \"right\" or \"left\"";
+      job.tca.side =
+          value.asString() == "left" ? FlankSide::Left : FlankSide::Right;
+      return "";
+    }
+    if (!value.isNumber())
+      return key + " must be a number";
+    const double x = value.asNumber();
+    if (!std::isfinite(x))
+      return key + " must be finite";
+    if (job.method == Method::Mesh) {
+      GearSurfaceOptions& s = job.surface;
+      if (key == "faceSteps")
+        return integer(x, 1, 4096, s.faceSteps) ? "" : key + " out of range";
+      if (key == "profileSteps")
+        return integer(x, 1, 4096, s.profileSteps) ? ""
+                                                   : key + " out of range";
+      if (key == "landSteps")
+        return integer(x, 1, 4096, s.landSteps) ? "" : key + " out of range";
+      if (key == "bodySteps")
+        return integer(x, 1, 4096, s.bodySteps) ? "" : key + " out of range";
+      if (key == "boreRadius") {
+        s.boreRadius = x;
+        return "";
+      }
+    }
+    if (job.method == Method::Tca) {
+      TcaOptions& t = job.tca;
+      if (key == "steps")
+        return integer(x, 1, 100000, job.steps) ? "" : key + " out of range";
+      if (key == "faceSamples")
+        return integer(x, 2, 100000, t.faceSamples) ? ""
+                                                    : key + " out of range";
+      if (key == "lengthwiseCrowning") {
+        t.lengthwiseCrowning = x;
+        return "";
+      }
+      if (key == "profileCrowning") {
+        t.profileCrowning = x;
+        return "";
+      }
+      if (key == "markingCompound") {
+        t.markingCompound = x;
+        return "";
+      }
+    }
+    if (!PairFieldUtils::valid(key, x))
+      return key + " out of range";
+    if (!PairFieldUtils::set(job.pair, key, x))
+      return "Unknown parameter " + key;
+    return "";
+  }
+
+  static bool integer(double x, int lo, int hi, int& out) {
+    if (!(x >= lo && x <= hi) || x != int(x))
+      return false;
+    out = int(x);
+    return true;
+  }
+
+  // Exact inputs of a job: every value as a hex float
+  static std::string cacheKey(const std::string& method, const Job& job) {
+    std::string key = method;
+    char buf[40];
+    auto add = [&](double x) {
+      std::snprintf(buf, sizeof(buf), "|%a", x);
+      key += buf;
+    };
+    for (const char* name : PairFieldUtils::names) {
+      double x = 0;
+      PairFieldUtils::get(job.pair, name, x);
+      add(x);
+    }
+    if (job.method == Method::Mesh) {
+      const GearSurfaceOptions& s = job.surface;
+      for (double x : {double(job.pinion), double(job.vertices),
+                       double(s.faceSteps), double(s.profileSteps),
+                       double(s.landSteps), double(s.bodySteps), s.boreRadius})
+        add(x);
+    } else if (job.method == Method::Tca) {
+      const TcaOptions& t = job.tca;
+      for (double x : {double(job.pinion), double(t.side == FlankSide::Left),
+                       double(job.steps), t.lengthwiseCrowning,
+                       t.profileCrowning, t.markingCompound,
+                       double(t.faceSamples)})
+        add(x);
+    }
+    return key;
+  }
+
+  Text lookup(const std::string& key) {
+    if (opt.cacheBytes == 0)
+      return nullptr;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = index.find(key);
+    if (it == index.end())
+      return nullptr;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->text;
+  }
+
+  void store(const std::string& key, const Text& text) {
+    const size_t bytes = key.size() + text->size();
+    if (bytes > opt.cacheBytes)
+      return;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (index.count(key))
+      return;
+    while (cachedBytes + bytes > opt.cacheBytes) {
+      const Entry& old = lru.back();
+      cachedBytes -= old.key.size() + old.text->size();
+      index.erase(old.key);
+      lru.pop_back();
+    }
+    lru.push_front(
+        {key, text, memory::Reservation(memory::Category::ResultBuffer,
+                                        bytes)});
+    index[key] = lru.begin();
+    cachedBytes += bytes;
+  }
+
+  const BevelGearPair base;
+  const ComputeServiceOptions opt;
+  ThreadPool& pool;
+  Lane lanes[2];  // Parameter queries, geometry
+
+  mutable std::mutex cacheMutex;
+  std::list<Entry> lru;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  size_t cachedBytes = 0;
+
+  mutable std::mutex statsMutex;
+  ComputeServiceStats counters;
+};
@@ -0,0 +1,445 @@
+// Gearbox.hpp
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../analysis/LoadRating.hpp"
+#include "../analysis/UnloadedTca.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../geometry/Vec3.hpp"
+#include "Pipeline.hpp"
+
+// Multi-stage bevel gearbox: a serial train of BevelGearPair stages
+// connected by shafts. Shaft 0 is the input and stage i drives shaft i + 1
+// from shaft i, so every intermediate shaft carries the driven member of one
+// stage and the driver of the next.
+//
+// Shaft axes are lines in housing coordinates (mm). Each member sits on its
+// shaft at the axial position of its thrust face, with the apex its mounting
+// distance further along the shaft in the direction it faces. The two
+// members of a stage must share their apex at the crossing of the shaft
+// axes, and the shafts must cross at the shaft angle of the pair.
+
+struct GearboxShaft {
+  std::string name;
+  Vec3 origin;         // A point on the axis, axial position 0
+  Vec3 axis{0, 0, 1};  // Direction, need not be unit
+};
+
+// Placement of one member on its shaft
+struct GearMount {
+  double thrustFace = 0;        // Axial position of the thrust face
+  double mountingDistance = 0;  // Apex to thrust face
+  int facing = 1;  // +1: apex in the axis direction from the thrust face
+};
+
+struct GearboxStage {
+  BevelGearPair pair;
+  bool pinionDrives = true;  // false for a speed increasing stage
+  GearMount driver;
+  GearMount driven;
+
+  int driverTeeth() const {
+    return pinionDrives ? pair.numPinionTeeth : pair.numGearTeeth;
+  }
+  int drivenTeeth() const {
+    return pinionDrives ? pair.numGearTeeth : pair.numPinionTeeth;
+  }
+};
+
+// Layout problem of one stage, or of the whole train with stage -1
+struct GearboxIssue {
+  int stage = -1;
+  std::string message;
+};
+
+struct Gearbox {
+  std::vector<GearboxShaft> shafts;  // stages.size() + 1
+  std::vector<GearboxStage> stages;
+
+  // Speed of shaft i over the input speed
+  double speedRatio(size_t shaft) const {
+    double r = 1;
+    for (size_t i = 0; i < shaft && i < stages.size(); ++i)
+      r *= double(stages[i].driverTeeth()) / stages[i].drivenTeeth();
+    return r;
+  }
+
+  // Input over output speed, > 1 for a reducer
+  double overallRatio() const { return 1 / speedRatio(stages.size()); }
+
+  // Shaft angles, apex positions and axial clearance of the members sharing
+  // a shaft. Linear tolerance in mm, angular in deg. Empty if consistent.
+  std::vector<GearboxIssue> check(double tolerance = 0.01,
+                                  double angleTolerance = 0.01) const {
+    std::vector<GearboxIssue> issues;
+    auto report = [&](int stage, const std::string& message) {
+      issues.push_back({stage, message});
+    };
+    if (stages.empty())
+      report(-1, "Gearbox has no stages");
+    if (shafts.size() != stages.size() + 1) {
+      report(-1, "Gearbox with " + std::to_string(stages.size()) +
+                     " stages needs " + std::to_string(stages.size() + 1) +
+                     " shafts, has " + std::to_string(shafts.size()));
+      return issues;
+    }
+    for (const GearboxShaft& s : shafts) {
+      if (s.axis.norm() == 0)
+        report(-1, "Shaft " + s.name + " has no axis direction");
+    }
+    if (!issues.empty())
+      return issues;
+
+    for (size_t i = 0; i < stages.size(); ++i)
+      checkStage(int(i), tolerance, angleTolerance, report);
+
+    // Driven member of stage i and driver of stage i + 1 on one shaft
+    for (size_t i = 0; i + 1 < stages.size(); ++i) {
+      const Interval a = extent(stages[i], false);
+      const Interval b = extent(stages[i + 1], true);
+      const double overlap = std::min(a.hi, b.hi) - std::max(a.lo, b.lo);
+      if (overlap > tolerance) {
+        report(int(i + 1), "Driver overlaps the stage " + std::to_string(i) +
+                               " member on shaft " + shafts[i + 1].name +
+                               " by " + format(overlap) + " mm");
+      }
+    }
+    return issues;
+  }
+
+private:
+  struct Interval {
+    double lo, hi;
+  };
+
+  static std::string format(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.4g", v);
+    return buf;
+  }
+
+  // Axial positions of a member on its shaft, thrust face to toe
+  static Interval extent(const GearboxStage& s, bool driver) {
+    const GearMount& m = driver ? s.driver : s.driven;
+    const bool pinion = driver == s.pinionDrives;
+    const double delta =
+        pinion ? s.pair.pinionPitchConeAngle : s.pair.pitchConeAngle;
+    const double toe = m.thrustFace +
+                       m.facing * (m.mountingDistance -
+                                   s.pair.innerConeDistance *
+                                       std::cos(delta * M_PI / 180));
+    return {std::min(m.thrustFace, toe), std::max(m.thrustFace, toe)};
+  }
+
+  template <typename Report>
+  void checkStage(int i, double tolerance, double angleTolerance,
+                  Report& report) const {
+    const GearboxStage& s = stages[i];
+    if (!s.pair.validateParam())
+      report(i, "Invalid pair parameters");
+    if (std::abs(s.driver.facing) != 1 || std::abs(s.driven.facing) != 1) {
+      report(i, "Mount facing must be +1 or -1");
+      return;
+    }
+    const GearboxShaft& in = shafts[i];
+    const GearboxShaft& out = shafts[i + 1];
+    const Vec3 a = in.axis.normalized(), b = out.axis.normalized();
+
+    // Directions from each member towards the common apex
+    const Vec3 da = a * double(s.driver.facing);
+    const Vec3 db = b * double(s.driven.facing);
+    const double angle =
+        std::acos(std::clamp(da.dot(db), -1.0, 1.0)) * 180 / M_PI;
+    if (std::abs(angle - s.pair.shaftAngle) > angleTolerance) {
+      report(i, "Shafts " + in.name + " and " + out.name + " cross at " +
+                    format(angle) + " deg, pair needs " +
+                    format(s.pair.shaftAngle) + " deg");
+    }
+
+    // Closest points of the two axis lines, origin + t axis
+    const Vec3 w = in.origin - out.origin;
+    const double c = a.dot(b), den = 1 - c * c;
+    if (den < 1e-12) {
+      report(i, "Shafts " + in.name + " and " + out.name + " are parallel");
+      return;
+    }
+    const double ta = (c * b.dot(w) - a.dot(w)) / den;
+    const double tb = (b.dot(w) - c * a.dot(w)) / den;
+    const double offset =
+        ((in.origin + a * ta) - (out.origin + b * tb)).norm();
+    if (offset > tolerance) {
+      report(i, "Shafts " + in.name + " and " + out.name +
+                    " do not intersect, offset " + format(offset) + " mm");
+    }
+
+    // Mounting distance that puts each apex on the crossing
+    auto checkMount = [&](const GearMount& m, double t, const char* what) {
+      const double needed = m.facing * (t - m.thrustFace);
+      if (std::abs(needed - m.mountingDistance) > tolerance) {
+        report(i, std::string(what) + " mounting distance " +
+                      format(m.mountingDistance) + " mm, apex needs " +
+                      format(needed) + " mm");
+      }
+    };
+    checkMount(s.driver, ta, "Driver");
+    checkMount(s.driven, tb, "Driven");
+  }
+};
+
+struct GearboxOptions {
+  int tcaSteps = 64;         // TE samples per mesh cycle of each stage
+  int trainSamples = 4096;   // Combined TE samples per output revolution
+  TcaOptions tca;            // Of every stage, analysing the driven member
+  LoadRating rating;
+};
+
+struct GearboxStageResult {
+  BevelGearPair pair;  // With derived values
+  bool valid = false;  // Pair parameters valid and TCA possible
+  double ratio = 0;    // Driver over driven speed
+  size_t mesh = 0;     // Distinct mesh the stage shares with others
+  // Unloaded TCA of the driven member over one of its mesh cycles, and the
+  // peak to peak transmission error at that member (arcsec)
+  std::vector<TcaPoint> tca;
+  double tePeakToPeak = 0;
+  LoadSpectrum spectrum;  // At the pinion of this stage
+  RatingResults rating;   // One design, empty without a spectrum
+};
+
+struct GearboxResult {
+  double overallRatio = 0;
+  bool valid = false;  // Every stage valid and no layout issues
+  std::vector<GearboxIssue> issues;
+  std::vector<GearboxStageResult> stages;
+  // Transmission error of the train at the output shaft over one output
+  // revolution: the stage errors carried through the downstream ratios
+  std::vector<double> rotation;           // Output shaft (deg)
+  std::vector<double> transmissionError;  // arcsec
+  double tePeakToPeak = 0;
+  // Over all stages and members, infinite without a spectrum
+  double minPittingSafety = 0;
+  double minBendingSafety = 0;
+};
+
+struct GearboxAnalysis {
+  std::vector<GearboxResult> variants;
+  size_t meshes = 0;  // Distinct stage meshes analysed
+};
+
+namespace gearbox_detail {
+
+// One distinct mesh: the same pair driven from the same member
+struct Mesh {
+  PairPipelineResult pipeline;
+  bool drivenIsPinion = false;
+  std::vector<TcaPoint> tca;
+  bool valid = false;
+};
+
+inline std::vector<double> meshKey(const GearboxStage& s) {
+  std::vector<double> key;
+  for (const char* name : PairFieldUtils::names) {
+    double v = 0;
+    PairFieldUtils::get(s.pair, name, v);
+    key.push_back(v);
+  }
+  key.push_back(s.pinionDrives);
+  return key;
+}
+
+// Linear interpolation of a TCA path at a rotation of the analysed member,
+// periodic over the mesh cycle
+inline double teAt(const std::vector<TcaPoint>& path, double cycle,
+                   double rotation) {
+  const size_t n = path.size();
+  double f = std::fmod(rotation, cycle) / cycle * n;
+  if (f < 0)
+    f += n;
+  const size_t i = std::min(size_t(f), n - 1);
+  const double t = f - i;
+  return (1 - t) * path[i].transmissionError +
+         t * path[(i + 1) % n].transmissionError;
+}
+
+// Of the finite values; NaN marks rotations without an engaged tooth
+inline double peakToPeak(const std::vector<double>& v) {
+  double lo = HUGE_VAL, hi = -HUGE_VAL;
+  for (double x : v) {
+    lo = std::fmin(lo, x);
+    hi = std::fmax(hi, x);
+  }
+  return hi >= lo ? hi - lo : 0;
+}
+
+// Spectrum of the input shaft moved to the pinion of stage i, lossless
+inline LoadSpectrum stageSpectrum(const Gearbox& box, size_t i,
+                                  const LoadSpectrum& input) {
+  const size_t shaft = box.stages[i].pinionDrives ? i : i + 1;
+  const double r = box.speedRatio(shaft);
+  LoadSpectrum out;
+  for (const LoadBin& bin : input)
+    out.push_back({bin.torque / r, bin.speed * r, bin.hours});
+  return out;
+}
+
+inline void combine(const Gearbox& box, const std::vector<Mesh>& meshes,
+                    const GearboxOptions& opt, GearboxResult& r) {
+  r.valid = r.issues.empty();
+  r.minPittingSafety = r.minBendingSafety =
+      std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < r.stages.size(); ++i) {
+    GearboxStageResult& s = r.stages[i];
+    const Mesh& m = meshes[s.mesh];
+    s.pair = m.pipeline.pair;
+    s.valid = m.valid;
+    s.tca = m.tca;
+    std::vector<double> te;
+    for (const TcaPoint& p : s.tca)
+      te.push_back(p.transmissionError);
+    s.tePeakToPeak = peakToPeak(te);
+    r.valid &= s.valid;
+    if (s.rating.size() == 1) {
+      r.minPittingSafety =
+          std::min(r.minPittingSafety, s.rating.minPittingSafety(0));
+      r.minBendingSafety =
+          std::min(r.minBendingSafety, s.rating.minBendingSafety(0));
+    }
+  }
+  if (!r.valid)
+    return;
+
+  // A lag of e at the driven shaft of stage i is a lag of e times the speed
+  // ratio of the output to that shaft at the output
+  const double out = box.speedRatio(box.stages.size());
+  const int n = std::max(opt.trainSamples, 1);
+  r.rotation.resize(n);
+  r.transmissionError.assign(n, 0.0);
+  for (size_t i = 0; i < r.stages.size(); ++i) {
+    const GearboxStageResult& s = r.stages[i];
+    const double shaft = box.speedRatio(i + 1) / out;
+    const double cycle = 360.0 / box.stages[i].drivenTeeth();
+    for (int k = 0; k < n; ++k) {
+      const double rot = 360.0 * k / n;
+      r.transmissionError[k] += teAt(s.tca, cycle, rot * shaft) / shaft;
+    }
+  }
+  for (int k = 0; k < n; ++k)
+    r.rotation[k] = 360.0 * k / n;
+  r.tePeakToPeak = peakToPeak(r.transmissionError);
+}
+
+}  // namespace gearbox_detail
+
+// Analyse gearbox variants under a load spectrum at the input shaft (torque
+// in Nm and speed in rpm of shaft 0). Stages with the same pair driven from
+// the same member, within a gearbox or across variants, are one mesh whose
+// pipeline and TCA run once. Meshes are branches of one TaskGraph and run
+// concurrently on the pool; each variant's train result is a stage after
+// the meshes it uses. Invalid stages are reported, not thrown.
+inline GearboxAnalysis analyseGearboxes(
+    const std::vector<Gearbox>& variants, const LoadSpectrum& spectrum = {},
+    GearboxOptions opt = {}, CancellationToken token = CancellationToken(),
+    ProgressCallback progress = nullptr) {
+  using namespace gearbox_detail;
+  GEARLAB_TRACE_SCOPE("gearbox");
+  GearboxAnalysis out;
+  out.variants.resize(variants.size());
+
+  // Distinct meshes first, so their storage is fixed while the graph runs
+  std::map<std::vector<double>, size_t> index;
+  std::vector<const GearboxStage*> first;
+  for (size_t v = 0; v < variants.size(); ++v) {
+    GearboxResult& r = out.variants[v];
+    r.stages.resize(variants[v].stages.size());
+    for (size_t i = 0; i < r.stages.size(); ++i) {
+      const GearboxStage& s = variants[v].stages[i];
+      auto it = index.emplace(meshKey(s), first.size()).first;
+      if (it->second == first.size())
+        first.push_back(&s);
+      r.stages[i].mesh = it->second;
+    }
+  }
+  std::vector<Mesh> meshes(first.size());
+  out.meshes = meshes.size();
+
+  TaskGraph graph;
+  std::vector<TaskGraph::TaskId> params(meshes.size()), tca(meshes.size());
+  const TcaOptions tcaOptions = opt.tca;
+  const int steps = opt.tcaSteps;
+  for (size_t m = 0; m < meshes.size(); ++m) {
+    Mesh& mesh = meshes[m];
+    mesh.drivenIsPinion = !first[m]->pinionDrives;
+    const std::string prefix = "gearbox.mesh" + std::to_string(m) + ".";
+    params[m] =
+        addPairPipeline(graph, first[m]->pair, mesh.pipeline, prefix).params;
+    tca[m] = graph.add(
+        prefix + "tca",
+        [&mesh, tcaOptions, steps](TaskGraph::Context&) {
+          if (!mesh.pipeline.valid)
+            return;
+          try {
+            const UnloadedTca t(mesh.pipeline.pair, mesh.drivenIsPinion,
+                                tcaOptions);
+            mesh.tca = t.path(steps);
+            mesh.valid = true;
+          } catch (const std::invalid_argument&) {
+            // No active profile: the stage is reported invalid
+          }
+        },
+        {params[m]});
+  }
+
+  for (size_t v = 0; v < variants.size(); ++v) {
+    const Gearbox& box = variants[v];
+    GearboxResult& r = out.variants[v];
+    r.issues = box.check();
+    r.overallRatio = box.stages.empty() ? 0 : box.overallRatio();
+    std::vector<TaskGraph::TaskId> deps;
+    for (size_t i = 0; i < r.stages.size(); ++i) {
+      GearboxStageResult& s = r.stages[i];
+      s.ratio = double(box.stages[i].drivenTeeth()) /
+                box.stages[i].driverTeeth();
+      if (!spectrum.empty())
+        s.spectrum = stageSpectrum(box, i, spectrum);
+      const Mesh& mesh = meshes[s.mesh];
+      // Rating depends on the stage load, so it is per stage
+      const LoadRating& rating = opt.rating;
+      deps.push_back(graph.add(
+          "gearbox.variant" + std::to_string(v) + ".rating" +
+              std::to_string(i),
+          [&s, &mesh, &rating](TaskGraph::Context&) {
+            if (mesh.pipeline.valid && !s.spectrum.empty())
+              s.rating = rating.rate(mesh.pipeline.pair, s.spectrum);
+          },
+          {params[s.mesh]}));
+      deps.push_back(tca[s.mesh]);
+    }
+    graph.add(
+        "gearbox.variant" + std::to_string(v) + ".train",
+        [&box, &meshes, &opt, &r](TaskGraph::Context&) {
+          combine(box, meshes, opt, r);
+        },
+        deps);
+  }
+  graph.setProgressCallback(std::move(progress));
+  graph.run(ThreadPool::shared(), token);
+  return out;
+}
+
+// Single gearbox convenience wrapper
+inline GearboxResult analyseGearbox(
+    const Gearbox& box, const LoadSpectrum& spectrum = {},
+    GearboxOptions opt = {}, CancellationToken token = CancellationToken(),
+    ProgressCallback progress = nullptr) {
+  return analyseGearboxes({box}, spectrum, std::move(opt), token,
+                          std::move(progress))
+      .variants[0];
+}
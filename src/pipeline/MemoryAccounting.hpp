@@ -0,0 +1,318 @@
+// MemoryAccounting.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+// Central accounting of the memory held by pipeline stages. Every stage
+// reports its large buffers under a category; the process wide totals and
+// peaks can be printed at any time. A job can carry a Budget: stages ask it
+// whether a buffer fits before allocating and pick a cheaper strategy
+// (coarser mesh, streamed results) when it does not.
+namespace memory {
+
+enum class Category {
+  Geometry,         // Flank grids, solver work arrays
+  Mesh,             // Surface and FE meshes
+  InfluenceMatrix,  // Compliance / stiffness matrices
+  ResultBuffer,     // Per-design results, row indices
+  Other,
+  Count
+};
+
+constexpr size_t numCategories = static_cast<size_t>(Category::Count);
+
+inline const char* toString(Category c) {
+  switch (c) {
+    case Category::Geometry:
+      return "geometry";
+    case Category::Mesh:
+      return "mesh";
+    case Category::InfluenceMatrix:
+      return "influenceMatrix";
+    case Category::ResultBuffer:
+      return "resultBuffer";
+    case Category::Other:
+      return "other";
+    default:
+      return "unknown";
+  }
+}
+
+// Current and peak bytes of one counter
+struct Counter {
+  std::atomic<int64_t> current{0};
+  std::atomic<int64_t> peak{0};
+
+  void add(int64_t bytes) {
+    const int64_t now =
+        current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t p = peak.load(std::memory_order_relaxed);
+    while (now > p &&
+           !peak.compare_exchange_weak(p, now, std::memory_order_relaxed)) {
+    }
+  }
+
+  void sub(int64_t bytes) {
+    current.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+};
+
+// Per-category and total counters
+struct Usage {
+  Counter categories[numCategories];
+  Counter total;
+
+  void add(Category c, int64_t bytes) {
+    categories[static_cast<size_t>(c)].add(bytes);
+    total.add(bytes);
+  }
+
+  void sub(Category c, int64_t bytes) {
+    categories[static_cast<size_t>(c)].sub(bytes);
+    total.sub(bytes);
+  }
+
+  void write(std::ostream& out) const {
+    auto line = [&](const char* name, const Counter& k) {
+      out << "  " << name << ": current " << k.current.load() << " B, peak "
+          << k.peak.load() << " B\n";
+    };
+    for (size_t c = 0; c < numCategories; ++c)
+      line(toString(static_cast<Category>(c)), categories[c]);
+    line("total", total);
+  }
+};
+
+// Process wide usage of all jobs
+inline Usage& global() {
+  static Usage usage;
+  return usage;
+}
+
+// Thrown when a stage needs a buffer that cannot fit its job budget and has
+// no cheaper fallback
+struct BudgetExceeded : std::bad_alloc {
+  const char* what() const noexcept override {
+    return "Job memory budget exceeded";
+  }
+};
+
+// Memory budget of one job. A limit of 0 means unlimited; usage is still
+// tracked so the job can report its peak.
+class Budget {
+public:
+  explicit Budget(size_t limitBytes = 0) : limitBytes(limitBytes) {}
+
+  Budget(const Budget&) = delete;
+  Budget& operator=(const Budget&) = delete;
+
+  size_t limit() const { return limitBytes; }
+  bool unlimited() const { return limitBytes == 0; }
+
+  // Bytes that can still be reserved
+  size_t available() const {
+    if (unlimited())
+      return SIZE_MAX;
+    const int64_t u = used.load(std::memory_order_relaxed);
+    return u >= int64_t(limitBytes) ? 0 : limitBytes - size_t(u);
+  }
+
+  bool fits(size_t bytes) const { return bytes <= available(); }
+
+  // Reserve bytes if they fit; the check and the charge are one atomic step
+  bool tryReserve(Category c, size_t bytes) {
+    int64_t u = used.load(std::memory_order_relaxed);
+    do {
+      if (!unlimited() && u + int64_t(bytes) > int64_t(limitBytes))
+        return false;
+    } while (!used.compare_exchange_weak(u, u + int64_t(bytes),
+                                         std::memory_order_relaxed));
+    record(c, int64_t(bytes));
+    return true;
+  }
+
+  // Record bytes that are already allocated, fitting or not
+  void charge(Category c, size_t bytes) {
+    used.fetch_add(int64_t(bytes), std::memory_order_relaxed);
+    record(c, int64_t(bytes));
+  }
+
+  void release(Category c, size_t bytes) {
+    used.fetch_sub(int64_t(bytes), std::memory_order_relaxed);
+    record(c, -int64_t(bytes));
+  }
+
+  const Usage& jobUsage() const { return usage; }
+
+private:
+  void record(Category c, int64_t bytes) {
+    if (bytes >= 0) {
+      usage.add(c, bytes);
+      global().add(c, bytes);
+    } else {
+      usage.sub(c, -bytes);
+      global().sub(c, -bytes);
+    }
+  }
+
+  size_t limitBytes;
+  std::atomic<int64_t> used{0};
+  Usage usage;
+};
+
+// Budget of the job running on this thread, set by TaskGraph while a stage
+// executes and by ThreadPool for the tasks it runs. nullptr outside jobs.
+inline Budget*& currentBudget() {
+  thread_local Budget* budget = nullptr;
+  return budget;
+}
+
+// Makes a budget current for the lifetime of the scope
+class BudgetScope {
+public:
+  explicit BudgetScope(Budget* b) : previous(currentBudget()) {
+    currentBudget() = b;
+  }
+  ~BudgetScope() { currentBudget() = previous; }
+
+  BudgetScope(const BudgetScope&) = delete;
+  BudgetScope& operator=(const BudgetScope&) = delete;
+
+private:
+  Budget* previous;
+};
+
+// RAII charge of a buffer against the current budget (if any) and the
+// global counters
+class Reservation {
+public:
+  Reservation() = default;
+
+  // Charge unconditionally
+  Reservation(Category c, size_t bytes)
+      : category(c), bytes(bytes), held(true) {
+    budget = currentBudget();
+    if (budget)
+      budget->charge(c, bytes);
+    else
+      global().add(c, int64_t(bytes));
+  }
+
+  Reservation(Reservation&& o) noexcept { *this = std::move(o); }
+
+  Reservation& operator=(Reservation&& o) noexcept {
+    if (this != &o) {
+      reset();
+      category = o.category;
+      bytes = o.bytes;
+      budget = o.budget;
+      held = o.held;
+      o.bytes = 0;
+      o.held = false;
+    }
+    return *this;
+  }
+
+  ~Reservation() { reset(); }
+
+  // Charge only if it fits the current budget; otherwise returns an empty
+  // reservation so the caller can fall back
+  static Reservation tryMake(Category c, size_t bytes) {
+    Reservation r;
+    Budget* b = currentBudget();
+    if (b && !b->tryReserve(c, bytes))
+      return r;
+    if (!b)
+      global().add(c, int64_t(bytes));
+    r.category = c;
+    r.bytes = bytes;
+    r.budget = b;
+    r.held = true;
+    return r;
+  }
+
+  // Like tryMake, but throws BudgetExceeded when the bytes do not fit
+  static Reservation require(Category c, size_t bytes) {
+    Reservation r = tryMake(c, bytes);
+    if (!r)
+      throw BudgetExceeded();
+    return r;
+  }
+
+  explicit operator bool() const { return held; }
+  size_t size() const { return bytes; }
+
+  void reset() {
+    if (bytes > 0) {
+      if (budget)
+        budget->release(category, bytes);
+      else
+        global().sub(category, int64_t(bytes));
+    }
+    bytes = 0;
+    held = false;
+  }
+
+private:
+  Category category = Category::Other;
+  size_t bytes = 0;
+  Budget* budget = nullptr;
+  bool held = false;
+};
+
+// Standard allocator that charges every allocation to a category of the
+// budget current at construction, for containers owned by a stage
+template <typename T>
+class TrackedAllocator {
+public:
+  using value_type = T;
+
+  explicit TrackedAllocator(Category c = Category::Other)
+      : category(c), budget(currentBudget()) {}
+
+  template <typename U>
+  TrackedAllocator(const TrackedAllocator<U>& o)
+      : category(o.category), budget(o.budget) {}
+
+  T* allocate(size_t n) {
+    const size_t bytes = n * sizeof(T);
+    T* p = static_cast<T*>(::operator new(bytes));
+    if (budget)
+      budget->charge(category, bytes);
+    else
+      global().add(category, int64_t(bytes));
+    return p;
+  }
+
+  void deallocate(T* p, size_t n) {
+    const size_t bytes = n * sizeof(T);
+    if (budget)
+      budget->release(category, bytes);
+    else
+      global().sub(category, int64_t(bytes));
+    ::operator delete(p);
+  }
+
+  template <typename U>
+  bool operator==(const TrackedAllocator<U>& o) const {
+    return category == o.category && budget == o.budget;
+  }
+  template <typename U>
+  bool operator!=(const TrackedAllocator<U>& o) const {
+    return !(*this == o);
+  }
+
+private:
+  template <typename U>
+  friend class TrackedAllocator;
+  Category category;
+  Budget* budget;
+};
+
+}  // namespace memory
@@ -0,0 +1,135 @@
+// Pipeline.hpp
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../geometry/GearParams.hpp"
+#include "../geometry/PairFields.hpp"
+#include "MemoryAccounting.hpp"
+#include "TaskGraph.hpp"
+
+// Outputs of the gear pair pipeline. Later stages (flanks, mesh, analysis,
+// export) append their results here as they are added to the pipeline.
+struct PairPipelineResult {
+  BevelGearPair pair;
+  std::optional<BevelGear> gear;
+  std::optional<BevelGear> pinion;
+  bool valid = false;
+};
+
+// Stage ids of a pair pipeline inside its TaskGraph, so callers can hang
+// further stages off the gear or pinion branch
+struct PairPipelineStages {
+  TaskGraph::TaskId params;
+  TaskGraph::TaskId gear;
+  TaskGraph::TaskId pinion;
+};
+
+// Add the stages for one gear pair: params -> {gear, pinion}.
+// The input pair is copied so the graph owns everything it touches.
+inline PairPipelineStages addPairPipeline(TaskGraph& graph,
+                                          const BevelGearPair& input,
+                                          PairPipelineResult& out,
+                                          const std::string& prefix = "") {
+  PairPipelineStages s;
+  s.params = graph.add(prefix + "params", [input, &out](TaskGraph::Context&) {
+    out.pair = PairFieldUtils::recompute(input);
+    out.valid = out.pair.validateParam();
+  });
+  s.gear = graph.add(
+      prefix + "gear",
+      [&out](TaskGraph::Context&) { out.gear = out.pair.makeGear(); },
+      {s.params});
+  s.pinion = graph.add(
+      prefix + "pinion",
+      [&out](TaskGraph::Context&) { out.pinion = out.pair.makePinion(); },
+      {s.params});
+  return s;
+}
+
+// Run the pair pipeline for one design on the shared pool
+inline PairPipelineResult runPairPipeline(
+    const BevelGearPair& input, CancellationToken token = CancellationToken(),
+    ProgressCallback progress = nullptr) {
+  PairPipelineResult out;
+  TaskGraph graph;
+  addPairPipeline(graph, input, out);
+  graph.setProgressCallback(std::move(progress));
+  graph.run(ThreadPool::shared(), token);
+  return out;
+}
+
+// Number of designs a sweep keeps in memory at once. The whole sweep if it
+// fits the current budget, otherwise blocks that take at most half of what
+// is left, so results are streamed to the caller instead of failing.
+inline size_t sweepBlockSize(size_t count) {
+  constexpr size_t minBlock = 64;
+  const size_t perDesign = sizeof(PairPipelineResult);
+  memory::Budget* budget = memory::currentBudget();
+  if (!budget || budget->fits(count * perDesign))
+    return std::max<size_t>(count, 1);
+  return std::max(minBlock, budget->available() / 2 / perDesign);
+}
+
+// Streaming sweep job: run the pair pipeline for designs [0, count), built on
+// demand by `design`, and hand the results to `sink` block by block together
+// with the index of the first design in the block. `design` is called from
+// worker threads. Designs are chunked with
+// parallelFor so a sweep cannot oversubscribe the machine, and the token is
+// checked between designs.
+inline void runPairSweepBlocks(
+    size_t count, const std::function<BevelGearPair(size_t)>& design,
+    const std::function<void(size_t first,
+                             std::vector<PairPipelineResult>& block)>& sink,
+    CancellationToken token = CancellationToken(),
+    ProgressCallback progress = nullptr) {
+  GEARLAB_TRACE_SCOPE("pairSweep");
+  const size_t blockSize = sweepBlockSize(count);
+  std::atomic<size_t> done{0};
+  std::vector<PairPipelineResult> block;
+  for (size_t first = 0; first < count; first += blockSize) {
+    const size_t n = std::min(blockSize, count - first);
+    memory::Reservation held(memory::Category::ResultBuffer,
+                             n * sizeof(PairPipelineResult));
+    block.assign(n, PairPipelineResult());
+    ThreadPool::shared().parallelFor(
+        0, n,
+        [&](size_t i) {
+          if (token.isCancelled())
+            return;
+          TaskGraph graph;
+          addPairPipeline(graph, design(first + i), block[i]);
+          // Waiting here runs queued stages, so nesting stays on the pool
+          graph.run(ThreadPool::shared(), token);
+          const size_t d = ++done;
+          if (progress)
+            progress("sweep", static_cast<double>(d) / count);
+        },
+        64);
+    if (token.isCancelled())
+      throw JobCancelled();
+    sink(first, block);
+  }
+}
+
+// Sweep job collecting every result in memory
+inline std::vector<PairPipelineResult> runPairSweep(
+    const std::vector<BevelGearPair>& designs,
+    CancellationToken token = CancellationToken(),
+    ProgressCallback progress = nullptr) {
+  std::vector<PairPipelineResult> results;
+  results.reserve(designs.size());
+  runPairSweepBlocks(
+      designs.size(), [&](size_t i) { return designs[i]; },
+      [&](size_t, std::vector<PairPipelineResult>& block) {
+        std::move(block.begin(), block.end(), std::back_inserter(results));
+      },
+      token, std::move(progress));
+  return results;
+}
@@ -0,0 +1,579 @@
+// ShardedSweep.hpp
+#pragma once
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../io/Json.hpp"
+#include "../io/ResultQuery.hpp"
+#include "../io/ResultStore.hpp"
+#include "SweepSpec.hpp"
+#include "Trace.hpp"
+
+extern char** environ;
+
+// Sweep split into shards of consecutive designs, computed by worker
+// processes and checkpointed to a run directory:
+//
+//   sweep.json         spec and shard size; a resumed run must match it
+//   shard-NNNNNN.glr   rows of one finished shard, "design" index first
+//   catalog.glr        merge of the finished shards, in design order
+//   pareto.glr         non-dominated valid rows of the catalog
+//
+// A shard file appears by atomic rename once all its rows are written, so
+// after a crash or pre-emption every shard file present is complete and
+// running the same sweep again computes only the missing shards. A partial
+// run can be merged at any time.
+//
+// Workers run `gearlab sweep-worker` (or any command running
+// runSweepWorker on its stdin/stdout) through /bin/sh, so a launch command
+// like `ssh node{worker} gearlab sweep-worker` spreads a sweep over hosts
+// without a shared file system: the spec goes to the worker and the rows
+// come back over the same stream. Rows travel as raw doubles, so all hosts
+// must share the byte order, as the .glr files already assume. A worker
+// that dies is restarted and its shard handed out again.
+//
+// Worker protocol, one command per line:
+//   -> spec <bytes>\n<spec json>
+//   -> shard <id> <first> <count>
+//   <- rows <id> <count> <columns>\n<count * columns doubles>
+//   <- error <id> <message>
+//   -> quit
+
+namespace shardedsweep {
+
+// Line and binary framing over a pair of file descriptors (a socket or the
+// stdin/stdout pipes of a worker)
+class Channel {
+public:
+  Channel(int in, int out) : in(in), out(out) {}
+
+  bool buffered() const { return pos < buffer.size(); }
+
+  // False at end of stream
+  bool readLine(std::string& line) {
+    for (;;) {
+      const size_t nl = buffer.find('\n', pos);
+      if (nl != std::string::npos) {
+        line.assign(buffer, pos, nl - pos);
+        pos = nl + 1;
+        return true;
+      }
+      if (!fill())
+        return false;
+    }
+  }
+
+  bool readExact(void* dst, size_t n) {
+    char* d = static_cast<char*>(dst);
+    while (n > 0) {
+      if (!buffered() && !fill())
+        return false;
+      const size_t k = std::min(n, buffer.size() - pos);
+      std::memcpy(d, buffer.data() + pos, k);
+      pos += k;
+      d += k;
+      n -= k;
+    }
+    return true;
+  }
+
+  // False once the peer is gone. Never raises SIGPIPE on a socket.
+  bool write(const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+      ssize_t w = ::send(out, p, n, MSG_NOSIGNAL);
+      if (w < 0 && errno == ENOTSOCK)
+        w = ::write(out, p, n);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w <= 0)
+        return false;
+      p += w;
+      n -= size_t(w);
+    }
+    return true;
+  }
+
+  bool writeLine(const std::string& line) {
+    const std::string l = line + "\n";
+    return write(l.data(), l.size());
+  }
+
+private:
+  bool fill() {
+    if (pos > 0) {
+      buffer.erase(0, pos);
+      pos = 0;
+    }
+    char chunk[64 * 1024];
+    for (;;) {
+      const ssize_t n = ::read(in, chunk, sizeof(chunk));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      buffer.append(chunk, size_t(n));
+      return true;
+    }
+  }
+
+  int in, out;
+  std::string buffer;
+  size_t pos = 0;
+};
+
+}  // namespace shardedsweep
+
+// Worker side of the protocol: compute the shards sent on `in` and answer
+// on `out` until quit or end of stream. maxShards stops early, as a
+// pre-empted worker would. Returns a process exit code.
+inline int runSweepWorker(int in = 0, int out = 1,
+                          size_t maxShards = size_t(-1)) {
+  trace::setThreadName("sweepWorker");
+  shardedsweep::Channel ch(in, out);
+  std::string line;
+  size_t specBytes = 0;
+  if (!ch.readLine(line) ||
+      std::sscanf(line.c_str(), "spec %zu", &specBytes) != 1)
+    return EXIT_FAILURE;
+  std::string text(specBytes, '\0');
+  if (!ch.readExact(&text[0], specBytes))
+    return EXIT_FAILURE;
+  SweepSpec spec;
+  try {
+    spec = SweepSpec::fromJson(json::parse(text));
+  } catch (const std::exception& e) {
+    ch.writeLine(std::string("error -1 ") + e.what());
+    return EXIT_FAILURE;
+  }
+  const size_t width = spec.columns().size() + 1;
+  std::vector<double> rows;
+  for (size_t done = 0; done < maxShards && ch.readLine(line);) {
+    long id;
+    size_t first, count;
+    if (line == "quit")
+      break;
+    if (std::sscanf(line.c_str(), "shard %ld %zu %zu", &id, &first,
+                    &count) != 3 ||
+        first + count > spec.size()) {
+      ch.writeLine("error -1 Invalid command: " + line);
+      return EXIT_FAILURE;
+    }
+    GEARLAB_TRACE_SCOPE("sweepWorker.shard");
+    try {
+      memory::Reservation held(memory::Category::ResultBuffer,
+                               count * width * sizeof(double));
+      rows.assign(count * width, 0.0);
+      spec.run(first, count, [&](size_t b, const double* r, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+          double* row = &rows[(b - first + i) * width];
+          row[0] = double(b + i);
+          std::copy(r + i * (width - 1), r + (i + 1) * (width - 1), row + 1);
+        }
+      });
+    } catch (const std::exception& e) {
+      ch.writeLine("error " + std::to_string(id) + " " + e.what());
+      continue;
+    }
+    char header[96];
+    std::snprintf(header, sizeof(header), "rows %ld %zu %zu\n", id, count,
+                  width);
+    if (!ch.write(header, std::strlen(header)) ||
+        !ch.write(rows.data(), rows.size() * sizeof(double)))
+      return EXIT_FAILURE;
+    ++done;
+  }
+  return EXIT_SUCCESS;
+}
+
+struct ShardedSweepOptions {
+  // Worker processes; 0 computes the shards in this process instead
+  int workers = 1;
+  // Worker command line for /bin/sh, "{worker}" replaced by the worker
+  // number. Required when workers > 0.
+  std::string command;
+  int maxRestarts = 3;  // Per worker, after a crash or pre-emption
+  ProgressCallback progress;
+};
+
+struct ShardedSweepMerge {
+  size_t rows = 0;           // In the catalog
+  size_t paretoRows = 0;
+  size_t missingShards = 0;  // Not finished yet, left out of the catalog
+};
+
+class ShardedSweep {
+public:
+  // Opens or creates the run directory. Throws std::invalid_argument if it
+  // holds a different sweep.
+  ShardedSweep(std::string dir, SweepSpec spec, size_t shardSize = 4096)
+      : runDir(std::move(dir)), sweep(std::move(spec)), shardSize(shardSize) {
+    if (shardSize == 0 || sweep.axes.empty())
+      throw std::invalid_argument("Sharded sweep needs axes and shards");
+    if (::mkdir(runDir.c_str(), 0777) != 0 && errno != EEXIST)
+      throw std::runtime_error("Cannot create " + runDir);
+    json::Value meta = json::Value::object();
+    meta["spec"] = sweep.toJson();
+    meta["shardSize"] = shardSize;
+    const std::string text = meta.dump();
+    const std::string path = runDir + "/sweep.json";
+    std::ifstream in(path);
+    if (in) {
+      std::stringstream existing;
+      existing << in.rdbuf();
+      if (existing.str() != text)
+        throw std::invalid_argument(runDir + " holds a different sweep");
+      return;
+    }
+    const std::string tmp = path + ".tmp";
+    {
+      std::ofstream out(tmp);
+      out << text;
+      if (!out.flush())
+        throw std::runtime_error("Cannot write " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+      throw std::runtime_error("Cannot write " + path);
+  }
+
+  const SweepSpec& spec() const { return sweep; }
+  const std::string& dir() const { return runDir; }
+
+  size_t shardCount() const {
+    return (sweep.size() + shardSize - 1) / shardSize;
+  }
+  size_t shardFirst(size_t k) const { return k * shardSize; }
+  size_t shardRows(size_t k) const {
+    return std::min(shardSize, sweep.size() - shardFirst(k));
+  }
+  std::string shardPath(size_t k) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/shard-%06zu.glr", k);
+    return runDir + name;
+  }
+
+  // Catalog columns: the design index, then the spec columns
+  std::vector<std::string> columns() const {
+    std::vector<std::string> c = sweep.columns();
+    c.insert(c.begin(), "design");
+    return c;
+  }
+
+  // A checkpoint counts only if it opens and has the expected shape
+  bool isComplete(size_t k) const {
+    try {
+      MappedResultTable t(shardPath(k));
+      return t.rowCount() == shardRows(k) &&
+             t.columnCount() == columns().size();
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  std::vector<size_t> pendingShards() const {
+    std::vector<size_t> pending;
+    for (size_t k = 0; k < shardCount(); ++k) {
+      if (!isComplete(k))
+        pending.push_back(k);
+    }
+    return pending;
+  }
+
+  // Compute every pending shard. Returns the number computed; finished
+  // shards of an earlier run are skipped. Throws std::runtime_error when a
+  // shard fails or every worker is gone, JobCancelled on cancellation;
+  // shards finished until then stay checkpointed.
+  size_t run(const ShardedSweepOptions& opt,
+             CancellationToken token = CancellationToken()) {
+    GEARLAB_TRACE_SCOPE("shardedSweep");
+    const std::vector<size_t> pending = pendingShards();
+    queue.assign(pending.begin(), pending.end());
+    todo = pending.size();
+    done = 0;
+    options = opt;
+    if (todo == 0)
+      return 0;
+    if (opt.workers <= 0) {
+      runInProcess(token);
+      return todo;
+    }
+    if (opt.command.empty())
+      throw std::invalid_argument("Sharded sweep needs a worker command");
+    workers.clear();
+    workers.resize(std::min<size_t>(size_t(opt.workers), todo));
+    try {
+      for (size_t w = 0; w < workers.size(); ++w) {
+        start(w);
+        assign(w);
+      }
+      coordinate(token);
+    } catch (...) {
+      stopWorkers(true);
+      throw;
+    }
+    stopWorkers(false);
+    return todo;
+  }
+
+  // Merge the finished shards into catalog.glr and, with objectives over
+  // the catalog columns, the non-dominated valid rows into pareto.glr
+  ShardedSweepMerge merge(
+      const std::vector<ParetoObjective>& objectives = {}) const {
+    GEARLAB_TRACE_SCOPE("shardedSweep.merge");
+    ShardedSweepMerge m;
+    const std::vector<std::string> names = columns();
+    const std::string catalogPath = runDir + "/catalog.glr";
+    {
+      ResultStoreWriter writer(catalogPath, names);
+      std::vector<double> row(names.size());
+      for (size_t k = 0; k < shardCount(); ++k) {
+        if (!isComplete(k)) {
+          ++m.missingShards;
+          continue;
+        }
+        MappedResultTable shard(shardPath(k));
+        for (size_t r = 0; r < shard.rowCount(); ++r) {
+          for (size_t c = 0; c < row.size(); ++c)
+            row[c] = shard.value(r, c);
+          writer.addRow(row);
+        }
+      }
+      m.rows = size_t(writer.rowCount());
+      writer.finish();
+    }
+    if (objectives.empty())
+      return m;
+
+    MappedResultTable catalog(catalogPath);
+    ResultQuery valid;
+    valid.filterColumn = int(std::find(names.begin(), names.end(), "valid") -
+                             names.begin());
+    valid.filterMin = valid.filterMax = 1;
+    const std::vector<uint32_t> rows =
+        runResultQuery(catalog, valid, ThreadPool::shared());
+    const std::vector<uint32_t> front =
+        runParetoQuery(catalog, objectives, &rows, ThreadPool::shared());
+    ResultStoreWriter writer(runDir + "/pareto.glr", names);
+    std::vector<double> row(names.size());
+    for (uint32_t r : front) {
+      for (size_t c = 0; c < row.size(); ++c)
+        row[c] = catalog.value(r, c);
+      writer.addRow(row);
+    }
+    writer.finish();
+    m.paretoRows = front.size();
+    return m;
+  }
+
+private:
+  struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+    std::unique_ptr<shardedsweep::Channel> channel;
+    long shard = -1;
+    int restarts = 0;
+    bool alive = false;
+  };
+
+  void runInProcess(const CancellationToken& token) {
+    const size_t width = columns().size();
+    std::vector<double> rows;
+    while (!queue.empty()) {
+      const size_t k = queue.front();
+      queue.pop_front();
+      rows.assign(shardRows(k) * width, 0.0);
+      sweep.run(
+          shardFirst(k), shardRows(k),
+          [&](size_t b, const double* r, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+              double* row = &rows[(b - shardFirst(k) + i) * width];
+              row[0] = double(b + i);
+              std::copy(r + i * (width - 1), r + (i + 1) * (width - 1),
+                        row + 1);
+            }
+          },
+          token);
+      checkpoint(k, rows.data());
+    }
+  }
+
+  // Atomically publish the rows of shard k
+  void checkpoint(size_t k, const double* rows) {
+    const size_t width = columns().size();
+    ResultStoreWriter writer(shardPath(k), columns());
+    for (size_t r = 0; r < shardRows(k); ++r)
+      writer.addRow(rows + r * width);
+    writer.finish();
+    ++done;
+    if (options.progress)
+      options.progress("shardedSweep", double(done) / todo);
+  }
+
+  void start(size_t w) {
+    Worker& wk = workers[w];
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0)
+      throw std::runtime_error("Cannot create a worker channel");
+    std::string cmd = options.command;
+    for (size_t at; (at = cmd.find("{worker}")) != std::string::npos;)
+      cmd.replace(at, 8, std::to_string(w));
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], 0);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], 1);
+    const char* argv[] = {"sh", "-c", cmd.c_str(), nullptr};
+    const int err = posix_spawn(&wk.pid, "/bin/sh", &fa, nullptr,
+                                const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&fa);
+    ::close(sv[1]);
+    if (err != 0) {
+      ::close(sv[0]);
+      throw std::runtime_error("Cannot start worker: " + cmd);
+    }
+    wk.fd = sv[0];
+    wk.channel = std::make_unique<shardedsweep::Channel>(wk.fd, wk.fd);
+    wk.alive = true;
+    wk.shard = -1;
+    const std::string text = sweep.toJson().dump();
+    wk.channel->writeLine("spec " + std::to_string(text.size()));
+    wk.channel->write(text.data(), text.size());
+  }
+
+  // Hand the next shard to an idle worker. A failed send shows up as end of
+  // stream on the next read.
+  void assign(size_t w) {
+    Worker& wk = workers[w];
+    if (!wk.alive || wk.shard >= 0 || queue.empty())
+      return;
+    wk.shard = long(queue.front());
+    queue.pop_front();
+    char line[96];
+    std::snprintf(line, sizeof(line), "shard %ld %zu %zu", wk.shard,
+                  shardFirst(size_t(wk.shard)), shardRows(size_t(wk.shard)));
+    wk.channel->writeLine(line);
+  }
+
+  void coordinate(const CancellationToken& token) {
+    std::vector<pollfd> fds;
+    std::vector<size_t> index;
+    while (done < todo) {
+      if (token.isCancelled())
+        throw JobCancelled();
+      fds.clear();
+      index.clear();
+      bool ready = false;
+      for (size_t w = 0; w < workers.size(); ++w) {
+        if (!workers[w].alive)
+          continue;
+        fds.push_back({workers[w].fd, POLLIN, 0});
+        index.push_back(w);
+        ready |= workers[w].channel->buffered();
+      }
+      if (fds.empty())
+        throw std::runtime_error("All sweep workers failed");
+      if (!ready && ::poll(fds.data(), fds.size(), 100) < 0 &&
+          errno != EINTR)
+        throw std::runtime_error("poll failed");
+      for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents || workers[index[i]].channel->buffered())
+          receive(index[i]);
+      }
+    }
+  }
+
+  void receive(size_t w) {
+    Worker& wk = workers[w];
+    std::string line;
+    if (!wk.channel->readLine(line)) {
+      lost(w);
+      return;
+    }
+    long id;
+    size_t count, width;
+    char message[512] = "";
+    if (std::sscanf(line.c_str(), "rows %ld %zu %zu", &id, &count, &width) ==
+        3) {
+      if (id != wk.shard || count != shardRows(size_t(id)) ||
+          width != columns().size())
+        throw std::runtime_error("Worker sent unexpected rows: " + line);
+      memory::Reservation held(memory::Category::ResultBuffer,
+                               count * width * sizeof(double));
+      std::vector<double> rows(count * width);
+      if (!wk.channel->readExact(rows.data(), rows.size() * sizeof(double))) {
+        lost(w);
+        return;
+      }
+      checkpoint(size_t(id), rows.data());
+      wk.shard = -1;
+      assign(w);
+    } else if (std::sscanf(line.c_str(), "error %ld %511[^\n]", &id,
+                           message) == 2) {
+      throw std::runtime_error("Sweep worker failed on shard " +
+                               std::to_string(id) + ": " + message);
+    } else {
+      throw std::runtime_error("Invalid worker reply: " + line);
+    }
+  }
+
+  // The worker died or was pre-empted: hand its shard out again and
+  // restart it while restarts remain
+  void lost(size_t w) {
+    Worker& wk = workers[w];
+    ::close(wk.fd);
+    ::waitpid(wk.pid, nullptr, 0);
+    wk.alive = false;
+    wk.channel.reset();
+    if (wk.shard >= 0)
+      queue.push_front(size_t(wk.shard));
+    wk.shard = -1;
+    if (queue.empty())
+      return;
+    if (wk.restarts < options.maxRestarts) {
+      ++wk.restarts;
+      start(w);
+    }
+    for (size_t v = 0; v < workers.size(); ++v)
+      assign(v);
+  }
+
+  void stopWorkers(bool kill) {
+    for (Worker& wk : workers) {
+      if (!wk.alive)
+        continue;
+      if (kill)
+        ::kill(wk.pid, SIGTERM);
+      else
+        wk.channel->writeLine("quit");
+      ::close(wk.fd);
+      ::waitpid(wk.pid, nullptr, 0);
+      wk.alive = false;
+    }
+  }
+
+  std::string runDir;
+  SweepSpec sweep;
+  size_t shardSize;
+
+  ShardedSweepOptions options;
+  std::deque<size_t> queue;
+  size_t todo = 0, done = 0;
+  std::vector<Worker> workers;
+};
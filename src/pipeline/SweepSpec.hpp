@@ -0,0 +1,194 @@
+// SweepSpec.hpp
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../analysis/LoadRating.hpp"
+#include "../geometry/PairFields.hpp"
+#include "../io/Json.hpp"
+#include "Pipeline.hpp"
+
+// One swept input: count values from start to stop, both included
+struct SweepAxis {
+  std::string key;
+  double start;
+  double stop;
+  int count;
+};
+
+// Grid of designs around a base pair and the result row of each: the axis
+// values, validity, the derived values and, with a load spectrum, the
+// pitting and bending safety. Design i varies the first axis fastest.
+// Shared by the CLI sweep and the sharded sweep so both produce the same
+// columns, and serialisable so worker processes rebuild the same grid.
+struct SweepSpec {
+  BevelGearPair base;
+  std::vector<SweepAxis> axes;
+  LoadSpectrum spectrum;  // Empty: no rating columns
+
+  size_t size() const {
+    size_t total = 1;
+    for (const auto& a : axes)
+      total *= size_t(a.count);
+    return total;
+  }
+
+  BevelGearPair design(size_t i) const {
+    BevelGearPair p = base;
+    size_t rest = i;
+    for (const auto& a : axes) {
+      const int k = static_cast<int>(rest % a.count);
+      rest /= a.count;
+      const double t = a.count > 1 ? double(k) / (a.count - 1) : 0.0;
+      PairFieldUtils::set(p, a.key, a.start + t * (a.stop - a.start));
+    }
+    return p;
+  }
+
+  std::vector<std::string> columns() const {
+    std::vector<std::string> names;
+    for (const auto& a : axes)
+      names.push_back(a.key);
+    for (const char* c : {"valid", "addendum", "dedendum", "pinionAddendum",
+                          "pinionDedendum", "pinionFaceConeOffset",
+                          "pinionRootConeOffset"})
+      names.push_back(c);
+    if (!spectrum.empty()) {
+      names.push_back("pittingSafety");
+      names.push_back("bendingSafety");
+    }
+    return names;
+  }
+
+  // Rows of designs [first, first + count), handed to sink block by block
+  // in row-major order. Designs are built on demand, so only one block of
+  // the range is held.
+  void run(size_t first, size_t count,
+           const std::function<void(size_t first, const double* rows,
+                                    size_t n)>& sink,
+           CancellationToken token = CancellationToken(),
+           ProgressCallback progress = nullptr) const {
+    runBlocks(
+        first, count,
+        [&](size_t blockFirst, const std::vector<PairPipelineResult>& block,
+            const double* rows) { sink(blockFirst, rows, block.size()); },
+        std::move(token), std::move(progress));
+  }
+
+  // As run, with the pipeline results of each block next to its rows for
+  // outputs that do not fit a row, such as per-design curves
+  void runBlocks(
+      size_t first, size_t count,
+      const std::function<void(size_t first,
+                               const std::vector<PairPipelineResult>& block,
+                               const double* rows)>& sink,
+      CancellationToken token = CancellationToken(),
+      ProgressCallback progress = nullptr) const {
+    const size_t width = columns().size();
+    std::vector<double> rows;
+    runPairSweepBlocks(
+        count, [&](size_t i) { return design(first + i); },
+        [&](size_t blockFirst, std::vector<PairPipelineResult>& block) {
+          RatingResults rating;
+          if (!spectrum.empty()) {
+            RatingInputs in;
+            in.reserve(block.size());
+            for (const auto& r : block)
+              in.push_back(*r.pinion, *r.gear);
+            rating = LoadRating().rate(in, spectrum);
+          }
+          memory::Reservation held(memory::Category::ResultBuffer,
+                                   block.size() * width * sizeof(double));
+          rows.resize(block.size() * width);
+          for (size_t i = 0; i < block.size(); ++i)
+            fillRow(block[i], spectrum.empty() ? nullptr : &rating, i,
+                    &rows[i * width]);
+          sink(first + blockFirst, block, rows.data());
+        },
+        token, std::move(progress));
+  }
+
+  // Row of result i of a block. Axis inputs are copied into the recomputed
+  // pair, so they are read back from it.
+  void fillRow(const PairPipelineResult& r, const RatingResults* rating,
+               size_t i, double* row) const {
+    size_t c = 0;
+    for (const auto& a : axes)
+      PairFieldUtils::get(r.pair, a.key, row[c++]);
+    const BevelGearPair& p = r.pair;
+    for (double v : {r.valid ? 1.0 : 0.0, p.addendum, p.dedendum,
+                     p.pinionAddendum, p.pinionDedendum,
+                     p.pinionFaceConeOffset, p.pinionRootConeOffset})
+      row[c++] = v;
+    if (rating) {
+      row[c++] = rating->minPittingSafety(i);
+      row[c++] = rating->minBendingSafety(i);
+    }
+  }
+
+  json::Value toJson() const {
+    json::Value v = json::Value::object();
+    json::Value& b = v["base"] = json::Value::object();
+    for (const char* name : PairFieldUtils::names) {
+      double x = 0;
+      PairFieldUtils::get(base, name, x);
+      b[name] = x;
+    }
+    json::Value& as = v["axes"] = json::Value::array();
+    for (const auto& a : axes) {
+      json::Value& j = as.push(json::Value::object());
+      j["key"] = a.key;
+      j["start"] = a.start;
+      j["stop"] = a.stop;
+      j["count"] = a.count;
+    }
+    json::Value& s = v["spectrum"] = json::Value::array();
+    for (const LoadBin& bin : spectrum) {
+      json::Value& j = s.push(json::Value::object());
+      j["torque"] = bin.torque;
+      j["speed"] = bin.speed;
+      j["hours"] = bin.hours;
+    }
+    return v;
+  }
+
+  // Throws std::invalid_argument for a malformed spec
+  static SweepSpec fromJson(const json::Value& v) {
+    auto number = [](const json::Value& o, const char* key) {
+      const json::Value* x = o.find(key);
+      if (!x || !x->isNumber())
+        throw std::invalid_argument(std::string("Sweep spec needs ") + key);
+      return x->asNumber();
+    };
+    const json::Value* b = v.find("base");
+    const json::Value* as = v.find("axes");
+    const json::Value* s = v.find("spectrum");
+    if (!b || !b->isObject() || !as || !as->isArray() || !s || !s->isArray())
+      throw std::invalid_argument("Malformed sweep spec");
+    SweepSpec spec;
+    for (const char* name : PairFieldUtils::names)
+      PairFieldUtils::set(spec.base, name, number(*b, name));
+    spec.base = PairFieldUtils::recompute(spec.base);
+    for (const json::Value& a : as->items()) {
+      const json::Value* key = a.find("key");
+      double probe;
+      if (!key || !key->isString() ||
+          !PairFieldUtils::get(spec.base, key->asString(), probe))
+        throw std::invalid_argument("Malformed sweep axis");
+      SweepAxis axis{key->asString(), number(a, "start"), number(a, "stop"),
+                     int(number(a, "count"))};
+      if (axis.count < 1)
+        throw std::invalid_argument("Sweep count must be positive");
+      spec.axes.push_back(axis);
+    }
+    for (const json::Value& bin : s->items()) {
+      spec.spectrum.push_back(LoadBin{number(bin, "torque"),
+                                      number(bin, "speed"),
+                                      number(bin, "hours")});
+    }
+    return spec;
+  }
+};
@@ -0,0 +1,197 @@
+// TaskGraph.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MemoryAccounting.hpp"
+#include "ThreadPool.hpp"
+
+// Shared cancellation flag. Copies refer to the same flag, so a UI or CLI
+// can keep one and cancel a job running on the pool.
+class CancellationToken {
+public:
+  CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+  void cancel() { flag->store(true, std::memory_order_relaxed); }
+  bool isCancelled() const { return flag->load(std::memory_order_relaxed); }
+
+private:
+  std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// Thrown by TaskGraph::run() when the job was cancelled
+struct JobCancelled : std::runtime_error {
+  JobCancelled() : std::runtime_error("Job cancelled") {}
+};
+
+// Called with the stage that reported and the overall job fraction [0, 1].
+// May be invoked from any worker thread.
+using ProgressCallback =
+    std::function<void(const std::string& stage, double fraction)>;
+
+// DAG of pipeline stages executed on a ThreadPool. A stage becomes ready when
+// all of its dependencies finished; independent branches (gear and pinion,
+// per-tooth work inside a stage via parallelFor) overlap on the pool.
+class TaskGraph {
+public:
+  using TaskId = size_t;
+
+  // Handed to every stage for cooperative cancellation and progress
+  class Context {
+  public:
+    bool isCancelled() const { return graph.token.isCancelled(); }
+
+    // Throws JobCancelled if the job was cancelled, for use inside loops
+    void checkCancelled() const {
+      if (isCancelled())
+        throw JobCancelled();
+    }
+
+    // Report progress of this stage in [0, 1]
+    void progress(double fraction) { graph.reportProgress(id, fraction); }
+
+    ThreadPool& pool() const { return *graph.pool; }
+    const CancellationToken& token() const { return graph.token; }
+
+    // Memory budget of the job, nullptr if unlimited. It is also current
+    // (memory::currentBudget()) on the thread running the stage and inside
+    // work the stage hands to pool().parallelFor.
+    memory::Budget* budget() const { return graph.budget; }
+
+  private:
+    friend class TaskGraph;
+    Context(TaskGraph& graph, TaskId id) : graph(graph), id(id) {}
+    TaskGraph& graph;
+    TaskId id;
+  };
+
+  using Stage = std::function<void(Context&)>;
+
+  TaskId add(std::string name, Stage fn, std::vector<TaskId> deps = {}) {
+    const TaskId id = tasks.size();
+    for (TaskId d : deps) {
+      if (d >= id)
+        throw std::invalid_argument("Dependency added after stage " + name);
+    }
+    auto t = std::make_unique<Task>();
+    t->name = std::move(name);
+    t->fn = std::move(fn);
+    t->deps = std::move(deps);
+    for (TaskId d : t->deps)
+      tasks[d]->dependents.push_back(id);
+    tasks.push_back(std::move(t));
+    return id;
+  }
+
+  void setProgressCallback(ProgressCallback cb) { onProgress = std::move(cb); }
+
+  // Budget charged by the stages of this job. Defaults to the budget current
+  // on the thread that built the graph, so nested jobs inherit it.
+  void setMemoryBudget(memory::Budget* b) { budget = b; }
+
+  size_t size() const { return tasks.size(); }
+  const std::string& name(TaskId id) const { return tasks.at(id)->name; }
+
+  // Execute all stages and block until they finished. The calling thread
+  // helps the pool. Rethrows the first stage exception, or JobCancelled if
+  // the token was cancelled before every stage ran.
+  void run(ThreadPool& pool = ThreadPool::shared(),
+           CancellationToken token = CancellationToken()) {
+    this->pool = &pool;
+    this->token = token;
+    remaining.store(tasks.size());
+    error = nullptr;
+    skipped = false;
+    for (auto& t : tasks) {
+      t->waiting.store(t->deps.size());
+      t->fraction.store(0);
+    }
+    for (TaskId id = 0; id < tasks.size(); ++id) {
+      if (tasks[id]->deps.empty())
+        schedule(id);
+    }
+    pool.waitUntil([this] { return remaining.load() == 0; });
+    if (error)
+      std::rethrow_exception(error);
+    if (skipped)
+      throw JobCancelled();
+  }
+
+private:
+  struct Task {
+    std::string name;
+    Stage fn;
+    std::vector<TaskId> deps;
+    std::vector<TaskId> dependents;
+    std::atomic<size_t> waiting{0};
+    std::atomic<double> fraction{0};
+  };
+
+  void schedule(TaskId id) {
+    pool->submit([this, id] { execute(id); });
+  }
+
+  void execute(TaskId id) {
+    Task& t = *tasks[id];
+    bool failed = false;
+    if (token.isCancelled() || skipped || hasError()) {
+      skipped = true;
+    } else {
+      try {
+        GEARLAB_TRACE_SCOPE(t.name.c_str());
+        memory::BudgetScope budgetScope(budget);
+        Context ctx(*this, id);
+        t.fn(ctx);
+      } catch (const JobCancelled&) {
+        skipped = true;
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error)
+          error = std::current_exception();
+        failed = true;
+      }
+    }
+    if (!failed && !skipped)
+      reportProgress(id, 1.0);
+    // Dependents still run their bookkeeping so the job always drains
+    for (TaskId d : t.dependents) {
+      if (tasks[d]->waiting.fetch_sub(1) == 1)
+        schedule(d);
+    }
+    remaining.fetch_sub(1);
+  }
+
+  bool hasError() {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return static_cast<bool>(error);
+  }
+
+  void reportProgress(TaskId id, double fraction) {
+    tasks[id]->fraction.store(fraction, std::memory_order_relaxed);
+    if (!onProgress)
+      return;
+    double sum = 0;
+    for (const auto& t : tasks)
+      sum += t->fraction.load(std::memory_order_relaxed);
+    onProgress(tasks[id]->name, sum / tasks.size());
+  }
+
+  std::vector<std::unique_ptr<Task>> tasks;
+  ProgressCallback onProgress;
+  ThreadPool* pool = nullptr;
+  CancellationToken token;
+  memory::Budget* budget = memory::currentBudget();
+  std::atomic<size_t> remaining{0};
+  std::atomic<bool> skipped{false};
+  std::mutex errorMutex;
+  std::exception_ptr error;
+};
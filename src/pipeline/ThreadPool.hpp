@@ -0,0 +1,214 @@
+// ThreadPool.hpp
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MemoryAccounting.hpp"
+#include "Trace.hpp"
+
+// Work-stealing thread pool shared by every GearLab job. Each worker owns a
+// deque: it pushes and pops its own work at the back (LIFO, cache friendly
+// for nested per-tooth work) and steals from the front of the others. Threads
+// waiting on a job help by running queued tasks, so nested parallelism never
+// spawns extra threads or deadlocks the pool. A task runs under the memory
+// budget that was current on the thread that submitted it.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(size_t numThreads = defaultThreadCount()) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    for (size_t i = 0; i < numThreads; ++i)
+      queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < numThreads; ++i)
+      threads.emplace_back([this, i] { workerLoop(i); });
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads)
+      t.join();
+  }
+
+  // Process wide pool, sized to the hardware
+  static ThreadPool& shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  static size_t defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  size_t size() const { return threads.size(); }
+
+  // Queue a task. From a worker thread it goes to that worker's own deque,
+  // otherwise queues are filled round robin. Tasks must not throw; use
+  // parallelFor or TaskGraph, which forward exceptions to the caller.
+  void submit(Task task) {
+    const size_t q = currentWorker() < queues.size() && currentPool() == this
+                         ? currentWorker()
+                         : next++ % queues.size();
+    {
+      std::lock_guard<std::mutex> lock(queues[q]->mutex);
+      queues[q]->tasks.push_back({std::move(task), memory::currentBudget()});
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      ++pending;
+    }
+    wake.notify_one();
+  }
+
+  // Run one queued task on the calling thread if any is available. Used by
+  // threads that wait on a job so they contribute instead of blocking.
+  bool runOne() {
+    Entry entry;
+    const size_t self = currentPool() == this ? currentWorker() : 0;
+    if (!take(self, entry))
+      return false;
+    run(entry);
+    return true;
+  }
+
+  // Split [begin, end) into chunks of at least grain and run f(i) for each
+  // index on the pool. Blocks until all chunks are done; the calling thread
+  // takes part in the work.
+  template <typename F>
+  void parallelFor(size_t begin, size_t end, F&& f, size_t grain = 1) {
+    if (begin >= end)
+      return;
+    const size_t n = end - begin;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks =
+        std::min((n + grain - 1) / grain, size() * 4);
+    if (chunks <= 1) {
+      for (size_t i = begin; i < end; ++i)
+        f(i);
+      return;
+    }
+    const size_t chunkSize = (n + chunks - 1) / chunks;
+    std::atomic<size_t> remaining{chunks};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    for (size_t c = 0; c < chunks; ++c) {
+      const size_t b = begin + c * chunkSize;
+      const size_t e = std::min(end, b + chunkSize);
+      submit([&, b, e] {
+        try {
+          for (size_t i = b; i < e; ++i)
+            f(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!error)
+            error = std::current_exception();
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+      });
+    }
+    waitUntil([&] { return remaining.load(std::memory_order_acquire) == 0; });
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  // Help with queued work until done() returns true
+  template <typename Pred>
+  void waitUntil(Pred done) {
+    while (!done()) {
+      if (!runOne())
+        std::this_thread::yield();
+    }
+  }
+
+private:
+  struct Entry {
+    Task task;
+    memory::Budget* budget = nullptr;  // current when submitted
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Entry> tasks;
+  };
+
+  static size_t& currentWorker() {
+    static thread_local size_t index = static_cast<size_t>(-1);
+    return index;
+  }
+
+  static ThreadPool*& currentPool() {
+    static thread_local ThreadPool* pool = nullptr;
+    return pool;
+  }
+
+  // Pop from our own queue first, then steal from the others
+  bool take(size_t self, Entry& entry) {
+    const size_t n = queues.size();
+    for (size_t k = 0; k < n; ++k) {
+      const size_t q = (self + k) % n;
+      std::lock_guard<std::mutex> lock(queues[q]->mutex);
+      auto& tasks = queues[q]->tasks;
+      if (tasks.empty())
+        continue;
+      if (k == 0) {
+        entry = std::move(tasks.back());
+        tasks.pop_back();
+      } else {
+        entry = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      std::lock_guard<std::mutex> sleepLock(sleepMutex);
+      --pending;
+      return true;
+    }
+    return false;
+  }
+
+  static void run(Entry& entry) {
+    memory::BudgetScope budgetScope(entry.budget);
+    entry.task();
+  }
+
+  void workerLoop(size_t index) {
+    currentWorker() = index;
+    currentPool() = this;
+    trace::setThreadName(("worker " + std::to_string(index)).c_str());
+    for (;;) {
+      Entry entry;
+      if (take(index, entry)) {
+        run(entry);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wake.wait(lock, [this] { return stopping || pending > 0; });
+      if (stopping && pending == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  size_t pending = 0;
+  bool stopping = false;
+  std::atomic<size_t> next{0};
+};
@@ -0,0 +1,221 @@
+// Trace.hpp
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped trace markers for the hot pipeline stages, dumped as Chrome trace
+// JSON (loads in chrome://tracing and ui.perfetto.dev).
+//
+// Markers are compiled in when GEARLAB_ENABLE_TRACING is defined (CMake
+// option GEARLAB_TRACING) and recorded only while trace::setEnabled(true).
+// A disabled marker costs one relaxed atomic load. Each thread writes
+// complete events into its own ring buffer without locks; the oldest events
+// are overwritten when a buffer is full.
+namespace trace {
+
+constexpr size_t maxNameLength = 47;
+
+struct Event {
+  char name[maxNameLength + 1];
+  uint64_t start;     // ns since trace epoch
+  uint64_t duration;  // ns
+};
+
+// Single producer ring buffer owned by one thread
+struct ThreadBuffer {
+  static constexpr size_t capacity = 1 << 14;  // power of two
+
+  std::unique_ptr<Event[]> events{new Event[capacity]};
+  std::atomic<uint64_t> head{0};
+  uint32_t tid = 0;
+  char threadName[32] = "";
+
+  void push(const char* name, uint64_t start, uint64_t duration) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    Event& e = events[h & (capacity - 1)];
+    std::strncpy(e.name, name, maxNameLength);
+    e.name[maxNameLength] = '\0';
+    e.start = start;
+    e.duration = duration;
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+struct Registry {
+  std::atomic<bool> enabled{false};
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  const std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+inline Registry& registry() {
+  static Registry r;
+  return r;
+}
+
+inline bool isEnabled() {
+  return registry().enabled.load(std::memory_order_relaxed);
+}
+
+inline void setEnabled(bool on) {
+  registry().enabled.store(on, std::memory_order_relaxed);
+}
+
+inline uint64_t now() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - registry().epoch)
+          .count());
+}
+
+inline char* pendingThreadName() {
+  thread_local char name[sizeof(ThreadBuffer::threadName)] = "";
+  return name;
+}
+
+inline ThreadBuffer*& currentBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  return buffer;
+}
+
+// Buffer of the calling thread, registered on first recorded event so
+// threads that never trace allocate nothing. Buffers outlive their threads
+// so events of finished workers still get dumped.
+inline ThreadBuffer& threadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> local = [] {
+    auto b = std::make_shared<ThreadBuffer>();
+    std::strcpy(b->threadName, pendingThreadName());
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    b->tid = static_cast<uint32_t>(r.buffers.size() + 1);
+    r.buffers.push_back(b);
+    currentBuffer() = b.get();
+    return b;
+  }();
+  return *local;
+}
+
+// Name shown for the calling thread in the trace viewer
+inline void setThreadName(const char* name) {
+  char* pending = pendingThreadName();
+  std::strncpy(pending, name, sizeof(ThreadBuffer::threadName) - 1);
+  if (ThreadBuffer* b = currentBuffer())
+    std::strcpy(b->threadName, pending);
+}
+
+// Records the lifetime of a scope as one complete event
+class Scope {
+public:
+  explicit Scope(const char* name) : name(name) {
+    if (isEnabled())
+      start = now();
+  }
+
+  ~Scope() {
+    if (start != notRecording)
+      threadBuffer().push(name, start, now() - start);
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  static constexpr uint64_t notRecording = ~uint64_t(0);
+  const char* name;
+  uint64_t start = notRecording;
+};
+
+inline void writeJsonString(FILE* f, const char* s) {
+  std::fputc('"', f);
+  for (; *s; ++s) {
+    const unsigned char c = static_cast<unsigned char>(*s);
+    if (c == '"' || c == '\\')
+      std::fprintf(f, "\\%c", c);
+    else if (c < 0x20)
+      std::fprintf(f, "\\u%04x", c);
+    else
+      std::fputc(c, f);
+  }
+  std::fputc('"', f);
+}
+
+// Write every buffered event as Chrome trace JSON. Safe to call while other
+// threads keep tracing; events overwritten during the copy are dropped.
+inline bool dumpChromeTrace(const std::string& path) {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    buffers = r.buffers;
+  }
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f)
+    return false;
+  std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  std::vector<Event> copy;
+  for (const auto& b : buffers) {
+    if (b->threadName[0]) {
+      std::fprintf(f,
+                   "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":%u,\"args\":{\"name\":",
+                   first ? "" : ",\n", b->tid);
+      writeJsonString(f, b->threadName);
+      std::fprintf(f, "}}");
+      first = false;
+    }
+    const uint64_t end = b->head.load(std::memory_order_acquire);
+    const uint64_t begin =
+        end > ThreadBuffer::capacity ? end - ThreadBuffer::capacity : 0;
+    copy.assign(b->events.get(), b->events.get() + ThreadBuffer::capacity);
+    // Anything older than capacity behind the new head may have been reused
+    const uint64_t after = b->head.load(std::memory_order_acquire);
+    const uint64_t valid =
+        after > ThreadBuffer::capacity ? after - ThreadBuffer::capacity : 0;
+    for (uint64_t i = std::max(begin, valid); i < end; ++i) {
+      const Event& e = copy[i & (ThreadBuffer::capacity - 1)];
+      std::fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+      writeJsonString(f, e.name);
+      std::fprintf(f,
+                   ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                   "\"dur\":%.3f}",
+                   b->tid, e.start / 1000.0, e.duration / 1000.0);
+      first = false;
+    }
+  }
+  std::fprintf(f, "\n]}\n");
+  return std::fclose(f) == 0;
+}
+
+// Enable tracing if GEARLAB_TRACE names an output file. Returns the path,
+// or an empty string when tracing stays off.
+inline std::string enableFromEnvironment() {
+  const char* path = std::getenv("GEARLAB_TRACE");
+  if (!path || !*path)
+    return "";
+  setEnabled(true);
+  return path;
+}
+
+}  // namespace trace
+
+#define GEARLAB_TRACE_CONCAT_(a, b) a##b
+#define GEARLAB_TRACE_CONCAT(a, b) GEARLAB_TRACE_CONCAT_(a, b)
+
+#ifdef GEARLAB_ENABLE_TRACING
+#define GEARLAB_TRACE_SCOPE(name) \
+  ::trace::Scope GEARLAB_TRACE_CONCAT(gearlabTrace_, __LINE__)(name)
+#else
+#define GEARLAB_TRACE_SCOPE(name) ((void)0)
+#endif
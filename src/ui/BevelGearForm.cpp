@@ -1,20 +1,29 @@
 #include "BevelGearForm.hpp"
 
+#include <QApplication>
 #include <QDebug>
 #include <QDialog>
+#include <QFile>
 #include <QFileDialog>
 #include <QFormLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QPointer>
 #include <QPushButton>
 #include <QTableWidget>
-#include <QTextStream>
 #include <QVBoxLayout>
 
+#include <sstream>
+
+#include "../io/ParamsToml.hpp"
+#include "../pipeline/Pipeline.hpp"
+#include "ResultBrowser.hpp"
+
 BevelGearForm::BevelGearForm(QWidget* parent, BevelGearPair pair)
     : QWidget(parent),
       pair(pair),
+      lazyPair(pair),
       gear(pair.makeGear()),
       pinion(pair.makePinion()) {
   QFormLayout* layout = new QFormLayout(this);
@@ -79,14 +88,34 @@ BevelGearForm::BevelGearForm(QWidget* parent, BevelGearPair pair)
   }
   layout->addRow("Spiral Function:", spiralTypeBox);
 
+  // Process and draft only drive the checks, they are not part of the pair
+  processBox = new QComboBox(this);
+  for (ManufacturingMethod m :
+       {ManufacturingMethod::Milling, ManufacturingMethod::ThreeD,
+        ManufacturingMethod::InjectionMoulding, ManufacturingMethod::Forging}) {
+    processBox->addItem(
+        QString::fromStdString(ManufacturingHelper::toString(m)),
+        QVariant::fromValue<int>(int(m)));
+  }
+  layout->addRow("Manufacturing:", processBox);
+  draftAngle = makeDoubleInput("Draft Angle (deg):", 0.0, 45.0,
+                               DraftOptions().draftAngle);
+  draftAngle->setEnabled(false);
+  connect(processBox, &QComboBox::currentIndexChanged, this, [this] {
+    draftAngle->setEnabled(DraftAnalysis::applies(ManufacturingMethod(
+        processBox->currentData().toInt())));
+  });
+
   // Buttons
   QPushButton* printBtn = new QPushButton("Print Gear Parameters", this);
   QPushButton* exportBtn = new QPushButton("Export Parameters", this);
   QPushButton* importBtn = new QPushButton("Import Parameters", this);
+  QPushButton* resultsBtn = new QPushButton("Open Results", this);
 
   layout->addRow(printBtn);
   layout->addRow(exportBtn);
   layout->addRow(importBtn);
+  layout->addRow(resultsBtn);
 
   connect(printBtn, &QPushButton::clicked, this,
           &BevelGearForm::onPrintClicked);
@@ -94,24 +123,73 @@ BevelGearForm::BevelGearForm(QWidget* parent, BevelGearPair pair)
           &BevelGearForm::onExportClicked);
   connect(importBtn, &QPushButton::clicked, this,
           &BevelGearForm::onImportClicked);
+  connect(resultsBtn, &QPushButton::clicked, this,
+          &BevelGearForm::onOpenResultsClicked);
+
+  // Every edit schedules an autosave
+  for (QSpinBox* spin : {numGearTeeth, numPinionTeeth})
+    connect(spin, &QSpinBox::valueChanged, this,
+            &BevelGearForm::onParametersEdited);
+  for (QDoubleSpinBox* spin :
+       {module, backlash, coneClearance, shaftAngle, faceConeAngle,
+        rootConeAngle, faceConeOffset, rootConeOffset, innerConeDistance,
+        outerConeDistance, pressureAngle, spiralAngle})
+    connect(spin, &QDoubleSpinBox::valueChanged, this,
+            &BevelGearForm::onParametersEdited);
+  connect(spiralTypeBox, &QComboBox::currentIndexChanged, this,
+          &BevelGearForm::onParametersEdited);
+
+  // Write results come back on the autosave thread; report them on the UI
+  // thread. Only an explicit export is worth a message box.
+  QPointer<BevelGearForm> self(this);
+  autosave = std::make_unique<AutosaveService>(
+      AutosaveOptions(), [self](const AutosaveResult& r) {
+        if (r.ok)
+          return;
+        QMetaObject::invokeMethod(
+            qApp,
+            [self, r] {
+              if (!self)
+                return;
+              if (r.now)
+                QMessageBox::warning(self, "Export Failed",
+                                     QString::fromStdString(r.error));
+              else
+                qWarning() << "Autosave failed:"
+                           << QString::fromStdString(r.error);
+            },
+            Qt::QueuedConnection);
+      });
 
   setLayout(layout);
 }
 
 void BevelGearForm::updatePairFromForm() {
-  pair = BevelGearPair(
-      numGearTeeth->value(), numPinionTeeth->value(), module->value(),
-      backlash->value(), coneClearance->value(), shaftAngle->value(),
-      faceConeAngle->value(), rootConeAngle->value(), faceConeOffset->value(),
-      rootConeOffset->value(), innerConeDistance->value(),
-      outerConeDistance->value(), pressureAngle->value(),
-      (spiralFunction)spiralTypeBox->currentData().toInt());
-
+  using P = BevelGearPair;
+  lazyPair.set(&P::numGearTeeth, numGearTeeth->value());
+  lazyPair.set(&P::numPinionTeeth, numPinionTeeth->value());
+  lazyPair.set(&P::module, module->value());
+  lazyPair.set(&P::backlash, backlash->value());
+  lazyPair.set(&P::coneClearance, coneClearance->value());
+  lazyPair.set(&P::shaftAngle, shaftAngle->value());
+  lazyPair.set(&P::faceConeAngle, faceConeAngle->value());
+  lazyPair.set(&P::rootConeAngle, rootConeAngle->value());
+  lazyPair.set(&P::faceConeOffset, faceConeOffset->value());
+  lazyPair.set(&P::rootConeOffset, rootConeOffset->value());
+  lazyPair.set(&P::innerConeDistance, innerConeDistance->value());
+  lazyPair.set(&P::outerConeDistance, outerConeDistance->value());
+  lazyPair.set(&P::pressureAngle, pressureAngle->value());
+  lazyPair.set(&P::spiralAngle, spiralAngle->value());
+  lazyPair.set(&P::spiralType,
+               (spiralFunction)spiralTypeBox->currentData().toInt());
+
+  pair = lazyPair.pair();
   gear = pair.makeGear();
   pinion = pair.makePinion();
 }
 
 void BevelGearForm::updateFormFromPair() {
+  updatingForm = true;
   numGearTeeth->setValue(pair.numGearTeeth);
   numPinionTeeth->setValue(pair.numPinionTeeth);
   module->setValue(pair.module);
@@ -127,11 +205,75 @@ void BevelGearForm::updateFormFromPair() {
   pressureAngle->setValue(pair.pressureAngle);
   spiralAngle->setValue(pair.spiralAngle);
   spiralTypeBox->setCurrentIndex(pair.spiralType);
+  updatingForm = false;
+}
+
+void BevelGearForm::onParametersEdited() {
+  if (updatingForm || rootDir.isEmpty() || projectName.isEmpty())
+    return;
+  updatePairFromForm();
+  autosave->schedule(parametersPath().toStdString(), snapshot());
+}
+
+QString BevelGearForm::parametersPath() const {
+  return rootDir + "/BevelGearParameters_" + projectName + ".toml";
+}
+
+AutosaveService::Serializer BevelGearForm::snapshot() const {
+  // Copying these values is all the UI thread pays for a save
+  const std::string name = projectName.toStdString();
+  const std::string dir = rootDir.toStdString();
+  const BevelGear g = gear, p = pinion;
+  return [name, dir, g, p](std::ostream& out) {
+    writeParamsToml(out, name, dir, g, p);
+  };
 }
 
 void BevelGearForm::onPrintClicked() {
   updatePairFromForm();
-  showResultDialog();
+
+  // Supersede a job that is still running for a previous click
+  pipelineJob.cancel();
+  pipelineJob = CancellationToken();
+
+  QPointer<BevelGearForm> self(this);
+  CancellationToken token = pipelineJob;
+  BevelGearPair input = pair;
+  const bool checkDraft = DraftAnalysis::applies(
+      ManufacturingMethod(processBox->currentData().toInt()));
+  DraftOptions draftOptions;
+  draftOptions.draftAngle = draftAngle->value();
+  ThreadPool::shared().submit([self, token, input, checkDraft,
+                               draftOptions] {
+    PairPipelineResult result;
+    std::optional<DraftResult> gearDraft, pinionDraft;
+    try {
+      result = runPairPipeline(input, token);
+      // Draft check of both members next to the parameter validation
+      if (checkDraft && result.valid && !token.isCancelled()) {
+        gearDraft = DraftAnalysis(*result.gear, draftOptions).run();
+        pinionDraft = DraftAnalysis(*result.pinion, draftOptions).run();
+      }
+    } catch (const JobCancelled&) {
+      return;
+    } catch (const std::exception& e) {
+      qWarning() << "Gear pair pipeline failed:" << e.what();
+      return;
+    }
+    // Hand the result back to the UI thread
+    QMetaObject::invokeMethod(
+        qApp,
+        [self, token, result, gearDraft, pinionDraft] {
+          if (!self || token.isCancelled())
+            return;
+          self->gear = *result.gear;
+          self->pinion = *result.pinion;
+          self->gearDraft = gearDraft;
+          self->pinionDraft = pinionDraft;
+          self->showResultDialog();
+        },
+        Qt::QueuedConnection);
+  });
 }
 
 void BevelGearForm::showResultDialog() {
@@ -194,6 +336,20 @@ void BevelGearForm::showResultDialog() {
          QString::number(pinion.spiralAngle));
   addRow("Spiral Function", spiralFunctionUtils::toString(gear.spiralType),
          spiralFunctionUtils::toString(pinion.spiralType));
+  if (gearDraft && pinionDraft) {
+    const DraftResult& g = *gearDraft;
+    const DraftResult& p = *pinionDraft;
+    addRow("Required Draft", QString::number(g.requiredDraft),
+           QString::number(p.requiredDraft));
+    addRow("Minimum Draft", QString::number(g.minDraft),
+           QString::number(p.minDraft));
+    addRow("Parting Plane Height", QString::number(g.partingZ),
+           QString::number(p.partingZ));
+    addRow("Undercut Area (mm^2)", QString::number(g.undercutArea),
+           QString::number(p.undercutArea));
+    addRow("Below Draft Area (mm^2)", QString::number(g.belowDraftArea),
+           QString::number(p.belowDraftArea));
+  }
 
   table->setShowGrid(true);
   dlgLayout->addWidget(table);
@@ -225,6 +381,14 @@ void BevelGearForm::onImportClicked() {
                          "Could not import gear parameters.");
 }
 
+void BevelGearForm::onOpenResultsClicked() {
+  QString filePath = QFileDialog::getOpenFileName(
+      this, "Open Results", rootDir, "GearLab results (*.glr *.glrc)");
+  if (filePath.isEmpty())
+    return;
+  ResultBrowser::open(filePath, this);
+}
+
 bool BevelGearForm::exportParameters() {
   if (rootDir.isEmpty() || projectName.isEmpty()) {
     QMessageBox::warning(this, "Missing Info",
@@ -233,50 +397,7 @@ bool BevelGearForm::exportParameters() {
   }
 
   updatePairFromForm();
-  QString filePath = rootDir + "/BevelGearParameters_" + projectName + ".toml";
-  QFile file(filePath);
-  if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
-    return false;
-
-  QTextStream out(&file);
-
-  // Project section
-  out << "[project]\n";
-  out << "projectName = \"" << projectName << "\"\n";
-  out << "rootDir = \"" << rootDir << "\"\n\n";
-
-  // Gear section
-  out << "[gear]\n";
-  out << "numTeeth = " << gear.numTeeth << "\n";
-  out << "module = " << gear.module << "\n";
-  out << "backlash = " << gear.backlash << "\n";
-  out << "shaftAngle = " << gear.shaftAngle << "\n";
-  out << "faceConeAngle = " << gear.faceConeAngle << "\n";
-  out << "rootConeAngle = " << gear.rootConeAngle << "\n";
-  out << "faceConeOffset = " << gear.faceConeOffset << "\n";
-  out << "rootConeOffset = " << gear.rootConeOffset << "\n";
-  out << "innerConeDistance = " << gear.innerConeDistance << "\n";
-  out << "outerConeDistance = " << gear.outerConeDistance << "\n";
-  out << "pressureAngle = " << gear.pressureAngle << "\n";
-  out << "spiralAngle = " << gear.spiralAngle << "\n";
-  out << "spiralType = " << (int)gear.spiralType << "\n\n";
-
-  // Pinion section
-  out << "[pinion]\n";
-  out << "numTeeth = " << pinion.numTeeth << "\n";
-  out << "module = " << pinion.module << "\n";
-  out << "backlash = " << pinion.backlash << "\n";
-  out << "shaftAngle = " << pinion.shaftAngle << "\n";
-  out << "faceConeAngle = " << pinion.faceConeAngle << "\n";
-  out << "rootConeAngle = " << pinion.rootConeAngle << "\n";
-  out << "faceConeOffset = " << pinion.faceConeOffset << "\n";
-  out << "rootConeOffset = " << pinion.rootConeOffset << "\n";
-  out << "innerConeDistance = " << pinion.innerConeDistance << "\n";
-  out << "outerConeDistance = " << pinion.outerConeDistance << "\n";
-  out << "pressureAngle = " << pinion.pressureAngle << "\n";
-  out << "spiralAngle = " << pinion.spiralAngle << "\n";
-  out << "spiralType = " << (int)pinion.spiralType << "\n";
-
+  autosave->saveNow(parametersPath().toStdString(), snapshot());
   return true;
 }
 
@@ -290,57 +411,15 @@ bool BevelGearForm::importParameters() {
   if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
     return false;
 
-  QTextStream in(&file);
-  QString currentSection;
-
-  QMap<QString, QString> gearParams;
-  QMap<QString, QString> pinionParams;
-
-  while (!in.atEnd()) {
-    QString line = in.readLine().trimmed();
-    if (line.startsWith("[")) {
-      if (line.contains("project"))
-        currentSection = "project";
-      else if (line.contains("gear"))
-        currentSection = "gear";
-      else if (line.contains("pinion"))
-        currentSection = "pinion";
-    } else if (line.contains("=")) {
-      auto parts = line.split("=");
-      if (parts.size() == 2) {
-        QString key = parts[0].trimmed();
-        QString value = parts[1].trimmed().replace("\"", "");
-
-        if (currentSection == "project") {
-          if (key == "projectName")
-            projectName = value;
-          if (key == "rootDir")
-            rootDir = value;
-        } else if (currentSection == "gear") {
-          gearParams[key] = value;
-        } else if (currentSection == "pinion") {
-          pinionParams[key] = value;
-        }
-      }
-    }
-  }
+  std::istringstream in(file.readAll().toStdString());
+  ParamsDocument doc = readParamsToml(in);
+  projectName = QString::fromStdString(doc.projectName);
+  rootDir = QString::fromStdString(doc.rootDir);
 
   // Construct pair again from imported values
-  pair = BevelGearPair(
-      gearParams["numTeeth"].toInt(), pinionParams["numTeeth"].toInt(),
-      gearParams["module"].toDouble(), gearParams["backlash"].toDouble(),
-      gearParams["coneClearance"].toDouble(),
-      gearParams["shaftAngle"].toDouble(),
-      gearParams["faceConeAngle"].toDouble(),
-      gearParams["rootConeAngle"].toDouble(),
-      gearParams["faceConeOffset"].toDouble(),
-      gearParams["rootConeOffset"].toDouble(),
-      gearParams["innerConeDistance"].toDouble(),
-      gearParams["outerConeDistance"].toDouble(),
-      gearParams["pressureAngle"].toDouble(),
-      gearParams["spiralAngle"].toDouble(),
-      (spiralFunction)gearParams["spiralType"].toInt());
+  pair = pairFromParams(doc);
 
+  lazyPair.assign(pair);
   gear = pair.makeGear();
   pinion = pair.makePinion();
   updateFormFromPair();
@@ -354,59 +433,19 @@ void BevelGearForm::importParametersFromDirSelect(const QString& filePath) {
     qWarning() << "Failed to open file:" << filePath;
     return;
   }
-  QTextStream in(&file);
-  QString currentSection;
-  QMap<QString, QString> gearParams;
-  QMap<QString, QString> pinionParams;
-
-  while (!in.atEnd()) {
-    QString line = in.readLine().trimmed();
-    if (line.startsWith("[")) {
-      if (line.contains("project"))
-        currentSection = "project";
-      else if (line.contains("gear"))
-        currentSection = "gear";
-      else if (line.contains("pinion"))
-        currentSection = "pinion";
-    } else if (line.contains("=")) {
-      auto parts = line.split("=");
-      if (parts.size() == 2) {
-        QString key = parts[0].trimmed();
-        QString value = parts[1].trimmed().replace("\"", "");
-        if (currentSection == "project") {
-          if (key == "projectName")
-            projectName = value;
-          if (key == "rootDir")
-            rootDir = value;
-        } else if (currentSection == "gear") {
-          gearParams[key] = value;
-        } else if (currentSection == "pinion") {
-          pinionParams[key] = value;
-        }
-      }
-    }
-  }
+  std::istringstream in(file.readAll().toStdString());
+  ParamsDocument doc = readParamsToml(in);
+  projectName = QString::fromStdString(doc.projectName);
+  rootDir = QString::fromStdString(doc.rootDir);
 
-  if (gearParams.isEmpty() || pinionParams.isEmpty()) {
+  if (doc.gear.empty() || doc.pinion.empty()) {
     qWarning() << "Gear or pinion parameters missing in file:" << filePath;
     return;
   }
 
-  pair = BevelGearPair(
-      gearParams["numTeeth"].toInt(), pinionParams["numTeeth"].toInt(),
-      gearParams["module"].toDouble(), gearParams["backlash"].toDouble(),
-      gearParams["coneClearance"].toDouble(),
-      gearParams["shaftAngle"].toDouble(),
-      gearParams["faceConeAngle"].toDouble(),
-      gearParams["rootConeAngle"].toDouble(),
-      gearParams["faceConeOffset"].toDouble(),
-      gearParams["rootConeOffset"].toDouble(),
-      gearParams["innerConeDistance"].toDouble(),
-      gearParams["outerConeDistance"].toDouble(),
-      gearParams["pressureAngle"].toDouble(),
-      gearParams["spiralAngle"].toDouble(),
-      (spiralFunction)gearParams["spiralType"].toInt());
+  pair = pairFromParams(doc);
 
+  lazyPair.assign(pair);
   gear = pair.makeGear();
   pinion = pair.makePinion();
   updateFormFromPair();
@@ -6,17 +6,27 @@
 #include <QSpinBox>
 #include <QString>
 #include <QWidget>
+#include <memory>
+#include <optional>
 #include "../geometry/GearParams.hpp"
+#include "../geometry/ParamGraph.hpp"
+#include "../io/Autosave.hpp"
+#include "../manufacturing/Draft.hpp"
+#include "../pipeline/TaskGraph.hpp"
 
 /**
  * @brief Form widget for editing and persisting bevel gear parameters.
  *
  * Displays inputs for a BevelGearPair and provides:
- *  - Live calculation/preview (via Print).
+ *  - Live calculation/preview (via Print), with the draft and undercut
+ *    check of both members when the process is moulding or forging.
  *  - Export to TOML (project, gear, pinion sections).
  *  - Import from TOML (populate widgets + internal state).
+ *  - Autosave of edits to the same TOML, written in the background.
  *
  * The widget maintains a root output directory and project name used for I/O.
+ * All writes go through an AutosaveService, so the UI thread only copies the
+ * parameters and a crash cannot leave a half-written file.
  */
 class BevelGearForm : public QWidget {
   Q_OBJECT
@@ -32,6 +42,11 @@ public:
       BevelGearPair pair =
           BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43, 60, 20));
 
+  /**
+   * @brief Cancel any pipeline job still running for this form.
+   */
+  ~BevelGearForm() override { pipelineJob.cancel(); }
+
   // I/O
 
   /**
@@ -44,7 +59,10 @@ public:
    *  - [gear]: values from the computed gear
    *  - [pinion]: values from the computed pinion
    *
-   * @return true on success, false on failure (missing fields or I/O error).
+   * The file is written on the autosave thread without waiting for the
+   * quiet period; a failed write is reported in a message box.
+   *
+   * @return true if the write was queued, false if fields are missing.
    */
   bool exportParameters();
 
@@ -109,7 +127,9 @@ public:
 
 private slots:
   /**
-   * @brief Show calculated results in a modal dialog (does not persist).
+   * @brief Run the pair pipeline on the shared pool, and the draft analysis
+   * of gear and pinion if the selected process needs draft, then show the
+   * results in a modal dialog (does not persist).
    */
   void onPrintClicked();
 
@@ -123,11 +143,25 @@ private slots:
    */
   void onImportClicked();
 
+  /**
+   * @brief Choose a .glr or .glrc result store and open it in a ResultBrowser.
+   */
+  void onOpenResultsClicked();
+
+  /**
+   * @brief Queue an autosave of the edited parameters; edits in quick
+   * succession are coalesced into one write.
+   */
+  void onParametersEdited();
+
 private:
   // Internal helpers
 
   /**
-   * @brief Read all widget values and rebuild @ref pair, @ref gear, @ref pinion.
+   * @brief Read all widget values and refresh @ref pair, @ref gear, @ref pinion.
+   *
+   * Values are pushed field by field into @ref lazyPair so only derived
+   * quantities depending on an edited field are recomputed.
    */
   void updatePairFromForm();
 
@@ -141,14 +175,42 @@ private:
    */
   void showResultDialog();
 
+  /**
+   * @brief Path of the project TOML in @ref rootDir.
+   */
+  QString parametersPath() const;
+
+  /**
+   * @brief Serializer owning a copy of the current project values, for the
+   * autosave thread.
+   */
+  AutosaveService::Serializer snapshot() const;
+
   // Members
   QString rootDir;
   QString projectName;
 
   BevelGearPair pair;
+  LazyBevelGearPair lazyPair;
   BevelGear gear;
   BevelGear pinion;
 
+  // Draft check of the last printed pair, empty unless the process was
+  // moulding or forging
+  std::optional<DraftResult> gearDraft;
+  std::optional<DraftResult> pinionDraft;
+
+  // Token of the latest pipeline job submitted by this form
+  CancellationToken pipelineJob;
+
+  // Background writer of the project TOML; writes pending edits when the
+  // form is destroyed
+  std::unique_ptr<AutosaveService> autosave;
+
+  // Set while updateFormFromPair() fills the widgets, so their change
+  // signals are not taken for edits
+  bool updatingForm = false;
+
   // Form widgets
   QSpinBox* numGearTeeth;
   QSpinBox* numPinionTeeth;
@@ -165,4 +227,6 @@ private:
   QDoubleSpinBox* pressureAngle;
   QDoubleSpinBox* spiralAngle;
   QComboBox* spiralTypeBox;
+  QComboBox* processBox;
+  QDoubleSpinBox* draftAngle;
 };
@@ -0,0 +1,122 @@
+#include "ResultBrowser.hpp"
+
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <limits>
+
+#include "../io/ColumnarStore.hpp"
+
+ResultBrowser::ResultBrowser(std::shared_ptr<const ResultTable> table,
+                             QWidget* parent)
+    : QDialog(parent) {
+  setWindowTitle("Results");
+  resize(1000, 700);
+
+  model = new ResultTableModel(std::move(table), this);
+
+  view = new QTableView(this);
+  view->setModel(model);
+  // No sort indicator, so enabling sorting keeps the file order
+  view->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+  view->setSortingEnabled(true);
+  view->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+  // Fixed row heights keep the header from measuring millions of rows
+  view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  view->verticalHeader()->setDefaultSectionSize(
+      view->fontMetrics().height() + 6);
+
+  // Range filter on one column
+  filterColumn = new QComboBox(this);
+  for (int c = 0; c < model->columnCount(); ++c)
+    filterColumn->addItem(model->headerData(c, Qt::Horizontal).toString());
+
+  auto makeBound = [&](double value) {
+    QDoubleSpinBox* spin = new QDoubleSpinBox(this);
+    spin->setRange(-std::numeric_limits<double>::max(),
+                   std::numeric_limits<double>::max());
+    spin->setDecimals(6);
+    spin->setValue(value);
+    return spin;
+  };
+  filterMin = makeBound(0.0);
+  filterMax = makeBound(0.0);
+
+  QPushButton* applyBtn = new QPushButton("Apply Filter", this);
+  QPushButton* clearBtn = new QPushButton("Clear Filter", this);
+  QPushButton* closeBtn = new QPushButton("Close", this);
+
+  QHBoxLayout* filterLayout = new QHBoxLayout();
+  filterLayout->addWidget(new QLabel("Filter:", this));
+  filterLayout->addWidget(filterColumn);
+  filterLayout->addWidget(new QLabel("from", this));
+  filterLayout->addWidget(filterMin);
+  filterLayout->addWidget(new QLabel("to", this));
+  filterLayout->addWidget(filterMax);
+  filterLayout->addWidget(applyBtn);
+  filterLayout->addWidget(clearBtn);
+
+  status = new QLabel(this);
+
+  QHBoxLayout* bottomLayout = new QHBoxLayout();
+  bottomLayout->addWidget(status, 1);
+  bottomLayout->addWidget(closeBtn);
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->addLayout(filterLayout);
+  layout->addWidget(view);
+  layout->addLayout(bottomLayout);
+
+  connect(applyBtn, &QPushButton::clicked, this,
+          &ResultBrowser::onApplyFilter);
+  connect(clearBtn, &QPushButton::clicked, this,
+          &ResultBrowser::onClearFilter);
+  connect(closeBtn, &QPushButton::clicked, this, &QDialog::accept);
+  connect(model, &ResultTableModel::busyChanged, this,
+          &ResultBrowser::onBusyChanged);
+
+  onBusyChanged(false);
+}
+
+ResultBrowser* ResultBrowser::open(const QString& filePath, QWidget* parent) {
+  std::shared_ptr<const ResultTable> table;
+  try {
+    const std::string path = filePath.toStdString();
+    if (filePath.endsWith(".glrc"))
+      table = std::make_shared<const ColumnarResultTable>(path);
+    else
+      table = std::make_shared<const MappedResultTable>(path);
+  } catch (const std::exception& e) {
+    QMessageBox::warning(parent, "Open Failed", e.what());
+    return nullptr;
+  }
+  ResultBrowser* browser = new ResultBrowser(std::move(table), parent);
+  browser->setWindowTitle("Results - " + QFileInfo(filePath).fileName());
+  browser->setAttribute(Qt::WA_DeleteOnClose);
+  browser->show();
+  return browser;
+}
+
+void ResultBrowser::onApplyFilter() {
+  if (filterColumn->currentIndex() < 0)
+    return;
+  model->setRangeFilter(filterColumn->currentIndex(), filterMin->value(),
+                        filterMax->value());
+}
+
+void ResultBrowser::onClearFilter() {
+  model->clearFilter();
+}
+
+void ResultBrowser::onBusyChanged(bool busy) {
+  if (busy) {
+    status->setText("Sorting/filtering...");
+    return;
+  }
+  status->setText(QString("%1 of %2 rows")
+                      .arg(model->matchingRows())
+                      .arg(model->totalRows()));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QComboBox>
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QTableView>
+#include <memory>
+
+#include "ResultTableModel.hpp"
+
+/**
+ * @brief Dialog for browsing large batch results (sweeps, tolerance runs).
+ *
+ * Shows a ResultTableModel in a QTableView with header-click sorting and a
+ * single-column range filter. Both run off the UI thread, so the dialog
+ * stays responsive on result sets with millions of rows.
+ */
+class ResultBrowser : public QDialog {
+  Q_OBJECT
+public:
+  /**
+   * @brief Construct a browser over an already opened table.
+   * @param table  Result table to display.
+   * @param parent Parent QWidget.
+   */
+  explicit ResultBrowser(std::shared_ptr<const ResultTable> table,
+                         QWidget* parent = nullptr);
+
+  /**
+   * @brief Map a .glr or .glrc result store and show it in a non-modal
+   *        browser.
+   *
+   * @param filePath Path to the result store.
+   * @param parent   Parent QWidget.
+   * @return The browser, or nullptr if the file could not be opened.
+   */
+  static ResultBrowser* open(const QString& filePath,
+                             QWidget* parent = nullptr);
+
+private slots:
+  /**
+   * @brief Apply the range filter from the filter widgets.
+   */
+  void onApplyFilter();
+
+  /**
+   * @brief Remove the range filter.
+   */
+  void onClearFilter();
+
+  /**
+   * @brief Update the status line while a sort/filter job runs.
+   */
+  void onBusyChanged(bool busy);
+
+private:
+  ResultTableModel* model;
+  QTableView* view;
+  QComboBox* filterColumn;
+  QDoubleSpinBox* filterMin;
+  QDoubleSpinBox* filterMax;
+  QLabel* status;
+};
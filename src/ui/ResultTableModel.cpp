@@ -0,0 +1,128 @@
+#include "ResultTableModel.hpp"
+
+#include <QApplication>
+#include <QDebug>
+#include <QPointer>
+#include <algorithm>
+
+ResultTableModel::ResultTableModel(std::shared_ptr<const ResultTable> table,
+                                   QObject* parent)
+    : QAbstractTableModel(parent), table(std::move(table)) {
+  loadedRows = int(std::min<qint64>(pageSize, matchingRows()));
+}
+
+ResultTableModel::~ResultTableModel() {
+  job.cancel();
+}
+
+int ResultTableModel::rowCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : loadedRows;
+}
+
+int ResultTableModel::columnCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : int(table->columnCount());
+}
+
+QVariant ResultTableModel::data(const QModelIndex& index, int role) const {
+  if (!index.isValid() || index.row() >= loadedRows)
+    return QVariant();
+  if (role == Qt::DisplayRole)
+    return table->value(sourceRow(index.row()), size_t(index.column()));
+  if (role == Qt::TextAlignmentRole)
+    return int(Qt::AlignRight | Qt::AlignVCenter);
+  return QVariant();
+}
+
+QVariant ResultTableModel::headerData(int section, Qt::Orientation orientation,
+                                      int role) const {
+  if (role != Qt::DisplayRole)
+    return QVariant();
+  if (orientation == Qt::Horizontal)
+    return QString::fromStdString(table->columnName(size_t(section)));
+  // Show the row number in the file, which stays stable across sorting
+  return qulonglong(sourceRow(section));
+}
+
+bool ResultTableModel::canFetchMore(const QModelIndex& parent) const {
+  return !parent.isValid() && loadedRows < matchingRows();
+}
+
+void ResultTableModel::fetchMore(const QModelIndex& parent) {
+  if (parent.isValid())
+    return;
+  const int add = int(std::min<qint64>(pageSize, matchingRows() - loadedRows));
+  if (add <= 0)
+    return;
+  beginInsertRows(QModelIndex(), loadedRows, loadedRows + add - 1);
+  loadedRows += add;
+  endInsertRows();
+}
+
+qint64 ResultTableModel::matchingRows() const {
+  return rows ? qint64(rows->size()) : qint64(table->rowCount());
+}
+
+void ResultTableModel::sort(int column, Qt::SortOrder order) {
+  query.sortColumn = column;
+  query.descending = order == Qt::DescendingOrder;
+  rebuildView();
+}
+
+void ResultTableModel::setRangeFilter(int column, double min, double max) {
+  query.filterColumn = column;
+  query.filterMin = min;
+  query.filterMax = max;
+  rebuildView();
+}
+
+void ResultTableModel::clearFilter() {
+  query.filterColumn = -1;
+  rebuildView();
+}
+
+void ResultTableModel::rebuildView() {
+  job.cancel();
+  job = CancellationToken();
+
+  if (query.filterColumn < 0 && query.sortColumn < 0) {
+    beginResetModel();
+    rows.reset();
+    loadedRows = int(std::min<qint64>(pageSize, matchingRows()));
+    endResetModel();
+    emit busyChanged(false);
+    return;
+  }
+
+  emit busyChanged(true);
+  QPointer<ResultTableModel> self(this);
+  CancellationToken token = job;
+  std::shared_ptr<const ResultTable> source = table;
+  ResultQuery q = query;
+  ThreadPool::shared().submit([self, token, source, q] {
+    std::shared_ptr<const std::vector<uint32_t>> result;
+    try {
+      result = std::make_shared<const std::vector<uint32_t>>(
+          runResultQuery(*source, q, ThreadPool::shared(), token));
+    } catch (const JobCancelled&) {
+      return;
+    } catch (const std::exception& e) {
+      qWarning() << "Result query failed:" << e.what();
+    }
+    // Swap the index in on the UI thread
+    QMetaObject::invokeMethod(
+        qApp,
+        [self, token, result] {
+          if (!self || token.isCancelled())
+            return;
+          if (result) {
+            self->beginResetModel();
+            self->rows = result;
+            self->loadedRows =
+                int(std::min<qint64>(pageSize, self->matchingRows()));
+            self->endResetModel();
+          }
+          emit self->busyChanged(false);
+        },
+        Qt::QueuedConnection);
+  });
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../io/ResultQuery.hpp"
+
+/**
+ * @brief Table model over a ResultTable (e.g. a memory-mapped .glr store).
+ *
+ * Cells are read from the table on demand, so opening a result set costs
+ * nothing beyond mapping the file. Rows are exposed to views in pages
+ * through canFetchMore()/fetchMore().
+ *
+ * Sorting and range filtering build a row index on the shared ThreadPool.
+ * The view keeps showing the previous order until the new index is ready,
+ * then the model resets on the UI thread. A newer request cancels an older
+ * one that is still running.
+ */
+class ResultTableModel : public QAbstractTableModel {
+  Q_OBJECT
+public:
+  /// Rows handed to the view per fetchMore() call.
+  static constexpr int pageSize = 100000;
+
+  /**
+   * @brief Construct a model over a result table.
+   * @param table  Shared table; kept alive by the model and running jobs.
+   * @param parent Parent QObject.
+   */
+  explicit ResultTableModel(std::shared_ptr<const ResultTable> table,
+                            QObject* parent = nullptr);
+
+  /**
+   * @brief Cancel a running sort/filter job.
+   */
+  ~ResultTableModel() override;
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+
+  /**
+   * @brief Sort by a column off the UI thread (called by QTableView).
+   */
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+  /**
+   * @brief Keep only rows with @p min <= value(column) <= @p max.
+   */
+  void setRangeFilter(int column, double min, double max);
+
+  /**
+   * @brief Remove the range filter.
+   */
+  void clearFilter();
+
+  /**
+   * @brief Number of rows matching the current filter (loaded or not).
+   */
+  qint64 matchingRows() const;
+
+  /**
+   * @brief Number of rows in the underlying table.
+   */
+  qint64 totalRows() const { return qint64(table->rowCount()); }
+
+signals:
+  /**
+   * @brief Emitted when a sort/filter job starts (true) or ends (false).
+   */
+  void busyChanged(bool busy);
+
+private:
+  /**
+   * @brief Start a job computing the row index for @ref query.
+   */
+  void rebuildView();
+
+  /**
+   * @brief Map a view row to a table row.
+   */
+  size_t sourceRow(int row) const {
+    return rows ? (*rows)[size_t(row)] : size_t(row);
+  }
+
+  std::shared_ptr<const ResultTable> table;
+  std::shared_ptr<const std::vector<uint32_t>> rows;  // null means identity
+  ResultQuery query;
+  int loadedRows = 0;
+  CancellationToken job;
+};
@@ -0,0 +1,25 @@
+// ReferencePairs.hpp
+// Gear pairs shared by the analysis and manufacturing tests: the reference
+// designs of assets/CAD, same parameter sets as tests/test_gearparams.cpp
+#pragma once
+
+#include "../src/geometry/GearParams.hpp"
+
+// assets/CAD/Gear_1.FCStd, straight teeth, 9-11 ratio
+inline BevelGearPair straightPair() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                       60, 20);
+}
+
+// assets/CAD/Gear_2.FCStd with a 30 deg spiral, 9-14 ratio
+inline BevelGearPair spiralPair() {
+  return BevelGearPair(14, 9, 4.77651, 0.1, 1.5, 90, 65, 45, 1.2, 0, 24.0405,
+                       60, 20, 30);
+}
+
+// straightPair() with stub teeth, contact ratio well below 1: some rotations
+// have no tooth in contact
+inline BevelGearPair stubPair() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, -7, 7, 19.43,
+                       60, 20);
+}
@@ -0,0 +1,226 @@
+// test_autosave.cpp
+// Unit test for atomic file replacement and the background autosave
+// service: coalescing, flush, snapshots, failures and writers killed
+// mid-write
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../src/io/Autosave.hpp"
+#include "../src/io/ParamsToml.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+using namespace std::chrono_literals;
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+bool exists(const std::string& path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0;
+}
+
+void waitIdle(const AutosaveService& s) {
+  while (s.busy())
+    std::this_thread::sleep_for(1ms);
+}
+
+bool testAtomicWrite(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Atomic replace" << std::endl;
+  bool passed = true;
+  passed &= check("New file written", writeFileAtomically(path, "one") &&
+                                          readFile(path) == "one");
+  chmod(path.c_str(), 0600);
+  passed &= check("Existing file replaced", writeFileAtomically(path, "two") &&
+                                                readFile(path) == "two");
+  struct stat st;
+  passed &= check("Permissions kept", ::stat(path.c_str(), &st) == 0 &&
+                                          (st.st_mode & 0777) == 0600);
+  passed &= check("No temporary left behind", !exists(path + ".tmp"));
+
+  std::string error;
+  const bool ok =
+      writeFileAtomically("no_such_dir_autosave/x.toml", "x", &error);
+  passed &= check("Failure reported with a reason",
+                  !ok && error.find("no_such_dir_autosave") !=
+                             std::string::npos);
+
+  // A writer killed at a random point of replacing a large file leaves the
+  // old or the new contents, never a torn file
+  bool whole = true;
+  const std::string a(8 << 20, 'a'), b(8 << 20, 'b');
+  writeFileAtomically(path, a);
+  for (int round = 0; round < 6; ++round) {
+    const pid_t child = fork();
+    if (child == 0) {
+      for (int i = 0;; ++i)
+        writeFileAtomically(path, i % 2 ? a : b);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20 + 17 * round));
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    const std::string s = readFile(path);
+    whole &= s == a || s == b;
+  }
+  passed &= check("Killed writer leaves a whole file", whole);
+  std::remove((path + ".tmp").c_str());
+  return passed;
+}
+
+bool testCoalescing(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Coalescing" << std::endl;
+  bool passed = true;
+  AutosaveOptions opt;
+  opt.quiet = 50ms;
+  opt.maxDelay = 150ms;
+  std::atomic<size_t> covered{0};
+  AutosaveService service(opt, [&](const AutosaveResult& r) {
+    covered += r.requests;
+  });
+
+  // A burst of edits is one write of the last state
+  for (int i = 0; i < 50; ++i) {
+    service.schedule(path, [i](std::ostream& out) { out << "edit " << i; });
+  }
+  passed &= check("Nothing written during the burst",
+                  service.stats().writes == 0);
+  waitIdle(service);
+  passed &= check("Burst written once with the last edit",
+                  service.stats().writes == 1 && covered == 50 &&
+                      readFile(path) == "edit 49");
+
+  // Edits that never pause are still saved every maxDelay
+  const auto start = std::chrono::steady_clock::now();
+  int i = 0;
+  while (std::chrono::steady_clock::now() - start < 500ms) {
+    service.schedule(path, [i](std::ostream& out) { out << "steady " << i; });
+    ++i;
+    std::this_thread::sleep_for(5ms);
+  }
+  const uint64_t during = service.stats().writes - 1;
+  waitIdle(service);
+  passed &= check("Continuous edits saved every maxDelay",
+                  during >= 2 && during <= 5 &&
+                      readFile(path) == "steady " + std::to_string(i - 1));
+
+  // The serializer sees the snapshot it captured, not later state
+  BevelGearPair pair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                     60, 20);
+  service.schedule(path, [pair](std::ostream& out) {
+    writeParamsToml(out, "snap", "/tmp", pair.makeGear(), pair.makePinion());
+  });
+  pair.module = 7;
+  passed &= check("Flush writes at once", service.flush());
+  std::istringstream in(readFile(path));
+  passed &= check("Snapshot taken when scheduled",
+                  std::abs(pairFromParams(readParamsToml(in)).module -
+                           5.593454) < 1e-4);
+
+  const std::string other = path + ".other";
+  service.schedule(path, [](std::ostream& out) { out << "p"; });
+  service.schedule(other, [](std::ostream& out) { out << "q"; });
+  service.flush();
+  passed &= check("Paths saved independently",
+                  readFile(path) == "p" && readFile(other) == "q");
+  std::remove(other.c_str());
+  return passed;
+}
+
+bool testNowAndFailures(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Immediate saves, failures and shutdown" << std::endl;
+  bool passed = true;
+  AutosaveOptions opt;
+  opt.quiet = 10s;
+  opt.maxDelay = 60s;
+  std::string lastError;
+  {
+    AutosaveService service(opt, [&](const AutosaveResult& r) {
+      if (!r.ok)
+        lastError = r.error;
+    });
+    const auto start = std::chrono::steady_clock::now();
+    service.saveNow(path, [](std::ostream& out) { out << "now"; });
+    waitIdle(service);
+    passed &= check("saveNow skips the quiet period",
+                    readFile(path) == "now" &&
+                        std::chrono::steady_clock::now() - start < 1s);
+
+    service.saveNow(path, [](std::ostream&) {
+      throw std::runtime_error("serializer failed");
+    });
+    passed &= check("Failed write reported by flush", !service.flush());
+    passed &= check("Target untouched by the failure",
+                    readFile(path) == "now" &&
+                        lastError == "serializer failed" &&
+                        service.stats().failures == 1);
+    passed &= check("Later flush succeeds again", service.flush());
+
+    service.schedule(path, [](std::ostream& out) { out << "on exit"; });
+  }
+  passed &= check("Pending edit written on shutdown",
+                  readFile(path) == "on exit");
+  return passed;
+}
+
+int main() {
+  const std::string path = "test_autosave.toml";
+  bool allPassed = true;
+  bool passed = testAtomicWrite(path);
+  printTestResult("Atomic replace", passed);
+  allPassed &= passed;
+  passed = testCoalescing(path);
+  printTestResult("Coalescing", passed);
+  allPassed &= passed;
+  passed = testNowAndFailures(path);
+  printTestResult("Immediate saves, failures and shutdown", passed);
+  allPassed &= passed;
+  std::remove(path.c_str());
+
+  printTestResult("All autosave tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,352 @@
+/* test_capi.c
+ * Unit test for the C interface, in plain C99 as an embedding host sees
+ * it: pairs, batch evaluation over strided inputs, flanks, surfaces, TCA,
+ * rating and the error reporting */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/capi/gearlab.h"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+static int check(const char* name, int condition) {
+  if (!condition) {
+    printf(COLOR_RED " ❌ Check failed: %s" COLOR_RESET "\n", name);
+    return 0;
+  }
+  printf(COLOR_GREEN " ✅ Check passed: %s" COLOR_RESET "\n", name);
+  return 1;
+}
+
+static void printTestResult(const char* testName, int passed) {
+  if (passed)
+    printf(COLOR_GREEN "[PASS] " COLOR_RESET "%s\n", testName);
+  else
+    printf(COLOR_RED "[FAIL] " COLOR_RESET "%s\n", testName);
+}
+
+static void running(const char* testName) {
+  printf(COLOR_YELLOW "Running test: " COLOR_RESET "%s\n", testName);
+}
+
+/* assets/CAD/Gear_2.FCStd with a 30 deg spiral */
+static const double gear2[15] = {14, 9,       4.77651, 0.1, 1.5,
+                                 90, 65,      45,      1.2, 0,
+                                 24.0405, 60, 20,      30,  0};
+
+/* Element i of a 1-D buffer */
+static double f64At(const gearlab_buffer* b, int64_t i) {
+  double v;
+  memcpy(&v, (const char*)b->data + i * b->strides[0], sizeof v);
+  return v;
+}
+
+static int sameShape1(const gearlab_buffer* b, int64_t n, int32_t dtype) {
+  return b && b->ndim == 1 && b->shape[0] == n && b->dtype == dtype;
+}
+
+static int testPairs(void) {
+  int passed = 1;
+  gearlab_pair* pair = NULL;
+  double v = 0;
+  running("Pairs and errors");
+  passed &= check("Version", gearlab_api_version() == GEARLAB_API_VERSION);
+  passed &= check("Field names",
+                  gearlab_pair_field_count() == 15 &&
+                      strcmp(gearlab_pair_field_name(2), "module") == 0 &&
+                      gearlab_pair_field_name(15) == NULL);
+
+  passed &= check("Create",
+                  gearlab_pair_create(gear2, 13, &pair) == GEARLAB_OK &&
+                      gearlab_pair_valid(pair) &&
+                      strcmp(gearlab_last_error(), "") == 0);
+  passed &= check("Optional spiral angle",
+                  gearlab_pair_get(pair, "spiralAngle", &v) == GEARLAB_OK &&
+                      v == 0);
+  passed &= check("Set recomputes",
+                  gearlab_pair_set(pair, "numPinionTeeth", 10) ==
+                          GEARLAB_OK &&
+                      gearlab_pair_get(pair, "numPinionTeeth", &v) ==
+                          GEARLAB_OK &&
+                      v == 10);
+  passed &= check("Unknown name",
+                  gearlab_pair_set(pair, "teeth", 3) == GEARLAB_ERR_ARGUMENT &&
+                      strstr(gearlab_last_error(), "teeth") != NULL);
+  passed &= check(
+      "Counts must be integers in range",
+      gearlab_pair_set(pair, "numGearTeeth", 11.7) == GEARLAB_ERR_ARGUMENT &&
+          gearlab_pair_set(pair, "numGearTeeth", 1e300) ==
+              GEARLAB_ERR_ARGUMENT &&
+          gearlab_pair_set(pair, "numPinionTeeth", NAN) ==
+              GEARLAB_ERR_ARGUMENT &&
+          gearlab_pair_set(pair, "spiralType", 99) == GEARLAB_ERR_ARGUMENT &&
+          gearlab_pair_set(pair, "module", INFINITY) ==
+              GEARLAB_ERR_ARGUMENT &&
+          gearlab_pair_get(pair, "numPinionTeeth", &v) == GEARLAB_OK &&
+          v == 10);
+  gearlab_pair_destroy(pair);
+  passed &= check("Too few inputs",
+                  gearlab_pair_create(gear2, 12, &pair) ==
+                          GEARLAB_ERR_ARGUMENT &&
+                      pair == NULL);
+  gearlab_pair_destroy(NULL);
+  return passed;
+}
+
+static int testEvaluate(void) {
+  int passed = 1, i, j;
+  /* Column major [3, 15] host array: a transposed numpy view */
+  double inputs[15 * 3];
+  gearlab_buffer in;
+  gearlab_result* r = NULL;
+  const gearlab_buffer *values, *valid, *pitch, *pinionPitch;
+  running("Batch evaluation");
+  for (i = 0; i < 3; ++i) {
+    for (j = 0; j < 15; ++j)
+      inputs[j * 3 + i] = gear2[j];
+  }
+  inputs[3 * 3 + 1] = 0.2;  /* Design 1: more backlash */
+  inputs[1 * 3 + 2] = 14;   /* Design 2: more pinion than gear teeth */
+  memset(&in, 0, sizeof in);
+  in.data = inputs;
+  in.dtype = GEARLAB_F64;
+  in.ndim = 2;
+  in.shape[0] = 3;
+  in.shape[1] = 15;
+  in.strides[0] = sizeof(double);
+  in.strides[1] = 3 * sizeof(double);
+
+  passed &= check("Evaluate", gearlab_evaluate(&in, &r) == GEARLAB_OK &&
+                                  gearlab_result_count(r) == 18);
+  values = gearlab_result_get(r, "values");
+  valid = gearlab_result_get(r, "valid");
+  pitch = gearlab_result_get(r, "gear.pitchConeAngle");
+  pinionPitch = gearlab_result_get(r, "pinion.pitchConeAngle");
+  passed &= check("Row major table with column views",
+                  values && values->ndim == 2 && values->shape[0] == 3 &&
+                      values->shape[1] == 17 &&
+                      values->strides[0] == 17 * sizeof(double) &&
+                      sameShape1(valid, 3, GEARLAB_F64) &&
+                      valid->data == values->data &&
+                      pitch->strides[0] == values->strides[0] &&
+                      pitch->data == (const double*)values->data + 1);
+  passed &= check("Validity per design", f64At(valid, 0) == 1 &&
+                                             f64At(valid, 1) == 1 &&
+                                             f64At(valid, 2) == 0);
+  passed &= check("Pitch cones add to the shaft angle",
+                  fabs(f64At(pitch, 0) + f64At(pinionPitch, 0) - 90) <
+                          1e-9 &&
+                      fabs(f64At(pitch, 0) -
+                           atan2(14, 9) * 180 / 3.14159265358979) < 1e-9);
+  passed &= check("Buffer lookup",
+                  gearlab_result_buffer(r, 0) == values &&
+                      strcmp(gearlab_result_name(r, 1), "valid") == 0 &&
+                      gearlab_result_get(r, "nothing") == NULL &&
+                      gearlab_result_buffer(r, 18) == NULL);
+  gearlab_result_destroy(r);
+
+  in.shape[1] = 12;
+  passed &= check("Too few inputs per row",
+                  gearlab_evaluate(&in, &r) == GEARLAB_ERR_ARGUMENT &&
+                      r == NULL);
+  in.shape[1] = 15;
+  inputs[0 * 3 + 2] = 14.5; /* Design 2: fractional gear teeth */
+  passed &= check("Fractional tooth count",
+                  gearlab_evaluate(&in, &r) == GEARLAB_ERR_ARGUMENT &&
+                      r == NULL &&
+                      strstr(gearlab_last_error(), "numGearTeeth") != NULL);
+  in.shape[0] = 0;
+  in.data = NULL;
+  passed &= check("No designs",
+                  gearlab_evaluate(&in, &r) == GEARLAB_OK &&
+                      gearlab_result_get(r, "values")->shape[0] == 0);
+  gearlab_result_destroy(r);
+  return passed;
+}
+
+static int testGeometry(void) {
+  int passed = 1;
+  int64_t i, n, teeth = 0, flanks = 0;
+  gearlab_pair *pair = NULL, *broken = NULL;
+  gearlab_result *flank = NULL, *surface = NULL;
+  gearlab_surface_options opt;
+  const gearlab_buffer *point, *R, *ax, *region, *tooth;
+  double p[3];
+  running("Flanks and surfaces");
+  gearlab_pair_create(gear2, 15, &pair);
+
+  passed &= check("Flank", gearlab_flank(pair, GEARLAB_GEAR, GEARLAB_RIGHT, 4,
+                                         2, &flank) == GEARLAB_OK);
+  point = gearlab_result_get(flank, "point");
+  R = gearlab_result_get(flank, "R");
+  passed &= check("Flank grid shape",
+                  point->ndim == 3 && point->shape[0] == 5 &&
+                      point->shape[1] == 3 && point->shape[2] == 3 &&
+                      point->strides[0] == 9 * sizeof(double) &&
+                      sameShape1(R, 5, GEARLAB_F64));
+  /* Pitch point at mid face lies on the sphere of its cone distance */
+  memcpy(p,
+         (const char*)point->data + 2 * point->strides[0] +
+             1 * point->strides[1],
+         sizeof p);
+  passed &= check("Flank points on their cone distance",
+                  fabs(sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) -
+                       f64At(R, 2)) < 1e-9);
+
+  gearlab_surface_options_init(&opt, sizeof opt);
+  opt.faceSteps = 4;
+  opt.profileSteps = 2;
+  passed &= check("Surface", gearlab_surface(pair, GEARLAB_PINION, &opt,
+                                             &surface) == GEARLAB_OK);
+  ax = gearlab_result_get(surface, "ax");
+  region = gearlab_result_get(surface, "region");
+  tooth = gearlab_result_get(surface, "tooth");
+  n = ax->shape[0];
+  passed &= check("Surface columns",
+                  n > 0 && sameShape1(region, n, GEARLAB_U8) &&
+                      sameShape1(tooth, n, GEARLAB_I32) &&
+                      gearlab_result_count(surface) == 11);
+  for (i = 0; i < n; ++i) {
+    const int32_t* t = (const int32_t*)((const char*)tooth->data +
+                                        i * tooth->strides[0]);
+    const uint8_t* g = (const uint8_t*)region->data + i * region->strides[0];
+    if (*t + 1 > teeth)
+      teeth = *t + 1;
+    flanks += *g == 0;
+  }
+  passed &= check("Every pinion tooth, both flanks",
+                  teeth == 9 && flanks == 9 * 2 * 4 * 2 * 2);
+
+  /* Results outlive their pair */
+  gearlab_pair_destroy(pair);
+  passed &= check("Results own their data",
+                  fabs(f64At(R, 4) - 60) < 1e-9 && isfinite(f64At(ax, n - 1)));
+  gearlab_result_destroy(flank);
+  gearlab_result_destroy(surface);
+
+  gearlab_pair_create(gear2, 15, &broken);
+  gearlab_pair_set(broken, "numPinionTeeth", 20);
+  passed &= check("Invalid design",
+                  gearlab_surface(broken, GEARLAB_GEAR, NULL, &surface) ==
+                          GEARLAB_ERR_DESIGN &&
+                      surface == NULL &&
+                      strstr(gearlab_last_error(), "validation") != NULL);
+  gearlab_pair_set(broken, "numPinionTeeth", 9);
+  opt.boreRadius = 1000;
+  passed &= check("Invalid options",
+                  gearlab_surface(broken, GEARLAB_GEAR, &opt, &surface) ==
+                      GEARLAB_ERR_ARGUMENT);
+  gearlab_pair_destroy(broken);
+  return passed;
+}
+
+static int testAnalysis(void) {
+  int passed = 1;
+  int64_t i;
+  gearlab_pair* pair = NULL;
+  gearlab_result *tca = NULL, *moved = NULL, *rated = NULL;
+  gearlab_tca_options opt;
+  const gearlab_buffer *rotation, *te, *tooth, *area, *centreU, *movedU;
+  double designs[2][15], spectrum[2][3] = {{100, 1500, 1000},
+                                           {200, 900, 100}};
+  gearlab_buffer d, s;
+  double lo = 1e300, hi = -1e300;
+  running("TCA and rating");
+  gearlab_pair_create(gear2, 15, &pair);
+
+  gearlab_tca_options_init(&opt, sizeof opt);
+  opt.steps = 16;
+  passed &= check("TCA", gearlab_tca(pair, GEARLAB_GEAR, &opt, &tca) ==
+                             GEARLAB_OK);
+  rotation = gearlab_result_get(tca, "rotation");
+  te = gearlab_result_get(tca, "transmissionError");
+  tooth = gearlab_result_get(tca, "tooth");
+  area = gearlab_result_get(tca, "area");
+  centreU = gearlab_result_get(tca, "centreU");
+  passed &= check("Views into the TCA points",
+                  sameShape1(rotation, 16, GEARLAB_F64) &&
+                      sameShape1(tooth, 16, GEARLAB_I32) &&
+                      rotation->strides[0] == te->strides[0] &&
+                      rotation->strides[0] > (int64_t)sizeof(double));
+  for (i = 0; i < 16; ++i) {
+    lo = fmin(lo, f64At(te, i));
+    hi = fmax(hi, f64At(te, i));
+  }
+  passed &= check("One mesh cycle of the gear",
+                  f64At(rotation, 0) == 0 &&
+                      fabs(f64At(rotation, 15) - 360.0 / 14 * 15 / 16) <
+                          1e-9 &&
+                      hi > lo && f64At(area, 0) > 0);
+
+  /* Mounting errors move the contact */
+  opt.pinionAxial = 0.05;
+  gearlab_tca(pair, GEARLAB_GEAR, &opt, &moved);
+  movedU = gearlab_result_get(moved, "centreU");
+  passed &= check("Mounting errors",
+                  fabs(f64At(movedU, 0) - f64At(centreU, 0)) > 0.01);
+  gearlab_result_destroy(tca);
+  gearlab_result_destroy(moved);
+
+  /* Options of an older, shorter struct keep the remaining defaults */
+  gearlab_tca_options_init(&opt, offsetof(gearlab_tca_options, side) +
+                                     sizeof opt.side);
+  passed &= check("Short options",
+                  opt.size < sizeof opt &&
+                      gearlab_tca(pair, GEARLAB_PINION, &opt, &tca) ==
+                          GEARLAB_OK &&
+                      gearlab_result_get(tca, "rotation")->shape[0] == 32);
+  gearlab_result_destroy(tca);
+
+  memcpy(designs[0], gear2, sizeof gear2);
+  memcpy(designs[1], gear2, sizeof gear2);
+  designs[1][2] = 5.5;
+  memset(&d, 0, sizeof d);
+  d.data = designs;
+  d.dtype = GEARLAB_F64;
+  d.ndim = 2;
+  d.shape[0] = 2;
+  d.shape[1] = 15;
+  d.strides[0] = sizeof designs[0];
+  d.strides[1] = sizeof(double);
+  s = d;
+  s.data = spectrum;
+  s.shape[1] = 3;
+  s.strides[0] = sizeof spectrum[0];
+  passed &= check("Rating", gearlab_rate(&d, &s, &rated) == GEARLAB_OK);
+  passed &= check(
+      "Larger module, safer teeth",
+      f64At(gearlab_result_get(rated, "bendingSafety1"), 1) >
+              f64At(gearlab_result_get(rated, "bendingSafety1"), 0) &&
+          f64At(gearlab_result_get(rated, "pittingDamage2"), 0) >= 0);
+  gearlab_result_destroy(rated);
+  s.shape[1] = 2;
+  passed &= check("Spectrum shape",
+                  gearlab_rate(&d, &s, &rated) == GEARLAB_ERR_ARGUMENT);
+  gearlab_pair_destroy(pair);
+  return passed;
+}
+
+int main(void) {
+  int allPassed = 1;
+  int passed = testPairs();
+  printTestResult("Pairs and errors", passed);
+  allPassed &= passed;
+  passed = testEvaluate();
+  printTestResult("Batch evaluation", passed);
+  allPassed &= passed;
+  passed = testGeometry();
+  printTestResult("Flanks and surfaces", passed);
+  allPassed &= passed;
+  passed = testAnalysis();
+  printTestResult("TCA and rating", passed);
+  allPassed &= passed;
+
+  printTestResult("All C interface tests", allPassed);
+  return allPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
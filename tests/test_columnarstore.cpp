@@ -0,0 +1,396 @@
+// test_columnarstore.cpp
+// Unit test for the append-only columnar store: codecs, array columns,
+// appending, recovery from a torn chunk and predicate pushdown
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/io/ColumnarStore.hpp"
+#include "../src/io/ResultQuery.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool sameBits(double a, double b) {
+  return columnstore::bitsOf(a) == columnstore::bitsOf(b);
+}
+
+// Row i of the test store: design index, a grid axis, a score with some
+// NaN, and a transmission error curve whose length varies
+double axis(size_t i) { return 56 + double(i % 30) * 0.25; }
+double score(size_t i) {
+  return i % 101 == 7 ? NAN : double((i * 7919) % 10007) / 10;
+}
+std::vector<double> curve(size_t i) {
+  std::vector<double> te(i % 13 == 0 ? 0 : 40 + i % 7);
+  for (size_t k = 0; k < te.size(); ++k)
+    te[k] = 12.5 * std::sin(0.157 * double(k) + 0.001 * double(i));
+  return te;
+}
+
+const std::vector<ColumnSpec> schema = {{"design", ColumnKind::Scalar},
+                                        {"faceConeAngle", ColumnKind::Scalar},
+                                        {"score", ColumnKind::Scalar},
+                                        {"te", ColumnKind::Array}};
+
+void writeRows(ColumnarStoreWriter& w, size_t first, size_t count) {
+  for (size_t i = first; i < first + count; ++i)
+    w.addRow({double(i), axis(i), score(i)}, {curve(i)});
+}
+
+bool rowsMatch(const ColumnarResultTable& t, size_t count) {
+  bool ok = t.rowCount() == count;
+  for (size_t i = 0; i < count && ok; ++i) {
+    ok &= t.value(i, 0) == double(i) && t.value(i, 1) == axis(i) &&
+          sameBits(t.value(i, 2), score(i));
+    const std::vector<double> te = curve(i);
+    const std::vector<double> back = t.array(i, 3);
+    ok &= t.value(i, 3) == double(te.size()) && back.size() == te.size();
+    for (size_t k = 0; k < te.size() && ok; ++k)
+      ok &= sameBits(back[k], te[k]);
+  }
+  return ok;
+}
+
+bool testCodecs() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << "Codecs"
+            << std::endl;
+  bool passed = true;
+  std::mt19937_64 rng(3);
+  std::vector<double> v;
+  for (int i = 0; i < 5000; ++i) {
+    switch (rng() % 6) {
+      case 0:
+        v.push_back(columnstore::fromBits(rng()));  // Any bit pattern
+        break;
+      case 1:
+        v.push_back(v.empty() ? 0.0 : v.back());
+        break;
+      case 2:
+        v.push_back(double(rng() % 100));
+        break;
+      case 3:
+        v.push_back(i % 2 ? INFINITY : -0.0);
+        break;
+      default:
+        v.push_back(std::sin(i * 0.01));
+    }
+  }
+  bool roundTrip = true;
+  using columnstore::Codec;
+  for (Codec c : {Codec::Xor, Codec::Delta}) {
+    std::vector<uint8_t> bytes;
+    if (c == Codec::Xor)
+      columnstore::encodeXor(v.data(), v.size(), bytes);
+    else
+      columnstore::encodeDelta(v.data(), v.size(), bytes);
+    std::vector<double> back(v.size());
+    columnstore::decode(c, {bytes.data(), bytes.data() + bytes.size()},
+                        v.size(), back.data());
+    for (size_t i = 0; i < v.size(); ++i)
+      roundTrip &= sameBits(back[i], v[i]);
+  }
+  passed &= check("XOR and delta codecs are lossless", roundTrip);
+
+  std::vector<uint8_t> bytes;
+  const std::vector<double> constant(1000, 3.25);
+  passed &= check("Constant column in a few bytes",
+                  columnstore::encode(constant.data(), 1000, bytes) ==
+                          Codec::Xor &&
+                      bytes.size() < 20);
+  std::vector<double> index(1000);
+  for (size_t i = 0; i < index.size(); ++i)
+    index[i] = double(i);
+  const Codec ci = columnstore::encode(index.data(), 1000, bytes);
+  passed &= check("Integer column at most 3 bytes a row",
+                  ci != Codec::Raw && bytes.size() <= 3000);
+  std::vector<double> noise(1000);
+  for (double& x : noise)
+    x = columnstore::fromBits(rng() >> 2);
+  passed &= check("Incompressible column stored raw",
+                  columnstore::encode(noise.data(), 1000, bytes) ==
+                          Codec::Raw &&
+                      bytes.size() == 8000);
+
+  bool truncated = false;
+  try {
+    std::vector<double> back(1000);
+    columnstore::encode(index.data(), 1000, bytes);
+    columnstore::decode(ci, {bytes.data(), bytes.data() + bytes.size() / 2},
+                        1000, back.data());
+  } catch (const std::runtime_error&) {
+    truncated = true;
+  }
+  passed &= check("Truncated stream detected", truncated);
+  return passed;
+}
+
+bool testRoundTrip(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Round trip, chunks and compression" << std::endl;
+  bool passed = true;
+  ColumnarStoreOptions opt;
+  opt.chunkRows = 1000;
+  opt.chunkValues = 30000;  // Closes chunks early on the curves
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    writeRows(w, 0, 5000);
+    w.close();
+  }
+  ColumnarResultTable t(path, 64 << 10);
+  passed &= check("Columns and kinds",
+                  t.columnCount() == 4 && t.columnName(3) == "te" &&
+                      t.kind(3) == ColumnKind::Array &&
+                      t.kind(2) == ColumnKind::Scalar);
+  passed &= check("Chunks closed by row and value limits",
+                  t.chunkCount() > 5 && t.chunkRows(0) < 1000);
+  passed &= check("Every value read back bit for bit", rowsMatch(t, 5000));
+
+  const ColumnChunkStats s = t.stats(0, 2);
+  double lo = INFINITY, hi = -INFINITY;
+  size_t nan = 0;
+  for (size_t i = 0; i < t.chunkRows(0); ++i) {
+    const double v = score(i);
+    nan += std::isnan(v);
+    if (!std::isnan(v)) {
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+  }
+  passed &= check("Chunk statistics", s.min == lo && s.max == hi &&
+                                          s.nanCount == nan &&
+                                          s.values == t.chunkRows(0));
+  const double raw0 = 5000 * 8.0;
+  std::cout << "  design " << t.storedBytes(0) / raw0 << ", axis "
+            << t.storedBytes(1) / raw0 << ", score " << t.storedBytes(2) / raw0
+            << " of raw" << std::endl;
+  passed &= check("Index and grid columns compress 3x",
+                  t.storedBytes(0) * 3 < raw0 && t.storedBytes(1) * 3 < raw0);
+
+  // Random access from several threads through a cache smaller than the
+  // store, so chunks are evicted while others read them
+  ThreadPool pool(4);
+  std::vector<char> ok(20000, 0);
+  pool.parallelFor(0, ok.size(), [&](size_t j) {
+    const size_t i = (j * 7919) % 5000;
+    ok[j] = sameBits(t.value(i, 2), score(i)) &&
+            t.array(i, 3) == curve(i);
+  });
+  passed &= check("Concurrent reads through an evicting cache",
+                  std::count(ok.begin(), ok.end(), 1) == int(ok.size()));
+
+  ResultQuery q;
+  q.filterColumn = 2;
+  q.filterMax = 100;
+  q.sortColumn = 1;
+  const std::vector<uint32_t> rows = runResultQuery(t, q, pool);
+  bool query = !rows.empty();
+  for (size_t k = 0; k < rows.size(); ++k) {
+    query &= t.value(rows[k], 2) <= 100;
+    if (k > 0)
+      query &= t.value(rows[k - 1], 1) <= t.value(rows[k], 1);
+  }
+  passed &= check("Backs runResultQuery like a .glr table", query);
+  return passed;
+}
+
+bool testAppendAndRecovery(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Appending and recovery" << std::endl;
+  bool passed = true;
+  ColumnarStoreOptions opt;
+  opt.chunkRows = 500;
+  opt.append = true;
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    passed &= check("Append continues the row count", w.rowCount() == 5000);
+    writeRows(w, 5000, 1200);
+    w.close();
+  }
+  {
+    ColumnarResultTable t(path);
+    passed &= check("Appended rows follow the old ones", rowsMatch(t, 6200));
+  }
+
+  // Writer killed after two chunks, before a third was complete
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    writeRows(w, 6200, 1000);
+    w.flush();
+  }
+  const off_t committed = [&] {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    std::fseek(f, 0, SEEK_END);
+    const off_t n = std::ftell(f);
+    std::fclose(f);
+    return n;
+  }();
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    writeRows(w, 7200, 500);
+  }
+  if (truncate(path.c_str(), committed + 777) != 0)
+    passed = false;
+  {
+    ColumnarResultTable t(path);
+    passed &= check("Reader ignores the torn chunk", rowsMatch(t, 7200));
+  }
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    passed &= check("Writer cuts the torn chunk", w.rowCount() == 7200);
+    writeRows(w, 7200, 300);
+    w.close();
+  }
+  {
+    ColumnarResultTable t(path);
+    passed &= check("Store continues after recovery", rowsMatch(t, 7500));
+  }
+
+  bool rejected = false;
+  try {
+    ColumnarStoreWriter w(path, {{"design"}, {"other"}}, opt);
+  } catch (const std::invalid_argument&) {
+    rejected = true;
+  }
+  passed &= check("Append with a different schema rejected", rejected);
+
+  // Flip a byte inside the array column stream of the first chunk
+  {
+    FILE* f = std::fopen(path.c_str(), "r+b");
+    columnstore::ChunkHeader h;
+    columnstore::ColumnChunk d;
+    const long at = long(sizeof(columnstore::FileHeader) +
+                         schema.size() * sizeof(columnstore::ColumnDef));
+    std::fseek(f, at, SEEK_SET);
+    std::fread(&h, sizeof(h), 1, f);
+    std::fseek(f, at + long(sizeof(h) + 3 * sizeof(d)), SEEK_SET);
+    std::fread(&d, sizeof(d), 1, f);
+    std::fseek(f, at + long(d.offset + d.size / 2), SEEK_SET);
+    const int c = std::fgetc(f);
+    std::fseek(f, at + long(d.offset + d.size / 2), SEEK_SET);
+    std::fputc(c ^ 0x10, f);
+    std::fclose(f);
+  }
+  ColumnarResultTable t(path);
+  bool corrupt = false;
+  try {
+    t.array(0, 3);
+  } catch (const std::runtime_error&) {
+    corrupt = true;
+  }
+  passed &= check("Corrupt column chunk detected by its checksum",
+                  corrupt && t.value(0, 2) == score(0));
+  return passed;
+}
+
+bool testPushdown(const std::string& path) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Predicate pushdown" << std::endl;
+  bool passed = true;
+  ColumnarStoreOptions opt;
+  opt.chunkRows = 1000;
+  {
+    ColumnarStoreWriter w(path, schema, opt);
+    writeRows(w, 0, 20000);
+    w.close();
+  }
+  ColumnarResultTable t(path);
+  ThreadPool pool(3);
+  auto brute = [&](const std::vector<ColumnRange>& ranges) {
+    std::vector<uint64_t> rows;
+    for (size_t i = 0; i < t.rowCount(); ++i) {
+      bool ok = true;
+      for (const ColumnRange& r : ranges) {
+        const double v = t.value(i, r.column);
+        ok &= v >= r.min && v <= r.max;
+      }
+      if (ok)
+        rows.push_back(i);
+    }
+    return rows;
+  };
+
+  const std::vector<ColumnRange> designs = {{0, 4500, 6999.5}};
+  const ColumnarSelection s = t.select(designs, pool);
+  passed &= check("Design range reads only the boundary chunk",
+                  s.rows == brute(designs) && s.chunksRead == 1 &&
+                      s.chunksWhole == 2 && s.chunksSkipped == 17);
+
+  const std::vector<ColumnRange> mixed = {{1, 57, 58}, {2, 0, 500}};
+  const ColumnarSelection m = t.select(mixed, pool);
+  passed &= check("Several predicates match brute force",
+                  m.rows == brute(mixed) && m.chunksRead == 20);
+
+  const ColumnarSelection none = t.select({{2, 2000, 3000}}, pool);
+  passed &= check("Out of range predicate skips every chunk",
+                  none.rows.empty() && none.chunksSkipped == 20);
+
+  bool rejected = false;
+  try {
+    t.select({{3, 0, 1}}, pool);
+  } catch (const std::invalid_argument&) {
+    rejected = true;
+  }
+  passed &= check("Predicate on an array column rejected", rejected);
+
+  CancellationToken token;
+  token.cancel();
+  bool cancelled = false;
+  try {
+    t.select(mixed, pool, token);
+  } catch (const JobCancelled&) {
+    cancelled = true;
+  }
+  passed &= check("Cancelled select throws", cancelled);
+  return passed;
+}
+
+int main() {
+  const std::string path = "test_columnarstore.glrc";
+  bool allPassed = true;
+  bool passed = testCodecs();
+  printTestResult("Codecs", passed);
+  allPassed &= passed;
+  passed = testRoundTrip(path);
+  printTestResult("Round trip, chunks and compression", passed);
+  allPassed &= passed;
+  passed = testAppendAndRecovery(path);
+  printTestResult("Appending and recovery", passed);
+  allPassed &= passed;
+  passed = testPushdown(path);
+  printTestResult("Predicate pushdown", passed);
+  allPassed &= passed;
+  std::remove(path.c_str());
+
+  printTestResult("All columnar store tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
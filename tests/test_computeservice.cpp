@@ -0,0 +1,414 @@
+// test_computeservice.cpp
+// Unit test for the JSON-RPC compute service and its Unix socket server
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/io/Json.hpp"
+#include "../src/io/UnixSocketServer.hpp"
+#include "../src/pipeline/ComputeService.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// assets/CAD/Gear_1.FCStd
+BevelGearPair gear1() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                       60, 20);
+}
+
+std::string request(const std::string& method, const std::string& params,
+                    int id) {
+  return "{\"jsonrpc\":\"2.0\",\"method\":\"" + method +
+         "\",\"params\":" + params + ",\"id\":" + std::to_string(id) + "}";
+}
+
+int errorCode(const json::Value& response) {
+  const json::Value* e = response.find("error");
+  const json::Value* c = e ? e->find("code") : nullptr;
+  return c ? int(c->asNumber()) : 0;
+}
+
+double number(const json::Value& v, const char* a, const char* b = nullptr) {
+  const json::Value* x = v.find(a);
+  if (x && b)
+    x = x->find(b);
+  return x && x->isNumber() ? x->asNumber() : NAN;
+}
+
+bool testJson() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << "JSON"
+            << std::endl;
+  bool passed = true;
+  const std::string text =
+      "{\"a\":[1,-2.5e-3,true,false,null],\"s\":\"q\\\"\\\\\\n\\u00e9"
+      "\\ud83d\\ude00\",\"o\":{}}";
+  const json::Value v = json::parse(text);
+  passed &= check("Parse nested values",
+                  v.isObject() && v.find("a")->size() == 5 &&
+                      v.find("a")->items()[1].asNumber() == -2.5e-3 &&
+                      v.find("a")->items()[4].isNull() &&
+                      v.find("o")->isObject());
+  passed &= check("Escapes and surrogate pairs to UTF-8",
+                  v.find("s")->asString() == "q\"\\\n\xc3\xa9\xf0\x9f\x98\x80");
+  passed &= check("Dump reparses to the same text",
+                  json::parse(v.dump()).dump() == v.dump());
+
+  bool exact = true;
+  for (double x : {0.1, 1.0 / 3, 5.593454, 1e-300, -123456789.125, 60.0}) {
+    json::Value n(x);
+    exact &= json::parse(n.dump()).asNumber() == x;
+  }
+  passed &= check("Numbers round trip bit identical", exact);
+  passed &= check("Integers written without exponent",
+                  json::Value(11).dump() == "11");
+
+  int rejected = 0;
+  for (const char* bad : {"", "{", "[1,]", "{\"a\" 1}", "01", "1.", "tru",
+                          "\"a", "[1] x", "\"\\x\"", "\"\x01\""}) {
+    try {
+      json::parse(bad);
+    } catch (const json::ParseError&) {
+      ++rejected;
+    }
+  }
+  passed &= check("Malformed texts rejected", rejected == 11);
+  try {
+    json::parse(std::string(100, '[') + std::string(100, ']'));
+    passed &= check("Deep nesting rejected", false);
+  } catch (const json::ParseError&) {
+    passed &= check("Deep nesting rejected", true);
+  }
+  return passed;
+}
+
+bool testMethods() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Methods against the kernels" << std::endl;
+  bool passed = true;
+  ComputeService service(gear1());
+
+  BevelGearPair changed = gear1();
+  changed.faceConeAngle = 62;
+  const PairPipelineResult direct = runPairPipeline(changed);
+  const json::Value c = json::parse(
+      service.handle(request("compute", "{\"faceConeAngle\":62}", 1)));
+  passed &= check("Compute id echoed", number(c, "id") == 1);
+  const json::Value& r = *c.find("result");
+  passed &= check("Compute gear and pinion bit identical",
+                  r.find("valid")->asBool() == direct.valid &&
+                      number(r, "gear", "addendum") == direct.gear->addendum &&
+                      number(r, "pinion", "dedendum") ==
+                          direct.pinion->dedendum &&
+                      number(r, "pinion", "faceConeOffset") ==
+                          direct.pinion->faceConeOffset);
+
+  const json::Value v = json::parse(
+      service.handle(request("validate", "{\"rootConeAngle\":70}", 2)));
+  const json::Value& vr = *v.find("result");
+  passed &= check("Validate reports the failing check",
+                  !vr.find("valid")->asBool() &&
+                      !vr.find("angles")->asBool() &&
+                      vr.find("toothCounts")->asBool());
+
+  const json::Value m = json::parse(service.handle(
+      request("mesh", "{\"member\":\"pinion\",\"vertices\":true}", 3)));
+  const GearSurfaceMesh mesh = GearSurface(gear1().makePinion()).build();
+  const json::Value& mr = *m.find("result");
+  passed &= check("Mesh of the pinion",
+                  number(mr, "triangles") == mesh.size() &&
+                      mr.find("vertices")->size() == mesh.size() * 9 &&
+                      mr.find("vertices")->items()[4].asNumber() ==
+                          mesh.b(0).y &&
+                      number(mr, "area") > 0);
+
+  const json::Value t = json::parse(
+      service.handle(request("tca", "{\"steps\":12}", 4)));
+  const std::vector<TcaPoint> path = UnloadedTca(gear1()).path(12);
+  const json::Value& tr = *t.find("result");
+  bool same = tr.find("transmissionError")->size() == path.size();
+  for (size_t i = 0; same && i < path.size(); ++i)
+    same &= tr.find("transmissionError")->items()[i].asNumber() ==
+            path[i].transmissionError;
+  passed &= check("TCA path bit identical", same);
+  return passed;
+}
+
+bool testErrors() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Protocol errors" << std::endl;
+  bool passed = true;
+  ComputeService service(gear1());
+  auto code = [&](const std::string& message) {
+    return errorCode(json::parse(service.handle(message)));
+  };
+  passed &= check("Parse error", code("{\"jsonrpc\":") == -32700);
+  passed &= check("Invalid request",
+                  code("{\"method\":\"compute\",\"id\":1}") == -32600 &&
+                      code("[]") == -32600 && code("42") == -32600);
+  passed &= check("Unknown method", code(request("nope", "{}", 1)) == -32601);
+  passed &= check("Unknown and malformed params",
+                  code(request("compute", "{\"teeth\":3}", 1)) == -32602 &&
+                      code(request("compute", "{\"module\":\"x\"}", 1)) ==
+                          -32602 &&
+                      code(request("compute", "{\"member\":\"gear\"}", 1)) ==
+                          -32602 &&
+                      code(request("mesh", "{\"faceSteps\":0}", 1)) ==
+                          -32602 &&
+                      code(request("tca", "{\"steps\":1.5}", 1)) == -32602);
+  passed &= check(
+      "Non-finite numbers and bad counts",
+      code(request("compute", "{\"module\":1e400}", 1)) == -32602 &&
+          code(request("compute", "{\"numGearTeeth\":1e300}", 1)) ==
+              -32602 &&
+          code(request("compute", "{\"numPinionTeeth\":11.7}", 1)) ==
+              -32602 &&
+          code(request("mesh", "{\"spiralType\":99}", 1)) == -32602 &&
+          code(request("compute", "{\"numGearTeeth\":12}", 1)) == 0);
+  passed &= check("Kernel argument errors are invalid params",
+                  code(request("mesh", "{\"boreRadius\":1000}", 1)) ==
+                      -32602);
+  passed &= check("Geometry of an invalid design",
+                  code(request("mesh", "{\"rootConeAngle\":70}", 1)) ==
+                      -32000);
+  passed &= check("Notifications get no response",
+                  service.handle("{\"jsonrpc\":\"2.0\",\"method\":"
+                                 "\"compute\"}")
+                      .empty());
+
+  const json::Value batch = json::parse(service.handle(
+      "[" + request("compute", "{}", 1) +
+      ",{\"jsonrpc\":\"2.0\",\"method\":\"validate\"}," +
+      request("nope", "{}", 3) + "]"));
+  passed &= check("Batch answers requests in order, skips notifications",
+                  batch.isArray() && batch.size() == 2 &&
+                      batch.items()[0].find("result") &&
+                      errorCode(batch.items()[1]) == -32601 &&
+                      number(batch.items()[1], "id") == 3);
+  return passed;
+}
+
+bool testCacheAndBatching() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Cache and batching" << std::endl;
+  bool passed = true;
+  ComputeService service(gear1());
+
+  const std::string q = request("compute", "{\"module\":5.5}", 7);
+  const std::string first = service.handle(q);
+  const std::string second = service.handle(q);
+  ComputeServiceStats s = service.stats();
+  passed &= check("Warm query served from the cache",
+                  first == second && s.cacheHits == 1 && s.computed == 1 &&
+                      s.cacheEntries == 1 && s.cacheBytes > 0);
+  passed &= check("Different id, same cache entry",
+                  service.handle(request("compute", "{\"module\":5.5}", 8))
+                          .find("\"id\":8") != std::string::npos &&
+                      service.stats().cacheHits == 2);
+
+  // Eight designs, two of them twice, in one message: one batch
+  std::string many = "[";
+  for (int i = 0; i < 10; ++i) {
+    many += (i ? "," : "") +
+            request("compute",
+                    "{\"faceConeAngle\":" + std::to_string(58 + i % 8) + "}",
+                    i);
+  }
+  service.handle(many + "]");
+  const ComputeServiceStats b = service.stats();
+  passed &= check("Batch message runs as one batch of distinct jobs",
+                  b.batches == s.batches + 1 && b.largestBatch == 10 &&
+                      b.computed == s.computed + 8);
+
+  // Concurrent clients: every answer right, batches coalesce
+  ComputeService concurrent(gear1());
+  constexpr int clients = 8, rounds = 25;
+  std::atomic<int> wrong{0};
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; ++c) {
+    threads.emplace_back([&, c] {
+      for (int k = 0; k < rounds; ++k) {
+        const double module = 4 + 0.01 * (c * rounds + k);
+        BevelGearPair p = gear1();
+        p.module = module;
+        p = PairFieldUtils::recompute(p);
+        char params[64];
+        std::snprintf(params, sizeof(params), "{\"module\":%.17g}", module);
+        const json::Value r =
+            json::parse(concurrent.handle(request("compute", params, k)));
+        if (number(r, "id") != k ||
+            number(*r.find("result"), "gear", "dedendum") != p.dedendum)
+          ++wrong;
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  const ComputeServiceStats cs = concurrent.stats();
+  std::cout << "  " << cs.requests << " concurrent requests in " << cs.batches
+            << " batches, largest " << cs.largestBatch << std::endl;
+  passed &= check("Concurrent answers correct", wrong == 0);
+  passed &= check("Every request computed once",
+                  cs.requests == clients * rounds &&
+                      cs.computed == clients * rounds &&
+                      cs.batches <= cs.requests);
+
+  ComputeServiceOptions tiny;
+  tiny.cacheBytes = 4096;
+  ComputeService small(gear1(), tiny);
+  for (int i = 0; i < 50; ++i) {
+    small.handle(
+        request("compute", "{\"module\":" + std::to_string(4 + i) + "}", i));
+  }
+  const ComputeServiceStats e = small.stats();
+  passed &= check("Cache bounded by bytes with LRU eviction",
+                  e.cacheBytes <= 4096 && e.cacheEntries < 50 &&
+                      e.cacheEntries > 0);
+  small.handle(request("compute", "{\"module\":53}", 0));
+  passed &= check("Most recent entry survives eviction",
+                  small.stats().cacheHits == 1);
+  return passed;
+}
+
+int connectTo(const std::string& path) {
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+std::string readLines(int fd, int lines) {
+  std::string out;
+  char buf[4096];
+  while (std::count(out.begin(), out.end(), '\n') < lines) {
+    const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0)
+      break;
+    out.append(buf, size_t(n));
+  }
+  return out;
+}
+
+bool testSocket() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Unix socket round trip" << std::endl;
+  bool passed = true;
+  const std::string path =
+      "/tmp/gearlab_test_" + std::to_string(getpid()) + ".sock";
+  ComputeService service(gear1());
+  {
+    UnixSocketServer server(
+        path, [&](const std::string& line) { return service.handle(line); });
+    std::thread loop([&] { server.serve(); });
+
+    bool inUse = false;
+    try {
+      UnixSocketServer second(path, [](const std::string&) { return ""; });
+    } catch (const std::runtime_error&) {
+      inUse = true;
+    }
+    passed &= check("Live socket is not taken over", inUse);
+
+    const int fd = connectTo(path);
+    // Two requests and a notification in one write, split mid line after
+    const std::string a = request("compute", "{}", 1) + "\n" +
+                          "{\"jsonrpc\":\"2.0\",\"method\":\"validate\"}\n" +
+                          request("validate", "{}", 2) + "\n";
+    const std::string b = request("compute", "{\"module\":5}", 3) + "\n";
+    send(fd, a.data(), a.size(), 0);
+    send(fd, b.data(), 10, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    send(fd, b.data() + 10, b.size() - 10, 0);
+    const std::string reply = readLines(fd, 3);
+    std::vector<json::Value> responses;
+    size_t start = 0, end;
+    while ((end = reply.find('\n', start)) != std::string::npos) {
+      responses.push_back(json::parse(reply.substr(start, end - start)));
+      start = end + 1;
+    }
+    passed &= check("Responses per line in order",
+                    responses.size() == 3 && number(responses[0], "id") == 1 &&
+                        number(responses[1], "id") == 2 &&
+                        number(responses[2], "id") == 3 &&
+                        responses[2].find("result"));
+    const int other = connectTo(path);
+    const std::string c = request("compute", "{}", 9) + "\n";
+    send(other, c.data(), c.size(), 0);
+    passed &= check("Second client served from the cache",
+                    readLines(other, 1).find("\"id\":9") !=
+                            std::string::npos &&
+                        service.stats().cacheHits >= 1);
+    close(other);
+
+    server.stop();
+    loop.join();
+    passed &= check("Stop closes open connections",
+                    readLines(fd, 1).empty());
+    close(fd);
+  }
+  passed &= check("Socket file removed", access(path.c_str(), F_OK) != 0);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testJson();
+  printTestResult("JSON", passed);
+  allPassed &= passed;
+  passed = testMethods();
+  printTestResult("Methods against the kernels", passed);
+  allPassed &= passed;
+  passed = testErrors();
+  printTestResult("Protocol errors", passed);
+  allPassed &= passed;
+  passed = testCacheAndBatching();
+  printTestResult("Cache and batching", passed);
+  allPassed &= passed;
+  passed = testSocket();
+  printTestResult("Unix socket round trip", passed);
+  allPassed &= passed;
+
+  printTestResult("All compute service tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
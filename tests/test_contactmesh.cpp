@@ -0,0 +1,363 @@
+// test_contactmesh.cpp
+// Unit test for the unloaded TCA and the contact zone FE mesh
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "../src/analysis/ContactMesh.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testTca() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Unloaded TCA" << std::endl;
+  const UnloadedTca tca(straightPair());
+  const ToothFlank& f = tca.toothFlank();
+  const std::vector<ContactZone> zones = tca.contact(0);
+
+  bool passed = true;
+  passed &= check("Tooth 0 carries at the pitch point",
+                  !zones.empty() && zones[0].tooth == 0 &&
+                      zones[0].gap == 0 && zones[0].marks());
+  const ContactZone& z = zones[0];
+  // Symmetric lengthwise crowning centres the straight tooth contact
+  const double Rmid = (f.innerR() + f.outerR()) / 2;
+  passed &= check("Centred on the face",
+                  std::fabs(z.centreR - Rmid) <
+                      (f.outerR() - f.innerR()) / 64);
+  passed &= check("Centre inside the zone",
+                  z.minR <= z.centreR && z.centreR <= z.maxR &&
+                      z.minU <= z.centreU && z.centreU <= z.maxU);
+  passed &= check("Touching at the centre",
+                  std::fabs(tca.separation(0, 0, z.centreR, z.centreU)) <
+                      1e-9);
+  // The marking zone is where the gap stays below the compound
+  const double marking = tca.options().markingCompound;
+  const double uIn = (z.minU + z.maxU) / 2;
+  passed &= check("Gap below the compound inside",
+                  tca.separation(0, 0, z.centreR, uIn) <= marking);
+  passed &= check("Gap above the compound outside",
+                  tca.separation(0, 0, z.centreR, z.maxU + 0.02) > marking &&
+                      tca.separation(0, 0, z.maxR + 1, z.centreU) > marking);
+  passed &= check("Contact ellipse is long and narrow",
+                  z.length > 5 * z.width && z.width > 0);
+
+  // Thinner compound, smaller pattern
+  TcaOptions thin;
+  thin.markingCompound = marking / 4;
+  const ContactZone t = UnloadedTca(straightPair(), false, thin).contact(0)[0];
+  passed &= check("Thinner compound marks less",
+                  t.area < z.area && t.length < z.length);
+
+  // Transmission error: parabolic per tooth, carried tooth handed over
+  const std::vector<TcaPoint> path = tca.path(32);
+  double teMin = HUGE_VAL, teMax = 0;
+  int handovers = 0;
+  for (size_t i = 0; i < path.size(); ++i) {
+    teMin = std::min(teMin, path[i].transmissionError);
+    teMax = std::max(teMax, path[i].transmissionError);
+    handovers += i > 0 && path[i].contact.tooth != path[i - 1].contact.tooth;
+  }
+  passed &= check("Transmission error", teMin >= 0 && teMax > teMin);
+  passed &= check("One handover per mesh cycle", handovers == 1);
+
+  // Spiral teeth: contact is shared and the other flank also works
+  TcaOptions left;
+  left.side = FlankSide::Left;
+  const std::vector<ContactZone> spiral = UnloadedTca(spiralPair()).contact(0);
+  const std::vector<ContactZone> coast =
+      UnloadedTca(spiralPair(), true, left).contact(0);
+  passed &= check("Spiral pair has several teeth engaged",
+                  spiral.size() >= 2);
+  passed &= check("Coast side of the pinion marks",
+                  !coast.empty() && coast[0].marks());
+  return passed;
+}
+
+bool testContactGap() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "TCA below a contact ratio of 1" << std::endl;
+  const UnloadedTca tca(stubPair());
+  const std::vector<TcaPoint> path = tca.path(64);
+  size_t gaps = 0;
+  bool marked = true, finite = true;
+  for (const TcaPoint& p : path) {
+    const bool none = tca.contact(p.rotation).empty();
+    gaps += none;
+    marked &= none == !p.engaged();
+    marked &= p.engaged() || (p.contact.tooth == -1 &&
+                              std::isnan(p.transmissionError));
+    finite &= !p.engaged() || std::isfinite(p.transmissionError);
+  }
+  bool passed = true;
+  passed &= check("Some rotations have no tooth engaged",
+                  gaps > 0 && gaps < path.size());
+  passed &= check("Those rotations are marked", marked);
+  passed &= check("Engaged rotations have a finite error", finite);
+  return passed;
+}
+
+// Largest edge of the brick
+double maxEdge(const FeMesh& m, size_t e) {
+  static const int edges[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0},
+                                   {4, 5}, {5, 6}, {6, 7}, {7, 4},
+                                   {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+  const uint32_t* h = &m.hex[8 * e];
+  double l = 0;
+  for (const auto& ed : edges)
+    l = std::max(l, (m.node(h[ed[0]]) - m.node(h[ed[1]])).norm());
+  return l;
+}
+
+bool testMesh() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Contact zone mesh" << std::endl;
+  FeMeshOptions opt;
+  opt.contactSize = 0.25;
+  opt.filletSize = 0.5;
+  const UnloadedTca tca(spiralPair());
+  const ContactZoneMesher mesher(tca, opt);
+  ThreadPool one(1), four(4);
+  const FeMesh m = mesher.build(four);
+
+  bool passed = true;
+  passed &= check("Loaded teeth from the TCA",
+                  !m.loadedTeeth.empty() &&
+                      m.loadedTeeth.size() == mesher.contactZones().size());
+
+  // Corner Jacobians of every brick are positive
+  size_t inverted = 0;
+  for (size_t e = 0; e < m.elements(); ++e) {
+    const uint32_t* h = &m.hex[8 * e];
+    static const int corner[8][4] = {{0, 1, 3, 4}, {1, 2, 0, 5}, {2, 3, 1, 6},
+                                     {3, 0, 2, 7}, {4, 7, 5, 0}, {5, 4, 6, 1},
+                                     {6, 5, 7, 2}, {7, 6, 4, 3}};
+    for (const auto& c : corner) {
+      const Vec3 p = m.node(h[c[0]]);
+      inverted += (m.node(h[c[1]]) - p)
+                      .cross(m.node(h[c[2]]) - p)
+                      .dot(m.node(h[c[3]]) - p) <= 0;
+    }
+  }
+  passed &= check("No inverted bricks", inverted == 0);
+
+  // Conforming: every face is shared by at most two bricks and the faces
+  // on the boundary close up
+  static const int faces[6][4] = {{0, 1, 2, 3}, {4, 7, 6, 5}, {0, 4, 5, 1},
+                                  {1, 5, 6, 2}, {2, 6, 7, 3}, {3, 7, 4, 0}};
+  std::map<std::array<uint32_t, 4>, int> count;
+  for (size_t e = 0; e < m.elements(); ++e) {
+    for (const auto& fc : faces) {
+      std::array<uint32_t, 4> key;
+      for (int i = 0; i < 4; ++i)
+        key[i] = m.hex[8 * e + fc[i]];
+      std::sort(key.begin(), key.end());
+      ++count[key];
+    }
+  }
+  bool shared = true;
+  size_t boundary = 0;
+  for (const auto& [key, n] : count) {
+    shared &= n <= 2;
+    boundary += n == 1;
+  }
+  Vec3 sum;
+  double area = 0;
+  for (size_t e = 0; e < m.elements(); ++e) {
+    for (const auto& fc : faces) {
+      std::array<uint32_t, 4> key;
+      for (int i = 0; i < 4; ++i)
+        key[i] = m.hex[8 * e + fc[i]];
+      std::sort(key.begin(), key.end());
+      if (count[key] != 1)
+        continue;
+      const uint32_t* h = &m.hex[8 * e];
+      const Vec3 n = (m.node(h[fc[2]]) - m.node(h[fc[0]]))
+                         .cross(m.node(h[fc[3]]) - m.node(h[fc[1]]));
+      sum += n * 0.5;
+      area += n.norm() / 2;
+    }
+  }
+  passed &= check("Faces shared by at most two bricks", shared);
+  passed &= check("Boundary is closed",
+                  boundary > 0 && sum.norm() < 1e-6 * area);
+
+  // Bricks on the loaded flank inside the marking zone are fine, the
+  // unloaded teeth are coarse
+  const ToothFlank& f = tca.toothFlank();
+  double inZone = 0;
+  for (uint32_t e : m.flankElements) {
+    const uint32_t* h = &m.hex[8 * e];
+    const Vec3 c = (m.node(h[4]) + m.node(h[6])) * 0.5;
+    const double R = c.norm();
+    const double u = f.profileParam(R, acos(c.z / R));
+    for (const ContactZone& z : mesher.contactZones()) {
+      if (z.tooth == m.tooth[e] && R > z.minR && R < z.maxR && u > z.minU &&
+          u < z.maxU)
+        inZone = std::max(inZone, maxEdge(m, e));
+    }
+  }
+  passed &= check("Fine in the contact zone",
+                  inZone > 0 && inZone < 1.3 * opt.contactSize);
+  double unloaded = 0;
+  for (size_t e = 0; e < m.elements(); ++e) {
+    if (std::find(m.loadedTeeth.begin(), m.loadedTeeth.end(), m.tooth[e]) ==
+        m.loadedTeeth.end())
+      unloaded = std::max(unloaded, maxEdge(m, e));
+  }
+  passed &= check("Coarse elsewhere", unloaded > 4 * opt.contactSize);
+  passed &= check("Fraction of the uniform node count",
+                  m.nodes() < m.uniformNodes / 10);
+
+  // Uniform reference count matches a uniform build
+  FeMeshOptions uniform;
+  uniform.contactSize = uniform.filletSize = uniform.coarseSize = 1;
+  const FeMesh u = ContactZoneMesher(tca, uniform).build(four);
+  passed &= check("Uniform node count", u.nodes() == u.uniformNodes);
+
+  // Sectors are independent of the pool
+  const FeMesh s = mesher.build(one);
+  passed &= check("Same mesh on one worker",
+                  s.x == m.x && s.y == m.y && s.z == m.z && s.hex == m.hex &&
+                      s.flankElements == m.flankElements);
+  return passed;
+}
+
+bool testExport() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Abaqus export" << std::endl;
+  FeMeshOptions opt;
+  opt.contactSize = 0.5;
+  opt.filletSize = 1;
+  const FeMesh m = ContactZoneMesher(UnloadedTca(straightPair()), opt).build();
+  const std::string path = "test_contactmesh.inp";
+  const size_t bytes = feexport::writeInp(path, m);
+
+  std::ifstream in(path);
+  std::string line, section;
+  size_t nodes = 0, elements = 0, sets = 0, lines = 0;
+  bool surface = false, lastNode = false;
+  while (std::getline(in, line)) {
+    lines += line.size() + 1;
+    if (line[0] == '*') {
+      section = line;
+      sets += line.rfind("*ELSET, ELSET=TOOTH_", 0) == 0;
+      surface |= line.rfind("*SURFACE", 0) == 0;
+      continue;
+    }
+    if (section == "*NODE") {
+      ++nodes;
+      double x, y, z;
+      size_t id;
+      if (std::sscanf(line.c_str(), "%zu, %lf, %lf, %lf", &id, &x, &y, &z) ==
+              4 &&
+          id == m.nodes())
+        lastNode = std::fabs(x - m.x.back()) < 1e-6 &&
+                   std::fabs(z - m.z.back()) < 1e-6;
+    }
+    elements += section.rfind("*ELEMENT", 0) == 0;
+  }
+  in.close();
+  std::remove(path.c_str());
+
+  bool passed = true;
+  passed &= check("All nodes and elements",
+                  nodes == m.nodes() && elements == m.elements() && lastNode);
+  passed &= check("One set per tooth and the flank surface",
+                  sets == 11 && surface);
+  passed &= check("Byte count", bytes == lines);
+  return passed;
+}
+
+bool testBudget() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Coarser mesh under a budget" << std::endl;
+  FeMeshOptions opt;
+  opt.contactSize = 0.25;
+  opt.filletSize = 0.5;
+  const UnloadedTca tca(spiralPair());
+  const ContactZoneMesher mesher(tca, opt);
+  auto bytes = [](const FeMesh& m) {
+    return m.nodes() * FeMesh::bytesPerNode() +
+           m.elements() * FeMesh::bytesPerElement();
+  };
+  const FeMesh fine = mesher.build();
+
+  bool passed = true;
+  passed &= check("Asked size without a budget",
+                  fine.contactSize == opt.contactSize);
+  {
+    memory::Budget budget(bytes(fine) / 2);
+    memory::BudgetScope scope(&budget);
+    const FeMesh m = mesher.build();
+    passed &= check("Contact size grown to fit",
+                    m.contactSize > opt.contactSize && m.elements() > 0 &&
+                        bytes(m) <= budget.limit() &&
+                        m.loadedTeeth == fine.loadedTeeth);
+  }
+
+  bool threw = false;
+  try {
+    memory::Budget budget(1);
+    memory::BudgetScope scope(&budget);
+    mesher.build();
+  } catch (const memory::BudgetExceeded&) {
+    threw = true;
+  }
+  passed &= check("Coarsest mesh over budget throws", threw);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testTca();
+  printTestResult("Unloaded TCA", passed);
+  allPassed &= passed;
+  passed = testContactGap();
+  printTestResult("TCA contact gap", passed);
+  allPassed &= passed;
+  passed = testMesh();
+  printTestResult("Contact zone mesh", passed);
+  allPassed &= passed;
+  passed = testExport();
+  printTestResult("FE export", passed);
+  allPassed &= passed;
+  passed = testBudget();
+  printTestResult("Mesh under a memory budget", passed);
+  allPassed &= passed;
+
+  printTestResult("All contact mesh tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+// test_contactpattern.cpp
+// Unit test for marking test contact patterns: accumulation over the mesh
+// cycle, mounting errors, parallel chunks and the image and grid files
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/analysis/ContactPattern.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testMisalignment() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Mounting errors in the TCA" << std::endl;
+  bool passed = true;
+  auto tcaWith = [](double h, double v) {
+    TcaOptions o;
+    o.misalignment.pinionAxial = h;
+    o.misalignment.offset = v;
+    return UnloadedTca(spiralPair(), false, o);
+  };
+  const UnloadedTca nominal(spiralPair());
+  const UnloadedTca h = tcaWith(0.05, 0), v = tcaWith(0, 0.05);
+  const UnloadedTca h2 = tcaWith(0.1, 0), hv = tcaWith(0.05, 0.05);
+  const ToothFlank& f = nominal.toothFlank();
+
+  bool zero = true, linear = true, additive = true, varies = false;
+  double first = 0;
+  for (int i = 0; i <= 8; ++i) {
+    const double R = f.innerR() + (f.outerR() - f.innerR()) * i / 8;
+    for (int j = 0; j <= 8; ++j) {
+      const double lo = nominal.activeLo(R), hi = nominal.activeHi(R);
+      const double c = lo + (hi - lo) * j / 8;
+      const double g = h.misalignmentGap(R, c);
+      zero &= nominal.misalignmentGap(R, c) == 0;
+      linear &= std::abs(h2.misalignmentGap(R, c) - 2 * g) < 1e-12;
+      additive &= std::abs(hv.misalignmentGap(R, c) -
+                           (g + v.misalignmentGap(R, c))) < 1e-12;
+      if (i == 0 && j == 0)
+        first = g;
+      varies |= std::abs(g - first) > 1e-3;
+    }
+  }
+  passed &= check("No mounting error, no gap", zero);
+  passed &= check("First order: linear and additive", linear && additive);
+  passed &= check("The gap varies over the flank", varies);
+
+  // Pinion in and out move the pattern to opposite sides of nominal
+  const ContactZone n = nominal.contact(0)[0];
+  const ContactZone out = h.contact(0)[0];
+  const ContactZone in = tcaWith(-0.05, 0).contact(0)[0];
+  passed &= check("H moves the pattern",
+                  (out.centreU - n.centreU) * (in.centreU - n.centreU) < 0 &&
+                      std::abs(out.centreU - n.centreU) > 0.01);
+  return passed;
+}
+
+bool testPattern() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Accumulated patterns" << std::endl;
+  bool passed = true;
+  ContactPatternOptions opt;
+  opt.faceCells = 64;
+  opt.profileCells = 32;
+  opt.rollPositions = 64;
+  const ContactPatternAnalysis straight(straightPair(), false, {}, opt);
+  const std::vector<ContactPattern> set =
+      straight.run({{"nominal", {}}});
+  const ContactPattern& drive = set[0];
+  const ContactPattern& coast = set[1];
+  passed &= check("Both flanks", set.size() == 2 &&
+                                     drive.side == FlankSide::Right &&
+                                     coast.side == FlankSide::Left);
+  const double Rmid = (drive.innerR + drive.outerR) / 2;
+  const double cell = (drive.outerR - drive.innerR) / opt.faceCells;
+  passed &= check("Straight teeth mark mid face",
+                  std::abs(drive.centreR - Rmid) < cell &&
+                      drive.markedShare > 0.05 && drive.markedShare < 0.8);
+  passed &= check("Straight teeth mark both flanks alike",
+                  std::abs(drive.centreR - coast.centreR) < 1e-6 &&
+                      std::abs(drive.centreU - coast.centreU) < 1e-6 &&
+                      drive.markedShare == coast.markedShare);
+
+  // Squeeze only where the cell marks, and never above the compound
+  const double marking = TcaOptions().markingCompound;
+  bool consistent = true;
+  for (size_t i = 0; i < drive.time.size(); ++i) {
+    consistent &= (drive.time[i] > 0) == (drive.squeeze[i] > 0);
+    consistent &= drive.squeeze[i] <= marking * drive.time[i] + 1e-9;
+  }
+  passed &= check("Squeeze where marked", consistent);
+
+  // One roll position is the TCA contact of rotation 0
+  ContactPatternOptions one = opt;
+  one.rollPositions = 1;
+  const ContactPattern snap =
+      ContactPatternAnalysis(straightPair(), false, {}, one)
+          .pattern(FlankSide::Right, {"nominal", {}});
+  const std::vector<ContactZone> zones = UnloadedTca(straightPair()).contact(0);
+  bool inside = true;
+  for (int row = 0; row < snap.profileCells; ++row) {
+    for (int col = 0; col < snap.faceCells; ++col) {
+      if (snap.time[snap.cell(col, row)] == 0)
+        continue;
+      bool any = false;
+      for (const ContactZone& z : zones) {
+        any |= z.marks() && snap.cellR(col) >= z.minR - cell &&
+               snap.cellR(col) <= z.maxR + cell &&
+               snap.cellU(row) >= z.minU - 1.0 / snap.profileCells &&
+               snap.cellU(row) <= z.maxU + 1.0 / snap.profileCells;
+      }
+      inside &= any;
+    }
+  }
+  passed &= check("Single roll position matches the TCA zones",
+                  inside && snap.markedShare > 0);
+
+  // Chunks are summed in order, so the pool size does not matter
+  ThreadPool single(1), four(4);
+  const ContactPatternAnalysis spiral(spiralPair(), false, {}, opt);
+  const ContactPatternCase hPlus = markingTestCases()[1];
+  const ContactPattern a = spiral.pattern(FlankSide::Right, hPlus, single);
+  const ContactPattern b = spiral.pattern(FlankSide::Right, hPlus, four);
+  passed &= check("Same pattern on any pool",
+                  a.time == b.time && a.squeeze == b.squeeze);
+  const ContactPattern nominal =
+      spiral.pattern(FlankSide::Right, markingTestCases()[0], four);
+  passed &= check("Mounting error moves the accumulated pattern",
+                  hPlus.name == "H+" &&
+                      std::abs(a.centreU - nominal.centreU) > 0.01);
+  return passed;
+}
+
+bool testFiles() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Image and grid files" << std::endl;
+  bool passed = true;
+  ContactPatternOptions opt;
+  opt.faceCells = 20;
+  opt.profileCells = 10;
+  opt.rollPositions = 16;
+  const ContactPattern p = ContactPatternAnalysis(straightPair(), false, {},
+                                                  opt)
+                               .pattern(FlankSide::Right, {"nominal", {}});
+  const std::string prefix = "test_contactpattern";
+  const size_t bytes = writeContactPattern(prefix, p, 0, 0, 3);
+
+  std::ifstream ppm(prefix + ".time.ppm", std::ios::binary);
+  std::string magic;
+  int w = 0, h = 0, depth = 0;
+  ppm >> magic >> w >> h >> depth;
+  ppm.get();
+  std::string pixels((std::istreambuf_iterator<char>(ppm)),
+                     std::istreambuf_iterator<char>());
+  passed &= check("PPM image scaled from the grid",
+                  magic == "P6" && w == 60 && h == 30 && depth == 255 &&
+                      pixels.size() == size_t(w) * h * 3);
+  // Bottom left pixel is the root at the toe, unmarked white
+  passed &= check("Root at the bottom, unmarked cells white",
+                  pixels.substr(size_t(h - 1) * w * 3, 3) == "\xff\xff\xff");
+
+  std::ifstream csv(prefix + ".squeeze.csv");
+  std::string line;
+  std::getline(csv, line);
+  bool header = line.rfind("u/R,", 0) == 0;
+  int rows = 0;
+  bool values = true;
+  while (std::getline(csv, line)) {
+    std::istringstream in(line);
+    std::string field;
+    std::getline(in, field, ',');
+    values &= std::abs(std::stod(field) - p.cellU(rows)) < 1e-6;
+    for (int c = 0; c < p.faceCells; ++c) {
+      std::getline(in, field, ',');
+      values &= std::stof(field) == p.squeeze[p.cell(c, rows)];
+    }
+    ++rows;
+  }
+  passed &= check("CSV grid round trips",
+                  header && rows == p.profileCells && values && bytes > 0);
+  for (const char* ext :
+       {".time.ppm", ".time.csv", ".squeeze.ppm", ".squeeze.csv"})
+    std::remove((prefix + ext).c_str());
+
+  bool threw = false;
+  try {
+    writeContactPattern("no_such_dir_pattern/x", p);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  passed &= check("Unwritable path throws", threw);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testMisalignment();
+  printTestResult("Mounting errors in the TCA", passed);
+  allPassed &= passed;
+  passed = testPattern();
+  printTestResult("Accumulated patterns", passed);
+  allPassed &= passed;
+  passed = testFiles();
+  printTestResult("Image and grid files", passed);
+  allPassed &= passed;
+
+  printTestResult("All contact pattern tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+// test_draft.cpp
+// Unit test for the gear surface mesh and the draft/undercut analysis
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/manufacturing/Draft.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testSurface() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Gear surface mesh" << std::endl;
+  GearSurfaceOptions opt;
+  opt.boreRadius = 6;
+  const GearSurface surface(straightPair().makeGear(), opt);
+  const GearSurfaceMesh m = surface.build();
+
+  // A closed, outward wound surface: area weighted normals cancel and the
+  // enclosed volume is positive
+  Vec3 sum;
+  double volume = 0, area = 0, bore = 0;
+  for (size_t i = 0; i < m.size(); ++i) {
+    const Vec3 n = (m.b(i) - m.a(i)).cross(m.c(i) - m.a(i));
+    sum += n;
+    area += n.norm() / 2;
+    volume += m.a(i).dot(m.b(i).cross(m.c(i))) / 6;
+    if (m.region[i] == SurfaceRegion::Bore)
+      bore += n.norm() / 2;
+  }
+  const ToothFlank& f = surface.toothFlank();
+  const double height = std::sqrt(f.outerR() * f.outerR() - 36) -
+                        std::sqrt(f.innerR() * f.innerR() - 36);
+
+  bool passed = true;
+  passed &= check("Triangles in every sector",
+                  m.size() % 11 == 0 && m.tooth.back() == 10);
+  // Up to chord gaps where the body sphere meets the teeth
+  passed &= check("Surface is closed", sum.norm() < 1e-3 * area);
+  passed &= check("Wound outwards", volume > 0);
+  passed &= check("Bore area", std::fabs(bore - 2 * M_PI * 6 * height) <
+                                   0.01 * bore);
+  return passed;
+}
+
+bool testDraft() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Draft and undercuts" << std::endl;
+  DraftOptions opt;
+  opt.surface.boreRadius = 6;
+  const DraftAnalysis analysis(straightPair().makeGear(), opt);
+  const GearSurfaceMesh m = analysis.gearSurface().build();
+  ThreadPool one(1), four(4);
+  const DraftResult r = analysis.run(m, one);
+
+  bool passed = true;
+  passed &= check("One draft per face",
+                  r.draft.size() == m.size() && r.status.size() == m.size());
+  double zLo = HUGE_VAL, zHi = -HUGE_VAL;
+  for (size_t i = 0; i < m.size(); ++i) {
+    zLo = std::min(zLo, m.az[i]);
+    zHi = std::max(zHi, m.az[i]);
+  }
+  passed &= check("Parting plane within the part",
+                  r.partingZ > zLo && r.partingZ < zHi);
+  // Vertical bore walls have no draft, spheres release cleanly
+  const size_t bore = size_t(SurfaceRegion::Bore);
+  const size_t body = size_t(SurfaceRegion::Body);
+  passed &= check("Bore below draft", r.regionBelowDraftArea[bore] > 0 &&
+                                          r.regionUndercutArea[bore] == 0);
+  passed &= check("Body spheres release", r.regionUndercutArea[body] == 0 &&
+                                              r.regionBelowDraftArea[body] ==
+                                                  0);
+  passed &= check("Undercuts are flagged",
+                  r.undercutFaces() > 0 && r.minDraft < 0);
+
+  // Chunked reduction does not depend on the pool
+  const DraftResult p = analysis.run(m, four);
+  passed &= check("Same result on four workers",
+                  p.partingZ == r.partingZ &&
+                      p.undercutArea == r.undercutArea &&
+                      p.belowDraftArea == r.belowDraftArea);
+
+  // A stricter draft only adds below draft area
+  opt.draftAngle = 3;
+  const DraftResult s = DraftAnalysis(straightPair().makeGear(), opt).run(m);
+  passed &= check("Stricter draft flags more",
+                  s.belowDraftArea + s.undercutArea >=
+                      r.belowDraftArea + r.undercutArea);
+  return passed;
+}
+
+bool testMacro() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Macro geometry" << std::endl;
+  const BevelMacroGeometry moulded(GearMacro(30, 10),
+                                   ManufacturingMethod::InjectionMoulding, 110,
+                                   12, 30, 80, 20, 3, 2.5);
+  const DraftResult r = DraftAnalysis(straightPair().makeGear(), moulded).run();
+
+  bool passed = true;
+  passed &= check("Draft angle from the macro", r.requiredDraft == 2.5);
+  passed &= check("Moulding and forging only",
+                  DraftAnalysis::applies(ManufacturingMethod::Forging) &&
+                      !DraftAnalysis::applies(ManufacturingMethod::Milling));
+  bool threw = false;
+  try {
+    const BevelMacroGeometry milled(GearMacro(30, 10),
+                                    ManufacturingMethod::Milling, 110, 12, 30,
+                                    80, 20, 3, 2.5);
+    DraftAnalysis(straightPair().makeGear(), milled);
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  passed &= check("Milled gears rejected", threw);
+  return passed;
+}
+
+bool testBudget() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Coarser meshes under a budget" << std::endl;
+  DraftOptions opt;
+  opt.surface.boreRadius = 6;
+  const DraftAnalysis analysis(straightPair().makeGear(), opt);
+  const GearSurfaceMesh fine = analysis.gearSurface().build();
+  ThreadPool one(1);
+  auto peak = [](const memory::Budget& b) {
+    return size_t(b.jobUsage().total.peak.load());
+  };
+
+  bool passed = true;
+  {
+    memory::Budget budget(fine.size() * GearSurfaceMesh::bytesPerTriangle() /
+                          2);
+    memory::BudgetScope scope(&budget);
+    const GearSurfaceMesh m = analysis.gearSurface().build(one);
+    passed &= check("Surface steps halved to fit",
+                    m.size() > 0 && m.size() < fine.size() &&
+                        peak(budget) <= budget.limit());
+  }
+
+  // Height maps take most of a run on a given mesh
+  size_t full = 0;
+  {
+    memory::Budget budget;
+    memory::BudgetScope scope(&budget);
+    analysis.run(fine, one);
+    full = peak(budget);
+  }
+  {
+    memory::Budget budget(full * 3 / 4);
+    memory::BudgetScope scope(&budget);
+    const DraftResult r = analysis.run(fine, one);
+    passed &= check("Height map pixel grown to fit",
+                    r.pixelSize > opt.pixelSize &&
+                        r.draft.size() == fine.size() &&
+                        peak(budget) <= budget.limit());
+  }
+
+  bool threw = false;
+  try {
+    memory::Budget budget(1);
+    memory::BudgetScope scope(&budget);
+    analysis.gearSurface().build(one);
+  } catch (const memory::BudgetExceeded&) {
+    threw = true;
+  }
+  passed &= check("Coarsest surface over budget throws", threw);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testSurface();
+  printTestResult("Gear surface", passed);
+  allPassed &= passed;
+  passed = testDraft();
+  printTestResult("Draft analysis", passed);
+  allPassed &= passed;
+  passed = testMacro();
+  printTestResult("Draft macro geometry", passed);
+  allPassed &= passed;
+  passed = testBudget();
+  printTestResult("Draft under a memory budget", passed);
+  allPassed &= passed;
+
+  printTestResult("All draft tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+// test_dynamics.cpp
+// Unit test for the torsional gear dynamics speed sweep
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/analysis/GearDynamics.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Straight teeth shortened to a contact ratio of about 0.9
+BevelGearPair stubTeeth() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, -4, 4, 19.43,
+                       60, 20);
+}
+
+// Heavy rotors bring the mesh resonance below 10k rpm
+DynamicsInputs heavyRotors(double damping = 0.07) {
+  DynamicsInputs in;
+  in.pinionInertia = 200;
+  in.gearInertia = 2000;
+  in.dampingRatio = damping;
+  return in;
+}
+
+bool testSweep() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Run-up sweep" << std::endl;
+  const GearDynamics dyn(spiralPair(), heavyRotors());
+  const std::vector<double> speeds = GearDynamics::speedRange(0, 10000, 200);
+  ThreadPool pool(4);
+  const DynamicsResults r = dyn.run(speeds, pool);
+
+  bool passed = true;
+  passed &= check("Standstill is static", r.quasiStatic[0] &&
+                                              r.dynamicFactor[0] == 1);
+  // Well below resonance the mesh force follows the static load
+  const size_t slow = 3;
+  passed &= check("Subcritical dynamic factor near 1",
+                  r.speed[slow] < 0.1 * dyn.resonanceSpeed() &&
+                      r.dynamicFactor[slow] < 1.2);
+
+  const size_t peak = std::max_element(r.dynamicFactor.begin(),
+                                       r.dynamicFactor.end()) -
+                      r.dynamicFactor.begin();
+  passed &= check("Peak near the mesh resonance",
+                  std::fabs(r.speed[peak] / dyn.resonanceSpeed() - 1) < 0.2);
+  passed &= check("Resonance amplifies the force", r.dynamicFactor[peak] > 1.5);
+  passed &= check("Teeth separate at resonance", r.minForceRatio[peak] == 0);
+
+  // Lanes are independent: a single speed gives the same answer
+  const DynamicsResults one = dyn.run({r.speed[peak]}, pool);
+  passed &= check("Lane matches single run",
+                  std::fabs(one.dynamicFactor[0] - r.dynamicFactor[peak]) <
+                      1e-12);
+  return passed;
+}
+
+bool testDamping() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Damping lowers the resonance peak" << std::endl;
+  const std::vector<double> speeds = GearDynamics::speedRange(500, 4000, 60);
+  const DynamicsResults lo = GearDynamics(spiralPair(), heavyRotors(0.05))
+                                 .run(speeds);
+  const DynamicsResults hi = GearDynamics(spiralPair(), heavyRotors(0.2))
+                                 .run(speeds);
+  const double peakLo =
+      *std::max_element(lo.dynamicFactor.begin(), lo.dynamicFactor.end());
+  const double peakHi =
+      *std::max_element(hi.dynamicFactor.begin(), hi.dynamicFactor.end());
+  return check("Higher damping, lower peak", peakHi < peakLo);
+}
+
+bool testContactLoss() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Contact ratio below 1" << std::endl;
+  const GearDynamics dyn(stubTeeth(), heavyRotors());
+  const DynamicsResults r = dyn.run({0, 50, 0.5 * dyn.resonanceSpeed()});
+
+  bool passed = true;
+  bool finite = true;
+  for (size_t i = 0; i < r.size(); ++i) {
+    finite &= std::isfinite(r.dynamicFactor[i]) &&
+              std::isfinite(r.minForceRatio[i]) && std::isfinite(r.dteRms[i]);
+  }
+  passed &= check("Results finite", finite);
+  passed &= check("Standstill reports loss of contact",
+                  r.quasiStatic[0] && r.minForceRatio[0] == 0);
+  passed &= check("Running mesh loses contact",
+                  !r.quasiStatic[2] && r.minForceRatio[2] == 0);
+  passed &= check("Deflection varies over the cycle", r.dteRms[0] > 0);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testSweep();
+  printTestResult("Dynamics run-up", passed);
+  allPassed &= passed;
+  passed = testDamping();
+  printTestResult("Dynamics damping", passed);
+  allPassed &= passed;
+  passed = testContactLoss();
+  printTestResult("Dynamics contact loss", passed);
+  allPassed &= passed;
+
+  printTestResult("All dynamics tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
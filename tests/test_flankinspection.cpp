@@ -0,0 +1,341 @@
+// test_flankinspection.cpp
+// Unit test for point cloud reading and CMM flank deviation analysis
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../src/analysis/FlankDeviation.hpp"
+#include "../src/geometry/GearParams.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Known deviation (mm) of a synthetic scan: a profile slope on left flanks,
+// a lead crowning on right flanks, both growing with the tooth number
+double pattern(const ToothFlank& f, int tooth, FlankSide side, double R,
+               double u) {
+  const double s = (R - f.innerR()) / (f.outerR() - f.innerR());
+  const double a = 1e-3 * (1 + tooth % 3);
+  return side == FlankSide::Left ? a * (u - 0.5)
+                                 : -a * 4 * (s - 0.5) * (s - 0.5);
+}
+
+// Points on every flank, offset along the normal by the pattern, plus
+// points on the tip lands that must be rejected
+PointCloud syntheticScan(const ToothFlank& f, int face, int profile,
+                         bool deviations, size_t* tipPoints = nullptr) {
+  PointCloud c;
+  size_t tips = 0;
+  for (int k = 0; k < f.numTeeth(); ++k) {
+    for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+      for (int i = 0; i < face; ++i) {
+        const double R =
+            f.innerR() + (f.outerR() - f.innerR()) * (i + 0.5) / face;
+        for (int j = 0; j < profile; ++j) {
+          const double u = 0.02 + 0.96 * (j + 0.37) / profile;
+          Vec3 p = f.point(side, R, u);
+          if (deviations)
+            p = p + f.normal(side, R, u) * pattern(f, k, side, R, u);
+          c.push_back(f.onTooth(p, k));
+        }
+      }
+    }
+    // Middle of the tip land, well away from both flanks
+    for (int i = 0; i < face; ++i) {
+      const double R =
+          f.innerR() + (f.outerR() - f.innerR()) * (i + 0.5) / face;
+      const Vec3 l = f.point(FlankSide::Left, R, 1);
+      const Vec3 r = f.point(FlankSide::Right, R, 1);
+      const Vec3 mid = (l + r) * 0.5;
+      c.push_back(f.onTooth(mid * (l.norm() / mid.norm()), k));
+      ++tips;
+    }
+  }
+  if (tipPoints)
+    *tipPoints = tips;
+  return c;
+}
+
+bool testReaders() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Point cloud readers" << std::endl;
+  const ToothFlank f(spiralPair().makeGear());
+  const PointCloud c = syntheticScan(f, 12, 8, true);
+  bool passed = true;
+
+  const std::string text = "test_flankinspection.xyz";
+  {
+    std::ofstream out(text);
+    out << "# GearLab CMM export\nX,Y,Z\n" << std::setprecision(17);
+    for (size_t i = 0; i < c.size(); ++i) {
+      const char* sep = i % 2 ? " " : ", ";
+      out << c.x[i] << sep << c.y[i] << sep << c.z[i] << "\r\n";
+    }
+  }
+  const PointCloud t = pointcloud::read(text);
+  std::remove(text.c_str());
+  double err = 0;
+  for (size_t i = 0; i < std::min(t.size(), c.size()); ++i)
+    err = std::max(err, (t.point(i) - c.point(i)).norm());
+  passed &= check("Text scan keeps every point in order",
+                  t.size() == c.size() && err == 0);
+
+  const std::string ply = "test_flankinspection.ply";
+  {
+    std::ofstream out(ply, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\ncomment test\n"
+        << "element vertex " << c.size() << "\n"
+        << "property float x\nproperty float y\nproperty double z\n"
+        << "property uchar intensity\nend_header\n";
+    for (size_t i = 0; i < c.size(); ++i) {
+      const float x = float(c.x[i]), y = float(c.y[i]);
+      const unsigned char s = 7;
+      out.write(reinterpret_cast<const char*>(&x), 4);
+      out.write(reinterpret_cast<const char*>(&y), 4);
+      out.write(reinterpret_cast<const char*>(&c.z[i]), 8);
+      out.write(reinterpret_cast<const char*>(&s), 1);
+    }
+  }
+  ThreadPool pool(4);
+  const PointCloud b = pointcloud::read(ply, pool);
+  std::remove(ply.c_str());
+  err = 0;
+  for (size_t i = 0; i < std::min(b.size(), c.size()); ++i) {
+    err = std::max(err, std::fabs(b.x[i] - c.x[i]) +
+                            std::fabs(b.y[i] - c.y[i]) +
+                            std::fabs(b.z[i] - c.z[i]));
+  }
+  passed &= check("Binary PLY skips extra properties",
+                  b.size() == c.size() && err < 1e-4);
+
+  bool threw = false;
+  {
+    std::ofstream out(ply);
+    out << "not a ply\n";
+  }
+  try {
+    pointcloud::read(ply);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  std::remove(ply.c_str());
+  passed &= check("Bad PLY header throws", threw);
+
+  // Fixed size elements before the vertices are skipped
+  const float camera[2] = {1.5f, -2.5f};
+  {
+    std::ofstream out(ply, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element camera 2\nproperty float view\nproperty uchar id\n"
+        << "element vertex " << c.size() << "\n"
+        << "property double x\nproperty double y\nproperty double z\n"
+        << "element face 0\nproperty list uchar int vertex_indices\n"
+        << "end_header\n";
+    for (int i = 0; i < 2; ++i) {
+      const unsigned char id = 9;
+      out.write(reinterpret_cast<const char*>(&camera[i]), 4);
+      out.write(reinterpret_cast<const char*>(&id), 1);
+    }
+    for (size_t i = 0; i < c.size(); ++i) {
+      out.write(reinterpret_cast<const char*>(&c.x[i]), 8);
+      out.write(reinterpret_cast<const char*>(&c.y[i]), 8);
+      out.write(reinterpret_cast<const char*>(&c.z[i]), 8);
+    }
+  }
+  const PointCloud l = pointcloud::read(ply, pool);
+  err = 0;
+  for (size_t i = 0; i < std::min(l.size(), c.size()); ++i)
+    err = std::max(err, (l.point(i) - c.point(i)).norm());
+  passed &= check("Binary PLY skips elements before the vertices",
+                  l.size() == c.size() && err == 0);
+
+  {
+    std::ofstream out(ply);
+    out << "ply\nformat ascii 1.0\n"
+        << "element camera 2\n"
+        << "property float yaw\nproperty float pitch\nproperty float roll\n"
+        << "element vertex 2\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "end_header\n1.5 0 0\n-2.5 0 0\n1 2 3\n4 5 6\n";
+  }
+  const PointCloud a = pointcloud::read(ply);
+  passed &= check("ASCII PLY skips elements before the vertices",
+                  a.size() == 2 && a.x[0] == 1 && a.z[1] == 6);
+
+  // Variable size data before the vertices cannot be skipped, and a vertex
+  // count whose byte size wraps around must not pass the size check
+  const char* broken[] = {
+      "element face 1\nproperty list uchar int vertex_indices\n"
+      "element vertex 1\n"
+      "property float x\nproperty float y\nproperty float z\n",
+      "element vertex 1152921504606846977\n"
+      "property float x\nproperty float y\nproperty double z\n"};
+  for (const char* elements : broken) {
+    {
+      std::ofstream out(ply, std::ios::binary);
+      out << "ply\nformat binary_little_endian 1.0\n"
+          << elements << "end_header\n"
+          << std::string(16, '\0');
+    }
+    threw = false;
+    try {
+      pointcloud::read(ply);
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    passed &= check("Unreadable PLY body throws", threw);
+  }
+  std::remove(ply.c_str());
+  return passed;
+}
+
+bool testDeviations() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Flank deviations" << std::endl;
+  InspectionOptions opt;
+  opt.registration = false;
+  opt.gridColumns = 6;
+  opt.gridRows = 4;
+  const FlankInspection inspection(spiralPair().makeGear(), opt);
+  const ToothFlank& f = inspection.toothFlank();
+  size_t tips = 0;
+  const PointCloud c = syntheticScan(f, 24, 16, true, &tips);
+
+  ThreadPool one(1), four(4);
+  const InspectionResult r = inspection.inspect(c, one);
+  const InspectionResult r4 = inspection.inspect(c, four);
+  bool passed = true;
+  passed &= check("Tip land points are off the flanks",
+                  r.onFlank == c.size() - tips);
+
+  // Walk the scan in the order it was built
+  double err = 0;
+  bool flanks = true;
+  size_t i = 0;
+  for (int k = 0; k < f.numTeeth(); ++k) {
+    for (int s = 0; s < 2; ++s) {
+      const FlankSide side = s ? FlankSide::Right : FlankSide::Left;
+      for (int a = 0; a < 24; ++a) {
+        const double R =
+            f.innerR() + (f.outerR() - f.innerR()) * (a + 0.5) / 24;
+        for (int b = 0; b < 16; ++b, ++i) {
+          const double u = 0.02 + 0.96 * (b + 0.37) / 16;
+          err = std::max(err, std::fabs(r.deviation[i] -
+                                        pattern(f, k, side, R, u)));
+          flanks &= r.flank[i] == 2 * k + s;
+        }
+      }
+    }
+    for (int a = 0; a < 24; ++a, ++i)
+      flanks &= r.flank[i] == -1 && std::isnan(r.deviation[i]);
+  }
+  std::cout << "  max deviation error " << err * 1e3 << " um" << std::endl;
+  passed &= check("Points are assigned to their flanks", flanks);
+  passed &= check("Deviations within 0.5 um", err < 5e-4);
+
+  // Left flank of tooth 1: the profile slope shows up row by row
+  const FlankTopography& t = r.topography[2];
+  const double a = 2e-3;
+  passed &= check("Topography layout",
+                  r.topography.size() == size_t(2 * f.numTeeth()) &&
+                      t.tooth == 1 && t.side == FlankSide::Left &&
+                      t.points == 24 * 16);
+  passed &= check("Profile slope across the rows",
+                  t.at(3, 2) - t.at(0, 2) > 0.5 * a &&
+                      std::fabs(t.at(3, 2) + t.at(0, 2)) < 0.1 * a);
+  const FlankTopography& rt = r.topography[3];
+  passed &= check("Lead crowning across the columns",
+                  rt.at(1, 0) < rt.at(1, 2) && rt.at(1, 5) < rt.at(1, 3) &&
+                      rt.max <= 1e-6 && rt.min < -0.5 * a);
+
+  bool same = r.onFlank == r4.onFlank;
+  for (size_t j = 0; j < c.size() && same; ++j) {
+    same = r.flank[j] == r4.flank[j] &&
+           (r.flank[j] < 0 || r.deviation[j] == r4.deviation[j]);
+  }
+  for (size_t k = 0; k < r.topography.size() && same; ++k) {
+    same = r.topography[k].rms == r4.topography[k].rms &&
+           r.topography[k].count == r4.topography[k].count;
+  }
+  passed &= check("Same result on 1 and 4 workers", same);
+  return passed;
+}
+
+bool testRegistration() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Scan registration" << std::endl;
+  const FlankInspection inspection(spiralPair().makeGear());
+  const ToothFlank& f = inspection.toothFlank();
+  const PointCloud nominal = syntheticScan(f, 24, 12, false);
+
+  // Scan in a machine frame a little off the gear frame
+  RigidTransform misplaced =
+      RigidTransform::rotationAbout(Vec3(0.004, -0.003, 0.01));
+  misplaced.translation = Vec3(0.08, -0.05, 0.1);
+  PointCloud scan;
+  for (size_t i = 0; i < nominal.size(); ++i)
+    scan.push_back(misplaced.apply(nominal.point(i)));
+
+  const InspectionResult r = inspection.inspect(scan);
+  const RigidTransform back = r.registration.then(misplaced);
+  std::cout << "  " << r.iterations << " iterations, rms "
+            << r.registrationRms * 1e3 << " um" << std::endl;
+  bool passed = true;
+  passed &= check("Registration undoes the machine frame",
+                  back.rotationVector().norm() < 1e-6 &&
+                      back.translation.norm() < 1e-4);
+  double worst = 0;
+  for (size_t i = 0; i < scan.size(); ++i) {
+    if (r.flank[i] >= 0)
+      worst = std::max(worst, double(std::fabs(r.deviation[i])));
+  }
+  passed &= check("Registered nominal scan deviates < 0.1 um",
+                  worst < 1e-4 && r.onFlank > scan.size() * 9 / 10);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testReaders();
+  printTestResult("Point cloud readers", passed);
+  allPassed &= passed;
+  passed = testDeviations();
+  printTestResult("Flank deviations", passed);
+  allPassed &= passed;
+  passed = testRegistration();
+  printTestResult("Scan registration", passed);
+  allPassed &= passed;
+
+  printTestResult("All flank inspection tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+// test_gearbox.cpp
+// Unit test for the multi-stage gearbox: layout checks, train ratios,
+// combined transmission error, per-stage rating and shared meshes
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/pipeline/Gearbox.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool hasIssue(const std::vector<GearboxIssue>& issues, int stage,
+              const std::string& text) {
+  for (const GearboxIssue& i : issues) {
+    if (i.stage == stage && i.message.find(text) != std::string::npos)
+      return true;
+  }
+  return false;
+}
+
+// Right angle reducer: input along x, intermediate shaft along z with the
+// first stage apex at the origin and the second 150 mm up, output along y
+Gearbox twoStage(const BevelGearPair& a = spiralPair(),
+                 const BevelGearPair& b = straightPair()) {
+  Gearbox box;
+  box.shafts = {{"input", {0, 0, 0}, {1, 0, 0}},
+                {"intermediate", {0, 0, 0}, {0, 0, 1}},
+                {"output", {0, 0, 150}, {0, 1, 0}}};
+  box.stages = {{a, true, {-80, 80, 1}, {-70, 70, 1}},
+                {b, true, {210, 60, -1}, {-75, 75, 1}}};
+  return box;
+}
+
+bool testLayout() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Layout checks" << std::endl;
+  bool passed = true;
+  passed &= check("Consistent layout", twoStage().check().empty());
+
+  Gearbox box = twoStage();
+  box.stages[0].driven.mountingDistance = 72;
+  auto issues = box.check();
+  passed &= check("Wrong mounting distance with the correction",
+                  issues.size() == 1 &&
+                      hasIssue(issues, 0, "Driven mounting distance 72 mm, "
+                                          "apex needs 70 mm"));
+
+  box = twoStage();
+  box.shafts[2].axis = {0, 1, 0.2};
+  passed &= check("Shaft angle",
+                  hasIssue(box.check(), 1,
+                           "cross at 101.3 deg, pair needs 90 deg"));
+
+  box = twoStage();
+  box.shafts[2].origin = {5, 0, 150};
+  passed &= check("Skew shafts",
+                  hasIssue(box.check(), 1, "do not intersect, offset 5 mm"));
+
+  // Second stage apex 20 mm up with its pinion below it, into the gear of
+  // the first stage
+  box = twoStage();
+  box.shafts[2].origin = {0, 0, 20};
+  box.stages[1].driver = {-40, 60, 1};
+  issues = box.check();
+  passed &= check("Members sharing a shaft overlap",
+                  issues.size() == 1 &&
+                      hasIssue(issues, 1, "on shaft intermediate"));
+
+  box = twoStage();
+  box.shafts.pop_back();
+  passed &= check("Shaft count", hasIssue(box.check(), -1, "needs 3 shafts"));
+  return passed;
+}
+
+bool testTrain() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Train ratio, TE and rating" << std::endl;
+  bool passed = true;
+  const Gearbox box = twoStage();
+  const LoadSpectrum spectrum = {{100, 1500, 1000}, {200, 900, 100}};
+  GearboxOptions opt;
+  const GearboxResult r = analyseGearbox(box, spectrum, opt);
+
+  passed &= check("Overall ratio",
+                  std::abs(r.overallRatio - 14.0 / 9 * 11.0 / 9) < 1e-12 &&
+                      std::abs(r.stages[1].ratio - 11.0 / 9) < 1e-12);
+  passed &= check("Valid", r.valid && r.issues.empty() &&
+                               r.stages[0].valid && r.stages[1].valid);
+
+  // Stages are the single pair analyses of their driven members
+  const std::vector<TcaPoint> direct =
+      UnloadedTca(spiralPair(), false, opt.tca).path(opt.tcaSteps);
+  bool same = r.stages[0].tca.size() == direct.size();
+  for (size_t i = 0; same && i < direct.size(); ++i)
+    same = r.stages[0].tca[i].transmissionError ==
+           direct[i].transmissionError;
+  passed &= check("Stage TCA of the driven gear", same);
+
+  // Second stage pinion runs 9/14 of the input speed at 14/9 the torque
+  const RatingResults rated = opt.rating.rate(
+      straightPair(), {{100 * 14.0 / 9, 1500 * 9.0 / 14, 1000},
+                      {200 * 14.0 / 9, 900 * 9.0 / 14, 100}});
+  passed &= check("Stage rating under the moved spectrum",
+                  r.stages[1].rating.size() == 1 &&
+                      r.stages[1].rating.pittingSafety1[0] ==
+                          rated.pittingSafety1[0] &&
+                      r.stages[1].rating.bendingDamage2[0] ==
+                          rated.bendingDamage2[0]);
+  passed &= check("Train safety is the weakest stage",
+                  r.minPittingSafety ==
+                      std::min(r.stages[0].rating.minPittingSafety(0),
+                               r.stages[1].rating.minPittingSafety(0)));
+
+  // At output rotation phi the intermediate shaft turned 11/9 phi, so the
+  // first stage lag reaches the output times 9/11
+  const size_t k = 777;
+  const double phi = r.rotation[k];
+  const double e0 = gearbox_detail::teAt(r.stages[0].tca, 360.0 / 14,
+                                         phi * 11 / 9) *
+                    9 / 11;
+  const double e1 = gearbox_detail::teAt(r.stages[1].tca, 360.0 / 11, phi);
+  passed &= check("Combined TE carries stage errors to the output",
+                  r.transmissionError.size() == size_t(opt.trainSamples) &&
+                      std::abs(r.transmissionError[k] - (e0 + e1)) < 1e-9);
+  passed &= check("Combined TE peak to peak",
+                  r.tePeakToPeak > 0 &&
+                      r.tePeakToPeak <= r.stages[0].tePeakToPeak * 9 / 11 +
+                                            r.stages[1].tePeakToPeak + 1e-9);
+
+  // One stage: the train error is the stage error
+  Gearbox single = box;
+  single.shafts.pop_back();
+  single.stages.pop_back();
+  const GearboxResult s = analyseGearbox(single);
+  passed &= check("Single stage train TE",
+                  s.valid && s.tePeakToPeak <= s.stages[0].tePeakToPeak &&
+                      s.tePeakToPeak > 0.9 * s.stages[0].tePeakToPeak);
+
+  // Driving the gear steps the speed up and analyses the pinion
+  single.stages[0].pinionDrives = false;
+  const GearboxResult up = analyseGearbox(single);
+  const std::vector<TcaPoint> pinion =
+      UnloadedTca(spiralPair(), true, opt.tca).path(opt.tcaSteps);
+  passed &= check("Speed increasing stage",
+                  std::abs(up.overallRatio - 9.0 / 14) < 1e-12 &&
+                      up.stages[0].tca.back().transmissionError ==
+                          pinion.back().transmissionError);
+  return passed;
+}
+
+bool testSharedMeshes() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Shared meshes and invalid stages" << std::endl;
+  bool passed = true;
+  BevelGearPair spiral = straightPair();
+  spiral.spiralAngle = 25;
+  Gearbox repeated = twoStage(spiralPair(), spiralPair());
+  repeated.stages[1].driven.mountingDistance = 70;
+  std::vector<Gearbox> variants = {twoStage(), twoStage(spiralPair(), spiral),
+                                   repeated};
+  const GearboxAnalysis a = analyseGearboxes(variants);
+  passed &= check("Identical stages computed once", a.meshes == 3);
+  const auto& v = a.variants;
+  passed &= check("Shared mesh results",
+                  v[1].stages[0].mesh == v[0].stages[0].mesh &&
+                      v[1].stages[0].tePeakToPeak ==
+                          v[0].stages[0].tePeakToPeak &&
+                      v[2].stages[1].mesh == v[2].stages[0].mesh);
+  passed &= check("Variants differ where their stages do",
+                  v[1].stages[1].tePeakToPeak != v[0].stages[1].tePeakToPeak);
+  passed &= check("Layout issues do not stop the analysis",
+                  !v[2].issues.empty() && !v[2].valid && v[2].stages[1].valid);
+
+  BevelGearPair broken = straightPair();
+  broken.numPinionTeeth = 12;
+  const GearboxResult r = analyseGearbox(twoStage(spiralPair(), broken));
+  passed &= check("Invalid stage reported, not thrown",
+                  !r.valid && r.stages[0].valid && !r.stages[1].valid &&
+                      hasIssue(r.issues, 1, "Invalid pair parameters") &&
+                      r.transmissionError.empty());
+
+  CancellationToken token;
+  token.cancel();
+  bool cancelled = false;
+  try {
+    analyseGearboxes(variants, {}, {}, token);
+  } catch (const JobCancelled&) {
+    cancelled = true;
+  }
+  passed &= check("Cancellation", cancelled);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testLayout();
+  printTestResult("Layout checks", passed);
+  allPassed &= passed;
+  passed = testTrain();
+  printTestResult("Train ratio, TE and rating", passed);
+  allPassed &= passed;
+  passed = testSharedMeshes();
+  printTestResult("Shared meshes and invalid stages", passed);
+  allPassed &= passed;
+
+  printTestResult("All gearbox tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
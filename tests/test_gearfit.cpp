@@ -0,0 +1,241 @@
+// test_gearfit.cpp
+// Unit test for fitting bevel gear parameters to a scan of the teeth
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/analysis/GearFit.hpp"
+#include "../src/geometry/GearParams.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Scan of every tooth at spacing h: both flanks, the tip land and the root
+// land, placed in the machine frame
+PointCloud syntheticScan(const BevelGear& g, double h,
+                         const RigidTransform& machine) {
+  const ToothFlank f(g);
+  PointCloud c;
+  const int face = int((f.outerR() - f.innerR()) / h);
+  for (int k = 0; k < f.numTeeth(); ++k) {
+    for (int i = 0; i < face; ++i) {
+      const double R =
+          f.innerR() + (f.outerR() - f.innerR()) * (i + 0.5) / face;
+      const double tip = f.tipAngle(R), root = f.rootAngle(R);
+      const int profile = std::max(2, int((tip - root) * R / h));
+      for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+        for (int j = 0; j < profile; ++j) {
+          const Vec3 p = f.point(side, R, (j + 0.5) / profile);
+          c.push_back(machine.apply(f.onTooth(p, k)));
+        }
+      }
+      const double tipWidth = f.halfWidth(tip);
+      const int tips = std::max(1, int(2 * tipWidth * R * sin(tip) / h));
+      for (int j = 0; j < tips; ++j) {
+        const double phi =
+            tipWidth * (2 * (j + 0.5) / tips - 1) + f.spiralOffset(R);
+        const Vec3 p(R * sin(tip) * cos(phi), R * sin(tip) * sin(phi),
+                     R * cos(tip));
+        c.push_back(machine.apply(f.onTooth(p, k)));
+      }
+      const double rootWidth = f.halfWidth(root);
+      const double gap = f.pitchAngle() - 2 * rootWidth;
+      const int roots = std::max(1, int(gap * R * sin(root) / h));
+      for (int j = 0; j < roots; ++j) {
+        const double phi = rootWidth + gap * (j + 0.5) / roots +
+                           f.spiralOffset(R);
+        const Vec3 p(R * sin(root) * cos(phi), R * sin(root) * sin(phi),
+                     R * cos(root));
+        c.push_back(machine.apply(f.onTooth(p, k)));
+      }
+    }
+  }
+  return c;
+}
+
+// A rotary table setup: the apex somewhere up the axis, a little tilt and
+// an arbitrary angular position
+RigidTransform machineFrame() {
+  RigidTransform m = RigidTransform::rotationAbout(Vec3(0.002, -0.001, 0.3));
+  m.translation = Vec3(0.05, -0.03, 25);
+  return m;
+}
+
+bool near(double a, double b, double tol) { return std::fabs(a - b) <= tol; }
+
+bool testStraight() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Straight gear scan" << std::endl;
+  const BevelGearPair pair = straightPair();
+  const BevelGear g = pair.makeGear();
+  const RigidTransform machine = machineFrame();
+  const PointCloud scan = syntheticScan(g, 0.2, machine);
+
+  GearFitOptions opt;
+  opt.backlash = 0.1;
+  const GearFitResult r = GearFit(opt).fit(scan);
+  const BevelGear& f = *r.gear;
+  std::cout << "  " << scan.size() << " points, " << r.iterations
+            << " iterations, rms " << r.rms * 1e3 << " um" << std::endl;
+  bool passed = true;
+  passed &= check("Tooth counts", f.numTeeth == 11 && r.mateTeeth == 9 &&
+                                      r.hasPair);
+  passed &= check("Pitch cone and pressure angle",
+                  near(f.pitchConeAngle, g.pitchConeAngle, 1e-3) &&
+                      near(f.pressureAngle, 20, 1e-3) &&
+                      near(f.spiralAngle, 0, 1e-3));
+  passed &= check("Face and root cones",
+                  near(f.faceConeAngle, 60, 1e-3) &&
+                      near(f.faceConeOffset, 0, 1e-3) &&
+                      near(f.rootConeAngle, 40, 1e-3) &&
+                      near(f.rootConeOffset, -0.74, 1e-3));
+  passed &= check("Face extents within a scan line",
+                  near(f.innerConeDistance, 19.43, 0.2) &&
+                      near(f.outerConeDistance, 60, 0.2));
+  passed &= check("Every point on the model",
+                  r.inliers == scan.size() && r.rms < 1e-4);
+
+  // The registration undoes the machine frame up to whole tooth pitches
+  const Vec3 w = machine.then(r.registration).rotationVector();
+  const double pitch = 2 * M_PI / 11;
+  const double turns = w.z / pitch;
+  passed &= check("Registration undoes the machine frame",
+                  std::hypot(w.x, w.y) < 1e-6 &&
+                      std::fabs(turns - std::nearbyint(turns)) < 1e-6 &&
+                      machine.then(r.registration).translation.norm() <
+                          1e-4);
+  return passed;
+}
+
+bool testSpiral() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Spiral gear scan with noise" << std::endl;
+  const BevelGearPair pair = spiralPair();
+  const BevelGear g = pair.makeGear();
+  PointCloud scan = syntheticScan(g, 0.15, machineFrame());
+
+  // 3 um probe noise and every 50th point a stray return up to 2 mm off
+  std::mt19937 rng(7);
+  std::normal_distribution<double> noise(0, 0.003);
+  std::uniform_real_distribution<double> stray(-2, 2);
+  for (size_t i = 0; i < scan.size(); ++i) {
+    scan.x[i] += noise(rng);
+    scan.y[i] += noise(rng);
+    scan.z[i] += noise(rng);
+    if (i % 50 == 0) {
+      scan.x[i] += stray(rng);
+      scan.z[i] += stray(rng);
+    }
+  }
+
+  GearFitOptions opt;
+  opt.backlash = 0.1;
+  opt.spiralType = Logarithmic;
+  ThreadPool one(1), four(4);
+  const GearFit fit(opt);
+  const GearFitResult r = fit.fit(scan, one);
+  const BevelGear& f = *r.gear;
+  std::cout << "  " << scan.size() << " points, " << r.iterations
+            << " iterations, rms " << r.rms * 1e3 << " um, module "
+            << f.module << std::endl;
+  bool passed = true;
+  passed &= check("Tooth counts", f.numTeeth == 14 && r.mateTeeth == 9);
+  passed &= check("Pressure and spiral angle",
+                  near(f.pressureAngle, 20, 0.01) &&
+                      near(f.spiralAngle, 30, 0.01));
+  passed &= check("Module from the face cone offset",
+                  near(f.module, g.module, 0.005) &&
+                      near(f.faceConeOffset, 1.2, 0.01));
+  passed &= check("Stray returns rejected, rms at the probe noise",
+                  r.inliers < scan.size() - scan.size() / 100 &&
+                      r.inliers > scan.size() * 9 / 10 && r.rms < 0.006);
+
+  const GearFitResult r4 = fit.fit(scan, four);
+  passed &= check("Same result on 1 and 4 workers",
+                  r4.gear->module == f.module &&
+                      r4.gear->pressureAngle == f.pressureAngle &&
+                      r4.inliers == r.inliers && r4.rms == r.rms);
+  return passed;
+}
+
+bool testPinion() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Pinion scan with a known mate" << std::endl;
+  const BevelGear p = straightPair().makePinion();
+  const PointCloud scan = syntheticScan(p, 0.25, machineFrame());
+  GearFitOptions opt;
+  opt.pinion = true;
+  opt.mateTeeth = 11;
+  opt.backlash = 0.1;
+  const GearFitResult r = GearFit(opt).fit(scan);
+  bool passed = true;
+  passed &= check("Pinion without a pair",
+                  !r.hasPair && r.gear->numTeeth == 9 && r.mateTeeth == 11);
+  passed &= check("Pinion cones",
+                  near(r.gear->pitchConeAngle, p.pitchConeAngle, 1e-3) &&
+                      near(r.gear->pressureAngle, 20, 1e-3) &&
+                      near(r.gear->faceConeAngle, p.faceConeAngle, 1e-3) &&
+                      near(r.gear->rootConeAngle, p.rootConeAngle, 1e-3));
+
+  bool threw = false;
+  try {
+    GearFit().fit(PointCloud());
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  passed &= check("Empty scan throws", threw);
+  threw = false;
+  try {
+    GearFitOptions bad;
+    bad.shaftAngle = 0;
+    GearFit fit(bad);
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  passed &= check("Invalid options throw", threw);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testStraight();
+  printTestResult("Straight gear scan", passed);
+  allPassed &= passed;
+  passed = testSpiral();
+  printTestResult("Spiral gear scan with noise", passed);
+  allPassed &= passed;
+  passed = testPinion();
+  printTestResult("Pinion scan with a known mate", passed);
+  allPassed &= passed;
+
+  printTestResult("All gear fit tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -1,12 +1,14 @@
 // test_gearparams.cpp
 // Unit test for checking gear parameter calculations
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <iostream>
 #include <vector>
 
 #include "../src/geometry/GearParams.hpp"
+#include "../src/geometry/GearSurface.hpp"
 
 #define COLOR_RESET "\033[0m"
 #define COLOR_RED "\033[31m"
@@ -119,6 +121,74 @@ bool testValidations(const std::string& testName, const BevelGearPair& pair) {
   return passed;
 }
 
+// Differential test of the float kernels against double and the CAD
+// references: parameters, flank points and normals, surface mesh
+bool testPrecision(const std::string& testName, const BevelGearPair& pair,
+                   const CADReferenceData& CAD) {
+  bool passed = true;
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << testName
+            << " in float" << std::endl;
+  const PairDerived<float> f =
+      derivePair(pair.numGearTeeth, pair.numPinionTeeth,
+                 pairInputs<float>(pair));
+  const double paramError = std::max(
+      {std::fabs(f.addendum - pair.addendum),
+       std::fabs(f.dedendum - pair.dedendum),
+       std::fabs(f.pinionAddendum - pair.pinionAddendum),
+       std::fabs(f.pinionDedendum - pair.pinionDedendum),
+       std::fabs(f.pinionFaceConeOffset - pair.pinionFaceConeOffset),
+       std::fabs(f.pinionRootConeOffset - pair.pinionRootConeOffset)});
+  std::cout << "  parameters: float - double " << paramError << " mm"
+            << std::endl;
+  constexpr double tol = 0.01;
+  passed &= checkValue("Float gear addendum", f.addendum, CAD.addendum, tol);
+  passed &= checkValue("Float gear dedendum", f.dedendum, CAD.dedendum, tol);
+  passed &= checkValue("Float pinion faceConeOffset", f.pinionFaceConeOffset,
+                       CAD.pinionFaceConeOffset, tol);
+  passed &= checkValue("Float pinion rootConeOffset", f.pinionRootConeOffset,
+                       CAD.pinionRootConeOffset, tol);
+  passed &= checkValue("Float - double parameters", paramError, 0, 1e-5);
+
+  const BevelGear gear = pair.makeGear();
+  const ToothFlank flank(gear);
+  const ToothFlankF flankF(gear);
+  double pointError = 0, normalError = 0;
+  for (FlankSide side : {FlankSide::Left, FlankSide::Right}) {
+    for (int i = 0; i <= 20; ++i) {
+      const double R = flank.innerR() +
+                       (flank.outerR() - flank.innerR()) * i / 20;
+      for (int j = 0; j <= 10; ++j) {
+        const Vec3 p = flank.point(side, R, j / 10.0);
+        const Vec3f q = flankF.point(side, float(R), j / 10.0f);
+        pointError = std::max(
+            pointError, (p - Vec3(q.x, q.y, q.z)).norm());
+        const Vec3 n = flank.normal(side, R, j / 10.0);
+        const Vec3f m = flankF.normal(side, float(R), j / 10.0f);
+        normalError = std::max(
+            normalError, (n - Vec3(m.x, m.y, m.z)).norm());
+      }
+    }
+  }
+  std::cout << "  flank: points " << pointError * 1e3 << " um, normals "
+            << normalError << std::endl;
+  passed &= checkValue("Float - double flank points", pointError, 0, 1e-3);
+  passed &= checkValue("Float - double flank normals", normalError, 0, 5e-3);
+
+  const GearSurfaceMesh mesh = GearSurface(gear).build();
+  const GearSurfaceMeshF meshF = GearSurfaceF(gear).build();
+  double meshError = mesh.size() == meshF.size() ? 0 : HUGE_VAL;
+  for (size_t i = 0; i < std::min(mesh.size(), meshF.size()); ++i) {
+    const Vec3f a = meshF.a(i), c = meshF.c(i);
+    meshError = std::max({meshError,
+                          (mesh.a(i) - Vec3(a.x, a.y, a.z)).norm(),
+                          (mesh.c(i) - Vec3(c.x, c.y, c.z)).norm()});
+  }
+  std::cout << "  mesh: " << meshF.size() << " triangles, vertices "
+            << meshError * 1e3 << " um" << std::endl;
+  passed &= checkValue("Float - double mesh vertices", meshError, 0, 1e-3);
+  return passed;
+}
+
 int main() {
   std::vector<GearTestCase> testCases = {
       {BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43, 60,
@@ -142,7 +212,9 @@ int main() {
     bool validationPassed = testValidations(tc.testName, tc.pair);
     bool paramPassed = testParams(tc.testName, gear, pinion, tc.CAD);
 
-    bool passed = paramPassed && validationPassed;
+    bool precisionPassed = testPrecision(tc.testName, tc.pair, tc.CAD);
+
+    bool passed = paramPassed && validationPassed && precisionPassed;
     printTestResult(tc.testName, passed);
     allPassed &= passed;
   }
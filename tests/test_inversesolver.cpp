@@ -0,0 +1,141 @@
+// test_inversesolver.cpp
+// Unit test for the batched addendum/dedendum -> cone parameter solver
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/geometry/InverseSolver.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool checkValue(const std::string& name, double calculated, double expected,
+                double tolerance) {
+  if (std::fabs(calculated - expected) >= tolerance) {
+    std::cout << COLOR_RED << " ❌ The value of " << name << " is "
+              << calculated << " instead of " << expected << COLOR_RESET
+              << std::endl;
+    return false;
+  } else {
+    std::cout << COLOR_GREEN << " ✅ " << name << " matches expected value."
+              << COLOR_RESET << std::endl;
+  }
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Solve for the forward values of a reference pair starting from a detuned
+// base pair and check that the original cone parameters are recovered.
+bool testRoundTrip(const std::string& testName, const BevelGearPair& ref) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << testName
+            << std::endl;
+  constexpr double tol = 1e-6;
+  BevelGearPair detuned(ref.numGearTeeth, ref.numPinionTeeth, ref.module,
+                        ref.backlash, ref.coneClearance, ref.shaftAngle,
+                        ref.faceConeAngle + 3, ref.rootConeAngle - 2, 0, 0,
+                        ref.innerConeDistance, ref.outerConeDistance,
+                        ref.pressureAngle);
+  InverseConeSolver solver(detuned);
+  BevelGearPair solved = solver.solve(ref.addendum, ref.dedendum,
+                                      ref.pinionAddendum, ref.pinionDedendum);
+
+  bool passed = true;
+  passed &= checkValue("Face cone angle", solved.faceConeAngle,
+                       ref.faceConeAngle, tol);
+  passed &= checkValue("Root cone angle", solved.rootConeAngle,
+                       ref.rootConeAngle, tol);
+  passed &= checkValue("Face cone offset", solved.faceConeOffset,
+                       ref.faceConeOffset, tol);
+  passed &= checkValue("Root cone offset", solved.rootConeOffset,
+                       ref.rootConeOffset, tol);
+  passed &= checkValue("Pinion face cone offset", solved.pinionFaceConeOffset,
+                       ref.pinionFaceConeOffset, tol);
+  passed &= checkValue("Pinion root cone offset", solved.pinionRootConeOffset,
+                       ref.pinionRootConeOffset, tol);
+  return passed;
+}
+
+// Solve a large batch of targets around a reference and check every lane
+// reproduces its targets through the forward model.
+bool testBatch(const std::string& testName, const BevelGearPair& ref) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << testName
+            << std::endl;
+  constexpr size_t n = 5000;
+  ConeTargets targets;
+  targets.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    double s = static_cast<double>(i) / n;
+    targets.push_back(ref.addendum + 0.8 * s, ref.dedendum - 0.5 * s,
+                      ref.pinionAddendum - 0.7 * s,
+                      ref.pinionDedendum + 1.0 * s);
+  }
+
+  InverseConeSolver solver(ref);
+  ConeSolution sol = solver.solve(targets);
+
+  size_t failed = 0;
+  double worst = 0;
+  for (size_t i = 0; i < n; ++i) {
+    BevelGearPair p = solver.apply(sol, i);
+    double err = std::fmax(
+        std::fmax(std::fabs(p.addendum - targets.addendum[i]),
+                  std::fabs(p.dedendum - targets.dedendum[i])),
+        std::fmax(std::fabs(p.pinionAddendum - targets.pinionAddendum[i]),
+                  std::fabs(p.pinionDedendum - targets.pinionDedendum[i])));
+    err = std::fmax(err, std::fmax(std::fabs(p.pinionFaceConeOffset -
+                                             sol.pinionFaceConeOffset[i]),
+                                   std::fabs(p.pinionRootConeOffset -
+                                             sol.pinionRootConeOffset[i])));
+    worst = std::fmax(worst, err);
+    failed += !sol.converged[i];
+  }
+
+  bool passed = true;
+  passed &= checkValue("Unconverged targets", static_cast<double>(failed), 0,
+                       0.5);
+  passed &= checkValue("Worst forward residual", worst, 0, 1e-6);
+
+  // Pinion dedendum closer to the gear addendum than the clearance allows
+  ConeTargets unreachable;
+  unreachable.push_back(ref.addendum, ref.dedendum, ref.pinionAddendum,
+                        ref.addendum + 0.5 * ref.coneClearance);
+  passed &= checkValue("Unreachable target flagged",
+                       solver.solve(unreachable).converged[0], 0, 0.5);
+  return passed;
+}
+
+int main() {
+  std::vector<BevelGearPair> refs = {
+      // assets/CAD/Gear_1.FCStd
+      BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43, 60,
+                    20),
+      // assets/CAD/Gear_2.FCStd
+      BevelGearPair(14, 9, 4.77651, 0.1, 1.5, 90, 65, 45, 1.2, 0, 24.0405, 60,
+                    20)};
+
+  bool allPassed = true;
+  for (size_t i = 0; i < refs.size(); ++i) {
+    std::string name = "Inverse cone solver, reference " + std::to_string(i + 1);
+    bool passed = testRoundTrip(name + " round trip", refs[i]);
+    passed &= testBatch(name + " batch", refs[i]);
+    printTestResult(name, passed);
+    allPassed &= passed;
+  }
+
+  printTestResult("All inverse solver tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
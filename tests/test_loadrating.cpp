@@ -0,0 +1,160 @@
+// test_loadrating.cpp
+// Unit test for the batched ISO 10300 style load rating
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/analysis/LoadRating.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool checkValue(const std::string& name, double calculated, double expected,
+                double tolerance) {
+  if (std::fabs(calculated - expected) >= tolerance) {
+    std::cout << COLOR_RED << " ❌ The value of " << name << " is "
+              << calculated << " instead of " << expected << COLOR_RESET
+              << std::endl;
+    return false;
+  } else {
+    std::cout << COLOR_GREEN << " ✅ " << name << " matches expected value."
+              << COLOR_RESET << std::endl;
+  }
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testVirtualGears() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Virtual cylindrical gears" << std::endl;
+  const BevelGearPair p = spiralPair();
+  RatingInputs in;
+  in.push_back(p);
+  const VirtualCylindricalGears v = LoadRating::virtualGears(in, 0);
+
+  const double k = M_PI / 180;
+  bool passed = true;
+  // zv = z / cos(delta); at 90 deg shaft angle uv = (z2 / z1)^2
+  passed &= checkValue("Pinion virtual teeth", v.zv1,
+                       9 / cos(p.pinionPitchConeAngle * k), 1e-9);
+  passed &= checkValue("Gear virtual teeth", v.zv2,
+                       14 / cos(p.pitchConeAngle * k), 1e-9);
+  passed &= checkValue("Virtual ratio", v.uv, 14.0 * 14 / (9.0 * 9), 1e-9);
+  passed &= checkValue("Transverse pressure angle", v.alphaVt / k,
+                       atan(tan(20 * k) / cos(30 * k)) / k, 1e-9);
+  passed &= checkValue("Face width", v.faceWidth, 60 - 24.0405, 1e-9);
+  // Plausible ranges rather than reference values
+  passed &= checkValue("Transverse contact ratio in [1, 2]",
+                       v.epsAlpha > 1 && v.epsAlpha < 2, 1, 0.5);
+  passed &= checkValue("Face contact ratio > 1", v.epsBeta > 1, 1, 0.5);
+  return passed;
+}
+
+bool testScaling() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Safety factors scale with torque" << std::endl;
+  LoadRating rating;
+  const BevelGearPair p = spiralPair();
+  // Beyond the endurance knee, so the life factors are 1
+  const RatingResults a = rating.rate(p, {{50, 1500, 1000}});
+  const RatingResults b = rating.rate(p, {{200, 1500, 1000}});
+
+  bool passed = true;
+  // Contact stress grows with sqrt(T), root stress with T
+  passed &= checkValue("Pitting safety ratio",
+                       a.pittingSafety1[0] / b.pittingSafety1[0], 2, 1e-9);
+  passed &= checkValue("Bending safety ratio",
+                       a.bendingSafety1[0] / b.bendingSafety1[0], 4, 1e-9);
+  // Same material and both members past the knee of the S-N curve
+  passed &= checkValue("Equal member pitting safety", a.pittingSafety1[0],
+                       a.pittingSafety2[0], 1e-12);
+  // Spectrum with an overload bin takes the minimum
+  const RatingResults s =
+      rating.rate(p, {{50, 1500, 1000}, {200, 1500, 1000}});
+  passed &= checkValue("Spectrum minimum", s.pittingSafety1[0],
+                       b.pittingSafety1[0], 1e-12);
+  return passed;
+}
+
+bool testDamage() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Miner damage" << std::endl;
+  LoadRating rating;
+  const BevelGearPair p = spiralPair();
+  const RatingResults light = rating.rate(p, {{1, 1500, 1000}});
+  bool passed = true;
+  passed &= checkValue("Below endurance limit", light.pittingDamage1[0], 0,
+                       1e-12);
+
+  // Well above the endurance limit
+  const RatingResults one = rating.rate(p, {{1000, 1500, 100}});
+  const RatingResults two = rating.rate(p, {{1000, 1500, 200}});
+  passed &= checkValue("Damage grows linearly with hours",
+                       two.pittingDamage1[0] / one.pittingDamage1[0], 2,
+                       1e-9);
+  passed &= checkValue("Damage positive", one.pittingDamage1[0] > 0, 1, 0.5);
+  return passed;
+}
+
+bool testBatch() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Batch matches single pair" << std::endl;
+  LoadRating rating;
+  const LoadSpectrum spectrum = {{120, 1000, 500}, {250, 800, 20}};
+  RatingInputs in;
+  std::vector<BevelGearPair> pairs;
+  for (int i = 0; i < 3000; ++i) {
+    BevelGearPair p = spiralPair();
+    p.spiralAngle = 20 + 15.0 * i / 3000;
+    p.module = 4.5 + 0.5 * i / 3000;
+    p.computeDerivedValues();
+    p.computePinionParameters();
+    pairs.push_back(p);
+    in.push_back(p);
+  }
+  ThreadPool pool(4);
+  const RatingResults r = rating.rate(in, spectrum, pool);
+  double worst = 0;
+  for (size_t i = 0; i < pairs.size(); i += 97) {
+    const RatingResults s = rating.rate(pairs[i], spectrum);
+    worst = std::fmax(worst, std::fabs(s.bendingSafety2[0] -
+                                       r.bendingSafety2[i]));
+    worst = std::fmax(worst, std::fabs(s.pittingDamage1[0] -
+                                       r.pittingDamage1[i]));
+  }
+  return checkValue("Worst difference", worst, 0, 1e-12);
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testVirtualGears();
+  printTestResult("Virtual cylindrical gears", passed);
+  allPassed &= passed;
+  passed = testScaling();
+  printTestResult("Safety factor scaling", passed);
+  allPassed &= passed;
+  passed = testDamage();
+  printTestResult("Miner damage", passed);
+  allPassed &= passed;
+  passed = testBatch();
+  printTestResult("Batched rating", passed);
+  allPassed &= passed;
+
+  printTestResult("All load rating tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+// test_memory.cpp
+// Unit test for per-stage memory accounting and job budgets
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/pipeline/MemoryAccounting.hpp"
+#include "../src/pipeline/Pipeline.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+int64_t current(const memory::Usage& u, memory::Category c) {
+  return u.categories[size_t(c)].current.load();
+}
+
+int64_t peak(const memory::Usage& u, memory::Category c) {
+  return u.categories[size_t(c)].peak.load();
+}
+
+bool testCounters() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Current and peak per category" << std::endl;
+  using memory::Category;
+  memory::Budget budget;
+  memory::BudgetScope scope(&budget);
+  const memory::Usage& u = budget.jobUsage();
+
+  bool passed = true;
+  {
+    memory::Reservation mesh(Category::Mesh, 1000);
+    {
+      memory::Reservation matrix(Category::InfluenceMatrix, 4000);
+      passed &= check("Both charged", u.total.current.load() == 5000);
+    }
+    passed &= check("Matrix released",
+                    current(u, Category::InfluenceMatrix) == 0);
+    passed &= check("Matrix peak kept", peak(u, Category::InfluenceMatrix) ==
+                                            4000);
+  }
+  {
+    std::vector<double, memory::TrackedAllocator<double>> v(
+        memory::TrackedAllocator<double>(Category::Geometry));
+    v.resize(100);
+    passed &= check("Tracked vector charged",
+                    current(u, Category::Geometry) >= int64_t(800));
+  }
+  passed &= check("All released", u.total.current.load() == 0);
+  passed &= check("Total peak", u.total.peak.load() >= 5000);
+  return passed;
+}
+
+bool testBudget() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Budget limits and fallback" << std::endl;
+  using memory::Category;
+  memory::Budget budget(10000);
+  memory::BudgetScope scope(&budget);
+
+  bool passed = true;
+  memory::Reservation a = memory::Reservation::tryMake(Category::Mesh, 8000);
+  passed &= check("Fits", static_cast<bool>(a));
+  memory::Reservation b = memory::Reservation::tryMake(Category::Mesh, 8000);
+  passed &= check("Over budget refused", !b);
+  passed &= check("Available", budget.available() == 2000);
+  bool threw = false;
+  try {
+    memory::Reservation::require(Category::ResultBuffer, 4000);
+  } catch (const memory::BudgetExceeded&) {
+    threw = true;
+  }
+  passed &= check("Require throws", threw);
+  a.reset();
+  passed &= check("Fits after release", budget.fits(8000));
+  return passed;
+}
+
+bool testPoolTasks() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Budget follows work onto pool threads" << std::endl;
+  using memory::Category;
+  ThreadPool pool(3);
+  const size_t n = 64;
+  memory::Budget budget(n * 1000);
+  std::vector<memory::Budget*> seen(n, nullptr);
+  std::atomic<size_t> refused{0};
+  {
+    memory::BudgetScope scope(&budget);
+    pool.parallelFor(0, n, [&](size_t i) {
+      seen[i] = memory::currentBudget();
+      memory::Reservation held(Category::Mesh, 600);
+      // Never fits next to the bytes this task holds
+      if (!memory::Reservation::tryMake(Category::Mesh, n * 1000))
+        ++refused;
+    });
+  }
+  const memory::Usage& u = budget.jobUsage();
+  bool passed = true;
+  bool all = true;
+  for (memory::Budget* b : seen)
+    all &= b == &budget;
+  passed &= check("Budget current in every task", all);
+  passed &= check("Task allocations charged to the job",
+                  peak(u, Category::Mesh) >= 600);
+  passed &= check("Task reservations checked against the job",
+                  refused.load() == n);
+  passed &= check("Task allocations released",
+                  current(u, Category::Mesh) == 0);
+
+  // Stages and the work they hand to the pool charge the graph's budget
+  memory::Budget graphBudget;
+  memory::Budget* inner = nullptr;
+  TaskGraph graph;
+  graph.setMemoryBudget(&graphBudget);
+  graph.add("stage", [&](TaskGraph::Context& ctx) {
+    ctx.pool().parallelFor(0, 8, [&](size_t i) {
+      memory::Reservation held(Category::Geometry, 100);
+      if (i == 7)
+        inner = memory::currentBudget();
+    });
+  });
+  graph.run(pool);
+  passed &= check("Stage work runs under the graph budget",
+                  inner == &graphBudget &&
+                      peak(graphBudget.jobUsage(), Category::Geometry) >= 100);
+
+  // Workers drop the budget again once the job's tasks finished
+  memory::Budget* after = &budget;
+  pool.parallelFor(0, 8, [&](size_t i) {
+    if (i == 7)
+      after = memory::currentBudget();
+  });
+  passed &= check("No budget outside the job", after == nullptr);
+  return passed;
+}
+
+bool testStreamingSweep() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Sweep streams results under a budget" << std::endl;
+  const BevelGearPair base(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74,
+                           19.43, 60, 20);
+  const size_t n = 2000;
+  auto design = [&](size_t i) {
+    BevelGearPair p = base;
+    p.faceConeAngle = 58 + 4.0 * i / n;
+    return p;
+  };
+
+  // Enough for a few hundred results, far less than the whole sweep
+  memory::Budget budget(400 * sizeof(PairPipelineResult));
+  memory::BudgetScope scope(&budget);
+  size_t blocks = 0, rows = 0, largest = 0;
+  bool ordered = true;
+  runPairSweepBlocks(n, design,
+                     [&](size_t first, std::vector<PairPipelineResult>& b) {
+                       ordered &= first == rows;
+                       ++blocks;
+                       rows += b.size();
+                       largest = std::max(largest, b.size());
+                       ordered &= b.back().pair.faceConeAngle ==
+                                  design(first + b.size() - 1).faceConeAngle;
+                     });
+
+  const memory::Usage& u = budget.jobUsage();
+  bool passed = true;
+  passed &= check("Every design delivered", rows == n);
+  passed &= check("Split into blocks", blocks > 1);
+  passed &= check("Blocks in order", ordered);
+  passed &= check("Peak within budget",
+                  u.total.peak.load() <= int64_t(budget.limit()));
+  passed &= check("Result buffers released",
+                  current(u, memory::Category::ResultBuffer) == 0);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testCounters();
+  printTestResult("Memory counters", passed);
+  allPassed &= passed;
+  passed = testBudget();
+  printTestResult("Memory budget", passed);
+  allPassed &= passed;
+  passed = testPoolTasks();
+  printTestResult("Budget on pool threads", passed);
+  allPassed &= passed;
+  passed = testStreamingSweep();
+  printTestResult("Streaming sweep", passed);
+  allPassed &= passed;
+
+  printTestResult("All memory accounting tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
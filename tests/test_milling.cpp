@@ -0,0 +1,204 @@
+// test_milling.cpp
+// Unit test for the analytic tooth flanks and 5-axis milling toolpaths
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/manufacturing/Milling.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testFlank() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Analytic tooth flanks" << std::endl;
+  const ToothFlank f(straightPair().makeGear());
+  const double R = 0.5 * (f.innerR() + f.outerR());
+
+  bool passed = true;
+  const Vec3 p = f.point(FlankSide::Right, R, 0.5);
+  passed &= check("Flank point on the sphere", std::fabs(p.norm() - R) < 1e-9);
+  const Vec3 n = f.normal(FlankSide::Right, R, 0.5);
+  passed &= check("Unit normal", std::fabs(n.norm() - 1) < 1e-9);
+  // The right flank of tooth 0 lies at positive azimuth and faces away from
+  // the tooth centre on +x
+  passed &= check("Normal points out of the tooth", p.y > 0 && n.y > 0);
+
+  // Without spiral the two flanks are mirror images in the x-z plane
+  const Vec3 l = f.point(FlankSide::Left, R, 0.3);
+  const Vec3 r = f.point(FlankSide::Right, R, 0.3);
+  passed &= check("Straight flanks symmetric",
+                  std::fabs(l.x - r.x) < 1e-9 && std::fabs(l.y + r.y) < 1e-9);
+  passed &= check("Tooth thins towards the tip",
+                  f.point(FlankSide::Right, R, 1).y <
+                      f.point(FlankSide::Right, R, 0).y);
+  passed &= check("Tooth k is rotated by k pitches",
+                  std::fabs(std::atan2(f.onTooth(p, 3).y, f.onTooth(p, 3).x) -
+                            std::atan2(p.y, p.x) - 3 * f.pitchAngle()) <
+                      1e-9);
+  return passed;
+}
+
+bool testToolpath() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Ball end mill toolpath" << std::endl;
+  MillingOptions opt;
+  opt.toolRadius = 1;
+  opt.scallopHeight = 0.01;
+  const MillingPlanner planner(spiralPair().makeGear(), opt);
+  const Toolpath tp = planner.planToothSpace();
+
+  bool passed = true;
+  passed &= check("Step-over from scallop height",
+                  std::fabs(planner.stepOver() -
+                            2 * std::sqrt(0.01 * (2 - 0.01))) < 1e-12);
+  passed &= check("Passes on both flanks", tp.passes() >= 4 &&
+                                               tp.passes() % 2 == 0);
+  // Segments along a pass stay near the requested length; tips run on an
+  // offset of the contact path
+  double longest = 0;
+  for (size_t p = 0; p < tp.passes(); ++p) {
+    for (size_t i = tp.passStart[p] + 1; i < tp.passEnd(p); ++i)
+      longest = std::max(longest,
+                         (tp.points[i].tip - tp.points[i - 1].tip).norm());
+  }
+  passed &= check("Segments within maxSegment",
+                  longest <= 1.25 * opt.maxSegment);
+
+  bool unitAxes = true;
+  size_t gouges = 0;
+  for (const auto& c : tp.points) {
+    unitAxes &= std::fabs(c.axis.norm() - 1) < 1e-9;
+    gouges += c.gouge;
+  }
+  passed &= check("Unit tool axes", unitAxes);
+  // Without a root fillet only the passes next to the root can interfere
+  passed &= check("Flanks above the root are gouge free",
+                  gouges < tp.points.size() / 4);
+
+  // A tool pushed into the tooth must be flagged
+  const Vec3 inside = planner.toothFlank().point(FlankSide::Right, 40, 0.5) -
+                      planner.toothFlank().normal(FlankSide::Right, 40, 0.5);
+  const Vec3 axis = planner.toothFlank().normal(FlankSide::Right, 40, 0.5);
+  passed &= check("Gouge detected", planner.gouges(inside, axis));
+
+  // Rotating a tooth space keeps the distance to the gear axis
+  const CutterLocation c = planner.onTooth(tp.points[5], 7);
+  passed &= check("Rotation keeps radius",
+                  std::fabs(std::hypot(c.tip.x, c.tip.y) -
+                            std::hypot(tp.points[5].tip.x,
+                                       tp.points[5].tip.y)) < 1e-9 &&
+                      std::fabs(c.tip.z - tp.points[5].tip.z) < 1e-12);
+  return passed;
+}
+
+bool testGcode() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "G-code for all tooth spaces" << std::endl;
+  MillingOptions opt;
+  opt.tool = MillingTool::Flank;
+  opt.toolRadius = 0.5;
+  const MillingPlanner planner(straightPair().makeGear(), opt);
+  const std::string path = "test_milling.nc";
+  ThreadPool pool(3);
+  const MillingStats stats = planner.writeGcode(path, pool);
+
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  const std::string text = ss.str();
+  size_t blocks = 0, pos = 0;
+  while ((pos = text.find("(Tooth space ", pos)) != std::string::npos) {
+    ++blocks;
+    ++pos;
+  }
+
+  bool passed = true;
+  passed &= check("One block per tooth space", blocks == 11 &&
+                                                   stats.teeth == 11);
+  passed &= check("Blocks in tooth order",
+                  text.find("(Tooth space 2)") < text.find("(Tooth space 10)"));
+  passed &= check("Program ends with M30",
+                  text.size() >= 4 && text.substr(text.size() - 4) == "M30\n");
+  passed &= check("Byte count matches file", stats.bytes == text.size());
+  bool fed = true;
+  std::istringstream lines(text);
+  std::string line, previous;
+  while (std::getline(lines, line)) {
+    if (line.rfind("G1 ", 0) == 0 && previous.rfind("G0 ", 0) == 0)
+      fed &= line.find(" F800") != std::string::npos;
+    previous = line;
+  }
+  passed &= check("Every plunge programs the feed", fed);
+  passed &= check("Temporary file renamed",
+                  !std::ifstream(path + ".tmp").good());
+  passed &= check("Flank milling does not gouge", stats.gouges == 0);
+  std::remove(path.c_str());
+
+  // A target that cannot be replaced fails without leaving path.tmp
+  const std::string dir = "test_milling.dir";
+  mkdir(dir.c_str(), 0755);
+  const std::string inside = dir + "/keep";
+  std::ofstream(inside) << "x";
+  bool threw = false;
+  try {
+    planner.writeGcode(dir, pool);
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  passed &= check("Failed write throws", threw);
+  passed &= check("Failed write removes the temporary file",
+                  !std::ifstream(dir + ".tmp").good());
+  std::remove(inside.c_str());
+  rmdir(dir.c_str());
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testFlank();
+  printTestResult("Tooth flanks", passed);
+  allPassed &= passed;
+  passed = testToolpath();
+  printTestResult("Milling toolpath", passed);
+  allPassed &= passed;
+  passed = testGcode();
+  printTestResult("Milling G-code", passed);
+  allPassed &= passed;
+
+  printTestResult("All milling tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+// test_pairgradient.cpp
+// Unit test for dual numbers and the exact gradient of the pair equations
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/geometry/PairFields.hpp"
+#include "../src/geometry/PairGradient.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// assets/CAD/Gear_1.FCStd and Gear_2.FCStd with a 30 deg spiral
+BevelGearPair gear1() {
+  return BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43,
+                       60, 20);
+}
+
+BevelGearPair gear2() {
+  return BevelGearPair(14, 9, 4.77651, 0.1, 1.5, 90, 65, 45, 1.2, 0, 24.0405,
+                       60, 20, 30);
+}
+
+bool testDual() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Dual numbers" << std::endl;
+  using D = Dual<2>;
+  const double x0 = 0.7, y0 = 1.3;
+  const D x = D::seed(x0, 0), y = D::seed(y0, 1);
+  // f = sin(x y) / (1 + x^2) + atan2(y, x) sqrt(y)
+  const D f = sin(x * y) / (1 + x * x) + atan2(y, x) * sqrt(y);
+  const double q = 1 + x0 * x0, r2 = x0 * x0 + y0 * y0;
+  const double fx = y0 * cos(x0 * y0) / q -
+                    2 * x0 * sin(x0 * y0) / (q * q) -
+                    y0 / r2 * sqrt(y0);
+  const double fy = x0 * cos(x0 * y0) / q + x0 / r2 * sqrt(y0) +
+                    atan2(y0, x0) * 0.5 / sqrt(y0);
+  bool passed = true;
+  passed &= check("Value", f.v == sin(x0 * y0) / q + atan2(y0, x0) *
+                                                         sqrt(y0));
+  passed &= check("Gradient by the chain rule",
+                  std::fabs(f.d[0] - fx) < 1e-14 &&
+                      std::fabs(f.d[1] - fy) < 1e-14);
+
+  const D g = tan(acos(x / 2)) - exp(log(y) * 2) + pow(x, 3) - fabs(-y);
+  const double gx = -1 / (x0 * x0 / 4 * sqrt(1 - x0 * x0 / 4)) / 2 +
+                    3 * x0 * x0;
+  const double gy = -2 * y0 - 1;
+  passed &= check("Inverse trig, exp, log, pow and fabs",
+                  std::fabs(g.d[0] - gx) < 1e-12 &&
+                      std::fabs(g.d[1] - gy) < 1e-12);
+  passed &= check("Constants carry no gradient",
+                  D(3.0).d[0] == 0 && D(3.0).d[1] == 0);
+  return passed;
+}
+
+bool testSameEquations(const std::string& name, const BevelGearPair& p) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Same equations as BevelGearPair, " << name << std::endl;
+  const PairGradient g = pairGradient(p);
+  const double expected[PairGradient::numOutputs] = {
+      p.pitchConeAngle,      p.pinionPitchConeAngle, p.pitchConeDistance,
+      p.addendum,            p.dedendum,             p.pinionFaceConeAngle,
+      p.pinionRootConeAngle, p.pinionAddendum,       p.pinionDedendum,
+      p.pinionFaceConeOffset, p.pinionRootConeOffset};
+  bool same = true;
+  for (int k = 0; k < PairGradient::numOutputs; ++k)
+    same &= g.value[k] == expected[k];
+  return check("Dual values are bit identical to the pair", same);
+}
+
+// Central differences through a full reconstruction per input
+bool testFiniteDifferences(const std::string& name, const BevelGearPair& p) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Gradient against finite differences, " << name << std::endl;
+  const PairGradient g = pairGradient(p);
+  double worst = 0;
+  for (int i = 0; i < PairGradient::numInputs; ++i) {
+    const char* input = PairGradient::inputs[i];
+    double x = 0;
+    PairFieldUtils::get(p, input, x);
+    const double h = 1e-6 * std::max(1.0, std::fabs(x));
+    BevelGearPair up = p, down = p;
+    PairFieldUtils::set(up, input, x + h);
+    PairFieldUtils::set(down, input, x - h);
+    up = PairFieldUtils::recompute(up);
+    down = PairFieldUtils::recompute(down);
+    const PairGradient gu = pairGradient(up), gd = pairGradient(down);
+    for (int k = 0; k < PairGradient::numOutputs; ++k) {
+      const double fd = (gu.value[k] - gd.value[k]) / (2 * h);
+      worst = std::max(worst, std::fabs(fd - g.d[k][i]) /
+                                  std::max(1.0, std::fabs(fd)));
+    }
+  }
+  std::cout << "  worst relative difference " << worst << std::endl;
+  bool passed = check("All 132 derivatives within 1e-6", worst < 1e-6);
+
+  // Closed forms: a = fo sin(FA) / cos(FA - PA) + R tan(FA - PA)
+  const double k = M_PI / 180;
+  const double u = (p.faceConeAngle - p.pitchConeAngle) * k;
+  double dfo = 0, dFA = 0, dBacklash = 1, dPinionPA = 0;
+  g.get("addendum", "faceConeOffset", dfo);
+  g.get("addendum", "faceConeAngle", dFA);
+  g.get("pinionDedendum", "backlash", dBacklash);
+  g.get("pinionPitchConeAngle", "faceConeAngle", dPinionPA);
+  passed &= check(
+      "Addendum derivatives in closed form",
+      std::fabs(dfo - sin(p.faceConeAngle * k) / cos(u)) < 1e-14 &&
+          std::fabs(dFA - (p.faceConeOffset * cos(p.pitchConeAngle * k) +
+                           p.pitchConeDistance) /
+                              (cos(u) * cos(u)) * k) < 1e-12);
+  passed &= check("Inputs without influence have zero derivative",
+                  dBacklash == 0 && dPinionPA == 0);
+  double unused = 0;
+  passed &= check("Unknown names are rejected",
+                  !g.get("addendum", "numGearTeeth", unused) &&
+                      !g.get("module", "module", unused));
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testDual();
+  printTestResult("Dual numbers", passed);
+  allPassed &= passed;
+  for (const auto& c : {std::make_pair("Gear_1", gear1()),
+                        std::make_pair("Gear_2", gear2())}) {
+    passed = testSameEquations(c.first, c.second);
+    printTestResult(std::string("Same equations, ") + c.first, passed);
+    allPassed &= passed;
+    passed = testFiniteDifferences(c.first, c.second);
+    printTestResult(std::string("Finite differences, ") + c.first, passed);
+    allPassed &= passed;
+  }
+
+  printTestResult("All pair gradient tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// test_paramgraph.cpp
+// Unit test for lazy dependency-graph evaluation of gear pair parameters
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../src/geometry/ParamGraph.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+bool same(const BevelGearPair& a, const BevelGearPair& b) {
+  auto eq = [](double x, double y) { return std::fabs(x - y) < 1e-12; };
+  return eq(a.pitchConeAngle, b.pitchConeAngle) &&
+         eq(a.pitchConeDistance, b.pitchConeDistance) &&
+         eq(a.addendum, b.addendum) && eq(a.dedendum, b.dedendum) &&
+         eq(a.pinionAddendum, b.pinionAddendum) &&
+         eq(a.pinionDedendum, b.pinionDedendum) &&
+         eq(a.pinionFaceConeOffset, b.pinionFaceConeOffset) &&
+         eq(a.pinionRootConeOffset, b.pinionRootConeOffset);
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+int main() {
+  // assets/CAD/Gear_1.FCStd
+  const BevelGearPair ref(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74,
+                          19.43, 60, 20);
+  bool passed = true;
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Lazy gear pair evaluation" << std::endl;
+
+  LazyBevelGearPair lazy(ref);
+  const auto& n = lazy.nodes();
+  const auto& g = lazy.dependencyGraph();
+
+  size_t flankRuns = 0, ltcaRuns = 0;
+  auto flanks = lazy.addStage(
+      "flanks", {n.addendum, n.dedendum, lazy.inputNode(&BevelGearPair::module)},
+      [&](const BevelGearPair&) { ++flankRuns; });
+  auto ltca = lazy.addStage(
+      "ltca", {flanks, lazy.inputNode(&BevelGearPair::backlash)},
+      [&](const BevelGearPair&) { ++ltcaRuns; });
+
+  passed &= check("Lazy values match eager constructor", same(lazy.pair(), ref));
+  lazy.evaluate(ltca);
+  passed &= check("Stages ran once", flankRuns == 1 && ltcaRuns == 1);
+
+  // Backlash feeds LTCA only
+  lazy.set(&BevelGearPair::backlash, 0.2);
+  passed &= check("Backlash keeps pitch cone angles clean",
+                  !lazy.isDirty(n.pitchConeAngles));
+  passed &= check("Backlash keeps flanks clean", !lazy.isDirty(flanks));
+  passed &= check("Backlash invalidates LTCA", lazy.isDirty(ltca));
+  lazy.evaluate(ltca);
+  passed &= check("Only LTCA reran", flankRuns == 1 && ltcaRuns == 2);
+
+  // Face cone angle feeds the addendum and pinion dedendum, not the dedendum
+  const size_t dedendumEvals = g.evaluations(n.dedendum);
+  lazy.set(&BevelGearPair::faceConeAngle, 62.0);
+  passed &= check("Face cone angle invalidates addendum",
+                  lazy.isDirty(n.addendum) && lazy.isDirty(n.pinionDedendum));
+  passed &= check("Face cone angle keeps dedendum clean",
+                  !lazy.isDirty(n.dedendum));
+  lazy.get(&BevelGearPair::pinionDedendum);
+  passed &= check("Dedendum not recomputed",
+                  g.evaluations(n.dedendum) == dedendumEvals);
+
+  // Setting an unchanged value invalidates nothing
+  lazy.evaluate(ltca);
+  lazy.set(&BevelGearPair::module, ref.module);
+  passed &= check("Unchanged value keeps flanks clean", !lazy.isDirty(flanks));
+
+  BevelGearPair eager(11, 9, 5.593454, 0.2, 1.5, 90, 62, 40, 0, -0.74, 19.43,
+                      60, 20);
+  passed &= check("Lazy values match eager after edits",
+                  same(lazy.pair(), eager));
+
+  lazy.assign(ref);
+  passed &= check("Assign restores reference", same(lazy.pair(), ref));
+
+  printTestResult("Lazy gear pair evaluation", passed);
+  if (!passed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
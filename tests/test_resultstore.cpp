@@ -0,0 +1,244 @@
+// test_resultstore.cpp
+// Unit test for the memory-mapped columnar result store and its queries
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/io/ResultQuery.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Small in-memory table for checking queries against brute force
+class VectorTable : public ResultTable {
+public:
+  VectorTable(size_t columns, std::vector<double> values)
+      : columns(columns), values(std::move(values)) {}
+  size_t rowCount() const override { return values.size() / columns; }
+  size_t columnCount() const override { return columns; }
+  std::string columnName(size_t c) const override {
+    return "c" + std::to_string(c);
+  }
+  double value(size_t row, size_t column) const override {
+    return values[row * columns + column];
+  }
+
+private:
+  size_t columns;
+  std::vector<double> values;
+};
+
+// O(n^2) reference: rows no other row dominates
+std::vector<uint32_t> bruteForcePareto(const ResultTable& t,
+                                       const std::vector<ParetoObjective>& o) {
+  auto key = [&](size_t r, size_t j) {
+    const double v = t.value(r, o[j].column);
+    return o[j].maximize ? -v : v;
+  };
+  std::vector<uint32_t> front;
+  for (size_t a = 0; a < t.rowCount(); ++a) {
+    bool dominated = false;
+    for (size_t b = 0; b < t.rowCount() && !dominated; ++b) {
+      bool noWorse = true, better = false;
+      for (size_t j = 0; j < o.size(); ++j) {
+        noWorse &= key(b, j) <= key(a, j);
+        better |= key(b, j) < key(a, j);
+      }
+      dominated = noWorse && better;
+    }
+    if (!dominated)
+      front.push_back(uint32_t(a));
+  }
+  return front;
+}
+
+bool testPareto() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Pareto query" << std::endl;
+  bool passed = true;
+  ThreadPool pool(3);
+  std::mt19937 rng(7);
+  // Coarse values so ties and duplicates occur
+  std::uniform_int_distribution<int> value(0, 30);
+  std::vector<double> values(3000 * 3);
+  for (double& v : values)
+    v = value(rng);
+  values[3] = NAN;  // Row 1
+  const VectorTable table(3, values);
+  for (const std::vector<ParetoObjective>& o :
+       {std::vector<ParetoObjective>{{0, true}},
+        std::vector<ParetoObjective>{{0, false}, {1, true}},
+        std::vector<ParetoObjective>{{0, false}, {1, true}, {2, false}}}) {
+    std::vector<uint32_t> front = runParetoQuery(table, o, nullptr, pool);
+    std::vector<uint32_t> expected = bruteForcePareto(table, o);
+    // The NaN row is skipped, brute force would keep it
+    expected.erase(std::remove(expected.begin(), expected.end(), 1u),
+                   expected.end());
+    const bool bestFirst = std::is_sorted(
+        front.begin(), front.end(), [&](uint32_t a, uint32_t b) {
+          return o[0].maximize ? table.value(a, o[0].column) >
+                                     table.value(b, o[0].column)
+                               : table.value(a, o[0].column) <
+                                     table.value(b, o[0].column);
+        });
+    std::sort(front.begin(), front.end());
+    passed &= check(std::to_string(o.size()) +
+                        " objectives match brute force (" +
+                        std::to_string(front.size()) + " rows)",
+                    front == expected && bestFirst);
+  }
+
+  const std::vector<uint32_t> subset = {10, 20, 30, 40, 50};
+  std::vector<uint32_t> front =
+      runParetoQuery(table, {{0, true}, {1, true}}, &subset, pool);
+  bool inSubset = !front.empty();
+  for (uint32_t r : front)
+    inSubset &= std::count(subset.begin(), subset.end(), r) == 1;
+  passed &= check("Front of a row subset", inSubset);
+
+  // An infinite objective does not keep a row off the front
+  const VectorTable infinite(2, {0, INFINITY, 1, 5, 2, 6});
+  for (bool swapped : {false, true}) {
+    std::vector<ParetoObjective> o = {{0, false}, {1, false}};
+    if (swapped)
+      std::swap(o[0], o[1]);
+    front = runParetoQuery(infinite, o, nullptr, pool);
+    std::sort(front.begin(), front.end());
+    passed &= check("Infinite objective on the front",
+                    front == std::vector<uint32_t>{0, 1});
+  }
+
+  bool thrown = false;
+  try {
+    runParetoQuery(table, {{3, true}}, nullptr, pool);
+  } catch (const std::out_of_range&) {
+    thrown = true;
+  }
+  passed &= check("Objective column checked", thrown);
+  return passed;
+}
+
+int main() {
+  const std::string path = "test_resultstore.glr";
+  constexpr size_t n = 200000;
+  bool passed = true;
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Result store round trip and queries" << std::endl;
+
+  {
+    ResultStoreWriter writer(path, {"design", "score", "addendum"});
+    for (size_t i = 0; i < n; ++i) {
+      double row[3] = {double(i), double((i * 7919) % 10007), 5 + i * 1e-5};
+      writer.addRow(row);
+    }
+    writer.finish();
+  }
+
+  {
+    MappedResultTable table(path);
+    passed &= check("Row count", table.rowCount() == n);
+    passed &= check("Column names", table.columnCount() == 3 &&
+                                        table.columnName(1) == "score");
+    bool values = true;
+    for (size_t i = 0; i < n; i += 997)
+      values &= table.value(i, 1) == double((i * 7919) % 10007);
+    passed &= check("Values read back", values);
+    // The last column ends on the 64 byte alignment
+    passed &= check("Last cell intact",
+                    table.value(n - 1, 2) == 5 + (n - 1) * 1e-5);
+
+    ThreadPool pool(3);
+    ResultQuery q;
+    q.filterColumn = 1;
+    q.filterMin = 100;
+    q.filterMax = 5000;
+    q.sortColumn = 1;
+    q.descending = true;
+    std::vector<uint32_t> rows = runResultQuery(table, q, pool);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < n; ++i) {
+      double v = table.value(i, 1);
+      expected += v >= 100 && v <= 5000;
+    }
+    bool sorted = true;
+    for (size_t i = 1; i < rows.size(); ++i)
+      sorted &= table.value(rows[i - 1], 1) >= table.value(rows[i], 1);
+    passed &= check("Filter keeps matching rows", rows.size() == expected);
+    passed &= check("Rows sorted descending", sorted);
+
+    CancellationToken token;
+    token.cancel();
+    bool cancelled = false;
+    try {
+      runResultQuery(table, q, pool, token);
+    } catch (const JobCancelled&) {
+      cancelled = true;
+    }
+    passed &= check("Cancelled query throws", cancelled);
+  }
+
+  bool rejected = false;
+  {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    std::fputs("not a result store, just some text padding", f);
+    std::fclose(f);
+    try {
+      MappedResultTable bad(path);
+    } catch (const std::runtime_error&) {
+      rejected = true;
+    }
+  }
+  passed &= check("Invalid file rejected", rejected);
+
+  // A directory in the way of the second spill file: the writer fails and
+  // leaves no spill files behind
+  const std::string blocked = path + ".col1.tmp";
+  mkdir(blocked.c_str(), 0700);
+  bool failed = false;
+  try {
+    ResultStoreWriter writer(path, {"a", "b", "c"});
+  } catch (const std::runtime_error&) {
+    failed = true;
+  }
+  rmdir(blocked.c_str());
+  FILE* spill = std::fopen((path + ".col0.tmp").c_str(), "rb");
+  passed &= check("Failed writer removes its spill files", failed && !spill);
+  if (spill)
+    std::fclose(spill);
+  std::remove(path.c_str());
+
+  passed &= testPareto();
+
+  printTestResult("Result store", passed);
+  if (!passed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
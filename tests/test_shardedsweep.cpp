@@ -0,0 +1,276 @@
+// test_shardedsweep.cpp
+// Unit test for the sharded sweep: worker processes, checkpoints, resume
+// after pre-emption, merging and the Pareto front. The test binary is its
+// own worker when started with --sweep-worker.
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/pipeline/ShardedSweep.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// 30 x 20 designs around assets/CAD/Gear_1.FCStd, rated at 50 Nm
+SweepSpec spec() {
+  SweepSpec s;
+  s.base = BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74,
+                         19.43, 60, 20);
+  s.axes = {{"faceConeAngle", 56, 64, 30}, {"module", 4, 6, 20}};
+  s.spectrum = {{50, 1000, 20000}};
+  return s;
+}
+
+std::string selfPath() {
+  char buf[4096];
+  const ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+  return std::string(buf, n > 0 ? size_t(n) : 0);
+}
+
+std::string workerCommand(int maxShards = 0) {
+  std::string cmd = selfPath() + " --sweep-worker";
+  if (maxShards > 0)
+    cmd += " " + std::to_string(maxShards);
+  return cmd;
+}
+
+void removeRun(const std::string& dir) {
+  if (DIR* d = opendir(dir.c_str())) {
+    while (dirent* e = readdir(d)) {
+      const std::string name = e->d_name;
+      if (name != "." && name != "..")
+        std::remove((dir + "/" + name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+// Invalid designs have NaN safety factors
+bool same(double x, double y) { return x == y || (x != x && y != y); }
+
+// Every cell of two tables, bit for bit
+bool sameTable(const ResultTable& a, const ResultTable& b) {
+  if (a.rowCount() != b.rowCount() || a.columnCount() != b.columnCount())
+    return false;
+  for (size_t r = 0; r < a.rowCount(); ++r) {
+    for (size_t c = 0; c < a.columnCount(); ++c) {
+      if (!same(a.value(r, c), b.value(r, c)))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool testSpec() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Sweep spec" << std::endl;
+  bool passed = true;
+  const SweepSpec s = spec();
+  const SweepSpec r = SweepSpec::fromJson(json::parse(s.toJson().dump()));
+  passed &= check("Spec JSON round trip",
+                  r.size() == 600 && r.columns() == s.columns() &&
+                      r.toJson().dump() == s.toJson().dump());
+  const BevelGearPair d = r.design(31);
+  passed &= check("Design index varies the first axis fastest",
+                  d.faceConeAngle == 56 + 8.0 / 29 && d.module == 4 + 2.0 / 19);
+  bool rejected = false;
+  try {
+    SweepSpec::fromJson(json::parse("{\"base\":{},\"axes\":[]}"));
+  } catch (const std::invalid_argument&) {
+    rejected = true;
+  }
+  passed &= check("Malformed spec rejected", rejected);
+  return passed;
+}
+
+bool testInProcess(const std::string& dir) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Shards in process" << std::endl;
+  bool passed = true;
+  ShardedSweep sweep(dir, spec(), 64);
+  ShardedSweepOptions opt;
+  opt.workers = 0;
+  passed &= check("Ten shards, last one partial",
+                  sweep.shardCount() == 10 && sweep.shardRows(9) == 24);
+  passed &= check("All shards computed", sweep.run(opt) == 10 &&
+                                             sweep.pendingShards().empty());
+  const ShardedSweepMerge m = sweep.merge();
+  passed &= check("Catalog has every design", m.rows == 600 &&
+                                                  m.missingShards == 0);
+
+  // Reference: the same spec in one piece
+  const SweepSpec s = spec();
+  const size_t width = s.columns().size();
+  MappedResultTable catalog(dir + "/catalog.glr");
+  bool identical = catalog.columnName(0) == "design";
+  s.run(0, s.size(), [&](size_t first, const double* rows, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      identical &= catalog.value(first + i, 0) == double(first + i);
+      for (size_t c = 0; c < width; ++c)
+        identical &= same(catalog.value(first + i, c + 1), rows[i * width + c]);
+    }
+  });
+  passed &= check("Catalog bit identical to an unsharded sweep", identical);
+  passed &= check("Rerun computes nothing", sweep.run(opt) == 0);
+
+  bool rejected = false;
+  try {
+    SweepSpec other = spec();
+    other.axes[1].count = 21;
+    ShardedSweep different(dir, other, 64);
+  } catch (const std::invalid_argument&) {
+    rejected = true;
+  }
+  passed &= check("Run directory of a different sweep rejected", rejected);
+  return passed;
+}
+
+bool testPreemption(const std::string& dir, const std::string& reference) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Worker processes, pre-emption and resume" << std::endl;
+  bool passed = true;
+  ShardedSweep sweep(dir, spec(), 64);
+
+  // Workers that quit after two shards and are not restarted
+  ShardedSweepOptions opt;
+  opt.workers = 2;
+  opt.command = workerCommand(2);
+  opt.maxRestarts = 0;
+  bool failed = false;
+  try {
+    sweep.run(opt);
+  } catch (const std::runtime_error& e) {
+    failed = std::string(e.what()) == "All sweep workers failed";
+  }
+  passed &= check("Run fails once every worker is gone", failed);
+  passed &= check("Finished shards checkpointed",
+                  sweep.pendingShards().size() == 6);
+
+  const ShardedSweepMerge partial = sweep.merge();
+  passed &= check("Partial results merge", partial.rows == 4 * 64 &&
+                                               partial.missingShards == 6);
+
+  // A truncated checkpoint, as a crash inside a write would leave without
+  // the atomic rename, is not trusted
+  const std::string torn = sweep.shardPath(sweep.pendingShards()[0]);
+  if (FILE* f = std::fopen(torn.c_str(), "wb")) {
+    std::fputs("GLRSTOR1", f);
+    std::fclose(f);
+  }
+  passed &= check("Torn shard file counts as pending",
+                  sweep.pendingShards().size() == 6);
+
+  // Resume with workers pre-empted every three shards but restarted
+  ShardedSweep resumed(dir, spec(), 64);
+  opt.workers = 3;
+  opt.command = workerCommand(3);
+  opt.maxRestarts = 5;
+  size_t progressCalls = 0;
+  opt.progress = [&](const std::string&, double) { ++progressCalls; };
+  passed &= check("Resume computes only the missing shards",
+                  resumed.run(opt) == 6 && progressCalls == 6);
+
+  const std::vector<std::string> names = sweep.columns();
+  auto column = [&](const char* name) {
+    return size_t(std::find(names.begin(), names.end(), name) -
+                  names.begin());
+  };
+  const std::vector<ParetoObjective> objectives = {
+      {column("pittingSafety"), true}, {column("addendum"), false}};
+  const ShardedSweepMerge m = resumed.merge(objectives);
+  MappedResultTable catalog(dir + "/catalog.glr");
+  MappedResultTable expected(reference + "/catalog.glr");
+  passed &= check("Resumed catalog bit identical to an uninterrupted run",
+                  m.rows == 600 && sameTable(catalog, expected));
+
+  MappedResultTable pareto(dir + "/pareto.glr");
+  const size_t valid = column("valid");
+  bool front = pareto.rowCount() == m.paretoRows && m.paretoRows > 0;
+  for (size_t p = 0; p < pareto.rowCount(); ++p) {
+    front &= pareto.value(p, valid) == 1;
+    for (size_t r = 0; r < catalog.rowCount(); ++r) {
+      const double s = catalog.value(r, objectives[0].column);
+      const double a = catalog.value(r, objectives[1].column);
+      const double ps = pareto.value(p, objectives[0].column);
+      const double pa = pareto.value(p, objectives[1].column);
+      if (catalog.value(r, valid) == 1 && s >= ps && a <= pa &&
+          (s > ps || a < pa))
+        front = false;
+    }
+  }
+  std::cout << "  " << m.paretoRows << " designs on the front" << std::endl;
+  passed &= check("Pareto rows valid and not dominated", front);
+
+  opt.command = "exit 3";
+  opt.maxRestarts = 1;
+  ShardedSweep broken(dir + "_broken", spec(), 64);
+  failed = false;
+  try {
+    broken.run(opt);
+  } catch (const std::runtime_error&) {
+    failed = true;
+  }
+  passed &= check("Workers that cannot start are reported", failed);
+  removeRun(dir + "_broken");
+  return passed;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--sweep-worker") {
+    return runSweepWorker(0, 1, argc > 2 ? std::stoul(argv[2])
+                                         : size_t(-1));
+  }
+
+  const std::string reference = "test_shardedsweep_ref";
+  const std::string dir = "test_shardedsweep_run";
+  removeRun(reference);
+  removeRun(dir);
+
+  bool allPassed = true;
+  bool passed = testSpec();
+  printTestResult("Sweep spec", passed);
+  allPassed &= passed;
+  passed = testInProcess(reference);
+  printTestResult("Shards in process", passed);
+  allPassed &= passed;
+  passed = testPreemption(dir, reference);
+  printTestResult("Worker processes, pre-emption and resume", passed);
+  allPassed &= passed;
+  removeRun(reference);
+  removeRun(dir);
+
+  printTestResult("All sharded sweep tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+// test_slicing.cpp
+// Unit test for direct slicing of the analytic gear into layer contours
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/manufacturing/Slicing.hpp"
+#include "ReferencePairs.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+// Even-odd point in polygon over all contours of a layer
+bool inLayer(const SliceLayer& layer, double x, double y) {
+  bool in = false;
+  for (const Contour& c : layer.contours) {
+    for (size_t i = 0, j = c.size() - 1; i < c.size(); j = i++) {
+      if ((c[i].y > y) != (c[j].y > y) &&
+          x < (c[j].x - c[i].x) * (y - c[i].y) / (c[j].y - c[i].y) + c[i].x)
+        in = !in;
+    }
+  }
+  return in;
+}
+
+bool testLayers() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Layer contours" << std::endl;
+  SliceOptions opt;
+  opt.boreRadius = 8;
+  const ContourSlicer slicer(spiralPair().makeGear(), opt);
+
+  bool passed = true;
+  // Low layers only cut the teeth: one island per tooth
+  const SliceLayer teeth =
+      slicer.slice(slicer.layerZ(slicer.layerCount() / 10));
+  bool ccw = true;
+  for (const Contour& c : teeth.contours)
+    ccw &= contourArea(c) > 0;
+  passed &= check("One island per tooth", teeth.contours.size() == 14 && ccw);
+  passed &= check("Teeth are congruent",
+                  std::fabs(contourArea(teeth.contours.front()) -
+                            contourArea(teeth.contours.back())) < 1e-3);
+
+  // Higher layers: toothed rim around the bore
+  const SliceLayer body =
+      slicer.slice(slicer.layerZ(slicer.layerCount() / 2));
+  size_t holes = 0;
+  double area = 0;
+  for (const Contour& c : body.contours) {
+    holes += contourArea(c) < 0;
+    area += contourArea(c);
+  }
+  passed &= check("Rim and bore", body.contours.size() == 2 && holes == 1);
+  // The bore is a circle of radius 8
+  for (const Contour& c : body.contours) {
+    if (contourArea(c) < 0)
+      passed &= check("Bore area", std::fabs(-contourArea(c) - 64 * M_PI) <
+                                       0.5);
+  }
+
+  // Polygons agree with the solid at random points
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> u(-60, 60);
+  const int samples = 100000;
+  int inside = 0, mismatches = 0;
+  for (int k = 0; k < samples; ++k) {
+    const double x = u(rng), y = u(rng);
+    const bool solid = slicer.inside(x, y, body.z);
+    inside += solid;
+    mismatches += solid != inLayer(body, x, y);
+  }
+  const double sampled = 120.0 * 120.0 * inside / samples;
+  passed &= check("Area matches the solid",
+                  std::fabs(area - sampled) < 0.02 * area);
+  passed &= check("Polygons match the solid", mismatches < samples / 1000);
+
+  passed &= check("Empty above the part",
+                  slicer.slice(slicer.layerZ(slicer.layerCount()) + 1)
+                      .contours.empty());
+  return passed;
+}
+
+bool testFile() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Contour file round trip" << std::endl;
+  SliceOptions opt;
+  opt.layerHeight = 1;
+  opt.boreRadius = 5;
+  const ContourSlicer slicer(spiralPair().makeGear(), opt);
+  const std::string path = "test_slicing.glc";
+  ThreadPool pool(3);
+  const SliceStats stats = slicer.write(path, pool);
+  const std::vector<SliceLayer> layers = contourfile::read(path);
+  std::remove(path.c_str());
+
+  bool passed = true;
+  passed &= check("Layer count", layers.size() == slicer.layerCount() &&
+                                     stats.layers == layers.size());
+  size_t contours = 0, points = 0;
+  double error = 0;
+  bool ordered = true;
+  for (size_t i = 0; i < layers.size(); ++i) {
+    ordered &= std::fabs(layers[i].z - slicer.layerZ(i)) < 1e-12;
+    contours += layers[i].contours.size();
+    for (const Contour& c : layers[i].contours)
+      points += c.size();
+  }
+  const SliceLayer direct = slicer.slice(slicer.layerZ(layers.size() / 2));
+  const SliceLayer& stored = layers[layers.size() / 2];
+  passed &= check("Layers in order", ordered);
+  passed &= check("Counts match", contours == stats.contours &&
+                                      points == stats.points);
+  if (direct.contours.size() == stored.contours.size()) {
+    for (size_t c = 0; c < direct.contours.size(); ++c) {
+      for (size_t i = 0; i < direct.contours[c].size(); ++i) {
+        error = std::max(error, std::hypot(direct.contours[c][i].x -
+                                               stored.contours[c][i].x,
+                                           direct.contours[c][i].y -
+                                               stored.contours[c][i].y));
+      }
+    }
+  }
+  passed &= check("Vertices within the quantum",
+                  direct.contours.size() == stored.contours.size() &&
+                      error <= contourfile::quantum);
+  // Varint deltas: well under the 16 bytes of two doubles per point
+  passed &= check("Compact", stats.bytes < points * 6 + 64 * layers.size());
+  return passed;
+}
+
+// Header followed by the given layer records
+bool readsCorrupt(const std::string& path, uint32_t numLayers,
+                  const std::string& records) {
+  contourfile::Header h{};
+  std::memcpy(h.magic, contourfile::magic, sizeof(h.magic));
+  h.numLayers = numLayers;
+  h.quantum = contourfile::quantum;
+  h.layerHeight = 1;
+  FILE* f = std::fopen(path.c_str(), "wb");
+  std::fwrite(&h, sizeof(h), 1, f);
+  std::fwrite(records.data(), 1, records.size(), f);
+  std::fclose(f);
+  bool rejected = false;
+  try {
+    contourfile::read(path);
+  } catch (const std::runtime_error&) {
+    rejected = true;
+  }
+  std::remove(path.c_str());
+  return rejected;
+}
+
+bool testCorruptFile() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Corrupt contour files" << std::endl;
+  const std::string path = "test_slicing_corrupt.glc";
+  auto put = [](std::string& s, const void* p, size_t n) {
+    s.append(static_cast<const char*>(p), n);
+  };
+  const double z = 1;
+  const uint32_t huge = 0xffffffffu, one = 1, four = 4;
+
+  std::string manyContours;
+  put(manyContours, &z, sizeof(z));
+  put(manyContours, &huge, sizeof(huge));
+
+  std::string manyPoints;
+  put(manyPoints, &z, sizeof(z));
+  put(manyPoints, &one, sizeof(one));
+  put(manyPoints, &huge, sizeof(huge));
+  put(manyPoints, &four, sizeof(four));
+  manyPoints += std::string(4, '\0');
+
+  bool passed = true;
+  passed &= check("Layer count beyond the file rejected",
+                  readsCorrupt(path, huge, ""));
+  passed &= check("Contour count beyond the file rejected",
+                  readsCorrupt(path, 1, manyContours));
+  passed &= check("Point count beyond the contour rejected",
+                  readsCorrupt(path, 1, manyPoints));
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+  bool passed = testLayers();
+  printTestResult("Slicing layers", passed);
+  allPassed &= passed;
+  passed = testFile();
+  printTestResult("Slicing file", passed);
+  allPassed &= passed;
+  passed = testCorruptFile();
+  printTestResult("Slicing corrupt file", passed);
+  allPassed &= passed;
+
+  printTestResult("All slicing tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+// test_taskgraph.cpp
+// Unit test for the work-stealing pool and pipeline task graph
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/pipeline/Pipeline.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testOrdering() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Stage ordering and nested work" << std::endl;
+  ThreadPool pool(4);
+  TaskGraph graph;
+  std::atomic<int> step{0};
+  int paramsAt = -1, exportAt = -1;
+  std::atomic<int> gearAt{-1}, pinionAt{-1};
+  std::vector<int> teeth(200, 0);
+
+  auto params = graph.add("params",
+                          [&](TaskGraph::Context&) { paramsAt = step++; });
+  auto gear = graph.add(
+      "gear",
+      [&](TaskGraph::Context& ctx) {
+        // Per-tooth work nested inside a stage
+        ctx.pool().parallelFor(0, teeth.size(),
+                               [&](size_t i) { teeth[i] = int(i); });
+        gearAt = step++;
+      },
+      {params});
+  auto pinion = graph.add(
+      "pinion", [&](TaskGraph::Context&) { pinionAt = step++; }, {params});
+  graph.add(
+      "export", [&](TaskGraph::Context&) { exportAt = step++; },
+      {gear, pinion});
+
+  std::vector<double> progress;
+  std::mutex progressMutex;
+  graph.setProgressCallback([&](const std::string&, double f) {
+    std::lock_guard<std::mutex> lock(progressMutex);
+    progress.push_back(f);
+  });
+  graph.run(pool);
+
+  bool passed = true;
+  passed &= check("Params first", paramsAt == 0);
+  passed &= check("Export last", exportAt == 3);
+  passed &= check("Branches between", gearAt > 0 && pinionAt > 0 &&
+                                          gearAt < 3 && pinionAt < 3);
+  bool teethDone = true;
+  for (size_t i = 0; i < teeth.size(); ++i)
+    teethDone &= teeth[i] == int(i);
+  passed &= check("Nested per-tooth work completed", teethDone);
+  passed &= check("Progress reaches 1",
+                  !progress.empty() && std::fabs(progress.back() - 1) < 1e-12);
+  return passed;
+}
+
+bool testCancellationAndErrors() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Cancellation and errors" << std::endl;
+  ThreadPool pool(2);
+  bool passed = true;
+
+  CancellationToken token;
+  bool downstreamRan = false;
+  TaskGraph cancelled;
+  auto first = cancelled.add("first",
+                             [&](TaskGraph::Context&) { token.cancel(); });
+  cancelled.add(
+      "second", [&](TaskGraph::Context&) { downstreamRan = true; }, {first});
+  bool threwCancelled = false;
+  try {
+    cancelled.run(pool, token);
+  } catch (const JobCancelled&) {
+    threwCancelled = true;
+  }
+  passed &= check("Cancelled job throws JobCancelled", threwCancelled);
+  passed &= check("Stages after cancel are skipped", !downstreamRan);
+
+  TaskGraph failing;
+  failing.add("bad", [](TaskGraph::Context&) {
+    throw std::runtime_error("stage failed");
+  });
+  bool threwError = false;
+  try {
+    failing.run(pool);
+  } catch (const std::runtime_error& e) {
+    threwError = std::string(e.what()) == "stage failed";
+  }
+  passed &= check("Stage exception reaches caller", threwError);
+  return passed;
+}
+
+bool testSweep() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Pair sweep on the shared pool" << std::endl;
+  std::vector<BevelGearPair> designs;
+  for (int i = 0; i < 500; ++i) {
+    designs.emplace_back(11 + i % 20, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0,
+                         -0.74, 19.43, 60, 20);
+  }
+  auto results = runPairSweep(designs);
+  bool same = results.size() == designs.size();
+  for (size_t i = 0; i < results.size() && same; ++i) {
+    same = results[i].gear && results[i].pinion &&
+           results[i].gear->addendum == designs[i].addendum &&
+           results[i].pinion->rootConeOffset == designs[i].pinionRootConeOffset;
+  }
+  return check("Sweep matches direct construction", same);
+}
+
+int main() {
+  bool passed = testOrdering();
+  passed &= testCancellationAndErrors();
+  passed &= testSweep();
+  printTestResult("All task graph tests", passed);
+  if (!passed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
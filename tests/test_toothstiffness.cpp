@@ -0,0 +1,184 @@
+// test_toothstiffness.cpp
+// Unit test for the reduced-order tooth stiffness and root stress model
+
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../src/analysis/ToothStiffness.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+bool testStiffness(const std::string& testName, const BevelGearPair& pair) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << testName
+            << std::endl;
+  const ToothStiffnessModel model(pair);
+  const double cycle = model.meshCycle();
+  const double eng = model.engagement();
+
+  bool passed = true;
+  passed &= check("Engagement longer than one mesh cycle", eng > cycle);
+  passed &= check("No stiffness before engagement",
+                  model.singleStiffness(-1) == 0);
+  passed &= check("No stiffness after engagement",
+                  model.singleStiffness(eng + 1) == 0);
+  passed &= check("Stiff in mid engagement",
+                  model.singleStiffness(eng / 2) > 0);
+
+  double periodic = 0, lo = 1e300, hi = 0;
+  for (int i = 0; i < 50; ++i) {
+    const double a = cycle * i / 50;
+    const double k = model.meshStiffness(a);
+    periodic = std::fmax(periodic,
+                         std::fabs(k - model.meshStiffness(a + 3 * cycle)));
+    lo = std::fmin(lo, k);
+    hi = std::fmax(hi, k);
+    passed &= k >= model.singleStiffness(a);
+  }
+  passed &= check("Mesh stiffness periodic", periodic < 1e-6 * hi);
+  passed &= check("Mesh stiffness varies over the cycle", hi > lo);
+  // Mesh stiffness per face width in N/(mm um), typically 10 - 50 for steel
+  const double perWidth = lo / model.faceWidth() / 1000;
+  passed &= check("Plausible mesh stiffness per face width",
+                  perWidth > 5 && perWidth < 100);
+  return passed;
+}
+
+bool testLoad(const std::string& testName, const BevelGearPair& pair) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET << testName
+            << std::endl;
+  const ToothStiffnessModel model(pair);
+  const double a = model.engagement() / 2;
+  const MeshLoadState s1 = model.evaluate(a, 1000);
+  const MeshLoadState s2 = model.evaluate(a, 2000);
+
+  bool passed = true;
+  passed &= check("Force balance",
+                  std::fabs(s1.deflection * s1.stiffness - 1000) < 1e-6);
+  passed &= check("Root stress linear in load",
+                  std::fabs(s2.pinionRootStress - 2 * s1.pinionRootStress) <
+                      1e-9 * s2.pinionRootStress);
+  passed &= check("Pair in contact", s1.pairsInContact >= 1);
+  // Shortly after a new pair engages, the previous one is still in mesh
+  passed &= check("Load shared at engagement",
+                  model.evaluate(0.01 * model.meshCycle(), 1000)
+                          .pairsInContact >= 2);
+
+  const int nw = model.options().faceSlices;
+  auto total = [](const std::vector<double>& v) {
+    return std::accumulate(v.begin(), v.end(), 0.0);
+  };
+  const std::vector<double> even = model.loadDistribution(a, 1000, {});
+  passed &= check("Distribution sums to force",
+                  std::fabs(total(even) - 1000) < 1e-6);
+  const std::vector<double> shifted =
+      model.loadDistribution(a, 1000, std::vector<double>(nw, 0.01));
+  double diff = 0;
+  for (int i = 0; i < nw; ++i)
+    diff = std::fmax(diff, std::fabs(shifted[i] - even[i]));
+  passed &= check("Uniform separation leaves loads unchanged", diff < 1e-6);
+
+  // Open up the toe end: load moves towards the heel
+  std::vector<double> tilt(nw);
+  for (int i = 0; i < nw; ++i)
+    tilt[i] = 0.002 * (nw - 1 - i) / (nw - 1);
+  const std::vector<double> misaligned = model.loadDistribution(a, 1000, tilt);
+  double heelEven = 0, heelTilt = 0;
+  for (int i = nw / 2; i < nw; ++i) {
+    heelEven += even[i];
+    heelTilt += misaligned[i];
+  }
+  passed &= check("Misalignment shifts load to the heel",
+                  heelTilt > heelEven);
+  const std::vector<double> sigma = model.rootStress(a, misaligned, true);
+  passed &= check("Root stress from distribution",
+                  *std::max_element(sigma.begin(), sigma.end()) > 0);
+  return passed;
+}
+
+bool testCache(const BevelGearPair& pair) {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Model cache" << std::endl;
+  auto a = cachedToothStiffness(pair);
+  auto b = cachedToothStiffness(pair);
+  BevelGearPair other = pair;
+  other.spiralAngle += 5;
+  other.computeDerivedValues();
+  auto c = cachedToothStiffness(other);
+
+  bool passed = true;
+  passed &= check("Same geometry reuses the model", a == b);
+  passed &= check("Changed geometry builds a new model", a != c);
+
+  // A model cached by a job must not point at the job's budget, which is
+  // gone long before the cache releases the model
+  other.spiralAngle += 5;
+  other.computeDerivedValues();
+  const memory::Counter& matrices = memory::global().categories[size_t(
+      memory::Category::InfluenceMatrix)];
+  const int64_t before = matrices.current.load();
+  std::shared_ptr<const ToothStiffnessModel> d;
+  {
+    memory::Budget budget;
+    memory::BudgetScope scope(&budget);
+    d = cachedToothStiffness(other);
+    passed &= check("Cached model not charged to the job",
+                    budget.jobUsage().total.current.load() == 0);
+  }
+  passed &= check("Cached model charged globally",
+                  matrices.current.load() > before);
+  return passed;
+}
+
+int main() {
+  std::vector<BevelGearPair> refs = {
+      // assets/CAD/Gear_1.FCStd
+      BevelGearPair(11, 9, 5.593454, 0.1, 1.5, 90, 60, 40, 0, -0.74, 19.43, 60,
+                    20),
+      // assets/CAD/Gear_2.FCStd with a 30 deg spiral
+      BevelGearPair(14, 9, 4.77651, 0.1, 1.5, 90, 65, 45, 1.2, 0, 24.0405, 60,
+                    20, 30)};
+
+  bool allPassed = true;
+  for (size_t i = 0; i < refs.size(); ++i) {
+    std::string name = "Tooth stiffness, reference " + std::to_string(i + 1);
+    bool passed = testStiffness(name + " mesh stiffness", refs[i]);
+    passed &= testLoad(name + " load distribution", refs[i]);
+    printTestResult(name, passed);
+    allPassed &= passed;
+  }
+
+  const bool cached = testCache(refs[1]);
+  printTestResult("Tooth stiffness cache", cached);
+  allPassed &= cached;
+
+  printTestResult("All tooth stiffness tests", allPassed);
+  if (!allPassed)
+    return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
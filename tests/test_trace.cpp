@@ -0,0 +1,205 @@
+// test_trace.cpp
+// Unit test for the scoped trace markers and the Chrome trace dump
+
+#ifndef GEARLAB_ENABLE_TRACING
+#define GEARLAB_ENABLE_TRACING
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/io/Json.hpp"
+#include "../src/pipeline/ThreadPool.hpp"
+#include "../src/pipeline/Trace.hpp"
+
+#define COLOR_RESET "\033[0m"
+#define COLOR_RED "\033[31m"
+#define COLOR_GREEN "\033[32m"
+#define COLOR_YELLOW "\033[33m"
+
+bool check(const std::string& name, bool condition) {
+  if (!condition) {
+    std::cout << COLOR_RED << " ❌ Check failed: " << name << COLOR_RESET
+              << std::endl;
+    return false;
+  }
+  std::cout << COLOR_GREEN << " ✅ Check passed: " << name << COLOR_RESET
+            << std::endl;
+  return true;
+}
+
+void printTestResult(const std::string& testName, bool passed) {
+  if (passed) {
+    std::cout << COLOR_GREEN << "[PASS] " << COLOR_RESET << testName
+              << std::endl;
+  } else {
+    std::cout << COLOR_RED << "[FAIL] " << COLOR_RESET << testName << std::endl;
+  }
+}
+
+struct Span {
+  std::string name;
+  unsigned tid;
+  double ts, dur;
+
+  // Times are written in microseconds with three decimals
+  bool contains(const Span& s) const {
+    const double eps = 0.002;
+    return s.ts >= ts - eps && s.ts + s.dur <= ts + dur + eps;
+  }
+};
+
+struct Dump {
+  std::vector<Span> spans;
+  std::map<unsigned, std::string> threadNames;
+};
+
+// Write the trace and read it back through the JSON parser, so the test
+// also covers that the dump is valid JSON
+Dump readDump(const std::string& path) {
+  Dump d;
+  if (!trace::dumpChromeTrace(path))
+    return d;
+  std::ifstream in(path);
+  std::stringstream text;
+  text << in.rdbuf();
+  const json::Value doc = json::parse(text.str());
+  const json::Value* events = doc.find("traceEvents");
+  if (!events)
+    return d;
+  for (const json::Value& e : events->items()) {
+    const unsigned tid = unsigned(e.find("tid")->asNumber());
+    if (e.find("ph")->asString() == "M") {
+      d.threadNames[tid] = e.find("args")->find("name")->asString();
+    } else {
+      d.spans.push_back({e.find("name")->asString(), tid,
+                         e.find("ts")->asNumber(), e.find("dur")->asNumber()});
+    }
+  }
+  return d;
+}
+
+std::vector<Span> named(const Dump& d, const std::string& name) {
+  std::vector<Span> out;
+  for (const Span& s : d.spans) {
+    if (s.name == name)
+      out.push_back(s);
+  }
+  return out;
+}
+
+bool testNestedScopesAcrossThreads() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Nested scopes across pool threads" << std::endl;
+  const std::string path = "test_trace.json";
+  const size_t tasks = 24;
+  trace::setThreadName("main");
+  trace::setEnabled(true);
+  {
+    ThreadPool pool(3);
+    GEARLAB_TRACE_SCOPE("test.outer");
+    pool.parallelFor(0, tasks, [](size_t) {
+      GEARLAB_TRACE_SCOPE("test.task");
+      // Long enough that the workers take part, not only the caller
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      GEARLAB_TRACE_SCOPE("test.inner");
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    });
+  }
+  trace::setEnabled(false);
+  const Dump d = readDump(path);
+  std::remove(path.c_str());
+
+  const std::vector<Span> outer = named(d, "test.outer");
+  const std::vector<Span> task = named(d, "test.task");
+  const std::vector<Span> inner = named(d, "test.inner");
+  bool passed = true;
+  passed &= check("One outer span", outer.size() == 1);
+  passed &= check("One span per task and nested scope",
+                  task.size() == tasks && inner.size() == tasks);
+  if (outer.size() != 1 || task.size() != tasks || inner.size() != tasks)
+    return false;
+
+  passed &= check("Outer span on the named main thread",
+                  d.threadNames.count(outer[0].tid) &&
+                      d.threadNames.at(outer[0].tid) == "main");
+
+  // Each inner span has its parent task span on the same thread
+  bool parented = true;
+  for (const Span& s : inner) {
+    size_t parents = 0;
+    for (const Span& t : task)
+      parents += t.tid == s.tid && t.contains(s);
+    parented &= parents == 1;
+  }
+  passed &= check("Inner spans nested in a task on their thread", parented);
+
+  bool withinOuter = true, onWorker = false, onPoolThreads = true;
+  for (const Span& t : task) {
+    withinOuter &= outer[0].contains(t);
+    const auto name = d.threadNames.find(t.tid);
+    const bool worker = name != d.threadNames.end() &&
+                        name->second.compare(0, 7, "worker ") == 0;
+    onWorker |= worker;
+    onPoolThreads &= worker || t.tid == outer[0].tid;
+  }
+  passed &= check("Tasks run during the outer span", withinOuter);
+  passed &= check("Tasks attributed to the pool workers or the caller",
+                  onPoolThreads);
+  passed &= check("Some tasks ran on a worker thread", onWorker);
+  return passed;
+}
+
+bool testDisabledAndLongNames() {
+  std::cout << COLOR_YELLOW << "Running test: " << COLOR_RESET
+            << "Disabled markers and long names" << std::endl;
+  const std::string path = "test_trace.json";
+  const std::string longName(trace::maxNameLength + 20, 'x');
+  {
+    GEARLAB_TRACE_SCOPE("test.disabled");
+  }
+  trace::setEnabled(true);
+  {
+    // Opened while disabled, so it stays unrecorded when enabled again
+    trace::setEnabled(false);
+    GEARLAB_TRACE_SCOPE("test.late");
+    trace::setEnabled(true);
+  }
+  {
+    GEARLAB_TRACE_SCOPE(longName.c_str());
+  }
+  trace::setEnabled(false);
+  const Dump d = readDump(path);
+  std::remove(path.c_str());
+
+  bool passed = true;
+  passed &= check("Disabled scopes record nothing",
+                  named(d, "test.disabled").empty() &&
+                      named(d, "test.late").empty());
+  passed &= check("Long names truncated",
+                  named(d, longName.substr(0, trace::maxNameLength)).size() ==
+                      1);
+  return passed;
+}
+
+int main() {
+  bool allPassed = true;
+
+  bool r = testNestedScopesAcrossThreads();
+  printTestResult("Nested scopes across pool threads", r);
+  allPassed &= r;
+
+  r = testDisabledAndLongNames();
+  printTestResult("Disabled markers and long names", r);
+  allPassed &= r;
+
+  return allPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}